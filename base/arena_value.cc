@@ -0,0 +1,333 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/arena_value.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <utility>
+
+#include "base/as_const.h"
+#include "base/bits.h"
+#include "base/check_op.h"
+#include "base/containers/flat_tree.h"
+#include "base/notreached.h"
+
+namespace base {
+
+namespace {
+
+// Capacity of a list or dictionary's first storage allocation.
+constexpr size_t kInitialCapacity = 4;
+
+}  // namespace
+
+ValueArena::ValueArena() : ValueArena(kDefaultFirstBlockSize) {}
+
+ValueArena::ValueArena(size_t first_block_size)
+    : next_block_size_(std::max<size_t>(first_block_size, 64)) {}
+
+ValueArena::~ValueArena() = default;
+
+void* ValueArena::Allocate(size_t size, size_t alignment) {
+  DCHECK(bits::IsPowerOfTwo(alignment));
+  DCHECK_LE(alignment, alignof(std::max_align_t));
+
+  char* result = bits::AlignUp(current_, alignment);
+  if (!current_ || result + size > end_) {
+    AddBlock(size);
+    result = current_;
+  }
+  current_ = result + size;
+  bytes_used_ += size;
+  return result;
+}
+
+StringPiece ValueArena::CopyString(StringPiece str) {
+  if (str.empty())
+    return StringPiece();
+  char* copy = static_cast<char*>(Allocate(str.size(), 1));
+  memcpy(copy, str.data(), str.size());
+  return StringPiece(copy, str.size());
+}
+
+void ValueArena::AddBlock(size_t min_size) {
+  // Oversized requests get a block of their own, without affecting the size of
+  // the next regular block.
+  size_t block_size = std::max(next_block_size_, min_size);
+  blocks_.emplace_back(new char[block_size]);
+  current_ = blocks_.back().get();
+  end_ = current_ + block_size;
+  bytes_reserved_ += block_size;
+  next_block_size_ = std::min(next_block_size_ * 2, kMaxBlockSize);
+}
+
+ArenaValue::ArenaValue(bool in_bool) : type_(Type::BOOLEAN) {
+  data_.bool_ = in_bool;
+}
+
+ArenaValue::ArenaValue(int in_int) : type_(Type::INTEGER) {
+  data_.int_ = in_int;
+}
+
+ArenaValue::ArenaValue(double in_double) : type_(Type::DOUBLE) {
+  data_.double_ = in_double;
+}
+
+// static
+ArenaValue ArenaValue::String(ValueArena* arena, StringPiece in_string) {
+  CHECK_LE(in_string.size(), std::numeric_limits<uint32_t>::max());
+  ArenaValue value;
+  value.type_ = Type::STRING;
+  value.size_ = static_cast<uint32_t>(in_string.size());
+  if (in_string.size() <= kMaxInlineStringSize)
+    memcpy(value.data_.inline_string_, in_string.data(), in_string.size());
+  else
+    value.data_.string_ = arena->CopyString(in_string).data();
+  return value;
+}
+
+// static
+ArenaValue ArenaValue::Blob(ValueArena* arena, span<const uint8_t> in_blob) {
+  CHECK_LE(in_blob.size(), std::numeric_limits<uint32_t>::max());
+  ArenaValue value;
+  value.type_ = Type::BINARY;
+  value.size_ = static_cast<uint32_t>(in_blob.size());
+  uint8_t* copy = nullptr;
+  if (!in_blob.empty()) {
+    copy = static_cast<uint8_t*>(arena->Allocate(in_blob.size(), 1));
+    memcpy(copy, in_blob.data(), in_blob.size());
+  }
+  value.data_.blob_ = copy;
+  return value;
+}
+
+// static
+ArenaValue ArenaValue::List() {
+  ArenaValue value;
+  value.type_ = Type::LIST;
+  value.data_.list_.elements = nullptr;
+  value.data_.list_.capacity = 0;
+  return value;
+}
+
+// static
+ArenaValue ArenaValue::Dict() {
+  ArenaValue value;
+  value.type_ = Type::DICTIONARY;
+  value.data_.dict_.entries = nullptr;
+  value.data_.dict_.capacity = 0;
+  return value;
+}
+
+// static
+ArenaValue ArenaValue::FromValue(ValueArena* arena, const Value& value) {
+  switch (value.type()) {
+    case Type::NONE:
+      return ArenaValue();
+    case Type::BOOLEAN:
+      return ArenaValue(value.GetBool());
+    case Type::INTEGER:
+      return ArenaValue(value.GetInt());
+    case Type::DOUBLE:
+      return ArenaValue(value.GetDouble());
+    case Type::STRING:
+      return String(arena, value.GetString());
+    case Type::BINARY:
+      return Blob(arena, value.GetBlob());
+    case Type::LIST: {
+      ArenaValue list = List();
+      Value::ConstListView elements = value.GetList();
+      list.Reserve(arena, elements.size(), sizeof(ArenaValue));
+      for (const Value& element : elements)
+        list.data_.list_.elements[list.size_++] = FromValue(arena, element);
+      return list;
+    }
+    case Type::DICTIONARY: {
+      ArenaValue dict = Dict();
+      dict.Reserve(arena, value.DictSize(), sizeof(DictEntry));
+      // Value's dictionaries are already sorted by key, so entries can be
+      // appended directly.
+      for (auto item : value.DictItems()) {
+        DictEntry& entry = dict.data_.dict_.entries[dict.size_++];
+        entry.key = arena->CopyString(item.first);
+        entry.value = FromValue(arena, item.second);
+      }
+      return dict;
+    }
+  }
+  NOTREACHED();
+  return ArenaValue();
+}
+
+Value ArenaValue::ToValue() const {
+  switch (type_) {
+    case Type::NONE:
+      return Value();
+    case Type::BOOLEAN:
+      return Value(data_.bool_);
+    case Type::INTEGER:
+      return Value(data_.int_);
+    case Type::DOUBLE:
+      return Value(data_.double_);
+    case Type::STRING:
+      return Value(GetString());
+    case Type::BINARY:
+      return Value(GetBlob());
+    case Type::LIST: {
+      Value::ListStorage list;
+      list.reserve(size_);
+      for (const ArenaValue& element : GetList())
+        list.push_back(element.ToValue());
+      return Value(std::move(list));
+    }
+    case Type::DICTIONARY: {
+      std::vector<std::pair<std::string, Value>> entries;
+      entries.reserve(size_);
+      for (const DictEntry& entry : DictItems())
+        entries.emplace_back(std::string(entry.key), entry.value.ToValue());
+      return Value(Value::DictStorage(sorted_unique, std::move(entries)));
+    }
+  }
+  NOTREACHED();
+  return Value();
+}
+
+bool ArenaValue::GetBool() const {
+  CHECK(is_bool());
+  return data_.bool_;
+}
+
+int ArenaValue::GetInt() const {
+  CHECK(is_int());
+  return data_.int_;
+}
+
+double ArenaValue::GetDouble() const {
+  if (is_int())
+    return data_.int_;
+  CHECK(is_double());
+  return data_.double_;
+}
+
+StringPiece ArenaValue::GetString() const {
+  CHECK(is_string());
+  if (size_ <= kMaxInlineStringSize)
+    return StringPiece(data_.inline_string_, size_);
+  return StringPiece(data_.string_, size_);
+}
+
+span<const uint8_t> ArenaValue::GetBlob() const {
+  CHECK(is_blob());
+  return span<const uint8_t>(data_.blob_, size_);
+}
+
+span<const ArenaValue> ArenaValue::GetList() const {
+  CHECK(is_list());
+  return span<const ArenaValue>(data_.list_.elements, size_);
+}
+
+span<ArenaValue> ArenaValue::GetList() {
+  CHECK(is_list());
+  return span<ArenaValue>(data_.list_.elements, size_);
+}
+
+void ArenaValue::Append(ValueArena* arena, ArenaValue value) {
+  CHECK(is_list());
+  Reserve(arena, size_ + 1, sizeof(ArenaValue));
+  data_.list_.elements[size_++] = value;
+}
+
+span<const ArenaValue::DictEntry> ArenaValue::DictItems() const {
+  CHECK(is_dict());
+  return span<const DictEntry>(data_.dict_.entries, size_);
+}
+
+const ArenaValue* ArenaValue::FindKey(StringPiece key) const {
+  span<const DictEntry> entries = DictItems();
+  auto it = std::lower_bound(
+      entries.begin(), entries.end(), key,
+      [](const DictEntry& entry, StringPiece key) { return entry.key < key; });
+  if (it == entries.end() || it->key != key)
+    return nullptr;
+  return &it->value;
+}
+
+ArenaValue* ArenaValue::FindKey(StringPiece key) {
+  return const_cast<ArenaValue*>(as_const(*this).FindKey(key));
+}
+
+const ArenaValue* ArenaValue::FindPath(
+    std::initializer_list<StringPiece> path) const {
+  const ArenaValue* current = this;
+  for (StringPiece key : path) {
+    if (!current->is_dict())
+      return nullptr;
+    current = current->FindKey(key);
+    if (!current)
+      return nullptr;
+  }
+  return current;
+}
+
+void ArenaValue::SetKey(ValueArena* arena, StringPiece key, ArenaValue value) {
+  CHECK(is_dict());
+  DictEntry* begin = data_.dict_.entries;
+  DictEntry* end = begin + size_;
+  DictEntry* it = std::lower_bound(
+      begin, end, key,
+      [](const DictEntry& entry, StringPiece key) { return entry.key < key; });
+  if (it != end && it->key == key) {
+    it->value = value;
+    return;
+  }
+
+  size_t index = it - begin;
+  Reserve(arena, size_ + 1, sizeof(DictEntry));
+  DictEntry* entries = data_.dict_.entries;
+  memmove(entries + index + 1, entries + index,
+          (size_ - index) * sizeof(DictEntry));
+  entries[index].key = arena->CopyString(key);
+  entries[index].value = value;
+  ++size_;
+}
+
+size_t ArenaValue::size() const {
+  CHECK(is_list() || is_dict());
+  return size_;
+}
+
+void ArenaValue::Reserve(ValueArena* arena,
+                         size_t min_capacity,
+                         size_t element_size) {
+  DCHECK(is_list() || is_dict());
+  // The list and dictionary representations have the same layout.
+  static_assert(offsetof(decltype(data_), list_.capacity) ==
+                    offsetof(decltype(data_), dict_.capacity),
+                "list and dictionary capacity must alias");
+  uint32_t capacity = data_.list_.capacity;
+  if (min_capacity <= capacity)
+    return;
+
+  CHECK_LE(min_capacity, std::numeric_limits<uint32_t>::max() / 2);
+  size_t new_capacity =
+      std::max({min_capacity, kInitialCapacity, size_t{capacity} * 2});
+  void* storage = arena->Allocate(new_capacity * element_size,
+                                  alignof(std::max_align_t));
+  // The old storage is abandoned; it is reclaimed with the arena.
+  if (size_)
+    memcpy(storage, data_.list_.elements, size_ * element_size);
+  if (is_list()) {
+    data_.list_.elements = static_cast<ArenaValue*>(storage);
+    data_.list_.capacity = static_cast<uint32_t>(new_capacity);
+  } else {
+    data_.dict_.entries = static_cast<DictEntry*>(storage);
+    data_.dict_.capacity = static_cast<uint32_t>(new_capacity);
+  }
+}
+
+}  // namespace base
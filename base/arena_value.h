@@ -0,0 +1,192 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+// ArenaValue is an opt-in, arena-allocated alternative to base::Value for code
+// that builds large Value trees only to walk them once and throw them away,
+// e.g. while parsing manifests or pref files.
+//
+// Every heap-backed part of an ArenaValue (long strings, blobs, list and
+// dictionary storage) is carved out of a ValueArena with a bump allocator, and
+// is freed all at once when the arena is destroyed. Strings of up to
+// ArenaValue::kMaxInlineStringSize bytes are stored inline in the node and do
+// not touch the arena at all. Individual nodes are never freed, so the arena
+// only grows; use one arena per parse, not per long-lived object.
+//
+// ArenaValue is trivially copyable: copying one copies the 24-byte node, and
+// the copy shares any arena storage with the original. It does not track which
+// arena it belongs to, so every mutating method takes the arena explicitly,
+// and it must be the arena the value was created in.
+//
+// Convert to and from base::Value at API boundaries:
+//
+//   ValueArena arena;
+//   ArenaValue manifest = ArenaValue::FromValue(&arena, parsed_value);
+//   ... walk |manifest| ...
+//   base::Value for_prefs = manifest.FindKey("settings")->ToValue();
+
+#ifndef BASE_ARENA_VALUE_H_
+#define BASE_ARENA_VALUE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <initializer_list>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/containers/span.h"
+#include "base/strings/string_piece.h"
+#include "base/values.h"
+
+namespace base {
+
+// Owns the storage of a tree of ArenaValues. Not thread-safe.
+class BASE_EXPORT ValueArena {
+ public:
+  // Size of the first block; subsequent blocks double in size up to
+  // kMaxBlockSize.
+  static constexpr size_t kDefaultFirstBlockSize = 4096;
+  static constexpr size_t kMaxBlockSize = 1 << 20;
+
+  ValueArena();
+  explicit ValueArena(size_t first_block_size);
+  ValueArena(const ValueArena&) = delete;
+  ValueArena& operator=(const ValueArena&) = delete;
+  ~ValueArena();
+
+  // Returns |size| bytes aligned to |alignment|, which must be a power of two
+  // no larger than alignof(std::max_align_t). The memory is uninitialized and
+  // lives as long as the arena.
+  void* Allocate(size_t size, size_t alignment);
+
+  // Copies |str| into the arena and returns the copy.
+  StringPiece CopyString(StringPiece str);
+
+  // Total bytes handed out by Allocate().
+  size_t bytes_used() const { return bytes_used_; }
+  // Total bytes obtained from the system allocator.
+  size_t bytes_reserved() const { return bytes_reserved_; }
+  // Number of system allocations made, i.e. blocks.
+  size_t block_count() const { return blocks_.size(); }
+
+ private:
+  void AddBlock(size_t min_size);
+
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  char* current_ = nullptr;
+  char* end_ = nullptr;
+  size_t next_block_size_;
+  size_t bytes_used_ = 0;
+  size_t bytes_reserved_ = 0;
+};
+
+class BASE_EXPORT ArenaValue {
+ public:
+  using Type = Value::Type;
+  struct DictEntry;
+
+  // Strings up to this many bytes are stored inline.
+  static constexpr size_t kMaxInlineStringSize = 16;
+
+  // Constructs a NONE value.
+  ArenaValue() = default;
+  explicit ArenaValue(bool in_bool);
+  explicit ArenaValue(int in_int);
+  explicit ArenaValue(double in_double);
+  // Disallow conversion of pointers (e.g. string literals) to bool.
+  template <typename T>
+  explicit ArenaValue(T* ptr) = delete;
+
+  // Values that may need arena storage are created by these.
+  static ArenaValue String(ValueArena* arena, StringPiece in_string);
+  static ArenaValue Blob(ValueArena* arena, span<const uint8_t> in_blob);
+  static ArenaValue List();
+  static ArenaValue Dict();
+
+  // Deep-converts |value| into |arena|.
+  static ArenaValue FromValue(ValueArena* arena, const Value& value);
+  // Deep-converts this value back to a base::Value.
+  Value ToValue() const;
+
+  Type type() const { return type_; }
+  bool is_none() const { return type_ == Type::NONE; }
+  bool is_bool() const { return type_ == Type::BOOLEAN; }
+  bool is_int() const { return type_ == Type::INTEGER; }
+  bool is_double() const { return type_ == Type::DOUBLE; }
+  bool is_string() const { return type_ == Type::STRING; }
+  bool is_blob() const { return type_ == Type::BINARY; }
+  bool is_dict() const { return type_ == Type::DICTIONARY; }
+  bool is_list() const { return type_ == Type::LIST; }
+
+  // These CHECK that the value has the corresponding type, except that
+  // GetDouble() also accepts integers, like Value::GetDouble().
+  bool GetBool() const;
+  int GetInt() const;
+  double GetDouble() const;
+  // The returned StringPiece points into this node for inline strings, so it
+  // is only valid as long as this particular ArenaValue is.
+  StringPiece GetString() const;
+  span<const uint8_t> GetBlob() const;
+
+  // Lists. These CHECK that the value is a list. Appending may move the
+  // elements, invalidating pointers into the list.
+  span<const ArenaValue> GetList() const;
+  span<ArenaValue> GetList();
+  void Append(ValueArena* arena, ArenaValue value);
+
+  // Dictionaries. These CHECK that the value is a dictionary. Entries are kept
+  // sorted by key, like Value's flat_map, so lookups are O(log n). Inserting a
+  // new key may move the entries, invalidating pointers into the dictionary.
+  span<const DictEntry> DictItems() const;
+  const ArenaValue* FindKey(StringPiece key) const;
+  ArenaValue* FindKey(StringPiece key);
+  // Follows |path| of nested dictionary keys, like Value::FindPath() without
+  // the dotted syntax.
+  const ArenaValue* FindPath(std::initializer_list<StringPiece> path) const;
+  void SetKey(ValueArena* arena, StringPiece key, ArenaValue value);
+
+  // Number of elements of a list or entries of a dictionary.
+  size_t size() const;
+
+ private:
+  // Grows list or dictionary storage so it can hold at least |min_capacity|
+  // elements of |element_size| bytes.
+  void Reserve(ValueArena* arena, size_t min_capacity, size_t element_size);
+
+  Type type_ = Type::NONE;
+  // Length of strings and blobs, or number of list or dictionary elements.
+  uint32_t size_ = 0;
+  union {
+    bool bool_;
+    int int_;
+    double double_;
+    char inline_string_[kMaxInlineStringSize];
+    const char* string_;
+    const uint8_t* blob_;
+    struct {
+      ArenaValue* elements;
+      uint32_t capacity;
+    } list_;
+    struct {
+      DictEntry* entries;
+      uint32_t capacity;
+    } dict_;
+  } data_ = {};
+};
+
+struct ArenaValue::DictEntry {
+  StringPiece key;
+  ArenaValue value;
+};
+
+static_assert(std::is_trivially_copyable<ArenaValue>::value,
+              "ArenaValue nodes are copied with memcpy when storage grows");
+static_assert(std::is_trivially_destructible<ArenaValue>::value,
+              "ValueArena never runs destructors");
+
+}  // namespace base
+
+#endif  // BASE_ARENA_VALUE_H_
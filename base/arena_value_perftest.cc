@@ -0,0 +1,164 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/arena_value.h"
+
+#include <string>
+
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/timer/elapsed_timer.h"
+#include "base/values.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace base {
+
+namespace {
+
+constexpr char kMetricPrefixArenaValue[] = "ArenaValue.";
+constexpr char kMetricBuildTime[] = "build_and_walk_time";
+constexpr char kMetricArenaBytes[] = "arena_bytes";
+constexpr char kMetricArenaBlocks[] = "arena_blocks";
+
+// Number of extension-manifest-like entries per tree; roughly the size of a
+// large Preferences file.
+constexpr int kNumEntries = 2000;
+constexpr int kIterations = 20;
+
+perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixArenaValue, story_name);
+  reporter.RegisterImportantMetric(kMetricBuildTime, "ms");
+  reporter.RegisterFyiMetric(kMetricArenaBytes, "bytes");
+  reporter.RegisterFyiMetric(kMetricArenaBlocks, "count");
+  return reporter;
+}
+
+// Builds a dictionary shaped like extension settings in Preferences: one entry
+// per extension id, each holding a manifest with nested lists and dicts and a
+// mix of short and long strings.
+Value BuildValueTree() {
+  Value root(Value::Type::DICTIONARY);
+  for (int i = 0; i < kNumEntries; ++i) {
+    Value manifest(Value::Type::DICTIONARY);
+    manifest.SetKey("name", Value(StringPrintf("Extension number %d", i)));
+    manifest.SetKey("version", Value("1.0." + NumberToString(i)));
+    manifest.SetKey("manifest_version", Value(3));
+    Value permissions(Value::Type::LIST);
+    for (const char* permission : {"tabs", "storage", "https://*.example.com/*",
+                                   "webRequest", "notifications"}) {
+      permissions.Append(permission);
+    }
+    manifest.SetKey("permissions", std::move(permissions));
+
+    Value entry(Value::Type::DICTIONARY);
+    entry.SetKey("manifest", std::move(manifest));
+    entry.SetKey("state", Value(1));
+    entry.SetKey("install_time", Value("13245678901234567"));
+    entry.SetKey("was_installed_by_default", Value(false));
+    root.SetKey(StringPrintf("abcdefghijklmnopabcdefghijk%05d", i),
+                std::move(entry));
+  }
+  return root;
+}
+
+// Same as BuildValueTree(), with ArenaValues.
+ArenaValue BuildArenaTree(ValueArena* arena) {
+  ArenaValue root = ArenaValue::Dict();
+  for (int i = 0; i < kNumEntries; ++i) {
+    ArenaValue manifest = ArenaValue::Dict();
+    manifest.SetKey(arena, "name",
+                    ArenaValue::String(
+                        arena, StringPrintf("Extension number %d", i)));
+    manifest.SetKey(arena, "version",
+                    ArenaValue::String(arena, "1.0." + NumberToString(i)));
+    manifest.SetKey(arena, "manifest_version", ArenaValue(3));
+    ArenaValue permissions = ArenaValue::List();
+    for (const char* permission : {"tabs", "storage", "https://*.example.com/*",
+                                   "webRequest", "notifications"}) {
+      permissions.Append(arena, ArenaValue::String(arena, permission));
+    }
+    manifest.SetKey(arena, "permissions", permissions);
+
+    ArenaValue entry = ArenaValue::Dict();
+    entry.SetKey(arena, "manifest", manifest);
+    entry.SetKey(arena, "state", ArenaValue(1));
+    entry.SetKey(arena, "install_time",
+                 ArenaValue::String(arena, "13245678901234567"));
+    entry.SetKey(arena, "was_installed_by_default", ArenaValue(false));
+    root.SetKey(arena, StringPrintf("abcdefghijklmnopabcdefghijk%05d", i),
+                entry);
+  }
+  return root;
+}
+
+// Walks a tree the way a consumer would, touching every leaf.
+size_t Walk(const Value& value) {
+  size_t total = 0;
+  for (auto item : value.DictItems()) {
+    const Value* manifest = item.second.FindDictKey("manifest");
+    total += manifest->FindStringKey("name")->size();
+    total += manifest->FindListKey("permissions")->GetList().size();
+    total += *item.second.FindIntKey("state");
+  }
+  return total;
+}
+
+size_t Walk(const ArenaValue& value) {
+  size_t total = 0;
+  for (const ArenaValue::DictEntry& item : value.DictItems()) {
+    const ArenaValue* manifest = item.value.FindKey("manifest");
+    total += manifest->FindKey("name")->GetString().size();
+    total += manifest->FindKey("permissions")->size();
+    total += item.value.FindKey("state")->GetInt();
+  }
+  return total;
+}
+
+}  // namespace
+
+TEST(ArenaValuePerfTest, BuildAndWalk) {
+  size_t expected = 0;
+  {
+    ElapsedTimer timer;
+    for (int i = 0; i < kIterations; ++i)
+      expected = Walk(BuildValueTree());
+    SetUpReporter("Value").AddResult(
+        kMetricBuildTime, timer.Elapsed().InMillisecondsF() / kIterations);
+  }
+
+  size_t bytes = 0;
+  size_t blocks = 0;
+  {
+    ElapsedTimer timer;
+    for (int i = 0; i < kIterations; ++i) {
+      ValueArena arena;
+      EXPECT_EQ(expected, Walk(BuildArenaTree(&arena)));
+      bytes = arena.bytes_reserved();
+      blocks = arena.block_count();
+    }
+    perf_test::PerfResultReporter reporter = SetUpReporter("ArenaValue");
+    reporter.AddResult(kMetricBuildTime,
+                       timer.Elapsed().InMillisecondsF() / kIterations);
+    reporter.AddResult(kMetricArenaBytes, bytes);
+    reporter.AddResult(kMetricArenaBlocks, blocks);
+  }
+}
+
+// Measures the cost of the API boundary: converting a parsed Value into an
+// arena and walking it.
+TEST(ArenaValuePerfTest, ConvertAndWalk) {
+  Value value = BuildValueTree();
+  size_t expected = Walk(value);
+
+  ElapsedTimer timer;
+  for (int i = 0; i < kIterations; ++i) {
+    ValueArena arena;
+    EXPECT_EQ(expected, Walk(ArenaValue::FromValue(&arena, value)));
+  }
+  SetUpReporter("FromValue").AddResult(
+      kMetricBuildTime, timer.Elapsed().InMillisecondsF() / kIterations);
+}
+
+}  // namespace base
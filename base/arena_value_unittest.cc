@@ -0,0 +1,161 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/arena_value.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/strings/string_number_conversions.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+TEST(ArenaValueTest, Scalars) {
+  EXPECT_TRUE(ArenaValue().is_none());
+  EXPECT_TRUE(ArenaValue(true).GetBool());
+  EXPECT_EQ(-7, ArenaValue(-7).GetInt());
+  EXPECT_EQ(2.5, ArenaValue(2.5).GetDouble());
+  // Integers can be read as doubles, like with Value.
+  EXPECT_EQ(3.0, ArenaValue(3).GetDouble());
+  EXPECT_EQ(24u, sizeof(ArenaValue));
+}
+
+TEST(ArenaValueTest, Strings) {
+  ValueArena arena;
+  const std::string short_string(ArenaValue::kMaxInlineStringSize, 's');
+  const std::string long_string(ArenaValue::kMaxInlineStringSize + 1, 'l');
+
+  ArenaValue empty = ArenaValue::String(&arena, "");
+  ArenaValue inline_value = ArenaValue::String(&arena, short_string);
+  // Short strings do not use the arena.
+  EXPECT_EQ(0u, arena.bytes_used());
+  ArenaValue arena_value = ArenaValue::String(&arena, long_string);
+  EXPECT_EQ(long_string.size(), arena.bytes_used());
+
+  EXPECT_EQ("", empty.GetString());
+  EXPECT_EQ(short_string, inline_value.GetString());
+  EXPECT_EQ(long_string, arena_value.GetString());
+  // The arena holds a copy.
+  EXPECT_NE(long_string.data(), arena_value.GetString().data());
+}
+
+TEST(ArenaValueTest, Blob) {
+  ValueArena arena;
+  const std::vector<uint8_t> bytes = {0, 1, 2, 0xff};
+  ArenaValue blob = ArenaValue::Blob(&arena, bytes);
+  EXPECT_EQ(bytes, std::vector<uint8_t>(blob.GetBlob().begin(),
+                                        blob.GetBlob().end()));
+  EXPECT_TRUE(ArenaValue::Blob(&arena, {}).GetBlob().empty());
+}
+
+TEST(ArenaValueTest, List) {
+  ValueArena arena;
+  ArenaValue list = ArenaValue::List();
+  EXPECT_EQ(0u, list.size());
+  for (int i = 0; i < 100; ++i)
+    list.Append(&arena, ArenaValue(i));
+  ASSERT_EQ(100u, list.size());
+  int expected = 0;
+  for (const ArenaValue& element : list.GetList())
+    EXPECT_EQ(expected++, element.GetInt());
+
+  list.GetList()[5] = ArenaValue(false);
+  EXPECT_FALSE(list.GetList()[5].GetBool());
+}
+
+TEST(ArenaValueTest, Dict) {
+  ValueArena arena;
+  ArenaValue dict = ArenaValue::Dict();
+  dict.SetKey(&arena, "b", ArenaValue(2));
+  dict.SetKey(&arena, "c", ArenaValue(3));
+  dict.SetKey(&arena, "a", ArenaValue(1));
+  dict.SetKey(&arena, "b", ArenaValue::String(&arena, "two"));
+  ASSERT_EQ(3u, dict.size());
+
+  // Entries are sorted by key.
+  std::vector<std::string> keys;
+  for (const ArenaValue::DictEntry& entry : dict.DictItems())
+    keys.emplace_back(entry.key);
+  EXPECT_EQ((std::vector<std::string>{"a", "b", "c"}), keys);
+
+  EXPECT_EQ(1, dict.FindKey("a")->GetInt());
+  EXPECT_EQ("two", dict.FindKey("b")->GetString());
+  EXPECT_EQ(nullptr, dict.FindKey("d"));
+
+  *dict.FindKey("c") = ArenaValue(4);
+  EXPECT_EQ(4, dict.FindKey("c")->GetInt());
+
+  // Many keys, inserted out of order.
+  ArenaValue big = ArenaValue::Dict();
+  for (int i = 0; i < 200; ++i) {
+    big.SetKey(&arena, NumberToString((i * 7919) % 200), ArenaValue(i));
+  }
+  ASSERT_EQ(200u, big.size());
+  for (int i = 0; i < 200; ++i)
+    EXPECT_EQ(i, big.FindKey(NumberToString((i * 7919) % 200))->GetInt());
+}
+
+TEST(ArenaValueTest, FindPath) {
+  ValueArena arena;
+  ArenaValue inner = ArenaValue::Dict();
+  inner.SetKey(&arena, "leaf", ArenaValue(true));
+  ArenaValue outer = ArenaValue::Dict();
+  outer.SetKey(&arena, "inner", inner);
+  outer.SetKey(&arena, "scalar", ArenaValue(1));
+
+  ASSERT_TRUE(outer.FindPath({"inner", "leaf"}));
+  EXPECT_TRUE(outer.FindPath({"inner", "leaf"})->GetBool());
+  EXPECT_FALSE(outer.FindPath({"inner", "missing"}));
+  EXPECT_FALSE(outer.FindPath({"scalar", "leaf"}));
+  EXPECT_EQ(&outer, outer.FindPath({}));
+}
+
+TEST(ArenaValueTest, ValueRoundTrip) {
+  Value::ListStorage list;
+  list.emplace_back(1);
+  list.emplace_back("a string long enough not to be stored inline");
+  list.emplace_back(std::vector<uint8_t>{1, 2, 3});
+  list.emplace_back();
+
+  Value nested(Value::Type::DICTIONARY);
+  nested.SetKey("double", Value(1.5));
+  nested.SetKey("bool", Value(false));
+
+  Value value(Value::Type::DICTIONARY);
+  value.SetKey("list", Value(std::move(list)));
+  value.SetKey("nested", std::move(nested));
+  value.SetKey("empty_dict", Value(Value::Type::DICTIONARY));
+  value.SetKey("empty_list", Value(Value::Type::LIST));
+
+  ValueArena arena;
+  ArenaValue arena_value = ArenaValue::FromValue(&arena, value);
+  ASSERT_TRUE(arena_value.is_dict());
+  EXPECT_EQ(4u, arena_value.size());
+  EXPECT_EQ(1.5, arena_value.FindPath({"nested", "double"})->GetDouble());
+  EXPECT_EQ("a string long enough not to be stored inline",
+            arena_value.FindKey("list")->GetList()[1].GetString());
+
+  EXPECT_EQ(value, arena_value.ToValue());
+}
+
+TEST(ArenaValueTest, ArenaBlocks) {
+  ValueArena arena(128);
+  EXPECT_EQ(0u, arena.block_count());
+  arena.Allocate(100, 1);
+  EXPECT_EQ(1u, arena.block_count());
+  // Does not fit in the rest of the first block.
+  arena.Allocate(100, 1);
+  EXPECT_EQ(2u, arena.block_count());
+  // Oversized allocations get their own block.
+  void* big = arena.Allocate(100000, 8);
+  EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(big) % 8);
+  EXPECT_EQ(3u, arena.block_count());
+  EXPECT_EQ(100200u, arena.bytes_used());
+  EXPECT_GE(arena.bytes_reserved(), arena.bytes_used());
+}
+
+}  // namespace base
@@ -6,39 +6,108 @@
 
 #include <stddef.h>
 
+#include "build/build_config.h"
 #include "third_party/modp_b64/modp_b64.h"
 
+#if defined(ARCH_CPU_X86_FAMILY)
+#include "base/base64_ssse3.h"
+#include "base/cpu.h"
+#endif
+
 namespace base {
 
-std::string Base64Encode(span<const uint8_t> input) {
+namespace {
+
+// Returns true if the SIMD kernels can be used on this machine.
+bool CanUseSimd() {
+#if defined(ARCH_CPU_X86_FAMILY)
+  static const bool has_ssse3 = CPU().has_ssse3();
+  return has_ssse3;
+#else
+  return false;
+#endif
+}
+
+// The SIMD kernels handle a prefix of whole blocks, and modp_b64 the rest.
+// Since every group of 3 bytes or 4 characters is coded on its own, this gives
+// the same results, and the same errors, as running modp_b64 on everything.
+std::string Base64EncodeImpl(span<const uint8_t> input, bool use_simd) {
   std::string output;
   output.resize(modp_b64_encode_len(input.size()));  // makes room for null byte
 
-  // modp_b64_encode_len() returns at least 1, so output[0] is safe to use.
-  const size_t output_size = modp_b64_encode(
-      &(output[0]), reinterpret_cast<const char*>(input.data()), input.size());
+  size_t input_done = 0;
+  size_t output_size = 0;
+#if defined(ARCH_CPU_X86_FAMILY)
+  if (use_simd) {
+    input_done = internal::Base64EncodeSSSE3(input.data(), input.size(),
+                                             &(output[0]));
+    output_size = input_done / 3 * 4;
+  }
+#endif
+
+  // modp_b64_encode_len() returns at least 1, and the SIMD kernel leaves room
+  // for the rest of the output and the null byte, so this is safe to use.
+  output_size += modp_b64_encode(
+      &(output[output_size]),
+      reinterpret_cast<const char*>(input.data()) + input_done,
+      input.size() - input_done);
 
   output.resize(output_size);
   return output;
 }
 
-void Base64Encode(const StringPiece& input, std::string* output) {
-  *output = Base64Encode(base::as_bytes(base::make_span(input)));
-}
-
-bool Base64Decode(const StringPiece& input, std::string* output) {
+bool Base64DecodeImpl(const StringPiece& input,
+                      std::string* output,
+                      bool use_simd) {
   std::string temp;
   temp.resize(modp_b64_decode_len(input.size()));
 
+  size_t input_done = 0;
+  size_t output_size = 0;
+#if defined(ARCH_CPU_X86_FAMILY)
+  if (use_simd) {
+    input_done = internal::Base64DecodeSSSE3(
+        input.data(), input.size(), reinterpret_cast<uint8_t*>(&(temp[0])));
+    output_size = input_done / 4 * 3;
+  }
+#endif
+
+  // The SIMD kernel leaves at least the last 8 characters, so the padding and
+  // length checks of modp_b64_decode() see the same input end.
   // does not null terminate result since result is binary data!
-  size_t input_size = input.size();
-  size_t output_size = modp_b64_decode(&(temp[0]), input.data(), input_size);
-  if (output_size == MODP_B64_ERROR)
+  const size_t tail_size =
+      modp_b64_decode(&(temp[output_size]), input.data() + input_done,
+                      input.size() - input_done);
+  if (tail_size == MODP_B64_ERROR)
     return false;
+  output_size += tail_size;
 
   temp.resize(output_size);
   output->swap(temp);
   return true;
 }
 
+}  // namespace
+
+std::string Base64Encode(span<const uint8_t> input) {
+  return Base64EncodeImpl(input, CanUseSimd());
+}
+
+void Base64Encode(const StringPiece& input, std::string* output) {
+  *output = Base64Encode(base::as_bytes(base::make_span(input)));
+}
+
+bool Base64Decode(const StringPiece& input, std::string* output) {
+  return Base64DecodeImpl(input, output, CanUseSimd());
+}
+
+std::string Base64EncodeScalarForTesting(span<const uint8_t> input) {
+  return Base64EncodeImpl(input, /*use_simd=*/false);
+}
+
+bool Base64DecodeScalarForTesting(const StringPiece& input,
+                                  std::string* output) {
+  return Base64DecodeImpl(input, output, /*use_simd=*/false);
+}
+
 }  // namespace base
@@ -24,6 +24,13 @@ BASE_EXPORT void Base64Encode(const StringPiece& input, std::string* output);
 // be done in-place.
 BASE_EXPORT bool Base64Decode(const StringPiece& input, std::string* output);
 
+// Same as Base64Encode() and Base64Decode(), but never use the SIMD code paths
+// picked at runtime from the CPU's features, so that tests and fuzzers can
+// check that both give the same results.
+BASE_EXPORT std::string Base64EncodeScalarForTesting(span<const uint8_t> input);
+BASE_EXPORT bool Base64DecodeScalarForTesting(const StringPiece& input,
+                                              std::string* output);
+
 }  // namespace base
 
 #endif  // BASE_BASE64_H_
@@ -5,11 +5,20 @@
 #include <string>
 
 #include "base/base64.h"
+#include "base/check_op.h"
 #include "base/strings/string_piece.h"
 
 extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   std::string decode_output;
   base::StringPiece data_piece(reinterpret_cast<const char*>(data), size);
-  base::Base64Decode(data_piece, &decode_output);
+  const bool success = base::Base64Decode(data_piece, &decode_output);
+
+  // The scalar code must accept and reject the same inputs as the SIMD code
+  // picked for this machine, and decode them to the same bytes.
+  std::string scalar_decode_output;
+  CHECK_EQ(success, base::Base64DecodeScalarForTesting(data_piece,
+                                                       &scalar_decode_output));
+  if (success)
+    CHECK_EQ(decode_output, scalar_decode_output);
   return 0;
 }
@@ -23,5 +23,13 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
   base::Base64Encode(data_piece, &string_piece_encode_output);
   CHECK_EQ(encode_output, string_piece_encode_output);
 
+  // Check that the scalar code gives the same results as the SIMD code picked
+  // for this machine.
+  CHECK_EQ(encode_output, base::Base64EncodeScalarForTesting(data_span));
+  std::string scalar_decode_output;
+  CHECK(base::Base64DecodeScalarForTesting(encode_output,
+                                           &scalar_decode_output));
+  CHECK_EQ(decode_output, scalar_decode_output);
+
   return 0;
 }
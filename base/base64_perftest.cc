@@ -0,0 +1,109 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/base64.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/strings/stringprintf.h"
+#include "base/timer/elapsed_timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace base {
+
+namespace {
+
+constexpr char kMetricPrefixBase64[] = "Base64.";
+constexpr char kMetricThroughput[] = "throughput";
+
+// Total number of bytes coded per test, whatever the input size.
+constexpr size_t kBytesPerTest = 64 * 1024 * 1024;
+
+perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixBase64, story_name);
+  reporter.RegisterImportantMetric(kMetricThroughput,
+                                   "bytesPerSecond_biggerIsBetter");
+  return reporter;
+}
+
+std::vector<uint8_t> RandomishBytes(size_t size) {
+  std::vector<uint8_t> bytes(size);
+  uint32_t state = 0x12345678;
+  for (uint8_t& byte : bytes) {
+    state = state * 1103515245 + 12345;
+    byte = static_cast<uint8_t>(state >> 16);
+  }
+  return bytes;
+}
+
+// Reports throughput in unencoded bytes per second, for both the code picked
+// for this machine and the scalar code.
+void RunEncodeTest(size_t input_size) {
+  const std::vector<uint8_t> input = RandomishBytes(input_size);
+  const size_t laps = kBytesPerTest / input_size;
+  size_t total = 0;
+
+  ElapsedTimer timer;
+  for (size_t lap = 0; lap < laps; ++lap)
+    total += Base64Encode(input).size();
+  SetUpReporter(StringPrintf("encode_%zu", input_size))
+      .AddResult(kMetricThroughput,
+                 laps * input_size / timer.Elapsed().InSecondsF());
+
+  ElapsedTimer scalar_timer;
+  for (size_t lap = 0; lap < laps; ++lap)
+    total -= Base64EncodeScalarForTesting(input).size();
+  SetUpReporter(StringPrintf("encode_scalar_%zu", input_size))
+      .AddResult(kMetricThroughput,
+                 laps * input_size / scalar_timer.Elapsed().InSecondsF());
+
+  EXPECT_EQ(0u, total);
+}
+
+void RunDecodeTest(size_t output_size) {
+  const std::string input = Base64Encode(RandomishBytes(output_size));
+  const size_t laps = kBytesPerTest / output_size;
+  size_t total = 0;
+  std::string output;
+
+  ElapsedTimer timer;
+  for (size_t lap = 0; lap < laps; ++lap) {
+    EXPECT_TRUE(Base64Decode(input, &output));
+    total += output.size();
+  }
+  SetUpReporter(StringPrintf("decode_%zu", output_size))
+      .AddResult(kMetricThroughput,
+                 laps * output_size / timer.Elapsed().InSecondsF());
+
+  ElapsedTimer scalar_timer;
+  for (size_t lap = 0; lap < laps; ++lap) {
+    EXPECT_TRUE(Base64DecodeScalarForTesting(input, &output));
+    total -= output.size();
+  }
+  SetUpReporter(StringPrintf("decode_scalar_%zu", output_size))
+      .AddResult(kMetricThroughput,
+                 laps * output_size / scalar_timer.Elapsed().InSecondsF());
+
+  EXPECT_EQ(0u, total);
+}
+
+}  // namespace
+
+// Sizes range from tokens and small images in data: URLs to large payloads.
+TEST(Base64PerfTest, Encode) {
+  for (size_t size : {32, 256, 4096, 1024 * 1024})
+    RunEncodeTest(size);
+}
+
+TEST(Base64PerfTest, Decode) {
+  for (size_t size : {32, 256, 4096, 1024 * 1024})
+    RunDecodeTest(size);
+}
+
+}  // namespace base
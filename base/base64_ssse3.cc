@@ -0,0 +1,132 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/base64_ssse3.h"
+
+#include <tmmintrin.h>
+
+// This file is built with -mssse3, see the base64_ssse3 target in BUILD.gn.
+// The algorithms are described in "Faster Base64 Encoding and Decoding Using
+// AVX2 Instructions" by Wojciech Muła and Daniel Lemire, which also covers
+// the SSE variants used here.
+
+namespace base {
+namespace internal {
+
+namespace {
+
+// Spreads 12 input bytes over 16 lanes, each holding one 6-bit index.
+inline __m128i EncodeReshuffle(__m128i in) {
+  // Duplicate the bytes so that each 32-bit lane holds the 3 input bytes it
+  // encodes, as [b1, b0, b2, b1].
+  in = _mm_shuffle_epi8(
+      in, _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1));
+  // Move the first and third indices of each lane into place with a multiply
+  // high, and the second and fourth with a multiply low.
+  const __m128i t0 = _mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00));
+  const __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+  const __m128i t2 = _mm_and_si128(in, _mm_set1_epi32(0x003f03f0));
+  const __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+  return _mm_or_si128(t1, t3);
+}
+
+// Maps 6-bit indices to the base64 alphabet by adding a per-range offset.
+inline __m128i EncodeTranslate(__m128i indices) {
+  // Offsets for A-Z, a-z, 0-9 (ten times), '+' and '/'.
+  const __m128i kOffsets = _mm_setr_epi8(65, 71, -4, -4, -4, -4, -4, -4, -4,
+                                         -4, -4, -4, -19, -16, 0, 0);
+  // 0 for A-Z, 1 for a-z, 2..11 for 0-9, 12 for '+' and 13 for '/'.
+  __m128i range = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+  range = _mm_sub_epi8(range, _mm_cmpgt_epi8(indices, _mm_set1_epi8(25)));
+  return _mm_add_epi8(indices, _mm_shuffle_epi8(kOffsets, range));
+}
+
+// Maps 16 characters to their 6-bit values. Returns false if any of them is
+// not in the base64 alphabet.
+inline bool DecodeTranslate(__m128i in, __m128i* values) {
+  // A character is invalid if the bits selected by its low nibble in
+  // |kLowNibbleInvalid| and by its high nibble in |kHighNibbleClass| overlap.
+  const __m128i kLowNibbleInvalid =
+      _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                    0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+  const __m128i kHighNibbleClass =
+      _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10,
+                    0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+  // Offsets by high nibble, with index 1 used for '/'.
+  const __m128i kOffsets = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0,
+                                         0, 0, 0, 0, 0, 0, 0);
+  const __m128i kNibbleMask = _mm_set1_epi8(0x0f);
+  const __m128i kSlash = _mm_set1_epi8('/');
+
+  const __m128i high_nibbles =
+      _mm_and_si128(_mm_srli_epi32(in, 4), kNibbleMask);
+  const __m128i low_nibbles = _mm_and_si128(in, kNibbleMask);
+  const __m128i invalid =
+      _mm_and_si128(_mm_shuffle_epi8(kLowNibbleInvalid, low_nibbles),
+                    _mm_shuffle_epi8(kHighNibbleClass, high_nibbles));
+  if (_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128())) !=
+      0xffff) {
+    return false;
+  }
+
+  const __m128i is_slash = _mm_cmpeq_epi8(in, kSlash);
+  const __m128i offsets =
+      _mm_shuffle_epi8(kOffsets, _mm_add_epi8(is_slash, high_nibbles));
+  *values = _mm_add_epi8(in, offsets);
+  return true;
+}
+
+// Packs 16 6-bit values into the first 12 bytes of the result.
+inline __m128i DecodeReshuffle(__m128i values) {
+  // Merge pairs of values into 12-bit fields, then pairs of those into 24-bit
+  // fields, one per 32-bit lane.
+  const __m128i pairs =
+      _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+  const __m128i quads = _mm_madd_epi16(pairs, _mm_set1_epi32(0x00011000));
+  // Store the 3 bytes of each lane in big-endian order.
+  return _mm_shuffle_epi8(quads, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14,
+                                               13, 12, -1, -1, -1, -1));
+}
+
+}  // namespace
+
+size_t Base64EncodeSSSE3(const uint8_t* input,
+                         size_t input_size,
+                         char* output) {
+  size_t consumed = 0;
+  // Each iteration loads 16 bytes but only encodes 12 of them.
+  while (input_size - consumed >= 16) {
+    const __m128i in =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + consumed));
+    const __m128i out = EncodeTranslate(EncodeReshuffle(in));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output), out);
+    consumed += 12;
+    output += 16;
+  }
+  return consumed;
+}
+
+size_t Base64DecodeSSSE3(const char* input,
+                         size_t input_size,
+                         uint8_t* output) {
+  size_t consumed = 0;
+  // Each iteration stores 16 bytes but only decodes 12 of them. Keeping the
+  // last 8 characters for the scalar code guarantees that |output| has room
+  // for the extra 4, and leaves it the padding.
+  while (input_size - consumed >= 24) {
+    const __m128i in =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + consumed));
+    __m128i values;
+    if (!DecodeTranslate(in, &values))
+      break;
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(output),
+                     DecodeReshuffle(values));
+    consumed += 16;
+    output += 12;
+  }
+  return consumed;
+}
+
+}  // namespace internal
+}  // namespace base
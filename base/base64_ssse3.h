@@ -0,0 +1,33 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_BASE64_SSSE3_H_
+#define BASE_BASE64_SSSE3_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace base {
+namespace internal {
+
+// SSSE3 kernels for the bulk of base64.cc's input. They must only be called if
+// base::CPU::has_ssse3() is true. Both stop early and leave the rest of the
+// input, including any padding, to the scalar code.
+
+// Encodes whole 12-byte blocks of |input| into |output|, as long as at least 16
+// bytes of input remain, and returns the number of input bytes consumed. Writes
+// 4 characters to |output| for every 3 bytes consumed.
+size_t Base64EncodeSSSE3(const uint8_t* input, size_t input_size, char* output);
+
+// Decodes whole 16-character blocks of |input| into |output|, as long as at
+// least 24 characters remain, and returns the number of input characters
+// consumed. Stops at the first block holding a character outside of the base64
+// alphabet, including padding. Writes 3 bytes to |output| for every 4
+// characters consumed, but may scribble over up to 4 more bytes after those.
+size_t Base64DecodeSSSE3(const char* input, size_t input_size, uint8_t* output);
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_BASE64_SSSE3_H_
@@ -4,10 +4,28 @@
 
 #include "base/base64.h"
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
 #include "testing/gtest/include/gtest/gtest.h"
 
 namespace base {
 
+namespace {
+
+// Returns |size| bytes that use every byte value.
+std::vector<uint8_t> TestBytes(size_t size) {
+  std::vector<uint8_t> bytes(size);
+  for (size_t i = 0; i < size; ++i)
+    bytes[i] = static_cast<uint8_t>(i * 167 + 13);
+  return bytes;
+}
+
+}  // namespace
+
 TEST(Base64Test, Basic) {
   const std::string kText = "hello world";
   const std::string kBase64Text = "aGVsbG8gd29ybGQ=";
@@ -51,4 +69,58 @@ TEST(Base64Test, InPlace) {
   EXPECT_EQ(text, kText);
 }
 
+// Inputs long enough to go through the SIMD code, where the machine supports
+// it, must give the same results as the scalar code at every length.
+TEST(Base64Test, MatchesScalar) {
+  for (size_t size = 0; size < 200; ++size) {
+    SCOPED_TRACE(size);
+    const std::vector<uint8_t> bytes = TestBytes(size);
+    const std::string encoded = Base64Encode(bytes);
+    EXPECT_EQ(Base64EncodeScalarForTesting(bytes), encoded);
+
+    std::string decoded;
+    ASSERT_TRUE(Base64Decode(encoded, &decoded));
+    EXPECT_EQ(std::string(bytes.begin(), bytes.end()), decoded);
+  }
+}
+
+TEST(Base64Test, LongKnownAnswer) {
+  const std::string kText =
+      "The quick brown fox jumps over the lazy dog, twice. The quick brown "
+      "fox jumps over the lazy dog.";
+  const std::string kBase64Text =
+      "VGhlIHF1aWNrIGJyb3duIGZveCBqdW1wcyBvdmVyIHRoZSBsYXp5IGRvZywgdHdpY2Uu"
+      "IFRoZSBxdWljayBicm93biBmb3gganVtcHMgb3ZlciB0aGUgbGF6eSBkb2cu";
+
+  std::string encoded;
+  Base64Encode(kText, &encoded);
+  EXPECT_EQ(kBase64Text, encoded);
+
+  std::string decoded;
+  EXPECT_TRUE(Base64Decode(kBase64Text, &decoded));
+  EXPECT_EQ(kText, decoded);
+}
+
+// An invalid character anywhere in the input, including in the blocks the SIMD
+// code handles, fails the whole decode.
+TEST(Base64Test, InvalidCharacters) {
+  const std::string encoded = Base64Encode(TestBytes(96));
+  ASSERT_EQ(128u, encoded.size());
+
+  for (char invalid : {'\0', ' ', '=', '-', '_', '@', '\x80', '\xff'}) {
+    for (size_t i = 0; i < encoded.size(); ++i) {
+      // Padding is valid in the last position.
+      if (invalid == '=' && i == encoded.size() - 1)
+        continue;
+      SCOPED_TRACE(i);
+      std::string input = encoded;
+      input[i] = invalid;
+      std::string output = "unchanged";
+      EXPECT_FALSE(Base64Decode(input, &output));
+      EXPECT_EQ("unchanged", output);
+      EXPECT_FALSE(Base64DecodeScalarForTesting(input, &output));
+    }
+  }
+}
+
 }  // namespace base
@@ -0,0 +1,95 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/chacha_random_buffer.h"
+
+namespace base {
+namespace internal {
+
+namespace {
+
+// "expand 32-byte k"
+constexpr uint32_t kConstants[4] = {0x61707865, 0x3320646e, 0x79622d32,
+                                    0x6b206574};
+
+inline uint32_t RotateLeft(uint32_t value, int bits) {
+  return (value << bits) | (value >> (32 - bits));
+}
+
+inline void QuarterRound(uint32_t* x, int a, int b, int c, int d) {
+  x[a] += x[b];
+  x[d] = RotateLeft(x[d] ^ x[a], 16);
+  x[c] += x[d];
+  x[b] = RotateLeft(x[b] ^ x[c], 12);
+  x[a] += x[b];
+  x[d] = RotateLeft(x[d] ^ x[a], 8);
+  x[c] += x[d];
+  x[b] = RotateLeft(x[b] ^ x[c], 7);
+}
+
+inline uint32_t LoadLittleEndian32(const uint8_t* bytes) {
+  return static_cast<uint32_t>(bytes[0]) |
+         static_cast<uint32_t>(bytes[1]) << 8 |
+         static_cast<uint32_t>(bytes[2]) << 16 |
+         static_cast<uint32_t>(bytes[3]) << 24;
+}
+
+inline void StoreLittleEndian32(uint32_t value, uint8_t* bytes) {
+  bytes[0] = static_cast<uint8_t>(value);
+  bytes[1] = static_cast<uint8_t>(value >> 8);
+  bytes[2] = static_cast<uint8_t>(value >> 16);
+  bytes[3] = static_cast<uint8_t>(value >> 24);
+}
+
+// Writes block |counter| of the keystream for |key| and a zero nonce, with the
+// original 64-bit counter layout, to |output|.
+void ChaChaBlock(const uint32_t* key, uint64_t counter, uint8_t* output) {
+  uint32_t input[16];
+  for (int i = 0; i < 4; ++i)
+    input[i] = kConstants[i];
+  for (int i = 0; i < 8; ++i)
+    input[4 + i] = key[i];
+  input[12] = static_cast<uint32_t>(counter);
+  input[13] = static_cast<uint32_t>(counter >> 32);
+  input[14] = 0;
+  input[15] = 0;
+
+  uint32_t x[16];
+  for (int i = 0; i < 16; ++i)
+    x[i] = input[i];
+  for (int round = 0; round < 20; round += 2) {
+    QuarterRound(x, 0, 4, 8, 12);
+    QuarterRound(x, 1, 5, 9, 13);
+    QuarterRound(x, 2, 6, 10, 14);
+    QuarterRound(x, 3, 7, 11, 15);
+    QuarterRound(x, 0, 5, 10, 15);
+    QuarterRound(x, 1, 6, 11, 12);
+    QuarterRound(x, 2, 7, 8, 13);
+    QuarterRound(x, 3, 4, 9, 14);
+  }
+  for (int i = 0; i < 16; ++i)
+    StoreLittleEndian32(x[i] + input[i], output + 4 * i);
+}
+
+}  // namespace
+
+ChaChaRandomBuffer::ChaChaRandomBuffer() = default;
+
+ChaChaRandomBuffer::~ChaChaRandomBuffer() = default;
+
+void ChaChaRandomBuffer::SetKey(span<const uint8_t, kKeySize> key) {
+  for (size_t i = 0; i < kKeySize / sizeof(uint32_t); ++i)
+    key_[i] = LoadLittleEndian32(key.data() + 4 * i);
+  counter_ = 0;
+  position_ = sizeof(buffer_);
+}
+
+void ChaChaRandomBuffer::Refill() {
+  for (size_t i = 0; i < kBlocksPerRefill; ++i)
+    ChaChaBlock(key_, counter_++, buffer_ + i * kBlockSize);
+  position_ = 0;
+}
+
+}  // namespace internal
+}  // namespace base
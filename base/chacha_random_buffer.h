@@ -0,0 +1,62 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_CHACHA_RANDOM_BUFFER_H_
+#define BASE_CHACHA_RANDOM_BUFFER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "base/base_export.h"
+#include "base/containers/span.h"
+
+namespace base {
+namespace internal {
+
+// Hands out the ChaCha20 keystream for a key, with a zero nonce, a few blocks
+// at a time. This backs base::InsecureRand*(), which keys one per thread from
+// base::RandBytes(), and is not meant to be used directly.
+class BASE_EXPORT ChaChaRandomBuffer {
+ public:
+  static constexpr size_t kKeySize = 32;
+  static constexpr size_t kBlockSize = 64;
+  // Number of blocks generated at once, to amortize the refill.
+  static constexpr size_t kBlocksPerRefill = 4;
+
+  ChaChaRandomBuffer();
+  ChaChaRandomBuffer(const ChaChaRandomBuffer&) = delete;
+  ChaChaRandomBuffer& operator=(const ChaChaRandomBuffer&) = delete;
+  ~ChaChaRandomBuffer();
+
+  // Restarts the keystream at block 0 of |key|, discarding buffered output.
+  void SetKey(span<const uint8_t, kKeySize> key);
+
+  // Returns the next 8 bytes of the keystream, in little-endian order.
+  uint64_t NextUint64() {
+    if (position_ == sizeof(buffer_))
+      Refill();
+    uint64_t result;
+    memcpy(&result, buffer_ + position_, sizeof(result));
+    position_ += sizeof(result);
+    return result;
+  }
+
+  // Number of blocks generated since the last SetKey().
+  uint64_t blocks_generated() const { return counter_; }
+
+ private:
+  void Refill();
+
+  uint32_t key_[kKeySize / sizeof(uint32_t)] = {};
+  // The block counter.
+  uint64_t counter_ = 0;
+  uint8_t buffer_[kBlocksPerRefill * kBlockSize];
+  size_t position_ = sizeof(buffer_);
+};
+
+}  // namespace internal
+}  // namespace base
+
+#endif  // BASE_CHACHA_RANDOM_BUFFER_H_
@@ -0,0 +1,81 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/chacha_random_buffer.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <vector>
+
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+namespace internal {
+
+namespace {
+
+std::vector<uint8_t> Keystream(ChaChaRandomBuffer* buffer, size_t size) {
+  std::vector<uint8_t> result;
+  while (result.size() < size) {
+    uint64_t value = buffer->NextUint64();
+    for (size_t i = 0; i < sizeof(value); ++i)
+      result.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+  return result;
+}
+
+}  // namespace
+
+// Keystream test vectors #1 and #2 of RFC 7539, appendix A.1: blocks 0 and 1
+// for the all-zero key and nonce.
+TEST(ChaChaRandomBufferTest, KnownAnswer) {
+  const uint8_t kExpected[] = {
+      0x76, 0xb8, 0xe0, 0xad, 0xa0, 0xf1, 0x3d, 0x90, 0x40, 0x5d, 0x6a, 0xe5,
+      0x53, 0x86, 0xbd, 0x28, 0xbd, 0xd2, 0x19, 0xb8, 0xa0, 0x8d, 0xed, 0x1a,
+      0xa8, 0x36, 0xef, 0xcc, 0x8b, 0x77, 0x0d, 0xc7, 0xda, 0x41, 0x59, 0x7c,
+      0x51, 0x57, 0x48, 0x8d, 0x77, 0x24, 0xe0, 0x3f, 0xb8, 0xd8, 0x4a, 0x37,
+      0x6a, 0x43, 0xb8, 0xf4, 0x15, 0x18, 0xa1, 0x1c, 0xc3, 0x87, 0xb6, 0x69,
+      0xb2, 0xee, 0x65, 0x86, 0x9f, 0x07, 0xe7, 0xbe, 0x55, 0x51, 0x38, 0x7a,
+      0x98, 0xba, 0x97, 0x7c, 0x73, 0x2d, 0x08, 0x0d, 0xcb, 0x0f, 0x29, 0xa0,
+      0x48, 0xe3, 0x65, 0x69, 0x12, 0xc6, 0x53, 0x3e, 0x32, 0xee, 0x7a, 0xed,
+      0x29, 0xb7, 0x21, 0x76, 0x9c, 0xe6, 0x4e, 0x43, 0xd5, 0x71, 0x33, 0xb0,
+      0x74, 0xd8, 0x39, 0xd5, 0x31, 0xed, 0x1f, 0x28, 0x51, 0x0a, 0xfb, 0x45,
+      0xac, 0xe1, 0x0a, 0x1f, 0x4b, 0x79, 0x4d, 0x6f};
+  const uint8_t kKey[ChaChaRandomBuffer::kKeySize] = {};
+
+  ChaChaRandomBuffer buffer;
+  buffer.SetKey(kKey);
+  EXPECT_EQ(std::vector<uint8_t>(std::begin(kExpected), std::end(kExpected)),
+            Keystream(&buffer, sizeof(kExpected)));
+}
+
+TEST(ChaChaRandomBufferTest, SetKeyRestartsKeystream) {
+  uint8_t key[ChaChaRandomBuffer::kKeySize];
+  for (size_t i = 0; i < sizeof(key); ++i)
+    key[i] = static_cast<uint8_t>(i);
+
+  ChaChaRandomBuffer buffer;
+  buffer.SetKey(key);
+  EXPECT_EQ(0x6a19c5d97d2bfd39u, buffer.NextUint64());
+  EXPECT_EQ(0x494adcb87703bd8du, buffer.NextUint64());
+  EXPECT_EQ(ChaChaRandomBuffer::kBlocksPerRefill, buffer.blocks_generated());
+
+  // The first value of the second refill.
+  for (size_t i = 2; i < ChaChaRandomBuffer::kBlocksPerRefill *
+                             ChaChaRandomBuffer::kBlockSize / sizeof(uint64_t);
+       ++i) {
+    buffer.NextUint64();
+  }
+  EXPECT_EQ(0x438c582718a1dbffu, buffer.NextUint64());
+  EXPECT_EQ(2 * ChaChaRandomBuffer::kBlocksPerRefill,
+            buffer.blocks_generated());
+
+  buffer.SetKey(key);
+  EXPECT_EQ(0u, buffer.blocks_generated());
+  EXPECT_EQ(0x6a19c5d97d2bfd39u, buffer.NextUint64());
+}
+
+}  // namespace internal
+}  // namespace base
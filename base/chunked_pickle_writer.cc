@@ -0,0 +1,131 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/chunked_pickle_writer.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+
+#include "base/bits.h"
+#include "base/check_op.h"
+
+namespace base {
+
+ChunkedPickleWriter::ChunkedPickleWriter() = default;
+
+ChunkedPickleWriter::~ChunkedPickleWriter() = default;
+
+void ChunkedPickleWriter::WriteString(StringPiece value) {
+  WriteInt(static_cast<int>(value.size()));
+  WriteBytes(value.data(), static_cast<int>(value.size()));
+}
+
+void ChunkedPickleWriter::WriteString16(StringPiece16 value) {
+  WriteInt(static_cast<int>(value.size()));
+  WriteBytes(value.data(), static_cast<int>(value.size()) * sizeof(char16_t));
+}
+
+void ChunkedPickleWriter::WriteData(const char* data, int length) {
+  DCHECK_GE(length, 0);
+  WriteInt(length);
+  WriteBytes(data, length);
+}
+
+void ChunkedPickleWriter::WriteBytes(const void* data, int length) {
+  DCHECK_GE(length, 0);
+  AppendCopy(data, length);
+  Pad();
+}
+
+void ChunkedPickleWriter::WriteStringByReference(StringPiece value) {
+  WriteDataByReference(as_bytes(make_span(value)));
+}
+
+void ChunkedPickleWriter::WriteDataByReference(span<const uint8_t> data) {
+  CHECK_LE(data.size(), static_cast<size_t>(std::numeric_limits<int>::max()));
+  WriteInt(static_cast<int>(data.size()));
+  if (data.size() < kMinReferenceSize)
+    AppendCopy(data.data(), data.size());
+  else
+    AppendReference(data.data(), data.size());
+  Pad();
+}
+
+std::vector<span<const uint8_t>> ChunkedPickleWriter::GetBuffers() {
+  header_.payload_size = static_cast<uint32_t>(payload_size_);
+  std::vector<span<const uint8_t>> buffers;
+  buffers.reserve(buffer_count());
+  buffers.push_back(as_bytes(make_span(&header_, 1)));
+  for (const Segment& segment : segments_) {
+    buffers.push_back(as_bytes(make_span(segment.data, segment.size)));
+  }
+  return buffers;
+}
+
+void ChunkedPickleWriter::CopyTo(span<uint8_t> dest) {
+  CHECK_EQ(dest.size(), size());
+  for (span<const uint8_t> buffer : GetBuffers()) {
+    memcpy(dest.data(), buffer.data(), buffer.size());
+    dest = dest.subspan(buffer.size());
+  }
+}
+
+Pickle ChunkedPickleWriter::ToPickle() {
+  Pickle pickle;
+  // |payload_size_| is always a multiple of 4, so ClaimBytes() adds no
+  // padding and the payload sizes match.
+  char* dest = static_cast<char*>(pickle.ClaimBytes(payload_size_));
+  for (const Segment& segment : segments_) {
+    memcpy(dest, segment.data, segment.size);
+    dest += segment.size;
+  }
+  DCHECK_EQ(pickle.size(), size());
+  return pickle;
+}
+
+void ChunkedPickleWriter::AppendCopy(const void* data, size_t length) {
+  const char* source = static_cast<const char*>(data);
+  while (length > 0) {
+    if (cursor_ == chunk_end_) {
+      chunks_.emplace_back(new char[kChunkSize]);
+      cursor_ = chunks_.back().get();
+      chunk_end_ = cursor_ + kChunkSize;
+    }
+
+    size_t bytes = std::min(length, static_cast<size_t>(chunk_end_ - cursor_));
+    memcpy(cursor_, source, bytes);
+
+    // Extend the current segment if it ends right where this copy starts,
+    // which is the case unless a new chunk or a reference intervened.
+    if (!segments_.empty() && segments_.back().owned &&
+        segments_.back().data + segments_.back().size == cursor_) {
+      segments_.back().size += bytes;
+    } else {
+      segments_.push_back({cursor_, bytes, /*owned=*/true});
+    }
+
+    cursor_ += bytes;
+    source += bytes;
+    length -= bytes;
+    payload_size_ += bytes;
+  }
+}
+
+void ChunkedPickleWriter::AppendReference(const void* data, size_t length) {
+  segments_.push_back({static_cast<const char*>(data), length,
+                       /*owned=*/false});
+  payload_size_ += length;
+}
+
+void ChunkedPickleWriter::Pad() {
+  static const char kZeros[sizeof(uint32_t)] = {};
+  size_t padding =
+      bits::AlignUp(payload_size_, sizeof(uint32_t)) - payload_size_;
+  AppendCopy(kZeros, padding);
+  CHECK_LE(payload_size_, std::numeric_limits<uint32_t>::max());
+}
+
+}  // namespace base
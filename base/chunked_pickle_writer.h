@@ -0,0 +1,116 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_CHUNKED_PICKLE_WRITER_H_
+#define BASE_CHUNKED_PICKLE_WRITER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/containers/span.h"
+#include "base/pickle.h"
+#include "base/strings/string_piece.h"
+
+namespace base {
+
+// ChunkedPickleWriter produces the same bytes as writing the same sequence of
+// values to a Pickle with the default header, but without ever reallocating:
+// small values are copied into fixed-size chunks that are never moved, and
+// large blobs passed to the *ByReference() methods are not copied at all.
+//
+// The result is a list of buffers suitable for scatter-gather I/O (e.g.
+// writev() or a mojo data pipe), see GetBuffers(). Callers that need a Pickle
+// can use ToPickle(), at the cost of one copy.
+//
+// Data passed by reference must stay alive and unchanged until the writer and
+// every span obtained from GetBuffers() are no longer used.
+class BASE_EXPORT ChunkedPickleWriter {
+ public:
+  // Size of the chunks small values are copied into.
+  static constexpr size_t kChunkSize = 4096;
+
+  // Blobs shorter than this are copied even when passed by reference, since
+  // an extra buffer costs more than copying them.
+  static constexpr size_t kMinReferenceSize = 256;
+
+  ChunkedPickleWriter();
+  ChunkedPickleWriter(const ChunkedPickleWriter&) = delete;
+  ChunkedPickleWriter& operator=(const ChunkedPickleWriter&) = delete;
+  ~ChunkedPickleWriter();
+
+  // Same as the Pickle methods of the same names.
+  void WriteBool(bool value) { WriteInt(value ? 1 : 0); }
+  void WriteInt(int value) { WritePOD(value); }
+  void WriteLong(long value) { WritePOD(static_cast<int64_t>(value)); }
+  void WriteUInt16(uint16_t value) { WritePOD(value); }
+  void WriteUInt32(uint32_t value) { WritePOD(value); }
+  void WriteInt64(int64_t value) { WritePOD(value); }
+  void WriteUInt64(uint64_t value) { WritePOD(value); }
+  void WriteFloat(float value) { WritePOD(value); }
+  void WriteDouble(double value) { WritePOD(value); }
+  void WriteString(StringPiece value);
+  void WriteString16(StringPiece16 value);
+  void WriteData(const char* data, int length);
+  void WriteBytes(const void* data, int length);
+
+  // Same as WriteString() and WriteData(), but reference |value| or |data|
+  // instead of copying it, if it is at least kMinReferenceSize bytes long.
+  void WriteStringByReference(StringPiece value);
+  void WriteDataByReference(span<const uint8_t> data);
+
+  // Returns the number of bytes written, including the header.
+  size_t size() const { return sizeof(Pickle::Header) + payload_size_; }
+
+  // Number of buffers GetBuffers() will return.
+  size_t buffer_count() const { return segments_.size() + 1; }
+
+  // Returns the serialized pickle, header first, as a list of buffers to be
+  // written out in order. The spans are invalidated by further writes.
+  std::vector<span<const uint8_t>> GetBuffers();
+
+  // Copies the serialized pickle into |dest|, which must be size() bytes.
+  void CopyTo(span<uint8_t> dest);
+
+  // Returns a Pickle holding a copy of the serialized data. The Pickle can be
+  // written to further.
+  Pickle ToPickle();
+
+ private:
+  template <typename T>
+  void WritePOD(const T& value) {
+    AppendCopy(&value, sizeof(value));
+    Pad();
+  }
+
+  // Copies |length| bytes into the chunks, starting new chunks as needed.
+  void AppendCopy(const void* data, size_t length);
+  // Appends |length| bytes that live outside of the writer.
+  void AppendReference(const void* data, size_t length);
+  // Pads the payload with zeros to a multiple of 4 bytes, like Pickle.
+  void Pad();
+
+  struct Segment {
+    const char* data;
+    size_t size;
+    // True if |data| points into one of |chunks_|.
+    bool owned;
+  };
+
+  Pickle::Header header_ = {0};
+  std::vector<std::unique_ptr<char[]>> chunks_;
+  std::vector<Segment> segments_;
+  // Free space in the last chunk.
+  char* cursor_ = nullptr;
+  char* chunk_end_ = nullptr;
+  size_t payload_size_ = 0;
+};
+
+}  // namespace base
+
+#endif  // BASE_CHUNKED_PICKLE_WRITER_H_
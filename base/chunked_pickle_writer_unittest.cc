@@ -0,0 +1,174 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/chunked_pickle_writer.h"
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/pickle.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace base {
+
+namespace {
+
+std::vector<uint8_t> Flatten(ChunkedPickleWriter* writer) {
+  std::vector<uint8_t> result(writer->size());
+  writer->CopyTo(result);
+  return result;
+}
+
+std::vector<uint8_t> PickleBytes(const Pickle& pickle) {
+  const uint8_t* data = static_cast<const uint8_t*>(pickle.data());
+  return std::vector<uint8_t>(data, data + pickle.size());
+}
+
+}  // namespace
+
+TEST(ChunkedPickleWriterTest, Empty) {
+  ChunkedPickleWriter writer;
+  Pickle pickle;
+  EXPECT_EQ(pickle.size(), writer.size());
+  EXPECT_EQ(1u, writer.buffer_count());
+  EXPECT_EQ(PickleBytes(pickle), Flatten(&writer));
+  EXPECT_EQ(PickleBytes(pickle), PickleBytes(writer.ToPickle()));
+}
+
+TEST(ChunkedPickleWriterTest, MatchesPickle) {
+  const std::string kLong(1000, 'x');
+  const char kData[] = "AAA\0BBB";
+
+  ChunkedPickleWriter writer;
+  Pickle pickle;
+
+  writer.WriteBool(true);
+  pickle.WriteBool(true);
+  writer.WriteInt(-12345);
+  pickle.WriteInt(-12345);
+  writer.WriteLong(1'093'847'192);
+  pickle.WriteLong(1'093'847'192);
+  writer.WriteUInt16(32123);
+  pickle.WriteUInt16(32123);
+  writer.WriteUInt32(1593847192);
+  pickle.WriteUInt32(1593847192);
+  writer.WriteInt64(-0x7E8CA9253104BDFCLL);
+  pickle.WriteInt64(-0x7E8CA9253104BDFCLL);
+  writer.WriteUInt64(0xCE8CA9253104BDF7ULL);
+  pickle.WriteUInt64(0xCE8CA9253104BDF7ULL);
+  writer.WriteFloat(3.1415926935f);
+  pickle.WriteFloat(3.1415926935f);
+  writer.WriteDouble(2.71828182845904523);
+  pickle.WriteDouble(2.71828182845904523);
+  writer.WriteString("Hello world");
+  pickle.WriteString("Hello world");
+  writer.WriteString16(u"Hello, world");
+  pickle.WriteString16(u"Hello, world");
+  writer.WriteData(kData, sizeof(kData) - 1);
+  pickle.WriteData(kData, sizeof(kData) - 1);
+  writer.WriteBytes(kData, 3);
+  pickle.WriteBytes(kData, 3);
+  writer.WriteStringByReference(kLong);
+  pickle.WriteString(kLong);
+  writer.WriteStringByReference("short");
+  pickle.WriteString("short");
+
+  EXPECT_EQ(pickle.size(), writer.size());
+  EXPECT_EQ(PickleBytes(pickle), Flatten(&writer));
+  EXPECT_EQ(PickleBytes(pickle), PickleBytes(writer.ToPickle()));
+}
+
+TEST(ChunkedPickleWriterTest, LargeBlobsAreReferenced) {
+  const std::string kFirst(ChunkedPickleWriter::kMinReferenceSize, 'a');
+  const std::string kSecond(3 * ChunkedPickleWriter::kMinReferenceSize + 1,
+                            'b');
+
+  ChunkedPickleWriter writer;
+  writer.WriteInt(1);
+  writer.WriteStringByReference(kFirst);
+  writer.WriteInt(2);
+  writer.WriteDataByReference(as_bytes(make_span(kSecond)));
+
+  // Header, {1, length}, kFirst, {2, length}, kSecond, padding.
+  std::vector<span<const uint8_t>> buffers = writer.GetBuffers();
+  ASSERT_EQ(6u, buffers.size());
+  EXPECT_EQ(writer.buffer_count(), buffers.size());
+  EXPECT_EQ(reinterpret_cast<const uint8_t*>(kFirst.data()),
+            buffers[2].data());
+  EXPECT_EQ(kFirst.size(), buffers[2].size());
+  EXPECT_EQ(reinterpret_cast<const uint8_t*>(kSecond.data()),
+            buffers[4].data());
+  EXPECT_EQ(kSecond.size(), buffers[4].size());
+  EXPECT_EQ(3u, buffers[5].size());
+
+  Pickle pickle;
+  pickle.WriteInt(1);
+  pickle.WriteString(kFirst);
+  pickle.WriteInt(2);
+  pickle.WriteData(kSecond.data(), kSecond.size());
+  EXPECT_EQ(PickleBytes(pickle), Flatten(&writer));
+}
+
+TEST(ChunkedPickleWriterTest, SpansChunks) {
+  ChunkedPickleWriter writer;
+  Pickle pickle;
+  // Small values end up in one buffer per chunk; these fill exactly four.
+  for (size_t i = 0; i < ChunkedPickleWriter::kChunkSize; ++i) {
+    writer.WriteUInt32(i);
+    pickle.WriteUInt32(i);
+  }
+  EXPECT_EQ(1u + 4u, writer.buffer_count());
+
+  // Copied values may straddle chunks.
+  const std::string kCopied(ChunkedPickleWriter::kChunkSize * 2 + 3, 'c');
+  writer.WriteString(kCopied);
+  pickle.WriteString(kCopied);
+
+  EXPECT_EQ(PickleBytes(pickle), Flatten(&writer));
+}
+
+TEST(ChunkedPickleWriterTest, ToPickleIsWritable) {
+  const std::string kLong(2 * ChunkedPickleWriter::kMinReferenceSize, 'l');
+  ChunkedPickleWriter writer;
+  writer.WriteInt(7);
+  writer.WriteStringByReference(kLong);
+
+  Pickle pickle = writer.ToPickle();
+  pickle.WriteString("after");
+
+  PickleIterator iter(pickle);
+  int int_result;
+  EXPECT_TRUE(iter.ReadInt(&int_result));
+  EXPECT_EQ(7, int_result);
+  StringPiece string_result;
+  EXPECT_TRUE(iter.ReadStringPiece(&string_result));
+  EXPECT_EQ(kLong, string_result);
+  EXPECT_TRUE(iter.ReadStringPiece(&string_result));
+  EXPECT_EQ("after", string_result);
+  EXPECT_FALSE(iter.ReadInt(&int_result));
+}
+
+TEST(ChunkedPickleWriterTest, ReadBytesSpan) {
+  const std::string kLong(2 * ChunkedPickleWriter::kMinReferenceSize, 'r');
+  ChunkedPickleWriter writer;
+  writer.WriteDataByReference(as_bytes(make_span(kLong)));
+  std::vector<uint8_t> flattened = Flatten(&writer);
+
+  Pickle pickle(reinterpret_cast<const char*>(flattened.data()),
+                flattened.size());
+  PickleIterator iter(pickle);
+  int length;
+  ASSERT_TRUE(iter.ReadLength(&length));
+  span<const uint8_t> bytes;
+  ASSERT_TRUE(iter.ReadBytes(&bytes, length));
+  EXPECT_EQ(kLong, std::string(bytes.begin(), bytes.end()));
+  // The span points into the pickle, not a copy.
+  EXPECT_EQ(flattened.data() + sizeof(Pickle::Header) + sizeof(int),
+            bytes.data());
+  EXPECT_FALSE(iter.ReadBytes(&bytes, 1));
+}
+
+}  // namespace base
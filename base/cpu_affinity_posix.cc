@@ -5,9 +5,25 @@
 #include "base/cpu_affinity_posix.h"
 
 #include <sched.h>
+#include <string.h>
 
+#include <string>
+#include <vector>
+
+#include "base/containers/flat_map.h"
 #include "base/cpu.h"
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/no_destructor.h"
 #include "base/process/internal_linux.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/synchronization/lock.h"
+#include "base/thread_annotations.h"
+#include "base/threading/thread_local_storage.h"
+#include "base/threading/thread_restrictions.h"
 #include "third_party/abseil-cpp/absl/types/optional.h"
 
 namespace base {
@@ -61,6 +77,173 @@ const cpu_set_t& LittleCores() {
   return kLittleCores;
 }
 
+const cpu_set_t& BigCores() {
+  static const cpu_set_t kBigCores = []() {
+    const std::vector<CPU::CoreType>& core_types = CPU::GetGuessedCoreTypes();
+    if (core_types.empty())
+      return AllCores();
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t core_index = 0; core_index < core_types.size(); core_index++) {
+      switch (core_types[core_index]) {
+        case CPU::CoreType::kUnknown:
+        case CPU::CoreType::kOther:
+        case CPU::CoreType::kSymmetric:
+          return AllCores();
+        case CPU::CoreType::kBigLittle_Little:
+        case CPU::CoreType::kBigLittleBigger_Little:
+          break;
+        case CPU::CoreType::kBigLittle_Big:
+        case CPU::CoreType::kBigLittleBigger_Big:
+        case CPU::CoreType::kBigLittleBigger_Bigger:
+          CPU_SET(core_index, &set);
+          break;
+      }
+    }
+    return set;
+  }();
+  return kBigCores;
+}
+
+// Returns the cores of each NUMA node that has any, or nothing if the host has
+// fewer than two such nodes.
+const std::vector<cpu_set_t>& NumaNodeCores() {
+  static const NoDestructor<std::vector<cpu_set_t>> kNumaNodeCores([]() {
+    const char kOnlineNodesPath[] = "/sys/devices/system/node/online";
+    const char kNodeCpuListPath[] = "/sys/devices/system/node/node%d/cpulist";
+
+    // Reading from sysfs doesn't block.
+    ThreadRestrictions::ScopedAllowIO allow_io;
+    std::vector<cpu_set_t> nodes;
+    std::string content;
+    cpu_set_t online_nodes;
+    if (!ReadFileToString(FilePath(kOnlineNodesPath), &content) ||
+        !internal::ParseCpuList(content, &online_nodes)) {
+      return nodes;
+    }
+    for (int node = 0; node < CPU_SETSIZE; ++node) {
+      if (!CPU_ISSET(node, &online_nodes))
+        continue;
+      cpu_set_t set;
+      if (!ReadFileToString(FilePath(StringPrintf(kNodeCpuListPath, node)),
+                            &content) ||
+          !internal::ParseCpuList(content, &set)) {
+        return std::vector<cpu_set_t>();
+      }
+      // Nodes with memory only have no cores.
+      if (CPU_COUNT(&set) > 0)
+        nodes.push_back(set);
+    }
+    if (nodes.size() < 2)
+      nodes.clear();
+    return nodes;
+  }());
+  return *kNumaNodeCores;
+}
+
+// Returns the index in NumaNodeCores() of the node the calling thread runs on,
+// or nullopt if there is no such node.
+absl::optional<size_t> CurrentNumaNode() {
+  const std::vector<cpu_set_t>& nodes = NumaNodeCores();
+  int cpu = sched_getcpu();
+  if (cpu < 0 || cpu >= CPU_SETSIZE)
+    return absl::nullopt;
+  for (size_t node = 0; node < nodes.size(); ++node) {
+    if (CPU_ISSET(cpu, &nodes[node]))
+      return node;
+  }
+  return absl::nullopt;
+}
+
+const cpu_set_t& CoreSetMask(CpuCoreSet core_set,
+                             absl::optional<size_t> numa_node) {
+  switch (core_set) {
+    case CpuCoreSet::kAll:
+      return AllCores();
+    case CpuCoreSet::kLittle:
+      return LittleCores();
+    case CpuCoreSet::kBig:
+      return BigCores();
+    case CpuCoreSet::kLocalNumaNode:
+      if (!numa_node)
+        return AllCores();
+      return NumaNodeCores()[*numa_node];
+  }
+}
+
+// The policy of the process, and the threads that follow it.
+class PolicyState {
+ public:
+  PolicyState() = default;
+  PolicyState(const PolicyState&) = delete;
+  PolicyState& operator=(const PolicyState&) = delete;
+
+  bool SetCurrentThreadType(CpuAffinityThreadType thread_type) {
+    PlatformThreadId thread_id = PlatformThread::CurrentId();
+    AutoLock lock(lock_);
+    threads_[thread_id] = thread_type;
+    return ApplyLocked(thread_id, thread_type);
+  }
+
+  void RemoveCurrentThread() {
+    AutoLock lock(lock_);
+    threads_.erase(PlatformThread::CurrentId());
+  }
+
+  bool SetPolicy(const CpuAffinityPolicy& policy) {
+    absl::optional<size_t> numa_node = CurrentNumaNode();
+    AutoLock lock(lock_);
+    policy_ = policy;
+    numa_node_ = numa_node;
+    bool result = true;
+    for (const auto& thread : threads_)
+      result &= ApplyLocked(thread.first, thread.second);
+    return result;
+  }
+
+  CpuAffinityPolicy GetPolicy() const {
+    AutoLock lock(lock_);
+    return policy_;
+  }
+
+  cpu_set_t GetCoreSetMask(CpuCoreSet core_set) const {
+    AutoLock lock(lock_);
+    return CoreSetMask(core_set, numa_node_);
+  }
+
+ private:
+  bool ApplyLocked(PlatformThreadId thread_id,
+                   CpuAffinityThreadType thread_type)
+      EXCLUSIVE_LOCKS_REQUIRED(lock_) {
+    const cpu_set_t& set =
+        CoreSetMask(policy_.GetCoreSet(thread_type), numa_node_);
+    return sched_setaffinity(thread_id, sizeof(set), &set) == 0;
+  }
+
+  mutable Lock lock_;
+  CpuAffinityPolicy policy_ GUARDED_BY(lock_);
+  absl::optional<size_t> numa_node_ GUARDED_BY(lock_);
+  // Threads are removed as they exit, before their ID can be reused.
+  flat_map<PlatformThreadId, CpuAffinityThreadType> threads_ GUARDED_BY(lock_);
+};
+
+PolicyState& GetPolicyState() {
+  static NoDestructor<PolicyState> state;
+  return *state;
+}
+
+void OnThreadExit(void* /*value*/) {
+  GetPolicyState().RemoveCurrentThread();
+}
+
+// Set on the threads that declared their type, so that they leave the policy
+// as they exit.
+ThreadLocalStorage::Slot& DeclaredTypeSlot() {
+  static NoDestructor<ThreadLocalStorage::Slot> slot(&OnThreadExit);
+  return *slot;
+}
+
 }  // anonymous namespace
 
 bool HasBigCpuCores() {
@@ -133,4 +316,84 @@ absl::optional<CpuAffinityMode> CurrentThreadCpuAffinityMode() {
   return absl::nullopt;
 }
 
+CpuAffinityPolicy::CpuAffinityPolicy() {
+  core_sets_.fill(CpuCoreSet::kAll);
+}
+
+// static
+CpuAffinityPolicy CpuAffinityPolicy::ForCurrentHardware() {
+  CpuAffinityPolicy policy;
+  if (HasBigCpuCores()) {
+    policy.SetCoreSet(CpuAffinityThreadType::kIO, CpuCoreSet::kBig);
+    policy.SetCoreSet(CpuAffinityThreadType::kCompositing, CpuCoreSet::kBig);
+    policy.SetCoreSet(CpuAffinityThreadType::kRendererMain, CpuCoreSet::kBig);
+    policy.SetCoreSet(CpuAffinityThreadType::kBackground, CpuCoreSet::kLittle);
+  } else if (!NumaNodeCores().empty()) {
+    policy.SetCoreSet(CpuAffinityThreadType::kIO, CpuCoreSet::kLocalNumaNode);
+    policy.SetCoreSet(CpuAffinityThreadType::kCompositing,
+                      CpuCoreSet::kLocalNumaNode);
+    policy.SetCoreSet(CpuAffinityThreadType::kRendererMain,
+                      CpuCoreSet::kLocalNumaNode);
+  }
+  return policy;
+}
+
+void CpuAffinityPolicy::SetCoreSet(CpuAffinityThreadType thread_type,
+                                   CpuCoreSet core_set) {
+  core_sets_[static_cast<size_t>(thread_type)] = core_set;
+}
+
+CpuCoreSet CpuAffinityPolicy::GetCoreSet(
+    CpuAffinityThreadType thread_type) const {
+  return core_sets_[static_cast<size_t>(thread_type)];
+}
+
+bool CpuAffinityPolicy::operator==(const CpuAffinityPolicy& other) const {
+  return core_sets_ == other.core_sets_;
+}
+
+bool CpuAffinityPolicy::operator!=(const CpuAffinityPolicy& other) const {
+  return !(*this == other);
+}
+
+bool SetCurrentThreadCpuAffinityType(CpuAffinityThreadType thread_type) {
+  DeclaredTypeSlot().Set(reinterpret_cast<void*>(1));
+  return GetPolicyState().SetCurrentThreadType(thread_type);
+}
+
+bool SetCpuAffinityPolicy(const CpuAffinityPolicy& policy) {
+  return GetPolicyState().SetPolicy(policy);
+}
+
+CpuAffinityPolicy GetCpuAffinityPolicy() {
+  return GetPolicyState().GetPolicy();
+}
+
+cpu_set_t GetCpuCoreSetMask(CpuCoreSet core_set) {
+  return GetPolicyState().GetCoreSetMask(core_set);
+}
+
+namespace internal {
+
+bool ParseCpuList(StringPiece cpu_list, cpu_set_t* set) {
+  CPU_ZERO(set);
+  for (StringPiece range : SplitStringPiece(
+           cpu_list, ",", TRIM_WHITESPACE, SPLIT_WANT_NONEMPTY)) {
+    std::vector<StringPiece> bounds =
+        SplitStringPiece(range, "-", KEEP_WHITESPACE, SPLIT_WANT_ALL);
+    unsigned first = 0;
+    unsigned last = 0;
+    if (bounds.size() > 2 || !StringToUint(bounds.front(), &first) ||
+        !StringToUint(bounds.back(), &last) || first > last ||
+        last >= CPU_SETSIZE) {
+      return false;
+    }
+    for (unsigned cpu = first; cpu <= last; ++cpu)
+      CPU_SET(cpu, set);
+  }
+  return true;
+}
+
+}  // namespace internal
+
 }  // namespace base
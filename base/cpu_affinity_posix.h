@@ -5,7 +5,13 @@
 #ifndef BASE_CPU_AFFINITY_POSIX_H_
 #define BASE_CPU_AFFINITY_POSIX_H_
 
+#include <sched.h>
+#include <stddef.h>
+
+#include <array>
+
 #include "base/process/process_handle.h"
+#include "base/strings/string_piece.h"
 #include "base/threading/platform_thread.h"
 #include "third_party/abseil-cpp/absl/types/optional.h"
 
@@ -38,6 +44,87 @@ BASE_EXPORT bool HasBigCpuCores();
 // return nullopt.
 BASE_EXPORT absl::optional<CpuAffinityMode> CurrentThreadCpuAffinityMode();
 
+// The kinds of threads a CpuAffinityPolicy can place on different cores.
+enum class CpuAffinityThreadType {
+  // Threads that did not declare a more specific type.
+  kDefault,
+  // The IO thread, and other threads servicing IPC.
+  kIO,
+  // Compositor and display threads.
+  kCompositing,
+  // The main thread of renderer processes.
+  kRendererMain,
+  // Thread pool workers running BEST_EFFORT tasks, and other background work.
+  kBackground,
+  kMaxValue = kBackground
+};
+
+// The sets of cores a CpuAffinityPolicy can restrict a thread to. On hardware
+// where a set can't be told apart from the others, it contains all cores.
+enum class CpuCoreSet {
+  kAll,
+  // The LITTLE cores of big.LITTLE-like architectures.
+  kLittle,
+  // All cores but the LITTLE ones.
+  kBig,
+  // The cores of the NUMA node that SetCpuAffinityPolicy() was last called
+  // from, on hosts with more than one node.
+  kLocalNumaNode
+};
+
+// Maps each CpuAffinityThreadType to the CpuCoreSet its threads run on.
+class BASE_EXPORT CpuAffinityPolicy {
+ public:
+  // Places every type of thread on all cores.
+  CpuAffinityPolicy();
+
+  // Returns a policy suited to the topology detected from base::CPU and sysfs:
+  // on big.LITTLE-like CPUs, latency sensitive threads run on the big cores
+  // and background threads on the LITTLE ones; on NUMA hosts, latency
+  // sensitive threads share the local node. Elsewhere, places every type of
+  // thread on all cores.
+  static CpuAffinityPolicy ForCurrentHardware();
+
+  void SetCoreSet(CpuAffinityThreadType thread_type, CpuCoreSet core_set);
+  CpuCoreSet GetCoreSet(CpuAffinityThreadType thread_type) const;
+
+  bool operator==(const CpuAffinityPolicy& other) const;
+  bool operator!=(const CpuAffinityPolicy& other) const;
+
+ private:
+  static constexpr size_t kThreadTypeCount =
+      static_cast<size_t>(CpuAffinityThreadType::kMaxValue) + 1;
+
+  std::array<CpuCoreSet, kThreadTypeCount> core_sets_;
+};
+
+// Declares the type of the calling thread, and restricts it to the cores the
+// current policy has for that type. Meant to be called once, as the thread
+// starts. Until it exits, the thread then follows SetCpuAffinityPolicy() calls,
+// overriding any SetThreadCpuAffinityMode() made in between. Returns false if
+// updating the affinity failed.
+BASE_EXPORT bool SetCurrentThreadCpuAffinityType(
+    CpuAffinityThreadType thread_type);
+
+// Replaces the policy of the current process, and applies it to every thread
+// that declared its type. Returns false if updating any of them failed.
+BASE_EXPORT bool SetCpuAffinityPolicy(const CpuAffinityPolicy& policy);
+
+// Returns the policy of the current process, which places every type of thread
+// on all cores until SetCpuAffinityPolicy() is called.
+BASE_EXPORT CpuAffinityPolicy GetCpuAffinityPolicy();
+
+// Returns the cores in |core_set|, as the current policy would apply them.
+BASE_EXPORT cpu_set_t GetCpuCoreSetMask(CpuCoreSet core_set);
+
+namespace internal {
+
+// Parses a CPU list in the sysfs format, e.g. "0-3,8,10-11", into |set|.
+// Returns false if |cpu_list| is malformed.
+BASE_EXPORT bool ParseCpuList(StringPiece cpu_list, cpu_set_t* set);
+
+}  // namespace internal
+
 }  // namespace base
 
 #endif  // BASE_CPU_AFFINITY_POSIX_H_
@@ -14,6 +14,7 @@
 #include "base/threading/thread.h"
 #include "build/build_config.h"
 #include "testing/gtest/include/gtest/gtest.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
 
 namespace base {
 
@@ -21,8 +22,11 @@ namespace {
 
 class TestThread : public PlatformThread::Delegate {
  public:
-  TestThread()
-      : termination_ready_(WaitableEvent::ResetPolicy::MANUAL,
+  // If |thread_type| is set, the thread declares it as it starts.
+  explicit TestThread(
+      absl::optional<CpuAffinityThreadType> thread_type = absl::nullopt)
+      : thread_type_(thread_type),
+        termination_ready_(WaitableEvent::ResetPolicy::MANUAL,
                            WaitableEvent::InitialState::NOT_SIGNALED),
         terminate_thread_(WaitableEvent::ResetPolicy::MANUAL,
                           WaitableEvent::InitialState::NOT_SIGNALED) {}
@@ -44,6 +48,9 @@ class TestThread : public PlatformThread::Delegate {
     // Make sure that the thread ID is the same across calls.
     EXPECT_EQ(thread_id_, PlatformThread::CurrentId());
 
+    if (thread_type_)
+      EXPECT_TRUE(SetCurrentThreadCpuAffinityType(*thread_type_));
+
     termination_ready_.Signal();
     terminate_thread_.Wait();
 
@@ -65,6 +72,7 @@ class TestThread : public PlatformThread::Delegate {
   void MarkForTermination() { terminate_thread_.Signal(); }
 
  private:
+  const absl::optional<CpuAffinityThreadType> thread_type_;
   PlatformThreadId thread_id_ = kInvalidThreadId;
 
   mutable WaitableEvent termination_ready_;
@@ -72,6 +80,27 @@ class TestThread : public PlatformThread::Delegate {
   bool done_ = false;
 };
 
+// Restores the policy of the process when going out of scope.
+class ScopedCpuAffinityPolicy {
+ public:
+  explicit ScopedCpuAffinityPolicy(const CpuAffinityPolicy& policy)
+      : old_policy_(GetCpuAffinityPolicy()) {
+    SetCpuAffinityPolicy(policy);
+  }
+  ScopedCpuAffinityPolicy(const ScopedCpuAffinityPolicy&) = delete;
+  ScopedCpuAffinityPolicy& operator=(const ScopedCpuAffinityPolicy&) = delete;
+  ~ScopedCpuAffinityPolicy() { SetCpuAffinityPolicy(old_policy_); }
+
+ private:
+  const CpuAffinityPolicy old_policy_;
+};
+
+cpu_set_t GetThreadAffinity(PlatformThreadId thread_id) {
+  cpu_set_t set;
+  EXPECT_EQ(sched_getaffinity(thread_id, sizeof(set), &set), 0);
+  return set;
+}
+
 }  // namespace
 
 #if defined(OS_ANDROID)
@@ -133,4 +162,122 @@ TEST(CpuAffinityTest, MAYBE_SetThreadCpuAffinityMode) {
   ASSERT_FALSE(thread.IsRunning());
 }
 
+TEST(CpuAffinityTest, ParseCpuList) {
+  cpu_set_t set;
+  ASSERT_TRUE(internal::ParseCpuList("0-3,8,10-11\n", &set));
+  EXPECT_EQ(CPU_COUNT(&set), 7);
+  for (int cpu : {0, 1, 2, 3, 8, 10, 11})
+    EXPECT_TRUE(CPU_ISSET(cpu, &set)) << cpu;
+
+  ASSERT_TRUE(internal::ParseCpuList("5", &set));
+  EXPECT_EQ(CPU_COUNT(&set), 1);
+  EXPECT_TRUE(CPU_ISSET(5, &set));
+
+  // Nodes without cores have an empty list.
+  ASSERT_TRUE(internal::ParseCpuList("\n", &set));
+  EXPECT_EQ(CPU_COUNT(&set), 0);
+
+  EXPECT_FALSE(internal::ParseCpuList("3-1", &set));
+  EXPECT_FALSE(internal::ParseCpuList("1-2-3", &set));
+  EXPECT_FALSE(internal::ParseCpuList("0-", &set));
+  EXPECT_FALSE(internal::ParseCpuList("a", &set));
+  EXPECT_FALSE(internal::ParseCpuList("0-100000", &set));
+}
+
+TEST(CpuAffinityTest, CpuAffinityPolicy) {
+  CpuAffinityPolicy policy;
+  EXPECT_EQ(policy.GetCoreSet(CpuAffinityThreadType::kIO), CpuCoreSet::kAll);
+  policy.SetCoreSet(CpuAffinityThreadType::kIO, CpuCoreSet::kBig);
+  EXPECT_EQ(policy.GetCoreSet(CpuAffinityThreadType::kIO), CpuCoreSet::kBig);
+  EXPECT_EQ(policy.GetCoreSet(CpuAffinityThreadType::kBackground),
+            CpuCoreSet::kAll);
+  EXPECT_NE(policy, CpuAffinityPolicy());
+
+  // Threads that didn't declare a type are never restricted.
+  CpuAffinityPolicy hardware_policy = CpuAffinityPolicy::ForCurrentHardware();
+  EXPECT_EQ(hardware_policy.GetCoreSet(CpuAffinityThreadType::kDefault),
+            CpuCoreSet::kAll);
+  if (!HasBigCpuCores()) {
+    EXPECT_EQ(hardware_policy.GetCoreSet(CpuAffinityThreadType::kBackground),
+              CpuCoreSet::kAll);
+  }
+}
+
+TEST(CpuAffinityTest, CpuCoreSetMask) {
+  cpu_set_t all_cores = GetCpuCoreSetMask(CpuCoreSet::kAll);
+  for (CpuCoreSet core_set : {CpuCoreSet::kLittle, CpuCoreSet::kBig,
+                              CpuCoreSet::kLocalNumaNode}) {
+    cpu_set_t set = GetCpuCoreSetMask(core_set);
+    cpu_set_t intersection;
+    CPU_AND(&intersection, &set, &all_cores);
+    EXPECT_TRUE(CPU_EQUAL(&intersection, &set));
+    EXPECT_GT(CPU_COUNT(&set), 0);
+  }
+
+  if (!HasBigCpuCores()) {
+    cpu_set_t little_cores = GetCpuCoreSetMask(CpuCoreSet::kLittle);
+    cpu_set_t big_cores = GetCpuCoreSetMask(CpuCoreSet::kBig);
+    EXPECT_TRUE(CPU_EQUAL(&little_cores, &all_cores));
+    EXPECT_TRUE(CPU_EQUAL(&big_cores, &all_cores));
+  }
+}
+
+#if defined(OS_ANDROID)
+#define MAYBE_ThreadsFollowCpuAffinityPolicy ThreadsFollowCpuAffinityPolicy
+#else
+// The linux-trusty-rel bot fails to sched_setaffinity(), see above.
+#define MAYBE_ThreadsFollowCpuAffinityPolicy \
+  DISABLED_ThreadsFollowCpuAffinityPolicy
+#endif
+TEST(CpuAffinityTest, MAYBE_ThreadsFollowCpuAffinityPolicy) {
+  CpuAffinityPolicy policy;
+  policy.SetCoreSet(CpuAffinityThreadType::kBackground, CpuCoreSet::kLittle);
+  policy.SetCoreSet(CpuAffinityThreadType::kIO, CpuCoreSet::kBig);
+  ScopedCpuAffinityPolicy scoped_policy(policy);
+
+  const cpu_set_t all_cores = GetCpuCoreSetMask(CpuCoreSet::kAll);
+  const cpu_set_t little_cores = GetCpuCoreSetMask(CpuCoreSet::kLittle);
+  const cpu_set_t big_cores = GetCpuCoreSetMask(CpuCoreSet::kBig);
+
+  TestThread background_thread(CpuAffinityThreadType::kBackground);
+  TestThread io_thread(CpuAffinityThreadType::kIO);
+  TestThread other_thread;
+  PlatformThreadHandle background_handle;
+  PlatformThreadHandle io_handle;
+  PlatformThreadHandle other_handle;
+  ASSERT_TRUE(
+      PlatformThread::Create(0, &background_thread, &background_handle));
+  ASSERT_TRUE(PlatformThread::Create(0, &io_thread, &io_handle));
+  ASSERT_TRUE(PlatformThread::Create(0, &other_thread, &other_handle));
+  background_thread.WaitForTerminationReady();
+  io_thread.WaitForTerminationReady();
+  other_thread.WaitForTerminationReady();
+
+  cpu_set_t set = GetThreadAffinity(background_thread.thread_id());
+  EXPECT_TRUE(CPU_EQUAL(&set, &little_cores));
+  set = GetThreadAffinity(io_thread.thread_id());
+  EXPECT_TRUE(CPU_EQUAL(&set, &big_cores));
+  set = GetThreadAffinity(other_thread.thread_id());
+  EXPECT_TRUE(CPU_EQUAL(&set, &all_cores));
+
+  // Switching the policy moves the threads that declared their type.
+  EXPECT_TRUE(SetCpuAffinityPolicy(CpuAffinityPolicy()));
+  set = GetThreadAffinity(background_thread.thread_id());
+  EXPECT_TRUE(CPU_EQUAL(&set, &all_cores));
+  set = GetThreadAffinity(io_thread.thread_id());
+  EXPECT_TRUE(CPU_EQUAL(&set, &all_cores));
+
+  // Threads stop following the policy once they exit.
+  background_thread.MarkForTermination();
+  PlatformThread::Join(background_handle);
+  EXPECT_TRUE(SetCpuAffinityPolicy(policy));
+  set = GetThreadAffinity(io_thread.thread_id());
+  EXPECT_TRUE(CPU_EQUAL(&set, &big_cores));
+
+  io_thread.MarkForTermination();
+  other_thread.MarkForTermination();
+  PlatformThread::Join(io_handle);
+  PlatformThread::Join(other_handle);
+}
+
 }  // namespace base
@@ -14,6 +14,8 @@
 
 #include <stddef.h>
 
+#include <atomic>
+
 #include "base/base_paths.h"
 #include "base/base_switches.h"
 #include "base/containers/contains.h"
@@ -44,6 +46,17 @@ FeatureList* g_feature_list_instance = nullptr;
 // which Feature that accessor was for, if so.
 const Feature* g_initialized_from_accessor = nullptr;
 
+// Source of FeatureList::caching_context_. Tests create many FeatureList
+// instances, possibly on different threads. Starts at 1 since 0 marks an empty
+// Feature::cached_state.
+std::atomic<uint32_t> g_next_caching_context{1};
+
+// Feature::cached_state holds the caching context in the upper 31 bits and
+// the enabled state in the lowest bit.
+uint32_t PackCachedState(uint32_t caching_context, bool enabled) {
+  return (caching_context << 1) | (enabled ? 1 : 0);
+}
+
 #if DCHECK_IS_ON()
 // Tracks whether the use of base::Feature is allowed for this module.
 // See ForbidUseForCurrentModule().
@@ -188,7 +201,12 @@ const Feature kDCheckIsFatalFeature{"DcheckIsFatal",
                                     FEATURE_DISABLED_BY_DEFAULT};
 #endif  // defined(DCHECK_IS_CONFIGURABLE)
 
-FeatureList::FeatureList() = default;
+FeatureList::FeatureList()
+    : caching_context_(
+          g_next_caching_context.fetch_add(1, std::memory_order_relaxed)) {
+  // Wrapping around would take billions of instances; 0 must stay unused.
+  DCHECK_LT(caching_context_, 1u << 31);
+}
 
 FeatureList::~FeatureList() = default;
 
@@ -509,6 +527,20 @@ void FeatureList::FinalizeInitialization() {
 
 bool FeatureList::IsFeatureEnabled(const Feature& feature) {
   DCHECK(initialized_);
+
+  // Overrides can't change after FinalizeInitialization(), so a state cached
+  // for this instance is still valid. The field trial, if any, was activated
+  // by the call that cached it.
+  const uint32_t cached_state = feature.cached_state.Get();
+  if ((cached_state >> 1) == caching_context_)
+    return cached_state & 1;
+
+  const bool enabled = IsFeatureEnabledUncached(feature);
+  feature.cached_state.Set(PackCachedState(caching_context_, enabled));
+  return enabled;
+}
+
+bool FeatureList::IsFeatureEnabledUncached(const Feature& feature) {
   DCHECK(IsValidFeatureOrFieldTrialName(feature.name)) << feature.name;
   DCHECK(CheckFeatureIdentity(feature)) << feature.name;
 
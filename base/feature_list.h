@@ -5,6 +5,9 @@
 #ifndef BASE_FEATURE_LIST_H_
 #define BASE_FEATURE_LIST_H_
 
+#include <stdint.h>
+
+#include <atomic>
 #include <functional>
 #include <map>
 #include <memory>
@@ -33,6 +36,32 @@ enum FeatureState {
   FEATURE_ENABLED_BY_DEFAULT,
 };
 
+namespace internal {
+
+// Holds the result of FeatureList::IsEnabled() for a Feature, tagged with the
+// FeatureList instance it was computed for. Only used by FeatureList. Copies
+// start out empty, since a copy is a different Feature as far as FeatureList
+// is concerned.
+class FeatureStateCache {
+ public:
+  constexpr FeatureStateCache() = default;
+  FeatureStateCache(const FeatureStateCache&) {}
+  FeatureStateCache& operator=(const FeatureStateCache&) {
+    value_.store(0, std::memory_order_relaxed);
+    return *this;
+  }
+
+  uint32_t Get() const { return value_.load(std::memory_order_relaxed); }
+  void Set(uint32_t value) const {
+    value_.store(value, std::memory_order_relaxed);
+  }
+
+ private:
+  mutable std::atomic<uint32_t> value_{0};
+};
+
+}  // namespace internal
+
 // The Feature struct is used to define the default state for a feature. See
 // comment below for more details. There must only ever be one struct instance
 // for a given feature name - generally defined as a constant global variable or
@@ -49,6 +78,10 @@ struct BASE_EXPORT Feature {
   // NOTE: The actual runtime state may be different, due to a field trial or a
   // command line switch.
   const FeatureState default_state;
+
+  // Cached runtime state, so that repeated FeatureList::IsEnabled() calls do
+  // not look up overrides by name. Not to be set in definitions.
+  internal::FeatureStateCache cached_state = {};
 };
 
 #if defined(DCHECK_IS_CONFIGURABLE)
@@ -237,6 +270,9 @@ class BASE_EXPORT FeatureList {
   // the singleton instance has been registered via SetInstance(). Additionally,
   // a feature with a given name must only have a single corresponding Feature
   // struct, which is checked in builds with DCHECKs enabled.
+  //
+  // The result is cached in |feature| for the current instance, so after the
+  // first call this costs a load and a compare.
   static bool IsEnabled(const Feature& feature);
 
   // Returns the field trial associated with the given |feature|. Must only be
@@ -336,6 +372,10 @@ class BASE_EXPORT FeatureList {
   // Requires the FeatureList to have already been fully initialized.
   bool IsFeatureEnabled(const Feature& feature);
 
+  // Same as IsFeatureEnabled(), without looking at or updating the state cached
+  // in |feature|.
+  bool IsFeatureEnabledUncached(const Feature& feature);
+
   // Returns the field trial associated with the given |feature|. This is
   // invoked by the public FeatureList::GetFieldTrial() static function on the
   // global singleton. Requires the FeatureList to have already been fully
@@ -397,6 +437,10 @@ class BASE_EXPORT FeatureList {
 
   // Whether this object has been initialized from command line.
   bool initialized_from_command_line_ = false;
+
+  // Identifies this instance in Feature::cached_state. Unique per instance and
+  // never 0, which marks an empty cache.
+  const uint32_t caching_context_;
 };
 
 }  // namespace base
@@ -0,0 +1,107 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/feature_list.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/scoped_feature_list.h"
+#include "base/timer/elapsed_timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace base {
+
+namespace {
+
+constexpr char kMetricPrefixFeatureList[] = "FeatureList.";
+constexpr char kMetricIsEnabledTime[] = "is_enabled_time";
+
+// Roughly the number of features a browser process checks, and the number of
+// overrides a typical field trial configuration registers.
+constexpr int kNumFeatures = 1000;
+constexpr int kNumOverrides = 200;
+constexpr int kLaps = 100;
+
+perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixFeatureList, story_name);
+  reporter.RegisterImportantMetric(kMetricIsEnabledTime, "ns");
+  return reporter;
+}
+
+class FeatureListPerfTest : public testing::Test {
+ public:
+  FeatureListPerfTest() {
+    std::vector<std::string> enabled;
+    names_.reserve(kNumFeatures);
+    for (int i = 0; i < kNumFeatures; ++i) {
+      names_.push_back(StringPrintf("PerfTestFeature%d", i));
+      features_.push_back(std::make_unique<Feature>(
+          Feature{names_.back().c_str(), FEATURE_DISABLED_BY_DEFAULT}));
+      if (i % (kNumFeatures / kNumOverrides) == 0)
+        enabled.push_back(names_.back());
+    }
+    enable_features_ = JoinString(enabled, ",");
+  }
+
+  // Installs a new FeatureList, so that no Feature has a state cached for it.
+  void ResetFeatureList() {
+    scoped_feature_list_.reset();
+    auto feature_list = std::make_unique<FeatureList>();
+    feature_list->InitializeFromCommandLine(enable_features_, "");
+    scoped_feature_list_ = std::make_unique<test::ScopedFeatureList>();
+    scoped_feature_list_->InitWithFeatureList(std::move(feature_list));
+  }
+
+  // Checks every feature once, and returns how many are enabled.
+  int CheckAllFeatures() {
+    int enabled = 0;
+    for (const auto& feature : features_)
+      enabled += FeatureList::IsEnabled(*feature);
+    return enabled;
+  }
+
+ private:
+  // Feature only points to its name, which must outlive it and not move.
+  std::vector<std::string> names_;
+  std::vector<std::unique_ptr<Feature>> features_;
+  std::string enable_features_;
+  std::unique_ptr<test::ScopedFeatureList> scoped_feature_list_;
+};
+
+}  // namespace
+
+// The first check of each feature after a FeatureList is installed looks up
+// its overrides by name.
+TEST_F(FeatureListPerfTest, FirstCheck) {
+  TimeDelta elapsed;
+  for (int lap = 0; lap < kLaps; ++lap) {
+    ResetFeatureList();
+    ElapsedTimer timer;
+    EXPECT_EQ(kNumOverrides, CheckAllFeatures());
+    elapsed += timer.Elapsed();
+  }
+  SetUpReporter("first_check")
+      .AddResult(kMetricIsEnabledTime,
+                 elapsed.InNanosecondsF() / (kLaps * kNumFeatures));
+}
+
+// Later checks use the state cached in the Feature.
+TEST_F(FeatureListPerfTest, CachedCheck) {
+  ResetFeatureList();
+  EXPECT_EQ(kNumOverrides, CheckAllFeatures());
+
+  ElapsedTimer timer;
+  for (int lap = 0; lap < kLaps; ++lap)
+    EXPECT_EQ(kNumOverrides, CheckAllFeatures());
+  SetUpReporter("cached_check")
+      .AddResult(kMetricIsEnabledTime,
+                 timer.Elapsed().InNanosecondsF() / (kLaps * kNumFeatures));
+}
+
+}  // namespace base
@@ -64,6 +64,45 @@ TEST_F(FeatureListTest, DefaultStates) {
   EXPECT_FALSE(FeatureList::IsEnabled(kFeatureOffByDefault));
 }
 
+TEST_F(FeatureListTest, CachedStateFollowsInstance) {
+  // Check twice, so that the second check hits the cache.
+  EXPECT_TRUE(FeatureList::IsEnabled(kFeatureOnByDefault));
+  EXPECT_TRUE(FeatureList::IsEnabled(kFeatureOnByDefault));
+  EXPECT_FALSE(FeatureList::IsEnabled(kFeatureOffByDefault));
+  EXPECT_FALSE(FeatureList::IsEnabled(kFeatureOffByDefault));
+
+  {
+    auto feature_list = std::make_unique<FeatureList>();
+    feature_list->InitializeFromCommandLine(kFeatureOffByDefaultName,
+                                            kFeatureOnByDefaultName);
+    test::ScopedFeatureList scoped_feature_list;
+    scoped_feature_list.InitWithFeatureList(std::move(feature_list));
+
+    // States cached for the previous instance are not used.
+    EXPECT_FALSE(FeatureList::IsEnabled(kFeatureOnByDefault));
+    EXPECT_FALSE(FeatureList::IsEnabled(kFeatureOnByDefault));
+    EXPECT_TRUE(FeatureList::IsEnabled(kFeatureOffByDefault));
+    EXPECT_TRUE(FeatureList::IsEnabled(kFeatureOffByDefault));
+  }
+
+  // Nor after restoring the previous instance.
+  EXPECT_TRUE(FeatureList::IsEnabled(kFeatureOnByDefault));
+  EXPECT_FALSE(FeatureList::IsEnabled(kFeatureOffByDefault));
+}
+
+TEST(FeatureStateCacheTest, CopiesStartEmpty) {
+  internal::FeatureStateCache cache;
+  EXPECT_EQ(0u, cache.Get());
+  cache.Set(3);
+  EXPECT_EQ(3u, cache.Get());
+
+  internal::FeatureStateCache copy(cache);
+  EXPECT_EQ(0u, copy.Get());
+  copy.Set(5);
+  copy = cache;
+  EXPECT_EQ(0u, copy.Get());
+}
+
 TEST_F(FeatureListTest, InitializeFromCommandLine) {
   struct {
     const char* enable_features;
@@ -205,6 +244,10 @@ TEST_F(FeatureListTest, FieldTrialOverrides) {
     // The above should have activated |trial2|.
     EXPECT_TRUE(FieldTrialList::IsTrialActive(trial1->trial_name()));
     EXPECT_TRUE(FieldTrialList::IsTrialActive(trial2->trial_name()));
+
+    // Cached states match.
+    EXPECT_EQ(expected_enabled_1, FeatureList::IsEnabled(kFeatureOnByDefault));
+    EXPECT_EQ(expected_enabled_2, FeatureList::IsEnabled(kFeatureOffByDefault));
   }
 }
 
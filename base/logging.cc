@@ -93,6 +93,7 @@ typedef FILE* FileHandle;
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <ctime>
 #include <iomanip>
@@ -109,9 +110,11 @@ typedef FILE* FileHandle;
 #include "base/debug/debugger.h"
 #include "base/debug/stack_trace.h"
 #include "base/debug/task_trace.h"
+#include "base/logging_async_sink.h"
 #include "base/no_destructor.h"
 #include "base/path_service.h"
 #include "base/posix/eintr_wrapper.h"
+#include "base/strings/string_number_conversions.h"
 #include "base/strings/string_piece.h"
 #include "base/strings/string_split.h"
 #include "base/strings/string_util.h"
@@ -414,6 +417,8 @@ bool BaseInitLoggingImpl(const LoggingSettings& settings) {
     }
   }
 
+  // Pending messages go where they were meant to.
+  FlushAsyncLogging();
   g_logging_destination = settings.logging_dest;
 
 #if defined(OS_FUCHSIA)
@@ -494,6 +499,84 @@ bool ShouldLogToStderr(int severity) {
   return false;
 }
 
+namespace {
+
+// Destinations of a message, for the async sink.
+constexpr uint8_t kWriteToStderr = 1 << 0;
+constexpr uint8_t kWriteToFile = 1 << 1;
+
+uint8_t GetWriteDestinations(int severity) {
+  uint8_t destinations = 0;
+  if (ShouldLogToStderr(severity))
+    destinations |= kWriteToStderr;
+  if ((g_logging_destination & LOG_TO_FILE) != 0)
+    destinations |= kWriteToFile;
+  return destinations;
+}
+
+// Writes |text|, one or more newline-terminated messages, to |destinations|.
+void WriteToDestinations(uint8_t destinations, base::StringPiece text) {
+  if (destinations & kWriteToStderr) {
+    ignore_result(fwrite(text.data(), text.size(), 1, stderr));
+    fflush(stderr);
+  }
+
+  if (destinations & kWriteToFile) {
+    // We can have multiple threads and/or processes, so try to prevent them
+    // from clobbering each other's writes.
+    // If the client app did not call InitLogging, and the lock has not
+    // been created do it now. We do this on demand, but if two threads try
+    // to do this at the same time, there will be a race condition to create
+    // the lock. This is why InitLogging should be called from the main
+    // thread at the beginning of execution.
+#if defined(OS_POSIX) || defined(OS_FUCHSIA)
+    base::AutoLock guard(GetLoggingLock());
+#endif
+    if (InitializeLogFileHandle()) {
+#if defined(OS_WIN)
+      DWORD num_written;
+      WriteFile(g_log_file,
+                static_cast<const void*>(text.data()),
+                static_cast<DWORD>(text.length()),
+                &num_written,
+                nullptr);
+#elif defined(OS_POSIX) || defined(OS_FUCHSIA)
+      ignore_result(fwrite(text.data(), text.size(), 1, g_log_file));
+      fflush(g_log_file);
+#else
+#error Unsupported platform
+#endif
+    }
+  }
+}
+
+// Writes out the messages of the async sink.
+class AsyncLogSinkClient : public AsyncLogSink::Client {
+ public:
+  // AsyncLogSink::Client:
+  void Write(uint8_t destinations, base::StringPiece messages) override {
+    WriteToDestinations(destinations, messages);
+  }
+  void OnMessagesDropped(uint64_t count) override {
+    WriteToDestinations(GetWriteDestinations(LOGGING_WARNING),
+                        "[WARNING:logging.cc] Async logging dropped " +
+                            base::NumberToString(count) + " messages\n");
+  }
+};
+
+// True while non-fatal messages go through GetAsyncLogSink().
+std::atomic<bool> g_async_logging_enabled{false};
+
+// Created on first use and never destroyed, since other threads may still be
+// enqueuing messages after async logging is disabled.
+AsyncLogSink* GetAsyncLogSink() {
+  static base::NoDestructor<AsyncLogSinkClient> client;
+  static base::NoDestructor<AsyncLogSink> sink(client.get());
+  return sink.get();
+}
+
+}  // namespace
+
 int GetVlogVerbosity() {
   return std::max(-1, LOG_INFO - GetMinLogLevel());
 }
@@ -503,9 +586,9 @@ int GetVlogLevelHelper(const char* file, size_t N) {
   // Note: |g_vlog_info| may change on a different thread during startup
   // (but will always be valid or nullptr).
   VlogInfo* vlog_info = g_vlog_info;
-  return vlog_info ?
-      vlog_info->GetVlogLevel(base::StringPiece(file, N - 1)) :
-      GetVlogVerbosity();
+  return vlog_info ? vlog_info->GetVlogLevelForStaticFile(
+                         base::StringPiece(file, N - 1))
+                   : GetVlogVerbosity();
 }
 
 void SetLogItems(bool enable_process_id, bool enable_thread_id,
@@ -607,6 +690,10 @@ LogMessage::~LogMessage() {
   TRACE_LOG_MESSAGE(
       file_, base::StringPiece(str_newline).substr(message_start_), line_);
 
+  // Make sure earlier messages are out before the process goes down.
+  if (severity_ == LOGGING_FATAL)
+    FlushAsyncLogging();
+
   // Give any log message handler first dibs on the message.
   if (g_log_message_handler &&
       g_log_message_handler(severity_, file_, line_, message_start_,
@@ -815,38 +902,12 @@ LogMessage::~LogMessage() {
 #endif  // OS_FUCHSIA
   }
 
-  if (ShouldLogToStderr(severity_)) {
-    ignore_result(fwrite(str_newline.data(), str_newline.size(), 1, stderr));
-    fflush(stderr);
-  }
-
-  if ((g_logging_destination & LOG_TO_FILE) != 0) {
-    // We can have multiple threads and/or processes, so try to prevent them
-    // from clobbering each other's writes.
-    // If the client app did not call InitLogging, and the lock has not
-    // been created do it now. We do this on demand, but if two threads try
-    // to do this at the same time, there will be a race condition to create
-    // the lock. This is why InitLogging should be called from the main
-    // thread at the beginning of execution.
-#if defined(OS_POSIX) || defined(OS_FUCHSIA)
-    base::AutoLock guard(GetLoggingLock());
-#endif
-    if (InitializeLogFileHandle()) {
-#if defined(OS_WIN)
-      DWORD num_written;
-      WriteFile(g_log_file,
-                static_cast<const void*>(str_newline.c_str()),
-                static_cast<DWORD>(str_newline.length()),
-                &num_written,
-                nullptr);
-#elif defined(OS_POSIX) || defined(OS_FUCHSIA)
-      ignore_result(fwrite(
-          str_newline.data(), str_newline.size(), 1, g_log_file));
-      fflush(g_log_file);
-#else
-#error Unsupported platform
-#endif
-    }
+  const uint8_t destinations = GetWriteDestinations(severity_);
+  if (destinations && severity_ != LOGGING_FATAL &&
+      g_async_logging_enabled.load(std::memory_order_relaxed)) {
+    GetAsyncLogSink()->Enqueue(destinations, str_newline);
+  } else if (destinations) {
+    WriteToDestinations(destinations, str_newline);
   }
 
   if (severity_ == LOGGING_FATAL) {
@@ -1030,7 +1091,28 @@ ErrnoLogMessage::~ErrnoLogMessage() {
 }
 #endif  // defined(OS_WIN)
 
+void EnableAsyncLogging() {
+  GetAsyncLogSink()->Start();
+  g_async_logging_enabled.store(true, std::memory_order_relaxed);
+}
+
+void DisableAsyncLogging() {
+  if (!g_async_logging_enabled.exchange(false, std::memory_order_relaxed))
+    return;
+  GetAsyncLogSink()->Stop();
+}
+
+void FlushAsyncLogging() {
+  if (g_async_logging_enabled.load(std::memory_order_relaxed))
+    GetAsyncLogSink()->Flush();
+}
+
+uint64_t GetAsyncLoggingDroppedCount() {
+  return GetAsyncLogSink()->dropped_count();
+}
+
 void CloseLogFile() {
+  FlushAsyncLogging();
 #if defined(OS_POSIX) || defined(OS_FUCHSIA)
   base::AutoLock guard(GetLoggingLock());
 #endif
@@ -295,7 +295,8 @@ BASE_EXPORT bool ShouldCreateLogMessage(int severity);
 // Gets the VLOG default verbosity level.
 BASE_EXPORT int GetVlogVerbosity();
 
-// Note that |N| is the size *with* the null terminator.
+// Note that |N| is the size *with* the null terminator. |file_start| must
+// point to a string literal, as results are cached by its address.
 BASE_EXPORT int GetVlogLevelHelper(const char* file_start, size_t N);
 
 // Gets the current vlog level for the given file (usually taken from __FILE__).
@@ -678,6 +679,32 @@ class BASE_EXPORT ErrnoLogMessage : public LogMessage {
 };
 #endif  // OS_WIN
 
+// Moves writing non-fatal messages to stderr and the log file off the logging
+// threads, which then only append them to a per-thread lock-free buffer. A
+// background thread writes them out within about 100ms. Messages logged faster
+// than that are dropped, and counted, rather than blocking the logging thread.
+// Each thread's messages are written in the order it logged them, but messages
+// logged concurrently on different threads may be written out of order. Other
+// destinations, such as the system debug log, and the log message handler, are
+// not affected.
+//
+// FATAL messages, including CHECK failures, flush pending messages and are
+// then written synchronously, so that nothing logged before a crash is lost.
+// So are messages larger than half a thread's 32KB buffer, which could
+// otherwise rarely be buffered.
+BASE_EXPORT void EnableAsyncLogging();
+
+// Flushes pending messages and stops the background thread. Messages that
+// other threads log concurrently with this call may be lost.
+BASE_EXPORT void DisableAsyncLogging();
+
+// Writes out all messages logged so far, before returning. Does nothing if
+// async logging is disabled.
+BASE_EXPORT void FlushAsyncLogging();
+
+// Returns the number of messages dropped by async logging so far.
+BASE_EXPORT uint64_t GetAsyncLoggingDroppedCount();
+
 // Closes the log file explicitly if open.
 // NOTE: Since the log file is opened as necessary by the action of logging
 //       statements, there's no guarantee that it will stay closed
@@ -0,0 +1,324 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/logging_async_sink.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "base/bits.h"
+#include "base/check.h"
+#include "base/containers/cxx20_erase_vector.h"
+
+namespace logging {
+
+namespace {
+
+struct RecordHeader {
+  uint64_t sequence_number;
+  uint32_t size;
+  uint32_t destinations;
+};
+
+// A message popped from a ThreadBuffer, with its text stored elsewhere.
+struct Record {
+  uint64_t sequence_number;
+  uint8_t destinations;
+  size_t offset;
+  size_t size;
+};
+
+}  // namespace
+
+// A single-producer, single-consumer ring buffer of messages. The producer is
+// the thread owning the buffer; consumers hold the sink's |drain_lock_|.
+class AsyncLogSink::ThreadBuffer {
+ public:
+  enum class PushResult {
+    kDropped,
+    kPushed,
+    // The buffer just became more than half full.
+    kPushedPastHalf,
+  };
+
+  explicit ThreadBuffer(size_t size)
+      : data_(std::make_unique<char[]>(size)), size_(size) {}
+  ThreadBuffer(const ThreadBuffer&) = delete;
+  ThreadBuffer& operator=(const ThreadBuffer&) = delete;
+  ~ThreadBuffer() = default;
+
+  // Called on the owning thread only.
+  PushResult Push(uint64_t sequence_number,
+                  uint8_t destinations,
+                  base::StringPiece message) {
+    const size_t record_size = sizeof(RecordHeader) + message.size();
+    const uint64_t write_position =
+        write_position_.load(std::memory_order_relaxed);
+    // Acquire, so that the consumer is done reading the space it freed.
+    const size_t used =
+        write_position - read_position_.load(std::memory_order_acquire);
+    if (record_size > size_ - used) {
+      dropped_count_.fetch_add(1, std::memory_order_relaxed);
+      return PushResult::kDropped;
+    }
+
+    const RecordHeader header = {sequence_number,
+                                 static_cast<uint32_t>(message.size()),
+                                 destinations};
+    CopyIn(write_position, &header, sizeof(header));
+    CopyIn(write_position + sizeof(header), message.data(), message.size());
+    // Release, so that the consumer sees the record once it sees the position.
+    write_position_.store(write_position + record_size,
+                          std::memory_order_release);
+
+    const size_t half = size_ / 2;
+    return used <= half && used + record_size > half
+               ? PushResult::kPushedPastHalf
+               : PushResult::kPushed;
+  }
+
+  // Appends all messages to |records|, and their text to |text|, then frees
+  // their space.
+  void Pop(std::vector<Record>* records, std::string* text) {
+    const uint64_t write_position =
+        write_position_.load(std::memory_order_acquire);
+    uint64_t read_position = read_position_.load(std::memory_order_relaxed);
+    while (read_position != write_position) {
+      RecordHeader header;
+      CopyOut(read_position, &header, sizeof(header));
+      const size_t offset = text->size();
+      text->resize(offset + header.size);
+      CopyOut(read_position + sizeof(header), &(*text)[offset], header.size);
+      records->push_back({header.sequence_number,
+                          static_cast<uint8_t>(header.destinations), offset,
+                          header.size});
+      read_position += sizeof(header) + header.size;
+    }
+    read_position_.store(read_position, std::memory_order_release);
+  }
+
+  bool empty() const {
+    return read_position_.load(std::memory_order_relaxed) ==
+           write_position_.load(std::memory_order_acquire);
+  }
+
+  uint64_t dropped_count() const {
+    return dropped_count_.load(std::memory_order_relaxed);
+  }
+
+  void set_thread_exited() {
+    thread_exited_.store(true, std::memory_order_release);
+  }
+  bool thread_exited() const {
+    return thread_exited_.load(std::memory_order_acquire);
+  }
+
+ private:
+  // Copies |size| bytes at |position| of the stream in or out of the ring,
+  // wrapping around its end.
+  void CopyIn(uint64_t position, const void* data, size_t size) {
+    const size_t offset = position & (size_ - 1);
+    const size_t first = std::min(size, size_ - offset);
+    memcpy(data_.get() + offset, data, first);
+    memcpy(data_.get(), static_cast<const char*>(data) + first, size - first);
+  }
+  void CopyOut(uint64_t position, void* data, size_t size) const {
+    const size_t offset = position & (size_ - 1);
+    const size_t first = std::min(size, size_ - offset);
+    memcpy(data, data_.get() + offset, first);
+    memcpy(static_cast<char*>(data) + first, data_.get(), size - first);
+  }
+
+  const std::unique_ptr<char[]> data_;
+  const size_t size_;
+  // Positions in the stream of bytes written to the ring since its creation.
+  std::atomic<uint64_t> write_position_{0};
+  std::atomic<uint64_t> read_position_{0};
+  std::atomic<uint64_t> dropped_count_{0};
+  std::atomic<bool> thread_exited_{false};
+};
+
+constexpr base::TimeDelta AsyncLogSink::kDefaultFlushInterval;
+
+AsyncLogSink::AsyncLogSink(Client* client,
+                           size_t buffer_size,
+                           base::TimeDelta flush_interval)
+    : client_(client),
+      buffer_size_(buffer_size),
+      flush_interval_(flush_interval),
+      thread_buffer_slot_(&AsyncLogSink::OnThreadExit),
+      wake_up_(base::WaitableEvent::ResetPolicy::AUTOMATIC,
+               base::WaitableEvent::InitialState::NOT_SIGNALED) {
+  DCHECK(client_);
+  DCHECK(base::bits::IsPowerOfTwo(buffer_size_));
+}
+
+AsyncLogSink::~AsyncLogSink() {
+  Stop();
+}
+
+void AsyncLogSink::Start() {
+  if (started())
+    return;
+  stopping_.store(false, std::memory_order_relaxed);
+  CHECK(base::PlatformThread::Create(0, this, &writer_thread_));
+}
+
+void AsyncLogSink::Stop() {
+  if (started()) {
+    stopping_.store(true, std::memory_order_release);
+    wake_up_.Signal();
+    base::PlatformThread::Join(writer_thread_);
+    writer_thread_ = base::PlatformThreadHandle();
+  }
+  Flush();
+}
+
+bool AsyncLogSink::Enqueue(uint8_t destinations, base::StringPiece message) {
+  // A message this large would leave little room for others, and be dropped
+  // whenever the buffer is not nearly empty.
+  if (sizeof(RecordHeader) + message.size() > buffer_size_ / 2) {
+    WriteSynchronously(destinations, message);
+    return true;
+  }
+
+  ThreadBuffer* buffer = GetOrCreateThreadBuffer();
+  const uint64_t sequence_number =
+      next_sequence_number_.fetch_add(1, std::memory_order_relaxed);
+  switch (buffer->Push(sequence_number, destinations, message)) {
+    case ThreadBuffer::PushResult::kDropped:
+      return false;
+    case ThreadBuffer::PushResult::kPushed:
+      return true;
+    case ThreadBuffer::PushResult::kPushedPastHalf:
+      wake_up_.Signal();
+      return true;
+  }
+}
+
+void AsyncLogSink::Flush() {
+  if (draining_thread_id_.load(std::memory_order_relaxed) ==
+      base::PlatformThread::CurrentId()) {
+    return;
+  }
+  base::AutoLock lock(drain_lock_);
+  DrainLocked();
+}
+
+uint64_t AsyncLogSink::dropped_count() const {
+  base::AutoLock lock(buffers_lock_);
+  uint64_t dropped_count = freed_buffers_dropped_count_;
+  for (const auto& buffer : buffers_)
+    dropped_count += buffer->dropped_count();
+  return dropped_count;
+}
+
+// static
+void AsyncLogSink::OnThreadExit(void* thread_buffer) {
+  static_cast<ThreadBuffer*>(thread_buffer)->set_thread_exited();
+}
+
+void AsyncLogSink::ThreadMain() {
+  base::PlatformThread::SetName("AsyncLogWriter");
+  while (!stopping_.load(std::memory_order_acquire)) {
+    wake_up_.TimedWait(flush_interval_);
+    base::AutoLock lock(drain_lock_);
+    DrainLocked();
+  }
+}
+
+AsyncLogSink::ThreadBuffer* AsyncLogSink::GetOrCreateThreadBuffer() {
+  ThreadBuffer* buffer = static_cast<ThreadBuffer*>(thread_buffer_slot_.Get());
+  if (buffer)
+    return buffer;
+
+  auto new_buffer = std::make_unique<ThreadBuffer>(buffer_size_);
+  buffer = new_buffer.get();
+  {
+    base::AutoLock lock(buffers_lock_);
+    buffers_.push_back(std::move(new_buffer));
+  }
+  thread_buffer_slot_.Set(buffer);
+  return buffer;
+}
+
+void AsyncLogSink::WriteSynchronously(uint8_t destinations,
+                                      base::StringPiece message) {
+  // Called from a Client method, which already holds |drain_lock_|.
+  if (draining_thread_id_.load(std::memory_order_relaxed) ==
+      base::PlatformThread::CurrentId()) {
+    client_->Write(destinations, message);
+    return;
+  }
+
+  base::AutoLock lock(drain_lock_);
+  DrainLocked();
+  draining_thread_id_.store(base::PlatformThread::CurrentId(),
+                            std::memory_order_relaxed);
+  client_->Write(destinations, message);
+  draining_thread_id_.store(base::kInvalidThreadId, std::memory_order_relaxed);
+}
+
+void AsyncLogSink::DrainLocked() {
+  draining_thread_id_.store(base::PlatformThread::CurrentId(),
+                            std::memory_order_relaxed);
+
+  // Buffers are only freed below, with |drain_lock_| held, so the pointers
+  // stay valid without holding |buffers_lock_|, which would block threads
+  // logging for the first time.
+  std::vector<ThreadBuffer*> buffers;
+  {
+    base::AutoLock lock(buffers_lock_);
+    for (const auto& buffer : buffers_)
+      buffers.push_back(buffer.get());
+  }
+
+  std::vector<Record> records;
+  std::string text;
+  for (ThreadBuffer* buffer : buffers)
+    buffer->Pop(&records, &text);
+  std::sort(records.begin(), records.end(),
+            [](const Record& a, const Record& b) {
+              return a.sequence_number < b.sequence_number;
+            });
+
+  // Write runs of messages with the same destinations at once.
+  std::string batch;
+  uint8_t batch_destinations = 0;
+  for (const Record& record : records) {
+    if (!batch.empty() && record.destinations != batch_destinations) {
+      client_->Write(batch_destinations, batch);
+      batch.clear();
+    }
+    batch_destinations = record.destinations;
+    batch.append(text, record.offset, record.size);
+  }
+  if (!batch.empty())
+    client_->Write(batch_destinations, batch);
+
+  {
+    base::AutoLock lock(buffers_lock_);
+    uint64_t freed_dropped_count = 0;
+    base::EraseIf(buffers_, [&](const std::unique_ptr<ThreadBuffer>& buffer) {
+      if (!buffer->thread_exited() || !buffer->empty())
+        return false;
+      freed_dropped_count += buffer->dropped_count();
+      return true;
+    });
+    freed_buffers_dropped_count_ += freed_dropped_count;
+  }
+
+  const uint64_t dropped_count = this->dropped_count();
+  if (dropped_count > reported_dropped_count_) {
+    client_->OnMessagesDropped(dropped_count - reported_dropped_count_);
+    reported_dropped_count_ = dropped_count;
+  }
+
+  draining_thread_id_.store(base::kInvalidThreadId, std::memory_order_relaxed);
+}
+
+}  // namespace logging
@@ -0,0 +1,140 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef BASE_LOGGING_ASYNC_SINK_H_
+#define BASE_LOGGING_ASYNC_SINK_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "base/base_export.h"
+#include "base/strings/string_piece.h"
+#include "base/synchronization/lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/thread_annotations.h"
+#include "base/threading/platform_thread.h"
+#include "base/threading/thread_local_storage.h"
+#include "base/time/time.h"
+
+namespace logging {
+
+// Collects log messages from any number of threads without taking a lock, and
+// hands them to a Client on a background thread. This backs
+// logging::EnableAsyncLogging(), see logging.h.
+//
+// Each thread's messages are written in the order it enqueued them. Messages
+// from different threads are ordered within each drain only: a message that
+// was still being enqueued during a drain is written by the next one, after
+// messages other threads enqueued later.
+//
+// Each thread appends to its own fixed-size ring buffer, of which it is the
+// only writer. Messages that do not fit are dropped and counted, except for
+// those larger than half a buffer, which are written synchronously. The writer
+// thread drains all buffers when one of them is half full, when Flush() is
+// called, or every |flush_interval|.
+class BASE_EXPORT AsyncLogSink : public base::PlatformThread::Delegate {
+ public:
+  class Client {
+   public:
+    virtual ~Client() = default;
+
+    // Writes |messages|, one or more consecutive messages that were all
+    // enqueued with |destinations|. Called on the writer thread, or on the
+    // thread calling Flush(), but never concurrently.
+    virtual void Write(uint8_t destinations, base::StringPiece messages) = 0;
+
+    // Reports that |count| more messages were dropped because a thread's
+    // buffer was full. Called like Write().
+    virtual void OnMessagesDropped(uint64_t count) = 0;
+  };
+
+  static constexpr size_t kDefaultBufferSize = 32 * 1024;
+  static constexpr base::TimeDelta kDefaultFlushInterval =
+      base::TimeDelta::FromMilliseconds(100);
+
+  // |client| must outlive this. |buffer_size| is the size of each thread's
+  // buffer, and must be a power of two.
+  explicit AsyncLogSink(Client* client,
+                        size_t buffer_size = kDefaultBufferSize,
+                        base::TimeDelta flush_interval = kDefaultFlushInterval);
+  AsyncLogSink(const AsyncLogSink&) = delete;
+  AsyncLogSink& operator=(const AsyncLogSink&) = delete;
+  // Stops the writer thread, if started, and flushes. No other thread may
+  // call Enqueue() concurrently.
+  ~AsyncLogSink() override;
+
+  // Starts and stops the writer thread. Stop() flushes after the thread is
+  // gone. Messages can be enqueued while stopped; they are written out by the
+  // next Flush() or Start().
+  void Start();
+  void Stop();
+  bool started() const { return !writer_thread_.is_null(); }
+
+  // Appends |message| to the calling thread's buffer. Never blocks, except on
+  // a thread's first call, which registers its buffer, and for messages larger
+  // than half a buffer, which are written out after the pending messages
+  // before returning. Returns false if the message was dropped.
+  bool Enqueue(uint8_t destinations, base::StringPiece message);
+
+  // Writes out every message enqueued before this call. Does nothing if called
+  // from a Client method.
+  void Flush();
+
+  // Total number of messages dropped so far.
+  uint64_t dropped_count() const;
+
+ private:
+  class ThreadBuffer;
+
+  // Destructor of |thread_buffer_slot_|.
+  static void OnThreadExit(void* thread_buffer);
+
+  // base::PlatformThread::Delegate:
+  void ThreadMain() override;
+
+  ThreadBuffer* GetOrCreateThreadBuffer();
+
+  // Drains all thread buffers, then writes |message|.
+  void WriteSynchronously(uint8_t destinations, base::StringPiece message);
+
+  // Drains all thread buffers, and frees those of exited threads.
+  void DrainLocked() EXCLUSIVE_LOCKS_REQUIRED(drain_lock_);
+
+  Client* const client_;
+  const size_t buffer_size_;
+  const base::TimeDelta flush_interval_;
+
+  // Orders the messages of different threads within a drain.
+  std::atomic<uint64_t> next_sequence_number_{0};
+
+  // Points to the calling thread's ThreadBuffer.
+  base::ThreadLocalStorage::Slot thread_buffer_slot_;
+
+  mutable base::Lock buffers_lock_;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers_
+      GUARDED_BY(buffers_lock_);
+  // Messages dropped by the buffers freed from |buffers_|.
+  uint64_t freed_buffers_dropped_count_ GUARDED_BY(buffers_lock_) = 0;
+
+  // Held while draining, so that the writer thread and Flush() take turns.
+  base::Lock drain_lock_;
+  uint64_t reported_dropped_count_ GUARDED_BY(drain_lock_) = 0;
+  // The thread currently draining, to make Flush() from a Client method a
+  // no-op rather than a deadlock.
+  std::atomic<base::PlatformThreadId> draining_thread_id_{
+      base::kInvalidThreadId};
+
+  // Wakes up the writer thread early.
+  base::WaitableEvent wake_up_;
+  std::atomic<bool> stopping_{false};
+  base::PlatformThreadHandle writer_thread_;
+};
+
+}  // namespace logging
+
+#endif  // BASE_LOGGING_ASYNC_SINK_H_
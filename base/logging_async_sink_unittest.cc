@@ -0,0 +1,202 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/logging_async_sink.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_split.h"
+#include "base/synchronization/lock.h"
+#include "base/synchronization/waitable_event.h"
+#include "base/threading/platform_thread.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace logging {
+
+namespace {
+
+class TestClient : public AsyncLogSink::Client {
+ public:
+  // AsyncLogSink::Client:
+  void Write(uint8_t destinations, base::StringPiece messages) override {
+    base::AutoLock lock(lock_);
+    writes_.push_back({destinations, std::string(messages)});
+  }
+  void OnMessagesDropped(uint64_t count) override {
+    base::AutoLock lock(lock_);
+    dropped_count_ += count;
+  }
+
+  std::string WrittenText() {
+    base::AutoLock lock(lock_);
+    std::string text;
+    for (const auto& write : writes_)
+      text += write.second;
+    return text;
+  }
+
+  std::vector<std::pair<uint8_t, std::string>> writes() {
+    base::AutoLock lock(lock_);
+    return writes_;
+  }
+
+  uint64_t dropped_count() {
+    base::AutoLock lock(lock_);
+    return dropped_count_;
+  }
+
+ private:
+  base::Lock lock_;
+  std::vector<std::pair<uint8_t, std::string>> writes_;
+  uint64_t dropped_count_ = 0;
+};
+
+// Enqueues |count| numbered messages, then exits.
+class LoggingThread : public base::PlatformThread::Delegate {
+ public:
+  LoggingThread(AsyncLogSink* sink, int id, int count)
+      : sink_(sink), id_(id), count_(count) {}
+
+  void ThreadMain() override {
+    for (int i = 0; i < count_; ++i) {
+      sink_->Enqueue(1, base::NumberToString(id_) + ":" +
+                            base::NumberToString(i) + "\n");
+    }
+  }
+
+ private:
+  AsyncLogSink* const sink_;
+  const int id_;
+  const int count_;
+};
+
+}  // namespace
+
+TEST(AsyncLogSinkTest, FlushWritesInOrder) {
+  TestClient client;
+  AsyncLogSink sink(&client);
+  EXPECT_TRUE(sink.Enqueue(1, "a\n"));
+  EXPECT_TRUE(sink.Enqueue(1, "b\n"));
+  EXPECT_TRUE(sink.Enqueue(2, "c\n"));
+  EXPECT_TRUE(client.writes().empty());
+
+  sink.Flush();
+  // Consecutive messages with the same destinations are written together.
+  std::vector<std::pair<uint8_t, std::string>> expected = {{1, "a\nb\n"},
+                                                           {2, "c\n"}};
+  EXPECT_EQ(expected, client.writes());
+
+  sink.Flush();
+  EXPECT_EQ(expected, client.writes());
+}
+
+TEST(AsyncLogSinkTest, WrapsAround) {
+  TestClient client;
+  AsyncLogSink sink(&client, /*buffer_size=*/128);
+  std::string expected;
+  for (int i = 0; i < 100; ++i) {
+    const std::string message = "message " + base::NumberToString(i) + "\n";
+    EXPECT_TRUE(sink.Enqueue(1, message));
+    expected += message;
+    sink.Flush();
+  }
+  EXPECT_EQ(expected, client.WrittenText());
+  EXPECT_EQ(0u, sink.dropped_count());
+}
+
+TEST(AsyncLogSinkTest, DropsWhenFull) {
+  TestClient client;
+  AsyncLogSink sink(&client, /*buffer_size=*/128);
+  const std::string kMessage(40, 'x');
+  int enqueued = 0;
+  for (int i = 0; i < 10; ++i)
+    enqueued += sink.Enqueue(1, kMessage);
+  EXPECT_LT(enqueued, 10);
+  EXPECT_EQ(10u - enqueued, sink.dropped_count());
+
+  sink.Flush();
+  EXPECT_EQ(10u - enqueued, client.dropped_count());
+  EXPECT_EQ(enqueued * kMessage.size(), client.WrittenText().size());
+
+  // The space is reusable once flushed.
+  EXPECT_TRUE(sink.Enqueue(1, kMessage));
+}
+
+TEST(AsyncLogSinkTest, WritesLargeMessagesSynchronously) {
+  TestClient client;
+  AsyncLogSink sink(&client, /*buffer_size=*/128);
+  EXPECT_TRUE(sink.Enqueue(1, "a\n"));
+  const std::string kLargeMessage = std::string(64, 'x') + "\n";
+  EXPECT_TRUE(sink.Enqueue(2, kLargeMessage));
+  // Written after the pending messages, without waiting for a flush.
+  std::vector<std::pair<uint8_t, std::string>> expected = {{1, "a\n"},
+                                                           {2, kLargeMessage}};
+  EXPECT_EQ(expected, client.writes());
+
+  // Even larger than a buffer.
+  const std::string kHugeMessage = std::string(1000, 'y') + "\n";
+  EXPECT_TRUE(sink.Enqueue(2, kHugeMessage));
+  expected.push_back({2, kHugeMessage});
+  EXPECT_EQ(expected, client.writes());
+  EXPECT_EQ(0u, sink.dropped_count());
+}
+
+TEST(AsyncLogSinkTest, WriterThread) {
+  TestClient client;
+  AsyncLogSink sink(&client, AsyncLogSink::kDefaultBufferSize,
+                    base::TimeDelta::FromMilliseconds(1));
+  sink.Start();
+  EXPECT_TRUE(sink.Enqueue(1, "written by the writer thread\n"));
+  while (client.WrittenText().empty())
+    base::PlatformThread::Sleep(base::TimeDelta::FromMilliseconds(1));
+  EXPECT_EQ("written by the writer thread\n", client.WrittenText());
+  sink.Stop();
+}
+
+// Messages from exited threads are still written, and each thread's messages
+// stay in order.
+TEST(AsyncLogSinkTest, ManyThreads) {
+  constexpr int kThreads = 8;
+  constexpr int kMessagesPerThread = 200;
+
+  TestClient client;
+  AsyncLogSink sink(&client, /*buffer_size=*/64 * 1024);
+  sink.Start();
+
+  std::vector<std::unique_ptr<LoggingThread>> threads;
+  std::vector<base::PlatformThreadHandle> handles(kThreads);
+  for (int i = 0; i < kThreads; ++i) {
+    threads.push_back(
+        std::make_unique<LoggingThread>(&sink, i, kMessagesPerThread));
+    ASSERT_TRUE(base::PlatformThread::Create(0, threads.back().get(),
+                                             &handles[i]));
+  }
+  for (auto& handle : handles)
+    base::PlatformThread::Join(handle);
+  sink.Stop();
+
+  EXPECT_EQ(0u, sink.dropped_count());
+  const std::string text = client.WrittenText();
+  std::vector<int> next_message(kThreads, 0);
+  for (base::StringPiece line : base::SplitStringPiece(
+           text, "\n", base::KEEP_WHITESPACE, base::SPLIT_WANT_NONEMPTY)) {
+    std::vector<base::StringPiece> parts = base::SplitStringPiece(
+        line, ":", base::KEEP_WHITESPACE, base::SPLIT_WANT_ALL);
+    ASSERT_EQ(2u, parts.size());
+    int thread = 0;
+    int message = 0;
+    ASSERT_TRUE(base::StringToInt(parts[0], &thread));
+    ASSERT_TRUE(base::StringToInt(parts[1], &message));
+    EXPECT_EQ(next_message[thread]++, message);
+  }
+  for (int count : next_message)
+    EXPECT_EQ(kMessagesPerThread, count);
+}
+
+}  // namespace logging
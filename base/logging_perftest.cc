@@ -0,0 +1,106 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/logging.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/scoped_logging_settings.h"
+#include "base/threading/platform_thread.h"
+#include "base/timer/elapsed_timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace logging {
+
+namespace {
+
+constexpr char kMetricPrefixLogging[] = "Logging.";
+constexpr char kMetricLogTime[] = "log_time";
+constexpr char kMetricDroppedMessages[] = "dropped_messages";
+
+constexpr int kMessagesPerThread = 10000;
+
+perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixLogging, story_name);
+  reporter.RegisterImportantMetric(kMetricLogTime, "ns");
+  reporter.RegisterFyiMetric(kMetricDroppedMessages, "count");
+  return reporter;
+}
+
+// Logs |kMessagesPerThread| messages, roughly the size of typical VLOGs.
+class LoggingThread : public base::PlatformThread::Delegate {
+ public:
+  void ThreadMain() override {
+    for (int i = 0; i < kMessagesPerThread; ++i)
+      LOG(INFO) << "Handling request " << i << " for some://url/path?query";
+  }
+};
+
+class LoggingPerfTest : public testing::Test {
+ public:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    log_file_path_ = temp_dir_.GetPath().AppendASCII("perf.log");
+    LoggingSettings settings;
+    settings.logging_dest = LOG_TO_FILE;
+    settings.log_file_path = log_file_path_.value().c_str();
+    settings.delete_old = DELETE_OLD_LOG_FILE;
+    ASSERT_TRUE(InitLogging(settings));
+  }
+
+  void TearDown() override { CloseLogFile(); }
+
+  // Reports the time each thread spends per message when |thread_count|
+  // threads log concurrently.
+  void RunTest(const std::string& story_name, int thread_count, bool async) {
+    if (async)
+      EnableAsyncLogging();
+    const uint64_t dropped_before = GetAsyncLoggingDroppedCount();
+
+    std::vector<LoggingThread> threads(thread_count);
+    std::vector<base::PlatformThreadHandle> handles(thread_count);
+    base::ElapsedTimer timer;
+    for (int i = 0; i < thread_count; ++i)
+      ASSERT_TRUE(base::PlatformThread::Create(0, &threads[i], &handles[i]));
+    for (auto& handle : handles)
+      base::PlatformThread::Join(handle);
+    const base::TimeDelta elapsed = timer.Elapsed();
+
+    if (async)
+      DisableAsyncLogging();
+
+    auto reporter = SetUpReporter(
+        base::StringPrintf("%s_%d_threads", story_name.c_str(), thread_count));
+    reporter.AddResult(kMetricLogTime,
+                       elapsed.InNanosecondsF() / kMessagesPerThread);
+    reporter.AddResult(kMetricDroppedMessages,
+                       static_cast<size_t>(GetAsyncLoggingDroppedCount() -
+                                           dropped_before));
+  }
+
+ private:
+  ScopedLoggingSettings scoped_logging_settings_;
+  base::ScopedTempDir temp_dir_;
+  base::FilePath log_file_path_;
+};
+
+}  // namespace
+
+TEST_F(LoggingPerfTest, Sync) {
+  for (int thread_count : {1, 4, 16})
+    RunTest("sync", thread_count, /*async=*/false);
+}
+
+TEST_F(LoggingPerfTest, Async) {
+  for (int thread_count : {1, 4, 16})
+    RunTest("async", thread_count, /*async=*/true);
+}
+
+}  // namespace logging
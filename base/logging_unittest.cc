@@ -693,6 +693,57 @@ TEST_F(LoggingTest, NestedLogAssertHandlers) {
   LOG(FATAL) << "Last assert must be caught by handler_a again";
 }
 
+TEST_F(LoggingTest, AsyncLogging) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath log_file_path = temp_dir.GetPath().Append("file.log");
+
+  LoggingSettings settings;
+  settings.logging_dest = LOG_TO_FILE;
+  settings.log_file_path = log_file_path.value().c_str();
+  InitLogging(settings);
+  EnableAsyncLogging();
+
+  LOG(INFO) << "first async message";
+  LOG(WARNING) << "second async message";
+  FlushAsyncLogging();
+
+  std::string written_logs;
+  ASSERT_TRUE(base::ReadFileToString(log_file_path, &written_logs));
+  size_t first = written_logs.find("first async message");
+  ASSERT_NE(std::string::npos, first);
+  EXPECT_LT(first, written_logs.find("second async message"));
+
+  DisableAsyncLogging();
+}
+
+// Messages still pending in the async sink are written before a FATAL one.
+TEST_F(LoggingTest, AsyncLoggingFlushesOnFatal) {
+  base::ScopedTempDir temp_dir;
+  ASSERT_TRUE(temp_dir.CreateUniqueTempDir());
+  base::FilePath log_file_path = temp_dir.GetPath().Append("file.log");
+
+  LoggingSettings settings;
+  settings.logging_dest = LOG_TO_FILE;
+  settings.log_file_path = log_file_path.value().c_str();
+  InitLogging(settings);
+  EnableAsyncLogging();
+
+  std::string logs_at_fatal;
+  logging::ScopedLogAssertHandler scoped_handler(base::BindLambdaForTesting(
+      [&](const char*, int, const base::StringPiece, const base::StringPiece) {
+        ASSERT_TRUE(base::ReadFileToString(log_file_path, &logs_at_fatal));
+      }));
+  LOG(INFO) << "message before the fatal one";
+  LOG(FATAL) << "the fatal message";
+
+  size_t before = logs_at_fatal.find("message before the fatal one");
+  ASSERT_NE(std::string::npos, before);
+  EXPECT_LT(before, logs_at_fatal.find("the fatal message"));
+
+  DisableAsyncLogging();
+}
+
 // Test that defining an operator<< for a type in a namespace doesn't prevent
 // other code in that namespace from calling the operator<<(ostream, wstring)
 // defined by logging.h. This can fail if operator<<(ostream, wstring) can't be
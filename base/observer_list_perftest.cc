@@ -4,10 +4,16 @@
 
 #include "base/observer_list.h"
 
+#include <atomic>
 #include <memory>
 
+#include "base/bind.h"
 #include "base/check_op.h"
+#include "base/observer_list_threadsafe.h"
 #include "base/strings/stringprintf.h"
+#include "base/task/thread_pool.h"
+#include "base/task/thread_pool/thread_pool_instance.h"
+#include "base/test/task_environment.h"
 #include "base/time/time.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "testing/perf/perf_result_reporter.h"
@@ -20,6 +26,8 @@ namespace base {
 
 constexpr char kMetricPrefixObserverList[] = "ObserverList.";
 constexpr char kMetricNotifyTimePerObserver[] = "notify_time_per_observer";
+constexpr char kMetricNotifyTime[] = "notify_time";
+constexpr char kMetricDeliveryTime[] = "delivery_time";
 
 namespace {
 
@@ -29,6 +37,14 @@ perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
   return reporter;
 }
 
+perf_test::PerfResultReporter SetUpThreadSafeReporter(
+    const std::string& story_name) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixObserverList, story_name);
+  reporter.RegisterImportantMetric(kMetricNotifyTime, "ns");
+  reporter.RegisterImportantMetric(kMetricDeliveryTime, "ns");
+  return reporter;
+}
+
 }  // namespace
 
 class ObserverInterface {
@@ -125,4 +141,98 @@ TYPED_TEST(ObserverListPerfTest, NotifyPerformance) {
   }
 }
 
+class CountingObserver {
+ public:
+  void Observe(int value) { count_.fetch_add(1, std::memory_order_relaxed); }
+  int count() const { return count_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int> count_{0};
+};
+
+enum class ThreadSafeNotifyMode {
+  kPerObserver,
+  kBatched,
+  kBatchedLatest,
+};
+
+// Cross-thread benchmark for ObserverListThreadSafe: a burst of notifications
+// from the main thread to observers registered on a few ThreadPool sequences,
+// as with network change or download progress updates.
+void RunThreadSafeNotifyTest(ThreadSafeNotifyMode mode,
+                             const char* mode_name) {
+  constexpr int kSequences = 4;
+  constexpr int kObserversPerSequence = 8;
+  constexpr int kNotifications = 10000;
+  static const char kCoalescingKey = 0;
+
+  test::TaskEnvironment task_environment;
+  auto observer_list = MakeRefCounted<ObserverListThreadSafe<CountingObserver>>(
+      ObserverListPolicy::ALL, mode == ThreadSafeNotifyMode::kPerObserver
+                                   ? ObserverListDispatch::PER_OBSERVER
+                                   : ObserverListDispatch::BATCHED);
+
+  std::vector<std::unique_ptr<CountingObserver>> observers;
+  for (int i = 0; i < kSequences; ++i) {
+    auto task_runner = ThreadPool::CreateSequencedTaskRunner({});
+    for (int j = 0; j < kObserversPerSequence; ++j) {
+      observers.push_back(std::make_unique<CountingObserver>());
+      task_runner->PostTask(
+          FROM_HERE,
+          BindOnce(IgnoreResult(
+                       &ObserverListThreadSafe<CountingObserver>::AddObserver),
+                   observer_list, Unretained(observers.back().get())));
+    }
+  }
+  ThreadPoolInstance::Get()->FlushForTesting();
+
+  TimeTicks start = TimeTicks::Now();
+  for (int i = 0; i < kNotifications; ++i) {
+    if (mode == ThreadSafeNotifyMode::kBatchedLatest) {
+      observer_list->NotifyLatest(FROM_HERE, &kCoalescingKey,
+                                  &CountingObserver::Observe, i);
+    } else {
+      observer_list->Notify(FROM_HERE, &CountingObserver::Observe, i);
+    }
+  }
+  TimeDelta notify_duration = TimeTicks::Now() - start;
+  ThreadPoolInstance::Get()->FlushForTesting();
+  TimeDelta delivery_duration = TimeTicks::Now() - start;
+
+  int delivered = 0;
+  for (const auto& observer : observers)
+    delivered += observer->count();
+  if (mode == ThreadSafeNotifyMode::kBatchedLatest)
+    EXPECT_GT(delivered, 0);
+  else
+    EXPECT_EQ(kNotifications * kSequences * kObserversPerSequence, delivered);
+
+  for (const auto& observer : observers) {
+    // Removal is allowed from any sequence; pending notifications are dropped.
+    observer_list->RemoveObserver(observer.get());
+  }
+
+  auto reporter = SetUpThreadSafeReporter(
+      StringPrintf("ObserverListThreadSafe_%s", mode_name));
+  reporter.AddResult(kMetricNotifyTime,
+                     notify_duration.InNanoseconds() /
+                         static_cast<double>(kNotifications));
+  reporter.AddResult(kMetricDeliveryTime,
+                     delivery_duration.InNanoseconds() /
+                         static_cast<double>(kNotifications));
+}
+
+TEST(ObserverListThreadSafePerfTest, NotifyPerObserver) {
+  RunThreadSafeNotifyTest(ThreadSafeNotifyMode::kPerObserver, "PerObserver");
+}
+
+TEST(ObserverListThreadSafePerfTest, NotifyBatched) {
+  RunThreadSafeNotifyTest(ThreadSafeNotifyMode::kBatched, "Batched");
+}
+
+TEST(ObserverListThreadSafePerfTest, NotifyBatchedLatest) {
+  RunThreadSafeNotifyTest(ThreadSafeNotifyMode::kBatchedLatest,
+                          "BatchedLatest");
+}
+
 }  // namespace base
@@ -7,11 +7,13 @@
 
 #include <unordered_map>
 #include <utility>
+#include <vector>
 
 #include "base/base_export.h"
 #include "base/bind.h"
 #include "base/check_op.h"
 #include "base/containers/contains.h"
+#include "base/containers/cxx20_erase_vector.h"
 #include "base/lazy_instance.h"
 #include "base/location.h"
 #include "base/memory/ref_counted.h"
@@ -49,9 +51,27 @@
 //   same-sequence observers, but it was error-prone and removed in
 //   crbug.com/1193750, think twice before re-considering this paradigm.
 //
+//   High-frequency notifiers can opt into ObserverListDispatch::BATCHED, in
+//   which each sequence with pending notifications gets a single task that
+//   delivers all of them, and NotifyLatest() replaces a pending notification
+//   instead of queuing another one.
+//
 ///////////////////////////////////////////////////////////////////////////////
 
 namespace base {
+
+// Enumeration of how ObserverListThreadSafe posts notifications.
+enum class ObserverListDispatch {
+  // Each notification is posted as one task per observer. This is the default
+  // if no dispatch mode is provided to the constructor.
+  PER_OBSERVER,
+
+  // Notifications are queued per sequence. Each sequence with pending
+  // notifications gets one task, which delivers them in order to every
+  // observer registered on that sequence.
+  BATCHED,
+};
+
 namespace internal {
 
 class BASE_EXPORT ObserverListThreadSafeBase
@@ -109,6 +129,9 @@ class ObserverListThreadSafe : public internal::ObserverListThreadSafeBase {
   ObserverListThreadSafe() = default;
   explicit ObserverListThreadSafe(ObserverListPolicy policy)
       : policy_(policy) {}
+  ObserverListThreadSafe(ObserverListPolicy policy,
+                         ObserverListDispatch dispatch)
+      : policy_(policy), dispatch_(dispatch) {}
   ObserverListThreadSafe(const ObserverListThreadSafe&) = delete;
   ObserverListThreadSafe& operator=(const ObserverListThreadSafe&) = delete;
 
@@ -124,10 +147,10 @@ class ObserverListThreadSafe : public internal::ObserverListThreadSafeBase {
 
     AutoLock auto_lock(lock_);
 
-    bool was_empty = observers_.empty();
+    bool was_empty = observers_->data.empty();
 
-    // Add |observer| to the list of observers.
-    DCHECK(!Contains(observers_, observer));
+    // Add |observer| to a copy of the list of observers.
+    DCHECK(!Contains(observers_->data, observer));
     const scoped_refptr<SequencedTaskRunner> task_runner =
         SequencedTaskRunnerHandle::Get();
     // Each observer gets a unique identifier. These unique identifiers are used
@@ -135,7 +158,9 @@ class ObserverListThreadSafe : public internal::ObserverListThreadSafeBase {
     // observers.
     const size_t observer_id = ++observer_id_counter_;
     ObserverTaskRunnerInfo task_info = {task_runner, observer_id};
-    observers_[observer] = std::move(task_info);
+    auto observers = MakeRefCounted<ObserverMap>(observers_->data);
+    observers->data[observer] = std::move(task_info);
+    observers_ = std::move(observers);
 
     // If this is called while a notification is being dispatched on this thread
     // and |policy_| is ALL, |observer| must be notified (if a notification is
@@ -169,16 +194,20 @@ class ObserverListThreadSafe : public internal::ObserverListThreadSafeBase {
   // observer won't stop it.
   RemoveObserverResult RemoveObserver(ObserverType* observer) {
     AutoLock auto_lock(lock_);
-    observers_.erase(observer);
-    return observers_.empty() ? RemoveObserverResult::kWasOrBecameEmpty
-                              : RemoveObserverResult::kRemainsNonEmpty;
+    if (Contains(observers_->data, observer)) {
+      auto observers = MakeRefCounted<ObserverMap>(observers_->data);
+      observers->data.erase(observer);
+      observers_ = std::move(observers);
+    }
+    return observers_->data.empty() ? RemoveObserverResult::kWasOrBecameEmpty
+                                    : RemoveObserverResult::kRemainsNonEmpty;
   }
 
   // Verifies that the list is currently empty (i.e. there are no observers).
   void AssertEmpty() const {
 #if DCHECK_IS_ON()
     AutoLock auto_lock(lock_);
-    DCHECK(observers_.empty());
+    DCHECK(observers_->data.empty());
 #endif
   }
 
@@ -188,24 +217,61 @@ class ObserverListThreadSafe : public internal::ObserverListThreadSafeBase {
   // delivery.
   template <typename Method, typename... Params>
   void Notify(const Location& from_here, Method m, Params&&... params) {
-    RepeatingCallback<void(ObserverType*)> method =
-        BindRepeating(&Dispatcher<ObserverType, Method>::Run, m,
-                      std::forward<Params>(params)...);
+    NotifyImpl(from_here, nullptr,
+               BindRepeating(&Dispatcher<ObserverType, Method>::Run, m,
+                             std::forward<Params>(params)...));
+  }
 
-    AutoLock lock(lock_);
-    for (const auto& observer : observers_) {
-      observer.second.task_runner->PostTask(
-          from_here,
-          BindOnce(&ObserverListThreadSafe<ObserverType>::NotifyWrapper, this,
-                   observer.first,
-                   NotificationData(this, observer.second.observer_id,
-                                    from_here, method)));
-    }
+  // Same as Notify(), but for notifications where only the latest value
+  // matters, e.g. connection type or download progress. With BATCHED
+  // dispatch, a notification with the same |coalescing_key| that has not been
+  // delivered to a sequence yet is dropped in favor of this one. With
+  // PER_OBSERVER dispatch, this is the same as Notify().
+  //
+  // |coalescing_key| is only compared, never dereferenced; the address of the
+  // observer method or of a static is a good choice.
+  template <typename Method, typename... Params>
+  void NotifyLatest(const Location& from_here,
+                    const void* coalescing_key,
+                    Method m,
+                    Params&&... params) {
+    DCHECK(coalescing_key);
+    NotifyImpl(from_here, coalescing_key,
+               BindRepeating(&Dispatcher<ObserverType, Method>::Run, m,
+                             std::forward<Params>(params)...));
   }
 
  private:
   friend class RefCountedThreadSafe<ObserverListThreadSafeBase>;
 
+  struct ObserverTaskRunnerInfo {
+    scoped_refptr<SequencedTaskRunner> task_runner;
+    size_t observer_id = 0;
+  };
+
+  // Keys are observers. Values are the SequencedTaskRunners on which they must
+  // be notified. Never modified once published in |observers_|, so that it can
+  // be read without holding |lock_|.
+  using ObserverMap =
+      RefCountedData<std::unordered_map<ObserverType*, ObserverTaskRunnerInfo>>;
+
+  // A notification waiting to be delivered to a sequence in BATCHED mode.
+  struct PendingNotification {
+    const void* coalescing_key;
+    Location from_here;
+    RepeatingCallback<void(ObserverType*)> method;
+    // Observers with a larger id were added after the notification was sent,
+    // and don't receive it.
+    size_t last_observer_id;
+  };
+
+  struct PendingBatch {
+    scoped_refptr<SequencedTaskRunner> task_runner;
+    std::vector<PendingNotification> notifications;
+    // Id of the last NotifyImpl() call that queued a notification here.
+    size_t last_notify_id = 0;
+  };
+
   struct NotificationData : public NotificationDataBase {
     NotificationData(ObserverListThreadSafe* observer_list_in,
                      size_t observer_id_in,
@@ -221,15 +287,116 @@ class ObserverListThreadSafe : public internal::ObserverListThreadSafeBase {
 
   ~ObserverListThreadSafe() override = default;
 
+  void NotifyImpl(const Location& from_here,
+                  const void* coalescing_key,
+                  const RepeatingCallback<void(ObserverType*)>& method) {
+    scoped_refptr<const ObserverMap> observers;
+    std::vector<scoped_refptr<SequencedTaskRunner>> batches_to_post;
+    {
+      AutoLock lock(lock_);
+      observers = observers_;
+      if (dispatch_ == ObserverListDispatch::BATCHED) {
+        const size_t notify_id = ++notify_id_counter_;
+        for (const auto& observer : observers->data) {
+          SequencedTaskRunner* task_runner = observer.second.task_runner.get();
+          auto inserted = pending_batches_.try_emplace(task_runner);
+          PendingBatch& batch = inserted.first->second;
+          if (inserted.second) {
+            batch.task_runner = observer.second.task_runner;
+            batches_to_post.push_back(batch.task_runner);
+          } else if (batch.last_notify_id == notify_id) {
+            // Already queued for another observer on this sequence.
+            continue;
+          }
+          batch.last_notify_id = notify_id;
+          EnqueueNotification(&batch,
+                              {coalescing_key, from_here, method,
+                               observer_id_counter_});
+        }
+      }
+    }
+
+    if (dispatch_ == ObserverListDispatch::BATCHED) {
+      for (const auto& task_runner : batches_to_post) {
+        if (!task_runner->PostTask(
+                from_here,
+                BindOnce(&ObserverListThreadSafe<ObserverType>::DeliverBatch,
+                         this, Unretained(task_runner.get())))) {
+          // The sequence is gone; don't let its batch absorb notifications.
+          AutoLock lock(lock_);
+          pending_batches_.erase(task_runner.get());
+        }
+      }
+      return;
+    }
+
+    for (const auto& observer : observers->data) {
+      observer.second.task_runner->PostTask(
+          from_here,
+          BindOnce(&ObserverListThreadSafe<ObserverType>::NotifyWrapper, this,
+                   observer.first,
+                   NotificationData(this, observer.second.observer_id,
+                                    from_here, method)));
+    }
+  }
+
+  static void EnqueueNotification(PendingBatch* batch,
+                                  PendingNotification notification) {
+    // Drop the previous notification rather than overwriting it in place, so
+    // that this one stays ordered after any sent in between.
+    if (notification.coalescing_key) {
+      EraseIf(batch->notifications,
+              [&notification](const PendingNotification& pending) {
+                return pending.coalescing_key == notification.coalescing_key;
+              });
+    }
+    batch->notifications.push_back(std::move(notification));
+  }
+
+  // Delivers the notifications queued for |task_runner|, which is the current
+  // sequence, in BATCHED mode.
+  void DeliverBatch(SequencedTaskRunner* task_runner) {
+    std::vector<PendingNotification> notifications;
+    scoped_refptr<const ObserverMap> observers;
+    {
+      AutoLock auto_lock(lock_);
+      auto it = pending_batches_.find(task_runner);
+      if (it == pending_batches_.end())
+        return;
+      notifications = std::move(it->second.notifications);
+      pending_batches_.erase(it);
+      observers = observers_;
+    }
+
+    for (const PendingNotification& notification : notifications) {
+      for (const auto& observer : observers->data) {
+        if (observer.second.task_runner.get() != task_runner ||
+            observer.second.observer_id > notification.last_observer_id) {
+          continue;
+        }
+        // NotifyWrapper() skips observers removed since |observers| was
+        // copied, including by earlier notifications of this batch.
+        NotifyWrapper(observer.first,
+                      NotificationData(this, observer.second.observer_id,
+                                       notification.from_here,
+                                       notification.method));
+      }
+    }
+  }
+
   void NotifyWrapper(ObserverType* observer,
                      const NotificationData& notification) {
     {
-      AutoLock auto_lock(lock_);
+      scoped_refptr<const ObserverMap> observers;
+      {
+        AutoLock auto_lock(lock_);
+        observers = observers_;
+      }
 
       // Check whether the observer still needs a notification.
       DCHECK_EQ(notification.observer_list, this);
-      auto it = observers_.find(observer);
-      if (it == observers_.end() ||
+      auto it = observers->data.find(observer);
+      if (it == observers->data.end() ||
           it->second.observer_id != notification.observer_id) {
         return;
       }
@@ -257,18 +424,22 @@ class ObserverListThreadSafe : public internal::ObserverListThreadSafeBase {
 
   const ObserverListPolicy policy_ = ObserverListPolicy::ALL;
 
+  const ObserverListDispatch dispatch_ = ObserverListDispatch::PER_OBSERVER;
+
   mutable Lock lock_;
 
   size_t observer_id_counter_ GUARDED_BY(lock_) = 0;
 
-  struct ObserverTaskRunnerInfo {
-    scoped_refptr<SequencedTaskRunner> task_runner;
-    size_t observer_id = 0;
-  };
+  size_t notify_id_counter_ GUARDED_BY(lock_) = 0;
 
-  // Keys are observers. Values are the SequencedTaskRunners on which they must
-  // be notified.
-  std::unordered_map<ObserverType*, ObserverTaskRunnerInfo> observers_
+  // Copy-on-write: AddObserver() and RemoveObserver() replace the map, so
+  // readers only hold |lock_| long enough to take a reference.
+  scoped_refptr<const ObserverMap> observers_ GUARDED_BY(lock_) =
+      MakeRefCounted<ObserverMap>();
+
+  // Notifications not yet delivered in BATCHED mode. A sequence has an entry
+  // iff a DeliverBatch() task is pending for it.
+  std::unordered_map<SequencedTaskRunner*, PendingBatch> pending_batches_
       GUARDED_BY(lock_);
 };
 
@@ -515,4 +515,161 @@ TEST(ObserverListThreadSafeTest, Existing) {
   EXPECT_EQ(1, c.total);
 }
 
+namespace {
+
+class Recorder : public Foo {
+ public:
+  void Observe(int x) override { values.push_back(x); }
+
+  std::vector<int> values;
+};
+
+}  // namespace
+
+// Verify that with BATCHED dispatch, notifications sent back to back reach the
+// sequence in a single task.
+TEST(ObserverListThreadSafeTest, BatchedDeliversInOneTask) {
+  test::TaskEnvironment task_environment;
+
+  for (ObserverListDispatch dispatch : {ObserverListDispatch::PER_OBSERVER,
+                                        ObserverListDispatch::BATCHED}) {
+    auto observer_list = MakeRefCounted<ObserverListThreadSafe<Foo>>(
+        ObserverListPolicy::ALL, dispatch);
+    Adder a(1);
+    Adder b(2);
+    observer_list->AddObserver(&a);
+    observer_list->AddObserver(&b);
+
+    int a_total_at_marker = -1;
+    observer_list->Notify(FROM_HERE, &Foo::Observe, 1);
+    ThreadTaskRunnerHandle::Get()->PostTask(
+        FROM_HERE,
+        BindLambdaForTesting([&]() { a_total_at_marker = a.total; }));
+    observer_list->Notify(FROM_HERE, &Foo::Observe, 10);
+    RunLoop().RunUntilIdle();
+
+    EXPECT_EQ(11, a.total);
+    EXPECT_EQ(22, b.total);
+    // The marker task was posted between the two notifications. Only with
+    // BATCHED dispatch does the first delivery task carry the second one too.
+    EXPECT_EQ(dispatch == ObserverListDispatch::BATCHED ? 11 : 1,
+              a_total_at_marker);
+  }
+}
+
+TEST(ObserverListThreadSafeTest, NotifyLatestCoalesces) {
+  test::TaskEnvironment task_environment;
+  auto observer_list = MakeRefCounted<ObserverListThreadSafe<Foo>>(
+      ObserverListPolicy::ALL, ObserverListDispatch::BATCHED);
+  static const char kKey = 0;
+  Recorder a;
+  Recorder b;
+  observer_list->AddObserver(&a);
+  observer_list->AddObserver(&b);
+
+  observer_list->NotifyLatest(FROM_HERE, &kKey, &Foo::Observe, 1);
+  observer_list->Notify(FROM_HERE, &Foo::Observe, 100);
+  observer_list->NotifyLatest(FROM_HERE, &kKey, &Foo::Observe, 2);
+  observer_list->NotifyLatest(FROM_HERE, &kKey, &Foo::Observe, 3);
+  RunLoop().RunUntilIdle();
+
+  // The latest notification is kept, ordered after the plain one.
+  EXPECT_EQ(std::vector<int>({100, 3}), a.values);
+  EXPECT_EQ(std::vector<int>({100, 3}), b.values);
+
+  // Once delivered, a notification is not coalesced with later ones.
+  observer_list->NotifyLatest(FROM_HERE, &kKey, &Foo::Observe, 4);
+  RunLoop().RunUntilIdle();
+  EXPECT_EQ(std::vector<int>({100, 3, 4}), a.values);
+}
+
+TEST(ObserverListThreadSafeTest, NotifyLatestPerObserver) {
+  test::TaskEnvironment task_environment;
+  auto observer_list = MakeRefCounted<ObserverListThreadSafe<Foo>>();
+  static const char kKey = 0;
+  Recorder a;
+  observer_list->AddObserver(&a);
+
+  observer_list->NotifyLatest(FROM_HERE, &kKey, &Foo::Observe, 1);
+  observer_list->NotifyLatest(FROM_HERE, &kKey, &Foo::Observe, 2);
+  RunLoop().RunUntilIdle();
+
+  // Without batching, nothing is coalesced.
+  EXPECT_EQ(std::vector<int>({1, 2}), a.values);
+}
+
+// Same as AddRemoveWithPendingNotifications, with BATCHED dispatch.
+TEST(ObserverListThreadSafeTest, BatchedAddRemoveWithPendingNotifications) {
+  test::TaskEnvironment task_environment;
+  auto observer_list = MakeRefCounted<ObserverListThreadSafe<Foo>>(
+      ObserverListPolicy::ALL, ObserverListDispatch::BATCHED);
+  Adder a(1);
+  Adder b(1);
+  Adder c(1);
+
+  observer_list->AddObserver(&a);
+  observer_list->AddObserver(&b);
+
+  // `a` is removed and re-added, and `c` is added, after the notification was
+  // sent. Neither must receive it.
+  observer_list->Notify(FROM_HERE, &Foo::Observe, 10);
+  observer_list->RemoveObserver(&a);
+  observer_list->AddObserver(&a);
+  observer_list->AddObserver(&c);
+  RunLoop().RunUntilIdle();
+
+  EXPECT_EQ(0, a.total);
+  EXPECT_EQ(10, b.total);
+  EXPECT_EQ(0, c.total);
+
+  // An observer removed by an earlier notification of the same batch is not
+  // notified by the later ones.
+  FooRemover remover(observer_list.get());
+  remover.AddFooToRemove(&b);
+  observer_list->AddObserver(&remover);
+  observer_list->Notify(FROM_HERE, &Foo::Observe, 10);
+  observer_list->Notify(FROM_HERE, &Foo::Observe, 10);
+  RunLoop().RunUntilIdle();
+
+  EXPECT_EQ(20, a.total);
+  // `b` may or may not get the first notification depending on the order in
+  // which it and `remover` are notified, but never gets the second.
+  EXPECT_LT(b.total, 30);
+  EXPECT_EQ(20, c.total);
+  observer_list->RemoveObserver(&remover);
+}
+
+// Verify that batched observers are notified on the correct sequence.
+TEST(ObserverListThreadSafeTest, BatchedNotificationOnValidSequence) {
+  test::TaskEnvironment task_environment;
+
+  auto task_runner_1 = ThreadPool::CreateSequencedTaskRunner({});
+  auto task_runner_2 = ThreadPool::CreateSequencedTaskRunner({});
+
+  auto observer_list = MakeRefCounted<ObserverListThreadSafe<Foo>>(
+      ObserverListPolicy::ALL, ObserverListDispatch::BATCHED);
+
+  SequenceVerificationObserver observer_1(task_runner_1);
+  SequenceVerificationObserver observer_2(task_runner_2);
+
+  task_runner_1->PostTask(
+      FROM_HERE,
+      BindOnce(base::IgnoreResult(&ObserverListThreadSafe<Foo>::AddObserver),
+               observer_list, Unretained(&observer_1)));
+  task_runner_2->PostTask(
+      FROM_HERE,
+      BindOnce(base::IgnoreResult(&ObserverListThreadSafe<Foo>::AddObserver),
+               observer_list, Unretained(&observer_2)));
+
+  ThreadPoolInstance::Get()->FlushForTesting();
+
+  observer_list->Notify(FROM_HERE, &Foo::Observe, 1);
+  observer_list->Notify(FROM_HERE, &Foo::Observe, 2);
+
+  ThreadPoolInstance::Get()->FlushForTesting();
+
+  EXPECT_TRUE(observer_1.called_on_valid_sequence());
+  EXPECT_TRUE(observer_2.called_on_valid_sequence());
+}
+
 }  // namespace base
@@ -217,6 +217,17 @@ bool PickleIterator::ReadBytes(const char** data, int length) {
   return true;
 }
 
+bool PickleIterator::ReadBytes(base::span<const uint8_t>* data,
+                               size_t length) {
+  if (length > static_cast<size_t>(std::numeric_limits<int>::max()))
+    return false;
+  const char* read_from = GetReadPointerAndAdvance(static_cast<int>(length));
+  if (!read_from)
+    return false;
+  *data = base::as_bytes(base::make_span(read_from, length));
+  return true;
+}
+
 Pickle::Attachment::Attachment() = default;
 
 Pickle::Attachment::~Attachment() = default;
@@ -65,6 +65,10 @@ class BASE_EXPORT PickleIterator {
   // mutated). Do not keep the pointer around!
   bool ReadBytes(const char** data, int length) WARN_UNUSED_RESULT;
 
+  // Similar, but using base::span for convenience.
+  bool ReadBytes(base::span<const uint8_t>* data,
+                 size_t length) WARN_UNUSED_RESULT;
+
   // A safer version of ReadInt() that checks for the result not being negative.
   // Use it for reading the object sizes.
   bool ReadLength(int* result) WARN_UNUSED_RESULT {
@@ -310,6 +314,7 @@ class BASE_EXPORT Pickle {
   static const int kPayloadUnit;
 
  private:
+  friend class ChunkedPickleWriter;
   friend class PickleIterator;
 
   Header* header_;
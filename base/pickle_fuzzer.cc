@@ -4,13 +4,22 @@
 
 #include <fuzzer/FuzzedDataProvider.h>
 
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+#include "base/check_op.h"
+#include "base/chunked_pickle_writer.h"
+#include "base/containers/span.h"
 #include "base/macros.h"
 #include "base/pickle.h"
 
 namespace {
 constexpr int kIterations = 16;
 constexpr int kReadControlBytes = 32;
-constexpr int kReadDataTypes = 17;
+constexpr int kReadDataTypes = 18;
+constexpr int kWriteDataTypes = 5;
 constexpr int kMaxReadLength = 1024;
 constexpr int kMaxSkipBytes = 1024;
 }  // namespace
@@ -118,8 +127,66 @@ extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
             data_provider.ConsumeIntegralInRange(0, kMaxSkipBytes)));
         break;
       }
+      case 17: {
+        base::span<const uint8_t> result;
+        ignore_result(iter.ReadBytes(
+            &result, data_provider.ConsumeIntegralInRange(0, kMaxReadLength)));
+        break;
+      }
+    }
+  }
+
+  // Write the rest of the input to a Pickle and a ChunkedPickleWriter the same
+  // way, and check that they serialize identically.
+  FuzzedDataProvider write_provider(data, size);
+  base::Pickle expected;
+  base::ChunkedPickleWriter writer;
+  // Keeps the by-reference strings alive until the writer is flattened.
+  std::vector<std::string> referenced;
+  referenced.reserve(kIterations);
+  for (int i = 0; i < kIterations && write_provider.remaining_bytes(); i++) {
+    switch (write_provider.ConsumeIntegral<uint8_t>() % kWriteDataTypes) {
+      case 0: {
+        int value = write_provider.ConsumeIntegral<int>();
+        expected.WriteInt(value);
+        writer.WriteInt(value);
+        break;
+      }
+      case 1: {
+        uint16_t value = write_provider.ConsumeIntegral<uint16_t>();
+        expected.WriteUInt16(value);
+        writer.WriteUInt16(value);
+        break;
+      }
+      case 2: {
+        uint64_t value = write_provider.ConsumeIntegral<uint64_t>();
+        expected.WriteUInt64(value);
+        writer.WriteUInt64(value);
+        break;
+      }
+      case 3: {
+        std::string value = write_provider.ConsumeRandomLengthString();
+        expected.WriteString(value);
+        writer.WriteString(value);
+        break;
+      }
+      case 4: {
+        referenced.push_back(write_provider.ConsumeRandomLengthString());
+        expected.WriteString(referenced.back());
+        writer.WriteStringByReference(referenced.back());
+        break;
+      }
     }
   }
 
+  CHECK_EQ(expected.size(), writer.size());
+  std::vector<uint8_t> flattened(writer.size());
+  writer.CopyTo(flattened);
+  CHECK_EQ(0, memcmp(expected.data(), flattened.data(), flattened.size()));
+
+  base::Pickle converted = writer.ToPickle();
+  CHECK_EQ(expected.size(), converted.size());
+  CHECK_EQ(0, memcmp(expected.data(), converted.data(), converted.size()));
+
   return 0;
 }
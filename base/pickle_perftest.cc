@@ -0,0 +1,147 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "base/chunked_pickle_writer.h"
+#include "base/pickle.h"
+#include "base/timer/elapsed_timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace base {
+
+namespace {
+
+constexpr char kMetricPrefixPickle[] = "Pickle.";
+constexpr char kMetricWriteTime[] = "write_time";
+constexpr char kMetricReadTime[] = "read_time";
+constexpr char kMetricBytesCopied[] = "bytes_copied";
+
+constexpr int kIterations = 50;
+
+perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixPickle, story_name);
+  reporter.RegisterImportantMetric(kMetricWriteTime, "ms");
+  reporter.RegisterImportantMetric(kMetricReadTime, "ms");
+  reporter.RegisterFyiMetric(kMetricBytesCopied, "bytes");
+  return reporter;
+}
+
+// A message shaped like a cached HTTP response: a few small fields followed by
+// a handful of large strings (headers, certificates).
+struct Message {
+  std::vector<std::string> blobs;
+};
+
+Message BuildMessage(size_t blob_size, size_t blob_count) {
+  Message message;
+  for (size_t i = 0; i < blob_count; ++i)
+    message.blobs.emplace_back(blob_size, static_cast<char>('a' + i % 26));
+  return message;
+}
+
+void WriteHeaderFields(Pickle* pickle) {
+  pickle->WriteInt(1);
+  pickle->WriteInt64(13245678901234567);
+  pickle->WriteBool(true);
+}
+
+void WriteHeaderFields(ChunkedPickleWriter* writer) {
+  writer->WriteInt(1);
+  writer->WriteInt64(13245678901234567);
+  writer->WriteBool(true);
+}
+
+// Serializes the message and copies it into a flat buffer, as a sender would
+// when writing it to disk or a socket.
+void RunWriteTest(const std::string& story,
+                  size_t blob_size,
+                  size_t blob_count) {
+  const Message message = BuildMessage(blob_size, blob_count);
+  std::vector<uint8_t> output;
+
+  ElapsedTimer pickle_timer;
+  size_t pickle_bytes = 0;
+  for (int i = 0; i < kIterations; ++i) {
+    Pickle pickle;
+    WriteHeaderFields(&pickle);
+    for (const std::string& blob : message.blobs)
+      pickle.WriteString(blob);
+    const uint8_t* data = static_cast<const uint8_t*>(pickle.data());
+    output.assign(data, data + pickle.size());
+    // Every blob is copied into the pickle, and the pickle into |output|.
+    pickle_bytes = 2 * pickle.size();
+  }
+  auto pickle_reporter = SetUpReporter(story + "_pickle");
+  pickle_reporter.AddResult(kMetricWriteTime, pickle_timer.Elapsed());
+  pickle_reporter.AddResult(kMetricBytesCopied, pickle_bytes);
+
+  ElapsedTimer chunked_timer;
+  size_t chunked_bytes = 0;
+  for (int i = 0; i < kIterations; ++i) {
+    ChunkedPickleWriter writer;
+    WriteHeaderFields(&writer);
+    for (const std::string& blob : message.blobs)
+      writer.WriteStringByReference(blob);
+    output.resize(writer.size());
+    writer.CopyTo(output);
+    chunked_bytes = writer.size();
+  }
+  auto chunked_reporter = SetUpReporter(story + "_chunked");
+  chunked_reporter.AddResult(kMetricWriteTime, chunked_timer.Elapsed());
+  chunked_reporter.AddResult(kMetricBytesCopied, chunked_bytes);
+}
+
+void RunReadTest(const std::string& story,
+                 size_t blob_size,
+                 size_t blob_count) {
+  const Message message = BuildMessage(blob_size, blob_count);
+  Pickle pickle;
+  for (const std::string& blob : message.blobs)
+    pickle.WriteString(blob);
+
+  size_t total = 0;
+  ElapsedTimer copy_timer;
+  for (int i = 0; i < kIterations; ++i) {
+    PickleIterator iter(pickle);
+    std::string result;
+    while (iter.ReadString(&result))
+      total += result.size();
+  }
+  SetUpReporter(story + "_read_string")
+      .AddResult(kMetricReadTime, copy_timer.Elapsed());
+
+  ElapsedTimer piece_timer;
+  for (int i = 0; i < kIterations; ++i) {
+    PickleIterator iter(pickle);
+    StringPiece result;
+    while (iter.ReadStringPiece(&result))
+      total += result.size();
+  }
+  SetUpReporter(story + "_read_string_piece")
+      .AddResult(kMetricReadTime, piece_timer.Elapsed());
+
+  EXPECT_EQ(2u * kIterations * blob_size * blob_count, total);
+}
+
+}  // namespace
+
+TEST(PicklePerfTest, WriteSmallBlobs) {
+  RunWriteTest("small_blobs", 64, 1000);
+}
+
+TEST(PicklePerfTest, WriteLargeBlobs) {
+  RunWriteTest("large_blobs", 64 * 1024, 64);
+}
+
+TEST(PicklePerfTest, ReadLargeBlobs) {
+  RunReadTest("large_blobs", 64 * 1024, 64);
+}
+
+}  // namespace base
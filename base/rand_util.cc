@@ -9,13 +9,85 @@
 #include <stdint.h>
 
 #include <algorithm>
+#include <atomic>
 #include <limits>
+#include <memory>
 
+#include "base/chacha_random_buffer.h"
 #include "base/check_op.h"
+#include "base/no_destructor.h"
 #include "base/strings/string_util.h"
+#include "base/threading/thread_local.h"
+#include "build/build_config.h"
+
+#if defined(OS_POSIX) && !defined(OS_NACL)
+#include <pthread.h>
+#endif
 
 namespace base {
 
+namespace {
+
+// Number of ChaCha20 blocks a thread's buffer generates before it is re-keyed
+// from the OS, i.e. 4 MiB of output.
+constexpr uint64_t kInsecureReseedBlocks =
+    4 * 1024 * 1024 / internal::ChaChaRandomBuffer::kBlockSize;
+
+// Incremented in the child after fork(), so that it does not keep producing
+// the same numbers as its parent, e.g. zygote children.
+std::atomic<uint32_t> g_fork_generation{0};
+
+struct InsecureRandomState {
+  internal::ChaChaRandomBuffer buffer;
+  // Value of |g_fork_generation| when |buffer| was keyed.
+  uint32_t fork_generation = 0;
+  bool keyed = false;
+};
+
+#if defined(OS_POSIX) && !defined(OS_NACL)
+void OnForkInChild() {
+  g_fork_generation.fetch_add(1, std::memory_order_relaxed);
+}
+#endif
+
+InsecureRandomState* GetInsecureRandomState() {
+  static NoDestructor<ThreadLocalOwnedPointer<InsecureRandomState>> tls;
+#if defined(OS_POSIX) && !defined(OS_NACL)
+  static const bool registered_fork_handler =
+      pthread_atfork(nullptr, nullptr, &OnForkInChild) == 0;
+  DCHECK(registered_fork_handler);
+#endif
+
+  InsecureRandomState* state = tls->Get();
+  if (!state) {
+    tls->Set(std::make_unique<InsecureRandomState>());
+    state = tls->Get();
+  }
+  return state;
+}
+
+// Returns a number in [0, range) from |generator|, which returns numbers in
+// [0, UINT64_MAX].
+template <typename Generator>
+uint64_t RandGeneratorImpl(uint64_t range, Generator generator) {
+  DCHECK_GT(range, 0u);
+  // We must discard random results above this number, as they would
+  // make the random generator non-uniform (consider e.g. if
+  // MAX_UINT64 was 7 and |range| was 5, then a result of 1 would be twice
+  // as likely as a result of 3 or 4).
+  uint64_t max_acceptable_value =
+      (std::numeric_limits<uint64_t>::max() / range) * range - 1;
+
+  uint64_t value;
+  do {
+    value = generator();
+  } while (value > max_acceptable_value);
+
+  return value % range;
+}
+
+}  // namespace
+
 uint64_t RandUint64() {
   uint64_t number;
   RandBytes(&number, sizeof(number));
@@ -56,20 +128,7 @@ double BitsToOpenEndedUnitInterval(uint64_t bits) {
 }
 
 uint64_t RandGenerator(uint64_t range) {
-  DCHECK_GT(range, 0u);
-  // We must discard random results above this number, as they would
-  // make the random generator non-uniform (consider e.g. if
-  // MAX_UINT64 was 7 and |range| was 5, then a result of 1 would be twice
-  // as likely as a result of 3 or 4).
-  uint64_t max_acceptable_value =
-      (std::numeric_limits<uint64_t>::max() / range) * range - 1;
-
-  uint64_t value;
-  do {
-    value = base::RandUint64();
-  } while (value > max_acceptable_value);
-
-  return value % range;
+  return RandGeneratorImpl(range, &base::RandUint64);
 }
 
 std::string RandBytesAsString(size_t length) {
@@ -79,9 +138,32 @@ std::string RandBytesAsString(size_t length) {
   return result;
 }
 
+uint64_t InsecureRandUint64() {
+  InsecureRandomState* state = GetInsecureRandomState();
+  const uint32_t fork_generation =
+      g_fork_generation.load(std::memory_order_relaxed);
+  if (!state->keyed || state->fork_generation != fork_generation ||
+      state->buffer.blocks_generated() >= kInsecureReseedBlocks) {
+    uint8_t key[internal::ChaChaRandomBuffer::kKeySize];
+    RandBytes(key, sizeof(key));
+    state->buffer.SetKey(key);
+    state->fork_generation = fork_generation;
+    state->keyed = true;
+  }
+  return state->buffer.NextUint64();
+}
+
+uint64_t InsecureRandGenerator(uint64_t range) {
+  return RandGeneratorImpl(range, &InsecureRandUint64);
+}
+
+double InsecureRandDouble() {
+  return BitsToOpenEndedUnitInterval(InsecureRandUint64());
+}
+
 void InsecureRandomGenerator::Seed() {
-  a_ = base::RandUint64();
-  b_ = base::RandUint64();
+  a_ = InsecureRandUint64();
+  b_ = InsecureRandUint64();
   seeded_ = true;
 }
 
@@ -24,6 +24,11 @@ class MainThreadMetricsHelper;
 
 namespace base {
 
+// The Rand*() functions below are backed by the OS's cryptographically secure
+// random number generator, and every call makes a system call on most
+// platforms. Code that only needs numbers that look random, and for which the
+// overhead matters, can use the InsecureRand*() functions further below.
+
 // Returns a random number in range [0, UINT64_MAX]. Thread-safe.
 BASE_EXPORT uint64_t RandUint64();
 
@@ -58,6 +63,26 @@ BASE_EXPORT void RandBytes(void* output, size_t output_length);
 // crypto::RandBytes instead to ensure the requirement is easily discoverable.
 BASE_EXPORT std::string RandBytesAsString(size_t length);
 
+// Fast, thread-safe random numbers for code that does not need them to be
+// unpredictable to an attacker, such as timer jitter, metrics sub-sampling and
+// hash table seeds. Do NOT use them for anything security-sensitive: keys,
+// nonces, tokens, or anything an attacker gains from guessing.
+//
+// Each thread draws from its own buffer of ChaCha20 output, keyed from
+// RandBytes() on first use and re-keyed every 4 MiB of output and after fork().
+// Unlike InsecureRandomGenerator below, they need no seeding or
+// synchronization, at the cost of a few ns per call for the thread-local
+// lookup.
+//
+// Returns a random number in range [0, UINT64_MAX].
+BASE_EXPORT uint64_t InsecureRandUint64();
+
+// Returns a random number in range [0, range).
+BASE_EXPORT uint64_t InsecureRandGenerator(uint64_t range);
+
+// Returns a random double in range [0, 1).
+BASE_EXPORT double InsecureRandDouble();
+
 // An STL UniformRandomBitGenerator backed by RandUint64.
 // TODO(tzik): Consider replacing this with a faster implementation.
 class RandomBitGenerator {
@@ -118,7 +143,8 @@ class SequenceManagerImpl;
 // Uses the XorShift128+ generator under the hood.
 class BASE_EXPORT InsecureRandomGenerator {
  public:
-  // Sets the seed by calling RandUint64() to initialize internal state.
+  // Sets the seed by calling InsecureRandUint64() to initialize internal
+  // state.
   void Seed();
   bool seeded() const { return seeded_; }
 
@@ -34,6 +34,24 @@ TEST(RandUtilPerfTest, RandUint64) {
   ASSERT_NE(inclusive_or, static_cast<uint64_t>(0));
 }
 
+TEST(RandUtilPerfTest, InsecureRandUint64) {
+  uint64_t inclusive_or = 0;
+  constexpr int kIterations = 1e7;
+
+  auto before = base::TimeTicks::Now();
+  for (int iter = 0; iter < kIterations; iter++) {
+    inclusive_or |= base::InsecureRandUint64();
+  }
+  auto after = base::TimeTicks::Now();
+
+  perf_test::PerfResultReporter reporter(kMetricPrefix, "InsecureRandUint64");
+  reporter.RegisterImportantMetric(kThroughput, "ns / iteration");
+
+  uint64_t nanos_per_iteration = (after - before).InNanoseconds() / kIterations;
+  reporter.AddResult("throughput", static_cast<size_t>(nanos_per_iteration));
+  ASSERT_NE(inclusive_or, static_cast<uint64_t>(0));
+}
+
 TEST(RandUtilPerfTest, InsecureRandomRandUint64) {
   base::InsecureRandomGenerator gen;
   gen.Seed();
@@ -173,6 +173,55 @@ TEST(RandUtilTest, DISABLED_RandBytesPerf) {
             << ") took: " << (end - now).InMicroseconds() << "µs";
 }
 
+namespace {
+
+// Returns true if all bits take both values within |max_tries| calls to
+// InsecureRandUint64().
+bool InsecureRandUint64ProducesBothValuesOfAllBits(size_t max_tries) {
+  uint64_t found_ones = 0;
+  uint64_t found_zeros = ~found_ones;
+  for (size_t i = 0; i < max_tries; ++i) {
+    uint64_t value = base::InsecureRandUint64();
+    found_ones |= value;
+    found_zeros &= value;
+    if (found_zeros == 0 && found_ones == ~uint64_t{0})
+      return true;
+  }
+  return false;
+}
+
+}  // namespace
+
+TEST(RandUtilTest, InsecureRandUint64ProducesBothValuesOfAllBits) {
+  EXPECT_TRUE(InsecureRandUint64ProducesBothValuesOfAllBits(1000));
+}
+
+// The per-thread generator is re-keyed every 4 MiB of output, and must keep
+// producing good values after that.
+TEST(RandUtilTest, InsecureRandUint64AfterReseed) {
+  constexpr size_t kValuesPerReseed = 4 * 1024 * 1024 / sizeof(uint64_t);
+  uint64_t inclusive_or = 0;
+  for (size_t i = 0; i < kValuesPerReseed; ++i)
+    inclusive_or |= base::InsecureRandUint64();
+  EXPECT_EQ(~uint64_t{0}, inclusive_or);
+  EXPECT_TRUE(InsecureRandUint64ProducesBothValuesOfAllBits(1000));
+}
+
+TEST(RandUtilTest, InsecureRandGenerator) {
+  EXPECT_EQ(0u, base::InsecureRandGenerator(1));
+  for (int i = 0; i < 1000; ++i)
+    EXPECT_LT(base::InsecureRandGenerator(3), 3u);
+}
+
+TEST(RandUtilTest, InsecureRandDouble) {
+  for (int i = 0; i < 1000; i++) {
+    // Force 64-bit precision, making sure we're not in a 80-bit FPU register.
+    volatile double number = base::InsecureRandDouble();
+    EXPECT_GT(1.0, number);
+    EXPECT_LE(0.0, number);
+  }
+}
+
 TEST(RandUtilTest, InsecureRandomGeneratorProducesBothValuesOfAllBits) {
   // This tests to see that our underlying random generator is good
   // enough, for some value of good enough.
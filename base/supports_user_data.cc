@@ -4,8 +4,110 @@
 
 #include "base/supports_user_data.h"
 
+#include "base/check.h"
+
 namespace base {
 
+SupportsUserData::DataMap::DataMap() = default;
+
+SupportsUserData::DataMap::DataMap(DataMap&& other) {
+  *this = std::move(other);
+}
+
+SupportsUserData::DataMap& SupportsUserData::DataMap::operator=(
+    DataMap&& other) {
+  // Take over the current entries first, so that they are destroyed only once
+  // |this| is in a consistent state.
+  DataMap old_entries;
+  for (size_t i = 0; i < inline_size_; ++i)
+    old_entries.inline_[i] = std::move(inline_[i]);
+  old_entries.inline_size_ = inline_size_;
+  old_entries.overflow_ = std::move(overflow_);
+
+  for (size_t i = 0; i < other.inline_size_; ++i)
+    inline_[i] = std::move(other.inline_[i]);
+  inline_size_ = other.inline_size_;
+  overflow_ = std::move(other.overflow_);
+  other.inline_size_ = 0;
+  return *this;
+}
+
+SupportsUserData::DataMap::~DataMap() = default;
+
+SupportsUserData::Data* SupportsUserData::DataMap::Find(const void* key) const {
+  if (overflow_) {
+    auto found = overflow_->find(key);
+    return found != overflow_->end() ? found->second.get() : nullptr;
+  }
+  for (size_t i = 0; i < inline_size_; ++i) {
+    if (inline_[i].first == key)
+      return inline_[i].second.get();
+  }
+  return nullptr;
+}
+
+std::unique_ptr<SupportsUserData::Data> SupportsUserData::DataMap::Set(
+    const void* key,
+    std::unique_ptr<Data> data) {
+  DCHECK(data);
+  if (overflow_) {
+    std::unique_ptr<Data>& slot = (*overflow_)[key];
+    std::swap(slot, data);
+    return data;
+  }
+
+  for (size_t i = 0; i < inline_size_; ++i) {
+    if (inline_[i].first == key) {
+      std::swap(inline_[i].second, data);
+      return data;
+    }
+  }
+
+  if (inline_size_ < kInlineUserDataCount) {
+    inline_[inline_size_++] = Entry(key, std::move(data));
+    return nullptr;
+  }
+
+  auto overflow = std::make_unique<OverflowMap>();
+  overflow->reserve(kInlineUserDataCount * 2);
+  for (size_t i = 0; i < inline_size_; ++i)
+    overflow->insert(std::move(inline_[i]));
+  overflow->emplace(key, std::move(data));
+  for (size_t i = 0; i < inline_size_; ++i)
+    inline_[i].first = nullptr;
+  inline_size_ = 0;
+  overflow_ = std::move(overflow);
+  return nullptr;
+}
+
+std::unique_ptr<SupportsUserData::Data> SupportsUserData::DataMap::Remove(
+    const void* key) {
+  std::unique_ptr<Data> removed;
+  if (overflow_) {
+    auto found = overflow_->find(key);
+    if (found != overflow_->end()) {
+      removed = std::move(found->second);
+      overflow_->erase(found);
+    }
+    return removed;
+  }
+
+  for (size_t i = 0; i < inline_size_; ++i) {
+    if (inline_[i].first == key) {
+      removed = std::move(inline_[i].second);
+      // Keep the used entries contiguous.
+      inline_[i] = std::move(inline_[--inline_size_]);
+      inline_[inline_size_].first = nullptr;
+      break;
+    }
+  }
+  return removed;
+}
+
+bool SupportsUserData::DataMap::empty() const {
+  return overflow_ ? overflow_->empty() : inline_size_ == 0;
+}
+
 std::unique_ptr<SupportsUserData::Data> SupportsUserData::Data::Clone() {
   return nullptr;
 }
@@ -23,10 +125,7 @@ SupportsUserData::Data* SupportsUserData::GetUserData(const void* key) const {
   DCHECK(sequence_checker_.CalledOnValidSequence());
   // Avoid null keys; they are too vulnerable to collision.
   DCHECK(key);
-  auto found = user_data_.find(key);
-  if (found != user_data_.end())
-    return found->second.get();
-  return nullptr;
+  return user_data_.Find(key);
 }
 
 void SupportsUserData::SetUserData(const void* key,
@@ -35,14 +134,14 @@ void SupportsUserData::SetUserData(const void* key,
   // Avoid null keys; they are too vulnerable to collision.
   DCHECK(key);
   if (data.get())
-    user_data_[key] = std::move(data);
+    user_data_.Set(key, std::move(data));
   else
     RemoveUserData(key);
 }
 
 void SupportsUserData::RemoveUserData(const void* key) {
   DCHECK(sequence_checker_.CalledOnValidSequence());
-  user_data_.erase(key);
+  user_data_.Remove(key);
 }
 
 void SupportsUserData::DetachFromSequence() {
@@ -50,17 +149,16 @@ void SupportsUserData::DetachFromSequence() {
 }
 
 void SupportsUserData::CloneDataFrom(const SupportsUserData& other) {
-  for (const auto& data_pair : other.user_data_) {
-    auto cloned_data = data_pair.second->Clone();
+  other.user_data_.ForEach([this](const void* key, Data* data) {
+    auto cloned_data = data->Clone();
     if (cloned_data)
-      SetUserData(data_pair.first, std::move(cloned_data));
-  }
+      SetUserData(key, std::move(cloned_data));
+  });
 }
 
 SupportsUserData::~SupportsUserData() {
   DCHECK(sequence_checker_.CalledOnValidSequence() || user_data_.empty());
-  DataMap local_user_data;
-  user_data_.swap(local_user_data);
+  DataMap local_user_data = std::move(user_data_);
   // Now this->user_data_ is empty, and any destructors called transitively from
   // the destruction of |local_user_data| will see it that way instead of
   // examining a being-destroyed object.
@@ -68,7 +166,8 @@ SupportsUserData::~SupportsUserData() {
 
 void SupportsUserData::ClearAllUserData() {
   DCHECK(sequence_checker_.CalledOnValidSequence());
-  user_data_.clear();
+  // Same as in the destructor, Data destructors see an empty map.
+  DataMap local_user_data = std::move(user_data_);
 }
 
 }  // namespace base
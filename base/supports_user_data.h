@@ -5,8 +5,12 @@
 #ifndef BASE_SUPPORTS_USER_DATA_H_
 #define BASE_SUPPORTS_USER_DATA_H_
 
-#include <map>
+#include <stddef.h>
+
+#include <array>
 #include <memory>
+#include <unordered_map>
+#include <utility>
 
 #include "base/base_export.h"
 #include "base/memory/ref_counted.h"
@@ -16,8 +20,14 @@ namespace base {
 
 // This is a helper for classes that want to allow users to stash random data by
 // key. At destruction all the objects will be destructed.
+//
+// Most instances hold only a few entries, so up to kInlineUserDataCount of
+// them are stored inline in the object and found by linear search. Beyond
+// that, all entries move to a hash map.
 class BASE_EXPORT SupportsUserData {
  public:
+  static constexpr size_t kInlineUserDataCount = 4;
+
   SupportsUserData();
   SupportsUserData(SupportsUserData&&);
   SupportsUserData& operator=(SupportsUserData&&);
@@ -62,7 +72,45 @@ class BASE_EXPORT SupportsUserData {
   void ClearAllUserData();
 
  private:
-  using DataMap = std::map<const void*, std::unique_ptr<Data>>;
+  // Map from keys to data, inline up to kInlineUserDataCount entries. Removing
+  // an entry moves it out of the map before destroying it, so that Data
+  // destructors calling back into SupportsUserData see a consistent map.
+  class DataMap {
+   public:
+    DataMap();
+    DataMap(DataMap&& other);
+    DataMap& operator=(DataMap&& other);
+    ~DataMap();
+
+    Data* Find(const void* key) const;
+    // Returns the previous data for |key|, if any, for the caller to destroy.
+    std::unique_ptr<Data> Set(const void* key, std::unique_ptr<Data> data);
+    std::unique_ptr<Data> Remove(const void* key);
+    bool empty() const;
+
+    // Calls |function| with each key and data.
+    template <typename Function>
+    void ForEach(Function function) const {
+      if (overflow_) {
+        for (const auto& entry : *overflow_)
+          function(entry.first, entry.second.get());
+        return;
+      }
+      for (size_t i = 0; i < inline_size_; ++i)
+        function(inline_[i].first, inline_[i].second.get());
+    }
+
+   private:
+    using Entry = std::pair<const void*, std::unique_ptr<Data>>;
+    using OverflowMap = std::unordered_map<const void*, std::unique_ptr<Data>>;
+
+    // Number of used entries of |inline_|. Zero once |overflow_| is in use.
+    size_t inline_size_ = 0;
+    std::array<Entry, kInlineUserDataCount> inline_;
+    // Non-null once more than kInlineUserDataCount entries were stored. Stays
+    // in use until the map is moved from or destroyed.
+    std::unique_ptr<OverflowMap> overflow_;
+  };
 
   // Externally-defined data accessible by key.
   DataMap user_data_;
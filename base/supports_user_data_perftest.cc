@@ -0,0 +1,156 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/supports_user_data.h"
+
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/strings/stringprintf.h"
+#include "base/timer/elapsed_timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace base {
+
+namespace {
+
+constexpr char kMetricPrefixSupportsUserData[] = "SupportsUserData.";
+constexpr char kMetricLookupTime[] = "lookup_time";
+constexpr char kMetricObjectSize[] = "object_size";
+constexpr char kMetricContainerAllocations[] =
+    "container_allocations_per_object";
+
+constexpr int kObjects = 10000;
+constexpr int kLookupLaps = 100;
+
+perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixSupportsUserData,
+                                         story_name);
+  reporter.RegisterImportantMetric(kMetricLookupTime, "ns");
+  reporter.RegisterImportantMetric(kMetricObjectSize, "bytes");
+  reporter.RegisterImportantMetric(kMetricContainerAllocations, "count");
+  return reporter;
+}
+
+struct TestSupportsUserData : public SupportsUserData {};
+
+struct TestData : public SupportsUserData::Data {};
+
+// The std::map based storage SupportsUserData used to have, as a baseline.
+class MapUserData {
+ public:
+  SupportsUserData::Data* GetUserData(const void* key) const {
+    auto found = user_data_.find(key);
+    return found != user_data_.end() ? found->second.get() : nullptr;
+  }
+  void SetUserData(const void* key,
+                   std::unique_ptr<SupportsUserData::Data> data) {
+    user_data_[key] = std::move(data);
+  }
+
+ private:
+  std::map<const void*, std::unique_ptr<SupportsUserData::Data>> user_data_;
+};
+
+// Keys are usually the addresses of statics in different files.
+char g_keys[16];
+
+// Number of entries of the |index|th object of a population resembling
+// WebContents, NavigationHandles and URLRequests: many objects have no or a
+// single entry, and a few have more than fit inline.
+size_t EntryCountForObject(int index) {
+  static constexpr size_t kDistribution[] = {0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                             3, 3, 4, 4, 5, 8};
+  return kDistribution[index % std::size(kDistribution)];
+}
+
+// Allocations made by the container itself, not counting the Data.
+size_t ContainerAllocations(size_t entry_count, bool is_map) {
+  if (is_map)
+    return entry_count;
+  if (entry_count <= SupportsUserData::kInlineUserDataCount)
+    return 0;
+  // One node per entry, plus the bucket array.
+  return entry_count + 1;
+}
+
+template <typename UserDataType>
+void RunTest(const std::string& story_name, bool is_map) {
+  std::vector<std::unique_ptr<UserDataType>> objects;
+  size_t container_allocations = 0;
+  size_t total_entries = 0;
+  for (int i = 0; i < kObjects; ++i) {
+    objects.push_back(std::make_unique<UserDataType>());
+    size_t entry_count = EntryCountForObject(i);
+    for (size_t j = 0; j < entry_count; ++j)
+      objects.back()->SetUserData(&g_keys[j], std::make_unique<TestData>());
+    container_allocations += ContainerAllocations(entry_count, is_map);
+    total_entries += entry_count;
+  }
+
+  // Look up the first key of every object, as most callers do for the one
+  // piece of data they own, whether it is present or not.
+  size_t found = 0;
+  ElapsedTimer timer;
+  for (int lap = 0; lap < kLookupLaps; ++lap) {
+    for (const auto& object : objects)
+      found += !!object->GetUserData(&g_keys[lap % 2]);
+  }
+  TimeDelta elapsed = timer.Elapsed();
+  EXPECT_GT(found, 0u);
+  EXPECT_GT(total_entries, 0u);
+
+  auto reporter = SetUpReporter(story_name);
+  reporter.AddResult(kMetricLookupTime,
+                     elapsed.InNanosecondsF() / (kObjects * kLookupLaps));
+  reporter.AddResult(kMetricObjectSize, sizeof(UserDataType));
+  reporter.AddResult(kMetricContainerAllocations,
+                     static_cast<double>(container_allocations) / kObjects);
+}
+
+// Lookups in objects that all have |entry_count| entries.
+template <typename UserDataType>
+void RunLookupTest(const std::string& story_name, size_t entry_count) {
+  std::vector<std::unique_ptr<UserDataType>> objects;
+  for (int i = 0; i < kObjects / 10; ++i) {
+    objects.push_back(std::make_unique<UserDataType>());
+    for (size_t j = 0; j < entry_count; ++j)
+      objects.back()->SetUserData(&g_keys[j], std::make_unique<TestData>());
+  }
+
+  size_t found = 0;
+  ElapsedTimer timer;
+  for (int lap = 0; lap < kLookupLaps; ++lap) {
+    for (const auto& object : objects) {
+      for (size_t j = 0; j < entry_count; ++j)
+        found += !!object->GetUserData(&g_keys[j]);
+    }
+  }
+  TimeDelta elapsed = timer.Elapsed();
+  EXPECT_EQ(objects.size() * kLookupLaps * entry_count, found);
+
+  SetUpReporter(StringPrintf("%s_%zu", story_name.c_str(), entry_count))
+      .AddResult(kMetricLookupTime,
+                 elapsed.InNanosecondsF() / static_cast<double>(found));
+}
+
+}  // namespace
+
+TEST(SupportsUserDataPerfTest, Population) {
+  RunTest<TestSupportsUserData>("population", /*is_map=*/false);
+  RunTest<MapUserData>("population_std_map", /*is_map=*/true);
+}
+
+TEST(SupportsUserDataPerfTest, Lookup) {
+  for (size_t entry_count : {1, 2, 4, 8, 16}) {
+    RunLookupTest<TestSupportsUserData>("lookup", entry_count);
+    RunLookupTest<MapUserData>("lookup_std_map", entry_count);
+  }
+}
+
+}  // namespace base
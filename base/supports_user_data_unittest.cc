@@ -73,5 +73,118 @@ TEST(SupportsUserDataTest, ClearAllUserData) {
   EXPECT_FALSE(supports_user_data.GetUserData(&key2));
 }
 
+struct CloneableTestData : public SupportsUserData::Data {
+  explicit CloneableTestData(int value) : value(value) {}
+
+  std::unique_ptr<Data> Clone() override {
+    return std::make_unique<CloneableTestData>(value);
+  }
+
+  int value;
+};
+
+// Enough keys to move the data out of the inline storage.
+constexpr size_t kManyKeys = SupportsUserData::kInlineUserDataCount * 3;
+
+TEST(SupportsUserDataTest, ManyKeys) {
+  TestSupportsUserData supports_user_data;
+  char keys[kManyKeys] = {};
+  std::vector<SupportsUserData::Data*> data;
+  for (size_t i = 0; i < kManyKeys; ++i) {
+    supports_user_data.SetUserData(&keys[i], std::make_unique<TestData>());
+    data.push_back(supports_user_data.GetUserData(&keys[i]));
+    // Entries set so far, inline or not, are all still there.
+    for (size_t j = 0; j <= i; ++j)
+      EXPECT_EQ(data[j], supports_user_data.GetUserData(&keys[j]));
+  }
+
+  // Replacing an entry keeps the others.
+  supports_user_data.SetUserData(&keys[0], std::make_unique<TestData>());
+  EXPECT_NE(nullptr, supports_user_data.GetUserData(&keys[0]));
+  EXPECT_EQ(data[1], supports_user_data.GetUserData(&keys[1]));
+
+  for (size_t i = 0; i < kManyKeys; i += 2)
+    supports_user_data.RemoveUserData(&keys[i]);
+  for (size_t i = 0; i < kManyKeys; ++i) {
+    EXPECT_EQ(i % 2 ? data[i] : nullptr,
+              supports_user_data.GetUserData(&keys[i]));
+  }
+
+  supports_user_data.ClearAllUserData();
+  for (size_t i = 0; i < kManyKeys; ++i)
+    EXPECT_EQ(nullptr, supports_user_data.GetUserData(&keys[i]));
+}
+
+TEST(SupportsUserDataTest, RemoveInline) {
+  TestSupportsUserData supports_user_data;
+  char keys[SupportsUserData::kInlineUserDataCount] = {};
+  for (char& key : keys)
+    supports_user_data.SetUserData(&key, std::make_unique<TestData>());
+
+  // Remove from the middle, then the end, then the start.
+  supports_user_data.RemoveUserData(&keys[1]);
+  supports_user_data.RemoveUserData(
+      &keys[SupportsUserData::kInlineUserDataCount - 1]);
+  supports_user_data.RemoveUserData(&keys[0]);
+  for (size_t i = 0; i < SupportsUserData::kInlineUserDataCount - 1; ++i) {
+    EXPECT_EQ(i == 2, !!supports_user_data.GetUserData(&keys[i]));
+  }
+
+  // Removed slots can be reused.
+  supports_user_data.SetUserData(&keys[0], std::make_unique<TestData>());
+  EXPECT_TRUE(supports_user_data.GetUserData(&keys[0]));
+  EXPECT_TRUE(supports_user_data.GetUserData(&keys[2]));
+}
+
+TEST(SupportsUserDataTest, ClearWorksRecursivelyWithManyKeys) {
+  TestSupportsUserData supports_user_data;
+  char keys[kManyKeys] = {};
+  for (char& key : keys) {
+    supports_user_data.SetUserData(
+        &key, std::make_unique<UsesItself>(&supports_user_data, &key));
+  }
+  supports_user_data.ClearAllUserData();
+}
+
+TEST(SupportsUserDataTest, MovableWithManyKeys) {
+  TestSupportsUserData supports_user_data_1;
+  char keys[kManyKeys] = {};
+  for (char& key : keys)
+    supports_user_data_1.SetUserData(&key, std::make_unique<TestData>());
+  void* data_ptr = supports_user_data_1.GetUserData(&keys[kManyKeys - 1]);
+
+  TestSupportsUserData supports_user_data_2(std::move(supports_user_data_1));
+  EXPECT_EQ(data_ptr, supports_user_data_2.GetUserData(&keys[kManyKeys - 1]));
+
+  // The moved-from object is empty and usable.
+  EXPECT_EQ(nullptr, supports_user_data_1.GetUserData(&keys[0]));
+  supports_user_data_1.SetUserData(&keys[0], std::make_unique<TestData>());
+  EXPECT_TRUE(supports_user_data_1.GetUserData(&keys[0]));
+}
+
+TEST(SupportsUserDataTest, CloneDataFrom) {
+  for (size_t count : {size_t{2}, kManyKeys}) {
+    TestSupportsUserData source;
+    char keys[kManyKeys] = {};
+    char uncloneable_key = 0;
+    for (size_t i = 0; i < count; ++i) {
+      source.SetUserData(
+          &keys[i], std::make_unique<CloneableTestData>(static_cast<int>(i)));
+    }
+    source.SetUserData(&uncloneable_key, std::make_unique<TestData>());
+
+    TestSupportsUserData destination;
+    destination.CloneDataFrom(source);
+    for (size_t i = 0; i < count; ++i) {
+      auto* data =
+          static_cast<CloneableTestData*>(destination.GetUserData(&keys[i]));
+      ASSERT_TRUE(data);
+      EXPECT_NE(source.GetUserData(&keys[i]), data);
+      EXPECT_EQ(static_cast<int>(i), data->value);
+    }
+    EXPECT_EQ(nullptr, destination.GetUserData(&uncloneable_key));
+  }
+}
+
 }  // namespace
 }  // namespace base
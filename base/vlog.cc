@@ -5,10 +5,14 @@
 #include "base/vlog.h"
 
 #include <stddef.h>
+#include <stdint.h>
 
+#include <algorithm>
+#include <atomic>
 #include <ostream>
 #include <utility>
 
+#include "base/bits.h"
 #include "base/cxx17_backports.h"
 #include "base/logging.h"
 #include "base/strings/string_number_conversions.h"
@@ -46,6 +50,252 @@ VlogInfo::VmodulePattern::VmodulePattern()
     : vlog_level(VlogInfo::kDefaultVlogLevel),
       match_target(MATCH_MODULE) {}
 
+namespace {
+
+// Matches a string against a list of vlog patterns in a single pass. The
+// patterns are compiled into one NFA, with a state per pattern character and
+// an accepting state per pattern, whose set of active states is kept as a bit
+// vector. Each input character then updates all the patterns at once with a
+// few bitwise operations per 64 states (the "shift-and" algorithm, extended
+// to support *).
+class GlobAutomaton {
+ public:
+  static constexpr int kNoMatch = -1;
+
+  GlobAutomaton() = default;
+  GlobAutomaton(const GlobAutomaton&) = delete;
+  GlobAutomaton& operator=(const GlobAutomaton&) = delete;
+
+  // Adds |pattern|, reported as |id| when it matches. Ids must be increasing.
+  void AddPattern(base::StringPiece pattern, int id);
+
+  // Builds the automaton, after all patterns are added.
+  void Compile();
+
+  // Returns the smallest id of the patterns matching |string|, or kNoMatch.
+  int Match(base::StringPiece string) const;
+
+ private:
+  using Word = uint64_t;
+  static constexpr size_t kWordBits = 64;
+  static constexpr size_t kAlphabetSize = 256;
+
+  // The character of each state, or 0 for accepting states.
+  std::string state_chars_;
+  // The id reported by each accepting state.
+  std::vector<int> state_ids_;
+
+  size_t word_count_ = 0;
+  // For each character, the states that consume it to move to the next one.
+  // These do not include * states, which consume any character to remain
+  // active instead.
+  std::vector<Word> char_masks_;
+  std::vector<Word> star_states_;
+  std::vector<Word> accepting_states_;
+  std::vector<Word> initial_states_;
+
+  static void SetBit(Word* bits, size_t state) {
+    bits[state / kWordBits] |= Word{1} << (state % kWordBits);
+  }
+
+  // Activates the state following each active * state, as * matches the empty
+  // string. Consecutive *s are merged by AddPattern(), so that a single pass
+  // suffices.
+  void FollowStars(Word* states) const;
+};
+
+void GlobAutomaton::AddPattern(base::StringPiece pattern, int id) {
+  DCHECK(state_ids_.empty() || state_ids_.back() < id);
+  for (char c : pattern) {
+    if (c == '*' && !state_chars_.empty() && state_chars_.back() == '*')
+      continue;
+    // A NUL in the pattern would be taken for an accepting state, and can't
+    // appear in file names anyway.
+    state_chars_.push_back(c ? c : '?');
+    state_ids_.push_back(kNoMatch);
+  }
+  state_chars_.push_back(0);
+  state_ids_.push_back(id);
+}
+
+void GlobAutomaton::Compile() {
+  word_count_ = (state_chars_.size() + kWordBits - 1) / kWordBits;
+  char_masks_.assign(kAlphabetSize * word_count_, 0);
+  star_states_.assign(word_count_, 0);
+  accepting_states_.assign(word_count_, 0);
+  initial_states_.assign(word_count_, 0);
+
+  bool at_pattern_start = true;
+  for (size_t state = 0; state < state_chars_.size(); ++state) {
+    if (at_pattern_start)
+      SetBit(initial_states_.data(), state);
+    const unsigned char c = static_cast<unsigned char>(state_chars_[state]);
+    at_pattern_start = c == 0;
+    switch (c) {
+      case 0:
+        SetBit(accepting_states_.data(), state);
+        break;
+      case '*':
+        SetBit(star_states_.data(), state);
+        break;
+      // A '?' matches anything.
+      case '?':
+        for (size_t input = 0; input < kAlphabetSize; ++input)
+          SetBit(&char_masks_[input * word_count_], state);
+        break;
+      // A slash (forward or back) must match a slash (forward or back).
+      case '/':
+      case '\\':
+        SetBit(&char_masks_['/' * word_count_], state);
+        SetBit(&char_masks_['\\' * word_count_], state);
+        break;
+      default:
+        SetBit(&char_masks_[c * word_count_], state);
+        break;
+    }
+  }
+  FollowStars(initial_states_.data());
+}
+
+void GlobAutomaton::FollowStars(Word* states) const {
+  Word carry = 0;
+  for (size_t i = 0; i < word_count_; ++i) {
+    const Word stars = states[i] & star_states_[i];
+    states[i] |= (stars << 1) | carry;
+    carry = stars >> (kWordBits - 1);
+  }
+}
+
+int GlobAutomaton::Match(base::StringPiece string) const {
+  if (!word_count_)
+    return kNoMatch;
+
+  std::vector<Word> states(initial_states_);
+  for (char c : string) {
+    const Word* mask =
+        &char_masks_[static_cast<unsigned char>(c) * word_count_];
+    Word carry = 0;
+    Word any_active = 0;
+    for (size_t i = 0; i < word_count_; ++i) {
+      const Word moving = states[i] & mask[i];
+      states[i] = (moving << 1) | carry | (states[i] & star_states_[i]);
+      carry = moving >> (kWordBits - 1);
+      any_active |= states[i];
+    }
+    if (!any_active)
+      return kNoMatch;
+    FollowStars(states.data());
+  }
+
+  // Patterns are laid out in the order they were added, so the first
+  // accepting state has the smallest id.
+  for (size_t i = 0; i < word_count_; ++i) {
+    const Word accepted = states[i] & accepting_states_[i];
+    if (accepted) {
+      return state_ids_[i * kWordBits +
+                        base::bits::CountTrailingZeroBits(accepted)];
+    }
+  }
+  return kNoMatch;
+}
+
+}  // namespace
+
+class VlogInfo::VmoduleMatcher {
+ public:
+  explicit VmoduleMatcher(const std::vector<VmodulePattern>& patterns) {
+    for (size_t i = 0; i < patterns.size(); ++i) {
+      GlobAutomaton& automaton =
+          patterns[i].match_target == VmodulePattern::MATCH_FILE
+              ? file_automaton_
+              : module_automaton_;
+      automaton.AddPattern(patterns[i].pattern, static_cast<int>(i));
+    }
+    module_automaton_.Compile();
+    file_automaton_.Compile();
+  }
+  VmoduleMatcher(const VmoduleMatcher&) = delete;
+  VmoduleMatcher& operator=(const VmoduleMatcher&) = delete;
+
+  // Returns the index of the first pattern matching either |module|, if it
+  // applies to modules, or |file|, or -1.
+  int Match(base::StringPiece file, base::StringPiece module) const {
+    const int module_match = module_automaton_.Match(module);
+    const int file_match = file_automaton_.Match(file);
+    if (module_match == GlobAutomaton::kNoMatch)
+      return file_match;
+    if (file_match == GlobAutomaton::kNoMatch)
+      return module_match;
+    return std::min(module_match, file_match);
+  }
+
+ private:
+  GlobAutomaton module_automaton_;
+  GlobAutomaton file_automaton_;
+};
+
+// A fixed-size hash table from the address of a file name to the index of the
+// pattern it matches, which threads can look up and insert into without
+// locking. Entries are never removed, and files that don't fit are simply not
+// cached.
+class VlogInfo::MatchCache {
+ public:
+  static constexpr int kNotCached = -2;
+
+  MatchCache() = default;
+  MatchCache(const MatchCache&) = delete;
+  MatchCache& operator=(const MatchCache&) = delete;
+
+  // Returns the pattern index stored for |file|, or kNotCached.
+  int Find(const char* file) const {
+    for (size_t probe = 0; probe < kMaxProbes; ++probe) {
+      const Entry& entry = entries_[Slot(file, probe)];
+      const char* key = entry.file.load(std::memory_order_acquire);
+      if (key == file)
+        return entry.pattern_index.load(std::memory_order_acquire);
+      if (!key)
+        break;
+    }
+    return kNotCached;
+  }
+
+  void Insert(const char* file, int pattern_index) {
+    for (size_t probe = 0; probe < kMaxProbes; ++probe) {
+      Entry& entry = entries_[Slot(file, probe)];
+      const char* key = nullptr;
+      // On failure, |key| is the file that claimed the entry first, which may
+      // be |file| if another thread inserted it concurrently. Both store the
+      // same index.
+      if (entry.file.compare_exchange_strong(key, file,
+                                             std::memory_order_acq_rel) ||
+          key == file) {
+        entry.pattern_index.store(pattern_index, std::memory_order_release);
+        return;
+      }
+    }
+  }
+
+ private:
+  static constexpr size_t kSize = 1024;
+  static constexpr size_t kMaxProbes = 16;
+
+  // |file| is set first, when the entry is claimed, and |pattern_index| next.
+  struct Entry {
+    std::atomic<const char*> file{nullptr};
+    std::atomic<int> pattern_index{kNotCached};
+  };
+
+  static size_t Slot(const char* file, size_t probe) {
+    // Fibonacci hashing of the address, followed by linear probing.
+    const uint64_t hash =
+        static_cast<uint64_t>(reinterpret_cast<uintptr_t>(file)) *
+        UINT64_C(0x9E3779B97F4A7C15);
+    return (static_cast<size_t>(hash >> 54) + probe) % kSize;
+  }
+
+  Entry entries_[kSize];
+};
+
 VlogInfo::VlogInfo(const std::string& v_switch,
                    const std::string& vmodule_switch,
                    int* min_log_level)
@@ -77,6 +327,11 @@ VlogInfo::VlogInfo(const std::string& v_switch,
     }
     vmodule_levels_.push_back(pattern);
   }
+
+  if (!vmodule_levels_.empty()) {
+    matcher_ = std::make_unique<VmoduleMatcher>(vmodule_levels_);
+    match_cache_ = std::make_unique<MatchCache>();
+  }
 }
 
 VlogInfo::~VlogInfo() = default;
@@ -105,17 +360,32 @@ base::StringPiece GetModule(const base::StringPiece& file) {
 
 int VlogInfo::GetVlogLevel(const base::StringPiece& file) const {
   if (!vmodule_levels_.empty()) {
-    base::StringPiece module(GetModule(file));
-    for (const auto& it : vmodule_levels_) {
-      base::StringPiece target(
-          (it.match_target == VmodulePattern::MATCH_FILE) ? file : module);
-      if (MatchVlogPattern(target, it.pattern))
-        return it.vlog_level;
+    int pattern_index = FindPattern(file);
+    if (pattern_index >= 0)
+      return vmodule_levels_[pattern_index].vlog_level;
+  }
+  return GetMaxVlogLevel();
+}
+
+int VlogInfo::GetVlogLevelForStaticFile(const base::StringPiece& file) const {
+  if (!vmodule_levels_.empty()) {
+    // The index is cached rather than the level, as the level of files that
+    // match no pattern follows SetMinLogLevel().
+    int pattern_index = match_cache_->Find(file.data());
+    if (pattern_index == MatchCache::kNotCached) {
+      pattern_index = FindPattern(file);
+      match_cache_->Insert(file.data(), pattern_index);
     }
+    if (pattern_index >= 0)
+      return vmodule_levels_[pattern_index].vlog_level;
   }
   return GetMaxVlogLevel();
 }
 
+int VlogInfo::FindPattern(const base::StringPiece& file) const {
+  return matcher_->Match(file, GetModule(file));
+}
+
 void VlogInfo::SetMaxVlogLevel(int level) {
   // Log severity is the negative verbosity.
   *min_log_level_ = -level;
@@ -5,6 +5,7 @@
 #ifndef BASE_VLOG_H_
 #define BASE_VLOG_H_
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -47,15 +48,33 @@ class BASE_EXPORT VlogInfo {
   // __FILE__).
   int GetVlogLevel(const base::StringPiece& file) const;
 
+  // Same as GetVlogLevel(), but remembers which pattern |file| matched, by
+  // the address of its characters. |file| must therefore point to a string
+  // that never changes, such as __FILE__. Safe to call from any thread.
+  int GetVlogLevelForStaticFile(const base::StringPiece& file) const;
+
  private:
   void SetMaxVlogLevel(int level);
   int GetMaxVlogLevel() const;
 
+  // Returns the index in |vmodule_levels_| of the first pattern matching
+  // |file|, or -1.
+  int FindPattern(const base::StringPiece& file) const;
+
   // VmodulePattern holds all the information for each pattern parsed
   // from |vmodule_switch|.
   struct VmodulePattern;
   std::vector<VmodulePattern> vmodule_levels_;
   int* min_log_level_;
+
+  // Matches files against all of |vmodule_levels_| at once.
+  class VmoduleMatcher;
+  std::unique_ptr<VmoduleMatcher> matcher_;
+
+  // Remembers the result of FindPattern() for the files passed to
+  // GetVlogLevelForStaticFile().
+  class MatchCache;
+  std::unique_ptr<MatchCache> match_cache_;
 };
 
 // Returns true if the string passed in matches the vlog pattern.  The
@@ -0,0 +1,150 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "base/vlog.h"
+
+#include <string>
+#include <vector>
+
+#include "base/strings/string_piece.h"
+#include "base/strings/string_split.h"
+#include "base/strings/string_util.h"
+#include "base/strings/stringprintf.h"
+#include "base/timer/elapsed_timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace logging {
+
+namespace {
+
+constexpr char kMetricPrefixVlog[] = "Vlog.";
+constexpr char kMetricGetVlogLevelTime[] = "get_vlog_level_time";
+
+constexpr int kFiles = 500;
+constexpr int kLaps = 20;
+
+perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixVlog, story_name);
+  reporter.RegisterImportantMetric(kMetricGetVlogLevelTime, "ns");
+  return reporter;
+}
+
+// A vmodule switch of |pattern_count| patterns, mixing the shapes seen in
+// debugging instructions: plain module names, module prefixes, and
+// directories.
+std::string BuildVmoduleSwitch(int pattern_count) {
+  std::vector<std::string> patterns;
+  for (int i = 0; i < pattern_count; ++i) {
+    switch (i % 4) {
+      case 0:
+        patterns.push_back(base::StringPrintf("network_service_%d=1", i));
+        break;
+      case 1:
+        patterns.push_back(base::StringPrintf("render_frame_host_%d*=2", i));
+        break;
+      case 2:
+        patterns.push_back(
+            base::StringPrintf("*/components/feature_%d/*=1", i));
+        break;
+      case 3:
+        patterns.push_back(base::StringPrintf("*_manager_%d=3", i));
+        break;
+    }
+  }
+  return base::JoinString(patterns, ",");
+}
+
+// Source file names like __FILE__ in a Chromium build, of which a few match
+// the patterns.
+std::vector<std::string> BuildFiles() {
+  std::vector<std::string> files;
+  for (int i = 0; i < kFiles; ++i) {
+    files.push_back(base::StringPrintf(
+        "../../components/feature_%d/browser/download_manager_%d.cc", i % 40,
+        i));
+  }
+  return files;
+}
+
+// Roughly the matching VlogInfo did before patterns were compiled: each
+// pattern is tried in turn with MatchVlogPattern().
+int GetVlogLevelPerPattern(
+    const std::vector<std::pair<std::string, int>>& patterns,
+    base::StringPiece file) {
+  base::StringPiece module = file;
+  module.remove_prefix(module.find_last_of("\\/") + 1);
+  module = module.substr(0, module.rfind('.'));
+  for (const auto& pattern : patterns) {
+    bool match_file = pattern.first.find_first_of("\\/") != std::string::npos;
+    if (MatchVlogPattern(match_file ? file : module, pattern.first))
+      return pattern.second;
+  }
+  return 0;
+}
+
+void RunTest(int pattern_count) {
+  const std::string vmodule_switch = BuildVmoduleSwitch(pattern_count);
+  const std::vector<std::string> files = BuildFiles();
+  int min_log_level = 0;
+  VlogInfo vlog_info(std::string(), vmodule_switch, &min_log_level);
+
+  base::StringPairs pairs;
+  base::SplitStringIntoKeyValuePairs(vmodule_switch, '=', ',', &pairs);
+  std::vector<std::pair<std::string, int>> patterns;
+  for (const auto& pair : pairs)
+    patterns.emplace_back(pair.first, pair.second[0] - '0');
+
+  int expected_sum = 0;
+  for (const std::string& file : files)
+    expected_sum += GetVlogLevelPerPattern(patterns, file);
+
+  int sum = 0;
+  base::ElapsedTimer per_pattern_timer;
+  for (int lap = 0; lap < kLaps; ++lap) {
+    for (const std::string& file : files)
+      sum += GetVlogLevelPerPattern(patterns, file);
+  }
+  const base::TimeDelta per_pattern_elapsed = per_pattern_timer.Elapsed();
+  EXPECT_EQ(expected_sum * kLaps, sum);
+
+  sum = 0;
+  base::ElapsedTimer compiled_timer;
+  for (int lap = 0; lap < kLaps; ++lap) {
+    for (const std::string& file : files)
+      sum += vlog_info.GetVlogLevel(file);
+  }
+  const base::TimeDelta compiled_elapsed = compiled_timer.Elapsed();
+  EXPECT_EQ(expected_sum * kLaps, sum);
+
+  // |files| stays unchanged, as __FILE__ would.
+  sum = 0;
+  base::ElapsedTimer cached_timer;
+  for (int lap = 0; lap < kLaps; ++lap) {
+    for (const std::string& file : files)
+      sum += vlog_info.GetVlogLevelForStaticFile(file);
+  }
+  const base::TimeDelta cached_elapsed = cached_timer.Elapsed();
+  EXPECT_EQ(expected_sum * kLaps, sum);
+
+  const double calls = kLaps * kFiles;
+  SetUpReporter(base::StringPrintf("per_pattern_%d", pattern_count))
+      .AddResult(kMetricGetVlogLevelTime,
+                 per_pattern_elapsed.InNanosecondsF() / calls);
+  SetUpReporter(base::StringPrintf("compiled_%d", pattern_count))
+      .AddResult(kMetricGetVlogLevelTime,
+                 compiled_elapsed.InNanosecondsF() / calls);
+  SetUpReporter(base::StringPrintf("cached_%d", pattern_count))
+      .AddResult(kMetricGetVlogLevelTime,
+                 cached_elapsed.InNanosecondsF() / calls);
+}
+
+}  // namespace
+
+TEST(VlogPerfTest, GetVlogLevel) {
+  for (int pattern_count : {4, 32, 256})
+    RunTest(pattern_count);
+}
+
+}  // namespace logging
@@ -4,6 +4,12 @@
 
 #include "base/vlog.h"
 
+#include <stdint.h>
+
+#include <string>
+
+#include "base/strings/string_piece.h"
+#include "base/strings/stringprintf.h"
 #include "base/time/time.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
@@ -118,6 +124,70 @@ TEST(VlogTest, VmoduleDirs) {
   EXPECT_EQ(4, vlog_info.GetVlogLevel("foo/bar/baz/blah-inl.h"));
 }
 
+TEST(VlogTest, VmoduleFirstMatchWins) {
+  // Enough patterns to span several words of the compiled matcher.
+  std::string vmodule_switch;
+  for (int i = 0; i < 20; ++i)
+    vmodule_switch += base::StringPrintf("some_long_module_name_%d=%d,", i, i);
+  vmodule_switch += "some_long_*=100,*/dir/*=200,*=300";
+  int min_log_level = 0;
+  VlogInfo vlog_info(std::string(), vmodule_switch, &min_log_level);
+  EXPECT_EQ(0, vlog_info.GetVlogLevel("a/some_long_module_name_0.cc"));
+  EXPECT_EQ(7, vlog_info.GetVlogLevel("a/some_long_module_name_7.cc"));
+  EXPECT_EQ(19, vlog_info.GetVlogLevel("a/dir/some_long_module_name_19.h"));
+  EXPECT_EQ(100, vlog_info.GetVlogLevel("a/dir/some_long_module_name_20.cc"));
+  EXPECT_EQ(200, vlog_info.GetVlogLevel("a/dir/other.cc"));
+  EXPECT_EQ(300, vlog_info.GetVlogLevel("a/other.cc"));
+}
+
+// Checks the compiled matcher against MatchVlogPattern() on random patterns.
+TEST(VlogTest, VmoduleMatchesMatchVlogPattern) {
+  static constexpr char kPatternChars[] = "ab/\\*?";
+  static constexpr char kStringChars[] = "ab/\\";
+  uint32_t seed = 1;
+  auto next_random = [&seed](uint32_t range) {
+    seed = seed * 1103515245u + 12345u;
+    return (seed >> 16) % range;
+  };
+
+  for (int i = 0; i < 1000; ++i) {
+    std::string pattern;
+    for (uint32_t j = next_random(8); j > 0; --j)
+      pattern += kPatternChars[next_random(sizeof(kPatternChars) - 1)];
+    // Patterns without a slash are matched against the module, which is the
+    // base name here, as strings have no extension.
+    int min_log_level = 0;
+    VlogInfo vlog_info(std::string(), pattern + "=1", &min_log_level);
+    for (int k = 0; k < 20; ++k) {
+      std::string string;
+      for (uint32_t j = next_random(10); j > 0; --j)
+        string += kStringChars[next_random(sizeof(kStringChars) - 1)];
+      base::StringPiece target = string;
+      if (pattern.find_first_of("\\/") == std::string::npos)
+        target.remove_prefix(target.find_last_of("\\/") + 1);
+      EXPECT_EQ(MatchVlogPattern(target, pattern) ? 1 : 0,
+                vlog_info.GetVlogLevel(string))
+          << "pattern: " << pattern << ", string: " << string;
+    }
+  }
+}
+
+TEST(VlogTest, GetVlogLevelForStaticFile) {
+  static constexpr char kFooFile[] = "/path/to/foo.cc";
+  static constexpr char kBarFile[] = "/path/to/bar.cc";
+  int min_log_level = 0;
+  VlogInfo vlog_info(std::string(), "foo=3", &min_log_level);
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_EQ(3, vlog_info.GetVlogLevelForStaticFile(kFooFile));
+    EXPECT_EQ(0, vlog_info.GetVlogLevelForStaticFile(kBarFile));
+  }
+
+  // Files matching no pattern keep following the default level.
+  min_log_level = -2;
+  EXPECT_EQ(3, vlog_info.GetVlogLevelForStaticFile(kFooFile));
+  EXPECT_EQ(2, vlog_info.GetVlogLevelForStaticFile(kBarFile));
+}
+
 }  // namespace
 
 }  // namespace logging
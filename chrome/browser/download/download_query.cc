@@ -9,12 +9,15 @@
 #include <algorithm>
 #include <limits>
 #include <memory>
+#include <numeric>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/bind.h"
 #include "base/callback.h"
 #include "base/check_op.h"
+#include "base/containers/contains.h"
 #include "base/files/file_path.h"
 #include "base/i18n/case_conversion.h"
 #include "base/i18n/string_search.h"
@@ -205,6 +208,36 @@ DownloadQuery::FilterCallback BuildRegexFilter(
                              base::BindRepeating(accessor));
 }
 
+// Returns the strings that FILTER_QUERY terms are matched against.
+std::vector<std::u16string> GetQueryFields(const DownloadItem& item) {
+  // Try to also match query with the URLs formatted in user display friendly
+  // way. This will unescape characters (including spaces) and trim all extra
+  // data (like username and password) from raw url so that for example raw url
+  // "http://some.server.org/example%20download/file.zip" will be matched with
+  // search term "example download".
+  return {base::UTF8ToUTF16(item.GetOriginalUrl().spec()),
+          url_formatter::FormatUrl(item.GetOriginalUrl()),
+          base::UTF8ToUTF16(item.GetURL().spec()),
+          url_formatter::FormatUrl(item.GetURL()),
+          item.GetTargetFilePath().LossyDisplayName()};
+}
+
+// Returns true if every one of |query_terms| is found in one of |fields|.
+bool MatchesQueryFields(const std::vector<std::u16string>& query_terms,
+                        const std::vector<std::u16string>& fields) {
+  for (const std::u16string& query_term : query_terms) {
+    std::u16string term = base::i18n::ToLower(query_term);
+    if (std::none_of(fields.begin(), fields.end(),
+                     [&term](const std::u16string& field) {
+                       return base::i18n::StringSearchIgnoringCaseAndAccents(
+                           term, field, NULL, NULL);
+                     })) {
+      return false;
+    }
+  }
+  return true;
+}
+
 // Returns a ComparisonType to indicate whether a field in |left| is less than,
 // greater than or equal to the same field in |right|.
 template <typename ValueType>
@@ -227,36 +260,93 @@ bool DownloadQuery::MatchesQuery(const std::vector<std::u16string>& query_terms,
                                  const DownloadItem& item) {
   if (query_terms.empty())
     return true;
+  return MatchesQueryFields(query_terms, GetQueryFields(item));
+}
 
-  std::u16string original_url_raw(
-      base::UTF8ToUTF16(item.GetOriginalUrl().spec()));
-  std::u16string url_raw(base::UTF8ToUTF16(item.GetURL().spec()));
-  // Try to also match query with above URLs formatted in user display friendly
-  // way. This will unescape characters (including spaces) and trim all extra
-  // data (like username and password) from raw url so that for example raw url
-  // "http://some.server.org/example%20download/file.zip" will be matched with
-  // search term "example download".
-  std::u16string original_url_formatted(
-      url_formatter::FormatUrl(item.GetOriginalUrl()));
-  std::u16string url_formatted(url_formatter::FormatUrl(item.GetURL()));
-  std::u16string path(item.GetTargetFilePath().LossyDisplayName());
-
-  for (auto it = query_terms.begin(); it != query_terms.end(); ++it) {
-    std::u16string term = base::i18n::ToLower(*it);
-    if (!base::i18n::StringSearchIgnoringCaseAndAccents(
-            term, original_url_raw, NULL, NULL) &&
-        !base::i18n::StringSearchIgnoringCaseAndAccents(
-            term, original_url_formatted, NULL, NULL) &&
-        !base::i18n::StringSearchIgnoringCaseAndAccents(
-            term, url_raw, NULL, NULL) &&
-        !base::i18n::StringSearchIgnoringCaseAndAccents(
-            term, url_formatted, NULL, NULL) &&
-        !base::i18n::StringSearchIgnoringCaseAndAccents(
-            term, path, NULL, NULL)) {
-      return false;
-    }
+DownloadQuery::Index::Entry::Entry(DownloadItem* item) : item(item) {
+  Update();
+}
+
+DownloadQuery::Index::Entry::Entry(Entry&& other) = default;
+
+DownloadQuery::Index::Entry& DownloadQuery::Index::Entry::operator=(
+    Entry&& other) = default;
+
+DownloadQuery::Index::Entry::~Entry() = default;
+
+bool DownloadQuery::Index::Entry::Update() {
+  std::string new_start_time = GetStartTime(*item);
+  const bool position_changed =
+      state != item->GetState() || start_time != new_start_time;
+  state = item->GetState();
+  danger_type = item->GetDangerType();
+  start_time = std::move(new_start_time);
+
+  // Progress updates leave these alone, so the URLs are only formatted again
+  // when they change.
+  if (query_fields.empty() || original_url != item->GetOriginalUrl() ||
+      url != item->GetURL() ||
+      target_file_path != item->GetTargetFilePath()) {
+    original_url = item->GetOriginalUrl();
+    url = item->GetURL();
+    target_file_path = item->GetTargetFilePath();
+    query_fields = GetQueryFields(*item);
   }
-  return true;
+  return position_changed;
+}
+
+DownloadQuery::Index::Index(const DownloadVector& items) {
+  entries_.reserve(items.size());
+  for (DownloadItem* item : items) {
+    DCHECK(!base::Contains(positions_, item));
+    positions_[item] = entries_.size();
+    entries_.emplace_back(item);
+    item->AddObserver(this);
+  }
+  UpdatePositions();
+}
+
+DownloadQuery::Index::~Index() {
+  for (Entry& entry : entries_)
+    entry.item->RemoveObserver(this);
+}
+
+void DownloadQuery::Index::Add(DownloadItem* item) {
+  DCHECK(!base::Contains(positions_, item));
+  entries_.emplace_back(item);
+  item->AddObserver(this);
+  UpdatePositions();
+}
+
+void DownloadQuery::Index::OnDownloadUpdated(DownloadItem* item) {
+  auto it = positions_.find(item);
+  DCHECK(it != positions_.end());
+  if (entries_[it->second].Update())
+    UpdatePositions();
+}
+
+void DownloadQuery::Index::OnDownloadDestroyed(DownloadItem* item) {
+  auto it = positions_.find(item);
+  DCHECK(it != positions_.end());
+  item->RemoveObserver(this);
+  entries_.erase(entries_.begin() + it->second);
+  UpdatePositions();
+}
+
+void DownloadQuery::Index::UpdatePositions() {
+  positions_.clear();
+  by_state_.clear();
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    positions_[entries_[i].item] = i;
+    by_state_[entries_[i].state].push_back(i);
+  }
+  by_start_time_.resize(entries_.size());
+  std::iota(by_start_time_.begin(), by_start_time_.end(), 0);
+  std::stable_sort(by_start_time_.begin(), by_start_time_.end(),
+                   [this](size_t left, size_t right) {
+                     return entries_[left].start_time <
+                            entries_[right].start_time;
+                   });
 }
 
 DownloadQuery::DownloadQuery() : limit_(std::numeric_limits<uint32_t>::max()) {}
@@ -265,7 +355,9 @@ DownloadQuery::~DownloadQuery() {}
 // AddFilter() pushes a new FilterCallback to filters_. Most FilterCallbacks are
 // Callbacks to FieldMatches<>(). Search() iterates over given DownloadItems,
 // discarding items for which any filter returns false. A DownloadQuery may have
-// zero or more FilterCallbacks.
+// zero or more FilterCallbacks. The state, danger, start time and query filters
+// are recorded as values instead, which Search() compares with either the
+// DownloadItem or its Index::Entry.
 
 bool DownloadQuery::AddFilter(const DownloadQuery::FilterCallback& value) {
   if (value.is_null()) return false;
@@ -274,13 +366,20 @@ bool DownloadQuery::AddFilter(const DownloadQuery::FilterCallback& value) {
 }
 
 void DownloadQuery::AddFilter(DownloadItem::DownloadState state) {
-  AddFilter(base::BindRepeating(&FieldMatches<DownloadItem::DownloadState>,
-                                state, EQ, base::BindRepeating(&GetState)));
+  states_.push_back(state);
 }
 
 void DownloadQuery::AddFilter(DownloadDangerType danger) {
-  AddFilter(base::BindRepeating(&FieldMatches<DownloadDangerType>, danger, EQ,
-                                base::BindRepeating(&GetDangerType)));
+  danger_types_.push_back(danger);
+}
+
+bool DownloadQuery::AddStartTimeFilter(std::vector<std::string>* start_times,
+                                       const base::Value& value) {
+  std::string start_time;
+  if (!GetAs(value, &start_time))
+    return false;
+  start_times->push_back(start_time);
+  return true;
 }
 
 bool DownloadQuery::AddFilter(DownloadQuery::FilterType type,
@@ -302,9 +401,11 @@ bool DownloadQuery::AddFilter(DownloadQuery::FilterType type,
       return AddFilter(BuildFilter<bool>(value, EQ, &IsPaused));
     case FILTER_QUERY: {
       std::vector<std::u16string> query_terms;
-      return GetAs(value, &query_terms) &&
-             (query_terms.empty() ||
-              AddFilter(base::BindRepeating(&MatchesQuery, query_terms)));
+      if (!GetAs(value, &query_terms))
+        return false;
+      query_terms_.insert(query_terms_.end(), query_terms.begin(),
+                          query_terms.end());
+      return true;
     }
     case FILTER_ENDED_AFTER:
       return AddFilter(BuildFilter<std::string>(value, GT, &GetEndTime));
@@ -313,11 +414,11 @@ bool DownloadQuery::AddFilter(DownloadQuery::FilterType type,
     case FILTER_END_TIME:
       return AddFilter(BuildFilter<std::string>(value, EQ, &GetEndTime));
     case FILTER_STARTED_AFTER:
-      return AddFilter(BuildFilter<std::string>(value, GT, &GetStartTime));
+      return AddStartTimeFilter(&started_after_, value);
     case FILTER_STARTED_BEFORE:
-      return AddFilter(BuildFilter<std::string>(value, LT, &GetStartTime));
+      return AddStartTimeFilter(&started_before_, value);
     case FILTER_START_TIME:
-      return AddFilter(BuildFilter<std::string>(value, EQ, &GetStartTime));
+      return AddStartTimeFilter(&start_times_, value);
     case FILTER_TOTAL_BYTES:
       return AddFilter(BuildFilter<double>(value, EQ, &GetTotalBytes));
     case FILTER_TOTAL_BYTES_GREATER:
@@ -337,6 +438,51 @@ bool DownloadQuery::AddFilter(DownloadQuery::FilterType type,
 }
 
 bool DownloadQuery::Matches(const DownloadItem& item) const {
+  if (!states_.empty() && !MatchesState(item.GetState()))
+    return false;
+  if (!danger_types_.empty() && !MatchesDangerType(item.GetDangerType()))
+    return false;
+  if (HasStartTimeFilters() && !MatchesStartTime(GetStartTime(item)))
+    return false;
+  return MatchesQuery(query_terms_, item) && MatchesFilters(item);
+}
+
+bool DownloadQuery::Matches(const Index::Entry& entry) const {
+  return MatchesState(entry.state) && MatchesDangerType(entry.danger_type) &&
+         MatchesStartTime(entry.start_time) &&
+         MatchesQueryFields(query_terms_, entry.query_fields) &&
+         MatchesFilters(*entry.item);
+}
+
+bool DownloadQuery::MatchesState(DownloadItem::DownloadState state) const {
+  return std::all_of(
+      states_.begin(), states_.end(),
+      [state](DownloadItem::DownloadState filter) { return filter == state; });
+}
+
+bool DownloadQuery::MatchesDangerType(DownloadDangerType danger_type) const {
+  return std::all_of(danger_types_.begin(), danger_types_.end(),
+                     [danger_type](DownloadDangerType filter) {
+                       return filter == danger_type;
+                     });
+}
+
+bool DownloadQuery::MatchesStartTime(const std::string& start_time) const {
+  for (const std::string& started_after : started_after_) {
+    if (!(start_time > started_after))
+      return false;
+  }
+  for (const std::string& started_before : started_before_) {
+    if (!(start_time < started_before))
+      return false;
+  }
+  return std::all_of(start_times_.begin(), start_times_.end(),
+                     [&start_time](const std::string& filter) {
+                       return filter == start_time;
+                     });
+}
+
+bool DownloadQuery::MatchesFilters(const DownloadItem& item) const {
   for (auto filter = filters_.begin(); filter != filters_.end(); ++filter) {
     if (!filter->Run(item))
       return false;
@@ -344,17 +490,80 @@ bool DownloadQuery::Matches(const DownloadItem& item) const {
   return true;
 }
 
+bool DownloadQuery::HasStartTimeFilters() const {
+  return !started_after_.empty() || !started_before_.empty() ||
+         !start_times_.empty();
+}
+
+void DownloadQuery::Search(const Index& index, DownloadVector* results) const {
+  results->clear();
+  if (states_.empty() && !HasStartTimeFilters()) {
+    for (size_t i = 0; i < index.entries_.size() && !IsFull(*results); ++i) {
+      if (Matches(index.entries_[i]))
+        results->push_back(index.entries_[i].item);
+    }
+    FinishSearch(results);
+    return;
+  }
+
+  // Only the entries in the filtered state, or else in the filtered start time
+  // range, can match. They are visited in the order of the items so that the
+  // results are the same as those of searching the items.
+  std::vector<size_t> positions;
+  if (!states_.empty()) {
+    auto by_state = index.by_state_.find(states_.front());
+    if (by_state != index.by_state_.end())
+      positions = by_state->second;
+  } else {
+    auto entry_before = [&index](size_t position, const std::string& time) {
+      return index.entries_[position].start_time < time;
+    };
+    auto entry_after = [&index](const std::string& time, size_t position) {
+      return time < index.entries_[position].start_time;
+    };
+    auto begin = index.by_start_time_.begin();
+    auto end = index.by_start_time_.end();
+    auto first = begin;
+    auto last = end;
+    for (const std::string& started_after : started_after_) {
+      first = std::max(
+          first, std::upper_bound(begin, end, started_after, entry_after));
+    }
+    for (const std::string& started_before : started_before_) {
+      last = std::min(
+          last, std::lower_bound(begin, end, started_before, entry_before));
+    }
+    for (const std::string& start_time : start_times_) {
+      first = std::max(first,
+                       std::lower_bound(begin, end, start_time, entry_before));
+      last = std::min(last,
+                      std::upper_bound(begin, end, start_time, entry_after));
+    }
+    if (first < last) {
+      positions.assign(first, last);
+      std::sort(positions.begin(), positions.end());
+    }
+  }
+  for (size_t i = 0; i < positions.size() && !IsFull(*results); ++i) {
+    const Index::Entry& entry = index.entries_[positions[i]];
+    if (Matches(entry))
+      results->push_back(entry.item);
+  }
+  FinishSearch(results);
+}
+
 // AddSorter() creates a Sorter and pushes it onto sorters_. A Sorter is a
 // direction and a Callback to Compare<>(). After filtering, Search() makes a
 // DownloadComparator functor from the sorters_ and passes the
-// DownloadComparator to std::partial_sort. std::partial_sort calls the
-// DownloadComparator with different pairs of DownloadItems.  DownloadComparator
-// iterates over the sorters until a callback returns ComparisonType LT or GT.
-// DownloadComparator returns true or false depending on that ComparisonType and
-// the sorter's direction in order to indicate to std::partial_sort whether the
-// left item is after or before the right item. If all sorters return EQ, then
-// DownloadComparator compares GetId. A DownloadQuery may have zero or more
-// Sorters, but there is one DownloadComparator per call to Search().
+// DownloadComparator to std::partial_sort, or to std::sort if all the results
+// fit within the limit. They call the DownloadComparator with different pairs
+// of DownloadItems. DownloadComparator iterates over the sorters until a
+// callback returns ComparisonType LT or GT. DownloadComparator returns true or
+// false depending on that ComparisonType and the sorter's direction in order to
+// indicate to the sort whether the left item is after or before the right item.
+// If all sorters return EQ, then DownloadComparator compares GetId. A
+// DownloadQuery may have zero or more Sorters, but there is one
+// DownloadComparator per call to Search().
 
 struct DownloadQuery::Sorter {
   using SortType = base::RepeatingCallback<ComparisonType(const DownloadItem&,
@@ -455,11 +664,15 @@ void DownloadQuery::AddSorter(DownloadQuery::SortType type,
 }
 
 void DownloadQuery::FinishSearch(DownloadQuery::DownloadVector* results) const {
- if (!sorters_.empty()) {
-    std::partial_sort(results->begin(),
-                      results->begin() + std::min(limit_, results->size()),
-                      results->end(),
-                      DownloadComparator(sorters_));
+  if (!sorters_.empty()) {
+    // Only the results within the limit need to be ordered.
+    if (limit_ < results->size()) {
+      std::partial_sort(results->begin(), results->begin() + limit_,
+                        results->end(), DownloadComparator(sorters_));
+    } else {
+      std::sort(results->begin(), results->end(),
+                DownloadComparator(sorters_));
+    }
   }
 
   if (results->size() > limit_)
@@ -12,8 +12,10 @@
 #include <vector>
 
 #include "base/callback_forward.h"
+#include "base/files/file_path.h"
 #include "base/macros.h"
 #include "components/download/public/common/download_item.h"
+#include "url/gurl.h"
 
 namespace base {
 class Value;
@@ -40,10 +42,80 @@ class Value;
 // query.Limit(20);
 // DownloadVector all_items, results;
 // query.Search(all_items.begin(), all_items.end(), &results);
+//
+// Callers that search the same items repeatedly, e.g. a page of results at a
+// time, can build a DownloadQuery::Index of the items once, keep it while they
+// page, and pass it to Search() instead of the items.
 class DownloadQuery {
  public:
   typedef std::vector<download::DownloadItem*> DownloadVector;
 
+  // The fields of a set of DownloadItems that the state, danger, start time
+  // and query filters read, gathered once so that every Search() of the index
+  // need not read them from every item again. Formatting the URLs for
+  // FILTER_QUERY in particular is far more expensive than matching them. The
+  // Index observes its items: it refreshes the entry of an item whose fields
+  // change, and drops the entry of an item that is destroyed. Items created
+  // after the Index must be added to it with Add().
+  class Index : public download::DownloadItem::Observer {
+   public:
+    explicit Index(const DownloadVector& items);
+    ~Index() override;
+
+    // Adds |item|, which must not be in the Index yet, after the other items.
+    void Add(download::DownloadItem* item);
+
+    size_t size() const { return entries_.size(); }
+
+   private:
+    friend class DownloadQuery;
+
+    struct Entry {
+      explicit Entry(download::DownloadItem* item);
+      Entry(Entry&& other);
+      Entry& operator=(Entry&& other);
+      ~Entry();
+
+      // Reads the fields of |item| again, and the query fields only if its
+      // URLs or filename changed. Returns true if its state or start time
+      // changed.
+      bool Update();
+
+      download::DownloadItem* item;
+      download::DownloadItem::DownloadState state =
+          download::DownloadItem::MAX_DOWNLOAD_STATE;
+      download::DownloadDangerType danger_type =
+          download::DOWNLOAD_DANGER_TYPE_MAX;
+      // The start time as the FILTER_STARTED_* filters compare it.
+      std::string start_time;
+      // What |query_fields| were built from.
+      GURL original_url;
+      GURL url;
+      base::FilePath target_file_path;
+      // The URLs and filename that FILTER_QUERY terms are matched against.
+      std::vector<std::u16string> query_fields;
+    };
+
+    // download::DownloadItem::Observer:
+    void OnDownloadUpdated(download::DownloadItem* item) override;
+    void OnDownloadDestroyed(download::DownloadItem* item) override;
+
+    // Rebuilds |positions_|, |by_state_| and |by_start_time_| from |entries_|.
+    void UpdatePositions();
+
+    // In the order of the items the Index was built from, then added.
+    std::vector<Entry> entries_;
+    // The position in |entries_| of the entry of each item.
+    std::map<download::DownloadItem*, size_t> positions_;
+    // The positions in |entries_| of the entries in each state, ascending.
+    std::map<download::DownloadItem::DownloadState, std::vector<size_t>>
+        by_state_;
+    // The positions in |entries_| ordered by start time.
+    std::vector<size_t> by_start_time_;
+
+    DISALLOW_COPY_AND_ASSIGN(Index);
+  };
+
   // FilterCallback is a Callback that takes a DownloadItem and returns true if
   // the item matches the filter and false otherwise.
   // query.AddFilter(base::BindRepeating(&YourFilterFunction));
@@ -127,7 +199,8 @@ class DownloadQuery {
   // ordered 1,0,3,2.
   void AddSorter(SortType type, SortDirection direction);
 
-  // Limit the size of search results to |limit|.
+  // Limit the size of search results to |limit|. Without sorters, Search()
+  // stops at the first |limit| matching items.
   void Limit(size_t limit) { limit_ = limit; }
 
   // Filters DownloadItem*s from |iter| to |last| into |results|, sorts
@@ -136,12 +209,16 @@ class DownloadQuery {
   void Search(InputIterator iter, const InputIterator last,
               DownloadVector* results) const {
     results->clear();
-    for (; iter != last; ++iter) {
+    for (; iter != last && !IsFull(*results); ++iter) {
       if (Matches(**iter)) results->push_back(*iter);
     }
     FinishSearch(results);
   }
 
+  // Like Search() over the items |index| was built from, but only visits the
+  // items in the state and start time range that the filters allow.
+  void Search(const Index& index, DownloadVector* results) const;
+
  private:
   struct Sorter;
   class DownloadComparator;
@@ -152,9 +229,30 @@ class DownloadQuery {
       const std::string& regex_str,
       const base::RepeatingCallback<std::string(const download::DownloadItem&)>&
           accessor);
+  bool AddStartTimeFilter(std::vector<std::string>* start_times,
+                          const base::Value& value);
   bool Matches(const download::DownloadItem& item) const;
+  bool Matches(const Index::Entry& entry) const;
+  bool MatchesState(download::DownloadItem::DownloadState state) const;
+  bool MatchesDangerType(download::DownloadDangerType danger_type) const;
+  bool MatchesStartTime(const std::string& start_time) const;
+  bool MatchesFilters(const download::DownloadItem& item) const;
+  bool HasStartTimeFilters() const;
+  // Returns true if no more items need to be considered for |results|.
+  bool IsFull(const DownloadVector& results) const {
+    return sorters_.empty() && results.size() >= limit_;
+  }
   void FinishSearch(DownloadVector* results) const;
 
+  // The filters an Index can answer are kept apart from |filters_|, so that
+  // searching an Index reads their fields from the Index instead of the items.
+  std::vector<download::DownloadItem::DownloadState> states_;
+  std::vector<download::DownloadDangerType> danger_types_;
+  std::vector<std::string> started_after_;
+  std::vector<std::string> started_before_;
+  std::vector<std::string> start_times_;
+  std::vector<std::u16string> query_terms_;
+
   FilterCallbackVector filters_;
   SorterVector sorters_;
   size_t limit_;
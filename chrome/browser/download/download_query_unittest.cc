@@ -15,7 +15,9 @@
 #include "base/check.h"
 #include "base/files/file_path.h"
 #include "base/macros.h"
+#include "base/strings/stringprintf.h"
 #include "base/time/time.h"
+#include "base/time/time_to_iso8601.h"
 #include "base/values.h"
 #include "build/build_config.h"
 #include "components/download/public/common/mock_download_item.h"
@@ -50,6 +52,15 @@ bool AlwaysReturn(bool result, const DownloadItem& item) {
   return result;
 }
 
+bool CountAndReturn(int* count, bool result, const DownloadItem& item) {
+  ++*count;
+  return result;
+}
+
+std::string StartTime8601(int offset) {
+  return base::TimeToISO8601(base::Time::FromTimeT(kSomeKnownTime + offset));
+}
+
 }  // anonymous namespace
 
 class DownloadQueryTest : public testing::Test {
@@ -70,8 +81,46 @@ class DownloadQueryTest : public testing::Test {
     }
   }
 
+  // Creates |count| mocks with all the fields that a DownloadQuery::Index
+  // reads. Every other mock is complete, every third one is dangerous, mock(i)
+  // starts i seconds after kSomeKnownTime, and it downloads "file<i>" from
+  // "http://example.com/<i>".
+  void CreateIndexableMocks(int count) {
+    const int first = static_cast<int>(mocks_.size());
+    CreateMocks(count);
+    for (int i = first; i < first + count; ++i)
+      ExpectIndexedFields(&mock(i), i);
+  }
+
+  // Sets up the fields of |item| that a DownloadQuery::Index reads as those of
+  // the |i|th mock of CreateIndexableMocks().
+  void ExpectIndexedFields(download::MockDownloadItem* item, int i) {
+    urls_.push_back(std::make_unique<GURL>(
+        base::StringPrintf("http://example.com/%d", i)));
+    paths_.push_back(std::make_unique<base::FilePath>(
+        base::FilePath::FromUTF8Unsafe(base::StringPrintf("file%d", i))));
+    EXPECT_CALL(*item, GetState())
+        .WillRepeatedly(Return(i % 2 ? DownloadItem::COMPLETE
+                                     : DownloadItem::IN_PROGRESS));
+    EXPECT_CALL(*item, GetDangerType())
+        .WillRepeatedly(
+            Return(i % 3 ? download::DOWNLOAD_DANGER_TYPE_NOT_DANGEROUS
+                         : download::DOWNLOAD_DANGER_TYPE_DANGEROUS_FILE));
+    EXPECT_CALL(*item, GetStartTime())
+        .WillRepeatedly(Return(base::Time::FromTimeT(kSomeKnownTime + i)));
+    EXPECT_CALL(*item, GetOriginalUrl())
+        .WillRepeatedly(ReturnRef(*urls_.back()));
+    EXPECT_CALL(*item, GetURL()).WillRepeatedly(ReturnRef(*urls_.back()));
+    EXPECT_CALL(*item, GetTargetFilePath())
+        .WillRepeatedly(ReturnRef(*paths_.back()));
+  }
+
   download::MockDownloadItem& mock(int index) { return *mocks_[index]; }
 
+  DownloadVector items() const {
+    return DownloadVector(mocks_.begin(), mocks_.end());
+  }
+
   DownloadQuery* query() { return &query_; }
 
   template<typename ValueType> void AddFilter(
@@ -81,6 +130,16 @@ class DownloadQueryTest : public testing::Test {
     query_.Search(mocks_.begin(), mocks_.end(), &results_);
   }
 
+  // Searches both the mocks and an Index of them, which must find the same
+  // results.
+  void SearchIndex() {
+    Search();
+    DownloadQuery::Index index(items());
+    DownloadVector index_results;
+    query_.Search(index, &index_results);
+    EXPECT_EQ(results_, index_results);
+  }
+
   DownloadVector* results() { return &results_; }
 
   // Filter tests generally contain 2 items. mock(0) matches the filter, mock(1)
@@ -107,6 +166,9 @@ class DownloadQueryTest : public testing::Test {
   // unowned pointers. |owned_mocks_| holds the ownership of the mock objects.
   std::vector<download::MockDownloadItem*> mocks_;
   std::vector<std::unique_ptr<download::MockDownloadItem>> owned_mocks_;
+  // The fields that CreateIndexableMocks() returns references to.
+  std::vector<std::unique_ptr<GURL>> urls_;
+  std::vector<std::unique_ptr<base::FilePath>> paths_;
   DownloadQuery query_;
   DownloadVector results_;
 
@@ -189,6 +251,18 @@ TEST_F(DownloadQueryTest, DownloadQueryTest_Limit) {
   ExpectStandardFilterResults();
 }
 
+TEST_F(DownloadQueryTest, DownloadQueryTest_LimitStopsSearch) {
+  CreateMocks(4);
+  int filter_count = 0;
+  query()->AddFilter(base::BindRepeating(&CountAndReturn, &filter_count, true));
+  query()->Limit(2);
+  Search();
+  ASSERT_EQ(2U, results()->size());
+  EXPECT_EQ(0U, results()->at(0)->GetId());
+  EXPECT_EQ(1U, results()->at(1)->GetId());
+  EXPECT_EQ(2, filter_count);
+}
+
 TEST_F(DownloadQueryTest, DownloadQueryTest_FilterGenericQueryFilename) {
   CreateMocks(2);
   base::FilePath match_filename(FILE_PATH_LITERAL("query"));
@@ -748,6 +822,129 @@ TEST_F(DownloadQueryTest, DownloadQueryTest_DefaultSortById2) {
   EXPECT_EQ(1U, results()->at(1)->GetId());
 }
 
+TEST_F(DownloadQueryTest, DownloadQueryTest_IndexFilterState) {
+  CreateIndexableMocks(6);
+  query()->AddFilter(DownloadItem::COMPLETE);
+  SearchIndex();
+  ASSERT_EQ(3U, results()->size());
+  EXPECT_EQ(1U, results()->at(0)->GetId());
+  EXPECT_EQ(3U, results()->at(1)->GetId());
+  EXPECT_EQ(5U, results()->at(2)->GetId());
+}
+
+TEST_F(DownloadQueryTest, DownloadQueryTest_IndexFilterTwoStates) {
+  CreateIndexableMocks(6);
+  query()->AddFilter(DownloadItem::COMPLETE);
+  query()->AddFilter(DownloadItem::IN_PROGRESS);
+  SearchIndex();
+  EXPECT_EQ(0U, results()->size());
+}
+
+TEST_F(DownloadQueryTest, DownloadQueryTest_IndexFilterStartTimeRange) {
+  CreateIndexableMocks(6);
+  AddFilter(DownloadQuery::FILTER_STARTED_AFTER, StartTime8601(1));
+  AddFilter(DownloadQuery::FILTER_STARTED_BEFORE, StartTime8601(4));
+  SearchIndex();
+  ASSERT_EQ(2U, results()->size());
+  EXPECT_EQ(2U, results()->at(0)->GetId());
+  EXPECT_EQ(3U, results()->at(1)->GetId());
+}
+
+TEST_F(DownloadQueryTest, DownloadQueryTest_IndexFilterStartTime) {
+  CreateIndexableMocks(6);
+  AddFilter(DownloadQuery::FILTER_START_TIME, StartTime8601(3));
+  SearchIndex();
+  ASSERT_EQ(1U, results()->size());
+  EXPECT_EQ(3U, results()->at(0)->GetId());
+}
+
+TEST_F(DownloadQueryTest, DownloadQueryTest_IndexFilterStateAndStartTime) {
+  CreateIndexableMocks(6);
+  query()->AddFilter(DownloadItem::IN_PROGRESS);
+  AddFilter(DownloadQuery::FILTER_STARTED_AFTER, StartTime8601(1));
+  SearchIndex();
+  ASSERT_EQ(2U, results()->size());
+  EXPECT_EQ(2U, results()->at(0)->GetId());
+  EXPECT_EQ(4U, results()->at(1)->GetId());
+}
+
+TEST_F(DownloadQueryTest, DownloadQueryTest_IndexQuerySortAndLimit) {
+  CreateIndexableMocks(10);
+  query()->AddFilter(download::DOWNLOAD_DANGER_TYPE_NOT_DANGEROUS);
+  AddFilter(DownloadQuery::FILTER_QUERY, std::vector<std::string>{"file"});
+  query()->AddSorter(DownloadQuery::SORT_START_TIME, DownloadQuery::DESCENDING);
+  query()->Limit(3);
+  SearchIndex();
+  ASSERT_EQ(3U, results()->size());
+  EXPECT_EQ(8U, results()->at(0)->GetId());
+  EXPECT_EQ(7U, results()->at(1)->GetId());
+  EXPECT_EQ(5U, results()->at(2)->GetId());
+}
+
+TEST_F(DownloadQueryTest, DownloadQueryTest_IndexQueryUrl) {
+  CreateIndexableMocks(12);
+  AddFilter(DownloadQuery::FILTER_QUERY,
+            std::vector<std::string>{"example.com/1"});
+  query()->Limit(2);
+  SearchIndex();
+  ASSERT_EQ(2U, results()->size());
+  EXPECT_EQ(1U, results()->at(0)->GetId());
+  EXPECT_EQ(10U, results()->at(1)->GetId());
+}
+
+TEST_F(DownloadQueryTest, DownloadQueryTest_IndexUpdatesChangedItems) {
+  CreateIndexableMocks(4);
+  query()->AddFilter(DownloadItem::COMPLETE);
+  AddFilter(DownloadQuery::FILTER_QUERY, std::vector<std::string>{"renamed"});
+  DownloadQuery::Index index(items());
+  DownloadVector index_results;
+  query()->Search(index, &index_results);
+  EXPECT_TRUE(index_results.empty());
+
+  // A progress update changes none of the indexed fields.
+  mock(0).NotifyObserversDownloadUpdated();
+  query()->Search(index, &index_results);
+  EXPECT_TRUE(index_results.empty());
+
+  // mock(0) completes and is renamed.
+  base::FilePath renamed(FILE_PATH_LITERAL("renamed"));
+  EXPECT_CALL(mock(0), GetState())
+      .WillRepeatedly(Return(DownloadItem::COMPLETE));
+  EXPECT_CALL(mock(0), GetTargetFilePath()).WillRepeatedly(ReturnRef(renamed));
+  mock(0).NotifyObserversDownloadUpdated();
+  query()->Search(index, &index_results);
+  ASSERT_EQ(1U, index_results.size());
+  EXPECT_EQ(0U, index_results[0]->GetId());
+  Search();
+  EXPECT_EQ(*results(), index_results);
+}
+
+TEST_F(DownloadQueryTest, DownloadQueryTest_IndexAddsAndDropsItems) {
+  CreateIndexableMocks(4);
+  query()->AddFilter(DownloadItem::COMPLETE);
+  DownloadQuery::Index index(items());
+
+  auto added = std::make_unique<download::MockDownloadItem>();
+  EXPECT_CALL(*added, GetId()).WillRepeatedly(Return(5));
+  ExpectIndexedFields(added.get(), 5);
+  index.Add(added.get());
+  EXPECT_EQ(5U, index.size());
+  DownloadVector index_results;
+  query()->Search(index, &index_results);
+  ASSERT_EQ(3U, index_results.size());
+  EXPECT_EQ(1U, index_results[0]->GetId());
+  EXPECT_EQ(3U, index_results[1]->GetId());
+  EXPECT_EQ(5U, index_results[2]->GetId());
+
+  // Destroying an item drops it from the index.
+  added.reset();
+  EXPECT_EQ(4U, index.size());
+  query()->Search(index, &index_results);
+  ASSERT_EQ(2U, index_results.size());
+  EXPECT_EQ(1U, index_results[0]->GetId());
+  EXPECT_EQ(3U, index_results[1]->GetId());
+}
+
 TEST_F(DownloadQueryTest, DownloadQueryFilterPerformance) {
   static const int kNumItems = 100;
   static const int kNumFilters = 100;
@@ -766,3 +963,43 @@ TEST_F(DownloadQueryTest, DownloadQueryFilterPerformance) {
   std::cout << "Search took " << nanos_per_item_per_filter
             << " nanoseconds per item per filter.\n";
 }
+
+TEST_F(DownloadQueryTest, DownloadQueryIndexPerformance) {
+  static const int kNumItems = 10000;
+  static const int kNumPages = 20;
+  static const size_t kPageSize = 50;
+  static const int kNumUpdates = 10000;
+  CreateIndexableMocks(kNumItems);
+  query()->AddFilter(download::DOWNLOAD_DANGER_TYPE_NOT_DANGEROUS);
+  AddFilter(DownloadQuery::FILTER_QUERY, std::vector<std::string>{"file"});
+  query()->AddSorter(DownloadQuery::SORT_START_TIME, DownloadQuery::DESCENDING);
+
+  // Each page searches for one more page of results, as the downloads page
+  // does when it is scrolled.
+  base::Time start = base::Time::Now();
+  for (int page = 1; page <= kNumPages; ++page) {
+    query()->Limit(page * kPageSize);
+    Search();
+  }
+  base::Time build_start = base::Time::Now();
+  DownloadQuery::Index index(items());
+  base::Time search_start = base::Time::Now();
+  DownloadVector index_results;
+  for (int page = 1; page <= kNumPages; ++page) {
+    query()->Limit(page * kPageSize);
+    query()->Search(index, &index_results);
+  }
+  base::Time update_start = base::Time::Now();
+  // What keeping the index up to date costs while downloads make progress.
+  for (int i = 0; i < kNumUpdates; ++i)
+    mock(i % kNumItems).NotifyObserversDownloadUpdated();
+  base::Time end = base::Time::Now();
+  EXPECT_EQ(*results(), index_results);
+  std::cout << "Searching " << kNumPages << " pages of " << kNumItems
+            << " items took " << (build_start - start).InMillisecondsF()
+            << " ms, or " << (update_start - search_start).InMillisecondsF()
+            << " ms with an index built in "
+            << (search_start - build_start).InMillisecondsF() << " ms. "
+            << kNumUpdates << " item updates took "
+            << (end - update_start).InMillisecondsF() << " ms.\n";
+}
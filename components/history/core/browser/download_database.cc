@@ -69,6 +69,21 @@ base::FilePath ColumnFilePath(sql::Statement& statement, int col) {
 
 #endif
 
+// Returns true if `a` and `b` differ in a column UpdateDownload() writes other
+// than the progress ones, received_bytes and total_bytes.
+bool DiffersBeyondProgress(const DownloadRow& a, const DownloadRow& b) {
+  return a.current_path != b.current_path || a.target_path != b.target_path ||
+         a.mime_type != b.mime_type ||
+         a.original_mime_type != b.original_mime_type || a.state != b.state ||
+         a.danger_type != b.danger_type ||
+         a.interrupt_reason != b.interrupt_reason || a.hash != b.hash ||
+         a.end_time != b.end_time || a.opened != b.opened ||
+         a.last_access_time != b.last_access_time ||
+         a.transient != b.transient || a.by_ext_id != b.by_ext_id ||
+         a.by_ext_name != b.by_ext_name || a.etag != b.etag ||
+         a.last_modified != b.last_modified;
+}
+
 }  // namespace
 
 DownloadDatabase::DownloadDatabase(
@@ -408,6 +423,7 @@ uint32_t DownloadDatabase::GetNextDownloadId() {
 }
 
 bool DownloadDatabase::DropDownloadTable() {
+  in_progress_downloads_.clear();
   return GetDB().Execute(
       base::StringPrintf("DROP TABLE %s", kDownloadsTable).c_str());
 }
@@ -565,56 +581,98 @@ bool DownloadDatabase::UpdateDownload(const DownloadRow& data) {
     return false;
   }
 
-  sql::Statement statement(GetDB().GetCachedStatement(
-      SQL_FROM_HERE,
-      base::StringPrintf("UPDATE %s "
-                         "SET current_path=?, target_path=?, "
-                         "mime_type=?, original_mime_type=?, "
-                         "received_bytes=?, state=?, "
-                         "danger_type=?, interrupt_reason=?, hash=?, "
-                         "end_time=?, total_bytes=?, "
-                         "opened=?, last_access_time=?, transient=?, "
-                         "by_ext_id=?, by_ext_name=?, "
-                         "etag=?, last_modified=? WHERE id=?",
-                         kDownloadsTable)
-          .c_str()));
-  int column = 0;
-  BindFilePath(statement, data.current_path, column++);
-  BindFilePath(statement, data.target_path, column++);
-  statement.BindString(column++, data.mime_type);
-  statement.BindString(column++, data.original_mime_type);
-  statement.BindInt64(column++, data.received_bytes);
-  statement.BindInt(column++, DownloadStateToInt(data.state));
-  statement.BindInt(column++, DownloadDangerTypeToInt(data.danger_type));
-  statement.BindInt(column++,
-                    DownloadInterruptReasonToInt(data.interrupt_reason));
-  statement.BindBlob(column++, data.hash);
-  statement.BindInt64(column++, data.end_time.ToInternalValue());
-  statement.BindInt64(column++, data.total_bytes);
-  statement.BindInt(column++, (data.opened ? 1 : 0));
-  statement.BindInt64(column++, data.last_access_time.ToInternalValue());
-  statement.BindInt(column++, (data.transient ? 1 : 0));
-  statement.BindString(column++, data.by_ext_id);
-  statement.BindString(column++, data.by_ext_name);
-  statement.BindString(column++, data.etag);
-  statement.BindString(column++, data.last_modified);
-  statement.BindInt64(column++, DownloadIdToInt(data.id));
-
-  if (!statement.Run())
-    return false;
+  // Progress updates of a download in progress only write what changed since
+  // the row last written for it.
+  auto written = in_progress_downloads_.find(data.id);
+  if (written == in_progress_downloads_.end() ||
+      DiffersBeyondProgress(written->second, data)) {
+    sql::Statement statement(GetDB().GetCachedStatement(
+        SQL_FROM_HERE,
+        base::StringPrintf("UPDATE %s "
+                           "SET current_path=?, target_path=?, "
+                           "mime_type=?, original_mime_type=?, "
+                           "received_bytes=?, state=?, "
+                           "danger_type=?, interrupt_reason=?, hash=?, "
+                           "end_time=?, total_bytes=?, "
+                           "opened=?, last_access_time=?, transient=?, "
+                           "by_ext_id=?, by_ext_name=?, "
+                           "etag=?, last_modified=? WHERE id=?",
+                           kDownloadsTable)
+            .c_str()));
+    int column = 0;
+    BindFilePath(statement, data.current_path, column++);
+    BindFilePath(statement, data.target_path, column++);
+    statement.BindString(column++, data.mime_type);
+    statement.BindString(column++, data.original_mime_type);
+    statement.BindInt64(column++, data.received_bytes);
+    statement.BindInt(column++, DownloadStateToInt(data.state));
+    statement.BindInt(column++, DownloadDangerTypeToInt(data.danger_type));
+    statement.BindInt(column++,
+                      DownloadInterruptReasonToInt(data.interrupt_reason));
+    statement.BindBlob(column++, data.hash);
+    statement.BindInt64(column++, data.end_time.ToInternalValue());
+    statement.BindInt64(column++, data.total_bytes);
+    statement.BindInt(column++, (data.opened ? 1 : 0));
+    statement.BindInt64(column++, data.last_access_time.ToInternalValue());
+    statement.BindInt(column++, (data.transient ? 1 : 0));
+    statement.BindString(column++, data.by_ext_id);
+    statement.BindString(column++, data.by_ext_name);
+    statement.BindString(column++, data.etag);
+    statement.BindString(column++, data.last_modified);
+    statement.BindInt64(column++, DownloadIdToInt(data.id));
+
+    if (!statement.Run()) {
+      in_progress_downloads_.erase(data.id);
+      return false;
+    }
+  } else if (written->second.received_bytes != data.received_bytes ||
+             written->second.total_bytes != data.total_bytes) {
+    sql::Statement statement(GetDB().GetCachedStatement(
+        SQL_FROM_HERE,
+        base::StringPrintf(
+            "UPDATE %s SET received_bytes=?, total_bytes=? WHERE id=?",
+            kDownloadsTable)
+            .c_str()));
+    statement.BindInt64(0, data.received_bytes);
+    statement.BindInt64(1, data.total_bytes);
+    statement.BindInt64(2, DownloadIdToInt(data.id));
+    if (!statement.Run()) {
+      in_progress_downloads_.erase(data.id);
+      return false;
+    }
+  }
 
   if (data.download_slice_info.size() == 0) {
-    RemoveDownloadSlices(data.id);
+    if (written == in_progress_downloads_.end() ||
+        !written->second.download_slice_info.empty()) {
+      RemoveDownloadSlices(data.id);
+    }
   } else {
-    for (size_t i = 0; i < data.download_slice_info.size(); ++i) {
-      if (!CreateOrUpdateDownloadSlice(data.download_slice_info[i]))
+    for (const DownloadSliceInfo& slice : data.download_slice_info) {
+      if (written != in_progress_downloads_.end() &&
+          base::Contains(written->second.download_slice_info, slice)) {
+        continue;
+      }
+      if (!CreateOrUpdateDownloadSlice(slice)) {
+        in_progress_downloads_.erase(data.id);
         return false;
+      }
     }
   }
 
+  if (data.state == DownloadState::IN_PROGRESS)
+    in_progress_downloads_[data.id] = data;
+  else
+    in_progress_downloads_.erase(data.id);
   return true;
 }
 
+bool DownloadDatabase::IsDownloadProgressUpdate(const DownloadRow& data) const {
+  auto written = in_progress_downloads_.find(data.id);
+  return written != in_progress_downloads_.end() &&
+         !DiffersBeyondProgress(written->second, data);
+}
+
 void DownloadDatabase::EnsureInProgressEntriesCleanedUp() {
   if (in_progress_entry_cleanup_completed_)
     return;
@@ -748,11 +806,14 @@ bool DownloadDatabase::CreateDownload(const DownloadRow& info) {
     }
   }
 
+  if (info.state == DownloadState::IN_PROGRESS)
+    in_progress_downloads_[info.id] = info;
   return true;
 }
 
 void DownloadDatabase::RemoveDownload(DownloadId id) {
   EnsureInProgressEntriesCleanedUp();
+  in_progress_downloads_.erase(id);
 
   sql::Statement downloads_statement(GetDB().GetCachedStatement(
       SQL_FROM_HERE,
@@ -15,6 +15,7 @@
 #include "base/gtest_prod_util.h"
 #include "base/macros.h"
 #include "base/threading/platform_thread.h"
+#include "components/history/core/browser/download_row.h"
 #include "components/history/core/browser/download_types.h"
 
 namespace sql {
@@ -23,9 +24,6 @@ class Database;
 
 namespace history {
 
-struct DownloadSliceInfo;
-struct DownloadRow;
-
 // Maintains a table of downloads.
 class DownloadDatabase {
  public:
@@ -41,9 +39,14 @@ class DownloadDatabase {
 
   // Update the state of one download. Returns true if successful.
   // Does not update `url`, `start_time`; uses `id` only
-  // to select the row in the database table to update.
+  // to select the row in the database table to update. Updates of a download
+  // in progress only write the columns and slices that changed.
   bool UpdateDownload(const DownloadRow& data);
 
+  // Returns true if `data` only changes the progress (the received and total
+  // bytes, and the slices) of a download last written in progress.
+  bool IsDownloadProgressUpdate(const DownloadRow& data) const;
+
   // Create a new database entry for one download and return true if the
   // creation succeeded, false otherwise.
   bool CreateDownload(const DownloadRow& info);
@@ -152,6 +155,10 @@ class DownloadDatabase {
   // actually use the downloads database.
   bool in_progress_entry_cleanup_completed_;
 
+  // The rows last written for the downloads in progress, which their updates
+  // are compared to.
+  std::map<DownloadId, DownloadRow> in_progress_downloads_;
+
   // Those constants are defined in the embedder and injected into the
   // database in the constructor. They represent the interrupt reason
   // to use for respectively an undefined value and in case of a crash.
@@ -108,6 +108,11 @@ class AutoSubframeVisitsReader : public ExpiringVisitsReader {
 // Prevents us from doing too much work any given time.
 const int kNumExpirePerIteration = 32;
 
+// How long a slice of an incremental expiration should take. The number of
+// visits per slice, starting at kNumExpirePerIteration, adapts to it.
+constexpr base::TimeDelta kExpireSliceBudget =
+    base::TimeDelta::FromMilliseconds(20);
+
 // The number of seconds between checking for items that should be expired when
 // we think there might be more items to expire. This timeout is used when the
 // last expiration found at least kNumExpirePerIteration and we want to check
@@ -159,6 +164,56 @@ ExpireHistoryBackend::DeleteEffects::DeleteEffects() = default;
 
 ExpireHistoryBackend::DeleteEffects::~DeleteEffects() = default;
 
+// ExpireHistoryBackend::IncrementalExpiration --------------------------------
+
+struct ExpireHistoryBackend::IncrementalExpiration {
+  IncrementalExpiration(int generation,
+                        const DeletionTimeRange& time_range,
+                        const std::set<GURL>& restrict_urls,
+                        std::set<URLID> restrict_url_ids,
+                        DeletionType type,
+                        ExpireProgressCallback progress_callback,
+                        base::OnceClosure done_callback)
+      : generation(generation),
+        time_range(time_range),
+        restrict_urls(restrict_urls),
+        restrict_url_ids(std::move(restrict_url_ids)),
+        type(type),
+        progress_callback(std::move(progress_callback)),
+        done_callback(std::move(done_callback)),
+        next_visit_time(time_range.begin()) {}
+
+  // The number of slices run, and of visits they expired.
+  size_t slices = 0;
+  size_t expired_visits = 0;
+
+  // The ExpireHistoryBackend's `incremental_expiration_generation_` when the
+  // expiration started.
+  const int generation;
+
+  // The number of visits the next slice expires.
+  size_t visits_per_slice = kNumExpirePerIteration;
+
+  const DeletionTimeRange time_range;
+  const std::set<GURL> restrict_urls;
+  // The IDs of `restrict_urls`, when the expiration started.
+  const std::set<URLID> restrict_url_ids;
+  const DeletionType type;
+
+  ExpireProgressCallback progress_callback;
+  base::OnceClosure done_callback;
+
+  // Where the next slice reads the range from: the visits before
+  // `next_visit_time`, and those at it with an ID up to `last_visit_id`, were
+  // read already.
+  base::Time next_visit_time;
+  VisitID last_visit_id = 0;
+
+  // Whether the range is being read a second time, for the visits added to it
+  // behind the first read.
+  bool rereading = false;
+};
+
 // ExpireHistoryBackend -------------------------------------------------------
 
 ExpireHistoryBackend::ExpireHistoryBackend(
@@ -168,6 +223,7 @@ ExpireHistoryBackend::ExpireHistoryBackend(
     : notifier_(notifier),
       main_db_(nullptr),
       favicon_db_(nullptr),
+      slice_budget_(kExpireSliceBudget),
       backend_client_(backend_client),
       task_runner_(task_runner) {
   DCHECK(notifier_);
@@ -239,6 +295,45 @@ void ExpireHistoryBackend::ExpireHistoryBetween(
     return;
 
   // Find the affected visits and delete them.
+  VisitVector visits = GetVisitsBetween(restrict_urls, begin_time, end_time);
+  DeletionTimeRange time_range(begin_time, end_time);
+  ExpireVisitsInternal(
+      visits, time_range, restrict_urls,
+      user_initiated ? DELETION_USER_INITIATED : DELETION_EXPIRED);
+}
+
+void ExpireHistoryBackend::ExpireHistoryBetweenIncrementally(
+    const std::set<GURL>& restrict_urls,
+    base::Time begin_time,
+    base::Time end_time,
+    bool user_initiated,
+    ExpireProgressCallback progress_callback,
+    base::OnceClosure done_callback) {
+  if (!main_db_) {
+    std::move(done_callback).Run();
+    return;
+  }
+
+  std::set<URLID> restrict_url_ids;
+  for (const auto& restrict_url : restrict_urls)
+    restrict_url_ids.insert(main_db_->GetRowForURL(restrict_url, nullptr));
+
+  DoIncrementalExpirationSlice(std::make_unique<IncrementalExpiration>(
+      incremental_expiration_generation_,
+      DeletionTimeRange(begin_time, end_time), restrict_urls,
+      std::move(restrict_url_ids),
+      user_initiated ? DELETION_USER_INITIATED : DELETION_EXPIRED,
+      std::move(progress_callback), std::move(done_callback)));
+}
+
+void ExpireHistoryBackend::CancelIncrementalExpirations() {
+  ++incremental_expiration_generation_;
+}
+
+VisitVector ExpireHistoryBackend::GetVisitsBetween(
+    const std::set<GURL>& restrict_urls,
+    base::Time begin_time,
+    base::Time end_time) {
   VisitVector visits;
   main_db_->GetAllVisitsInRange(begin_time, end_time, 0, &visits);
   if (!restrict_urls.empty()) {
@@ -252,10 +347,7 @@ void ExpireHistoryBackend::ExpireHistoryBetween(
         visits.push_back(visit);
     }
   }
-  DeletionTimeRange time_range(begin_time, end_time);
-  ExpireVisitsInternal(
-      visits, time_range, restrict_urls,
-      user_initiated ? DELETION_USER_INITIATED : DELETION_EXPIRED);
+  return visits;
 }
 
 void ExpireHistoryBackend::ExpireHistoryForTimes(
@@ -320,6 +412,100 @@ void ExpireHistoryBackend::ExpireVisitsInternal(
   }
 }
 
+void ExpireHistoryBackend::DoIncrementalExpirationSlice(
+    std::unique_ptr<IncrementalExpiration> expiration) {
+  if (!main_db_ ||
+      expiration->generation != incremental_expiration_generation_) {
+    std::move(expiration->done_callback).Run();
+    return;
+  }
+
+  base::TimeTicks start = base::TimeTicks::Now();
+  ++expiration->slices;
+
+  // Read the next page of the range. The visits are read right before they
+  // are expired, so other deletions and new visits since the expiration
+  // started are accounted for.
+  VisitVector page;
+  main_db_->GetNextVisitsInRange(
+      expiration->next_visit_time, expiration->last_visit_id,
+      expiration->time_range.end(),
+      static_cast<int>(expiration->visits_per_slice), &page);
+  VisitVector visits;
+  for (const VisitRow& visit : page) {
+    if (expiration->restrict_url_ids.empty() ||
+        expiration->restrict_url_ids.count(visit.url_id)) {
+      visits.push_back(visit);
+    }
+  }
+  if (!page.empty()) {
+    expiration->next_visit_time = page.back().visit_time;
+    expiration->last_visit_id = page.back().visit_id;
+  }
+  bool last_slice = false;
+  if (page.size() < expiration->visits_per_slice) {
+    // The end of the range is reached. Unless that took a single task, the
+    // range is read again for the visits added behind the first read. The
+    // expired visits are gone, so unless `restrict_urls` kept others, this
+    // reads little more than the added ones.
+    if (expiration->slices == 1 || expiration->rereading) {
+      last_slice = true;
+    } else {
+      expiration->rereading = true;
+      expiration->next_visit_time = expiration->time_range.begin();
+      expiration->last_visit_id = 0;
+    }
+  }
+  expiration->expired_visits += visits.size();
+  if (last_slice && !expiration->expired_visits) {
+    // Nothing was in the range.
+    std::move(expiration->done_callback).Run();
+    return;
+  }
+
+  const VisitVector visits_and_redirects = GetVisitsAndRedirectParents(visits);
+  DeleteEffects effects;
+  DeleteVisitRelatedInfo(visits_and_redirects, &effects);
+  ExpireURLsForVisits(visits_and_redirects, &effects);
+  DeleteFaviconsIfPossible(&effects);
+
+  if (last_slice) {
+    BroadcastNotifications(&effects, expiration->type, expiration->time_range,
+                           expiration->restrict_urls.empty()
+                               ? absl::optional<std::set<GURL>>()
+                               : expiration->restrict_urls);
+  } else {
+    BroadcastNotifications(&effects, expiration->type,
+                           DeletionTimeRange::Invalid(), absl::nullopt);
+  }
+
+  base::TimeDelta slice_time = base::TimeTicks::Now() - start;
+  UMA_HISTOGRAM_TIMES("History.ExpireVisits.SliceDuration", slice_time);
+
+  if (expiration->progress_callback)
+    expiration->progress_callback.Run(expiration->expired_visits);
+
+  if (last_slice) {
+    // Pick up any bits possibly left over.
+    ParanoidExpireHistory();
+    std::move(expiration->done_callback).Run();
+    return;
+  }
+
+  // Fit the next slice to the budget.
+  if (slice_time >= slice_budget_) {
+    expiration->visits_per_slice =
+        std::max<size_t>(1, expiration->visits_per_slice / 2);
+  } else if (slice_time < slice_budget_ / 2) {
+    expiration->visits_per_slice *= 2;
+  }
+
+  task_runner_->PostTask(
+      FROM_HERE,
+      base::BindOnce(&ExpireHistoryBackend::DoIncrementalExpirationSlice,
+                     weak_factory_.GetWeakPtr(), std::move(expiration)));
+}
+
 void ExpireHistoryBackend::ExpireHistoryBeforeForTesting(base::Time end_time) {
   if (!main_db_)
     return;
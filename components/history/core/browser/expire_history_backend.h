@@ -10,6 +10,7 @@
 #include <set>
 #include <vector>
 
+#include "base/callback.h"
 #include "base/containers/queue.h"
 #include "base/gtest_prod_util.h"
 #include "base/macros.h"
@@ -58,6 +59,11 @@ extern const int kOnDemandFaviconIsOldAfterDays;
 // StartExpiringOldStuff().
 class ExpireHistoryBackend {
  public:
+  // Runs after each slice of an incremental expiration, with the number of
+  // visits expired so far.
+  using ExpireProgressCallback =
+      base::RepeatingCallback<void(size_t expired_visits)>;
+
   // The delegate pointer must be non-null. We will NOT take ownership of it.
   // HistoryBackendClient may be null. The HistoryBackendClient is used when
   // expiring URLS so that we don't remove any URLs or favicons that are
@@ -88,6 +94,27 @@ class ExpireHistoryBackend {
                             base::Time end_time,
                             bool user_initiated);
 
+  // Same as ExpireHistoryBetween(), but expires the visits in slices, posting a
+  // task between them so that deleting a large range does not block the
+  // history sequence. Each slice reads the next visits of the range, in time
+  // order, and is sized to take about `slice_budget_`.
+  // `progress_callback`, which may be null, runs after each slice, and
+  // `done_callback` once all the visits are expired or the databases are gone.
+  // Only the deletion notification of the last slice has the time range and
+  // `restrict_urls`.
+  void ExpireHistoryBetweenIncrementally(
+      const std::set<GURL>& restrict_urls,
+      base::Time begin_time,
+      base::Time end_time,
+      bool user_initiated,
+      ExpireProgressCallback progress_callback,
+      base::OnceClosure done_callback);
+
+  // Stops the incremental expirations in progress, because the visits they
+  // read when they started may no longer be the ones in the database, e.g.
+  // after all history is deleted. Each one still runs its `done_callback`.
+  void CancelIncrementalExpirations();
+
   // Removes all visits to all URLs with the given times, updating the
   // URLs accordingly.  `times` must be in reverse chronological order
   // and not contain any duplicates.
@@ -112,6 +139,10 @@ class ExpireHistoryBackend {
     return base::Time::Now() - expiration_threshold_;
   }
 
+  void set_slice_budget_for_testing(base::TimeDelta slice_budget) {
+    slice_budget_ = slice_budget;
+  }
+
  private:
   FRIEND_TEST_ALL_PREFIXES(ExpireHistoryTest, DeleteFaviconsIfPossible);
   FRIEND_TEST_ALL_PREFIXES(ExpireHistoryTest, ExpireSomeOldHistory);
@@ -153,6 +184,14 @@ class ExpireHistoryBackend {
     std::set<GURL> deleted_favicons;
   };
 
+  struct IncrementalExpiration;
+
+  // Returns the visits to `restrict_urls` (or to all URLs if empty) in the
+  // given time range.
+  VisitVector GetVisitsBetween(const std::set<GURL>& restrict_urls,
+                               base::Time begin_time,
+                               base::Time end_time);
+
   // Returns a vector with all visits that eventually redirect to `visits`.
   VisitVector GetVisitsAndRedirectParents(const VisitVector& visits);
 
@@ -219,6 +258,11 @@ class ExpireHistoryBackend {
                             const std::set<GURL>& restrict_urls,
                             DeletionType type);
 
+  // Reads and expires the next slice of visits of `expiration`, and posts a
+  // task for the one after.
+  void DoIncrementalExpirationSlice(
+      std::unique_ptr<IncrementalExpiration> expiration);
+
   // Deletes the favicons listed in `effects->affected_favicons` if they are
   // unused. Fails silently (we don't care about favicons so much, so don't want
   // to stop everything if it fails). Fills `expired_favicons` with the set of
@@ -277,6 +321,13 @@ class ExpireHistoryBackend {
   // The time at which we expect the expiration code to run.
   base::Time expected_expiration_time_;
 
+  // How long a slice of an incremental expiration should take.
+  base::TimeDelta slice_budget_;
+
+  // Incremented by CancelIncrementalExpirations(). An incremental expiration
+  // only goes on while this is what it was when the expiration started.
+  int incremental_expiration_generation_ = 0;
+
   // The lastly used threshold for "old" on-demand favicons.
   base::Time last_on_demand_expiration_threshold_;
 
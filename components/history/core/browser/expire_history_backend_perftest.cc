@@ -0,0 +1,212 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "components/history/core/browser/expire_history_backend.h"
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/callback.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/location.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/run_loop.h"
+#include "base/sequenced_task_runner.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/task_environment.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "components/history/core/browser/history_backend_notifier.h"
+#include "components/history/core/browser/history_constants.h"
+#include "components/history/core/browser/history_types.h"
+#include "components/history/core/test/test_history_database.h"
+#include "sql/init_status.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "ui/base/page_transition_types.h"
+#include "url/gurl.h"
+
+namespace history {
+
+namespace {
+
+constexpr char kMetricPrefixExpireHistory[] = "ExpireHistory.";
+constexpr char kMetricMaxPause[] = "max_pause";
+constexpr char kMetricTotalTime[] = "total_time";
+
+// A year of history, as a heavy user would have it.
+constexpr int kDays = 365;
+constexpr int kVisitsPerDay = 200;
+constexpr int kURLCount = 5000;
+
+perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixExpireHistory,
+                                         story_name);
+  reporter.RegisterImportantMetric(kMetricMaxPause, "ms");
+  reporter.RegisterImportantMetric(kMetricTotalTime, "ms");
+  return reporter;
+}
+
+// Runs the tasks posted to it on `task_runner`, and keeps track of the longest
+// of them.
+class TimingTaskRunner : public base::SequencedTaskRunner {
+ public:
+  explicit TimingTaskRunner(
+      scoped_refptr<base::SequencedTaskRunner> task_runner)
+      : task_runner_(std::move(task_runner)) {}
+  TimingTaskRunner(const TimingTaskRunner&) = delete;
+  TimingTaskRunner& operator=(const TimingTaskRunner&) = delete;
+
+  base::TimeDelta max_task_time() const { return max_task_time_; }
+
+  // base::SequencedTaskRunner:
+  bool PostDelayedTask(const base::Location& from_here,
+                       base::OnceClosure task,
+                       base::TimeDelta delay) override {
+    return task_runner_->PostDelayedTask(
+        from_here,
+        base::BindOnce(&TimingTaskRunner::RunTask, this, std::move(task)),
+        delay);
+  }
+  bool PostNonNestableDelayedTask(const base::Location& from_here,
+                                  base::OnceClosure task,
+                                  base::TimeDelta delay) override {
+    return task_runner_->PostNonNestableDelayedTask(
+        from_here,
+        base::BindOnce(&TimingTaskRunner::RunTask, this, std::move(task)),
+        delay);
+  }
+  bool RunsTasksInCurrentSequence() const override {
+    return task_runner_->RunsTasksInCurrentSequence();
+  }
+
+ private:
+  ~TimingTaskRunner() override = default;
+
+  void RunTask(base::OnceClosure task) {
+    base::ElapsedTimer timer;
+    std::move(task).Run();
+    max_task_time_ = std::max(max_task_time_, timer.Elapsed());
+  }
+
+  const scoped_refptr<base::SequencedTaskRunner> task_runner_;
+  base::TimeDelta max_task_time_;
+};
+
+// Measures the longest the history sequence is blocked by deleting a year of
+// history.
+class ExpireHistoryPerfTest : public testing::Test,
+                              public HistoryBackendNotifier {
+ public:
+  ExpireHistoryPerfTest()
+      : task_runner_(base::MakeRefCounted<TimingTaskRunner>(
+            task_environment_.GetMainThreadTaskRunner())),
+        expirer_(this, /*backend_client=*/nullptr, task_runner_) {}
+
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    ASSERT_EQ(sql::INIT_OK,
+              db_.Init(temp_dir_.GetPath().Append(kHistoryFilename)));
+    expirer_.SetDatabases(&db_, nullptr);
+    PopulateDatabase();
+  }
+
+  void TearDown() override { expirer_.SetDatabases(nullptr, nullptr); }
+
+  void PopulateDatabase() {
+    db_.BeginTransaction();
+    std::vector<URLID> url_ids(kURLCount);
+    for (int i = 0; i < kURLCount; ++i) {
+      URLRow row(GURL(base::StringPrintf("https://www.site%d.com/page", i)));
+      row.set_visit_count(kDays * kVisitsPerDay / kURLCount);
+      row.set_last_visit(now_);
+      url_ids[i] = db_.AddURL(row);
+    }
+    for (int i = 0; i < kDays * kVisitsPerDay; ++i) {
+      VisitRow visit;
+      visit.url_id = url_ids[i % kURLCount];
+      visit.visit_time = now_ - base::TimeDelta::FromDays(kDays) +
+                         base::TimeDelta::FromMinutes(i * 24 * 60 /
+                                                      kVisitsPerDay);
+      visit.transition = ui::PAGE_TRANSITION_LINK;
+      db_.AddVisit(&visit, SOURCE_BROWSED);
+    }
+    db_.CommitTransaction();
+  }
+
+  // Deletes the year of history as a single task.
+  void RunSynchronous(const std::string& story_name) {
+    base::ElapsedTimer timer;
+    expirer_.ExpireHistoryBetween(std::set<GURL>(), YearAgo(), base::Time(),
+                                  /*user_initiated=*/true);
+    const base::TimeDelta elapsed = timer.Elapsed();
+
+    auto reporter = SetUpReporter(story_name);
+    reporter.AddResult(kMetricMaxPause, elapsed.InMillisecondsF());
+    reporter.AddResult(kMetricTotalTime, elapsed.InMillisecondsF());
+  }
+
+  // Deletes the year of history in slices. The expiration is started by a
+  // task of `task_runner_` as well, so that every task it runs in is timed,
+  // from the one reading the first slice to the one running `done_callback`.
+  void RunIncremental(const std::string& story_name) {
+    base::RunLoop run_loop;
+    base::ElapsedTimer timer;
+    task_runner_->PostTask(
+        FROM_HERE,
+        base::BindOnce(&ExpireHistoryBackend::ExpireHistoryBetweenIncrementally,
+                       base::Unretained(&expirer_), std::set<GURL>(),
+                       YearAgo(), base::Time(), /*user_initiated=*/true,
+                       ExpireHistoryBackend::ExpireProgressCallback(),
+                       run_loop.QuitClosure()));
+    run_loop.Run();
+    const base::TimeDelta elapsed = timer.Elapsed();
+
+    auto reporter = SetUpReporter(story_name);
+    reporter.AddResult(kMetricMaxPause,
+                       task_runner_->max_task_time().InMillisecondsF());
+    reporter.AddResult(kMetricTotalTime, elapsed.InMillisecondsF());
+  }
+
+ private:
+  base::Time YearAgo() const {
+    return now_ - base::TimeDelta::FromDays(kDays + 1);
+  }
+
+  // HistoryBackendNotifier:
+  void NotifyFaviconsChanged(const std::set<GURL>& page_urls,
+                             const GURL& icon_url) override {}
+  void NotifyURLVisited(ui::PageTransition transition,
+                        const URLRow& row,
+                        const RedirectList& redirects,
+                        base::Time visit_time) override {}
+  void NotifyURLsModified(const URLRows& changed_urls,
+                          bool is_from_expiration) override {}
+  void NotifyURLsDeleted(DeletionInfo deletion_info) override {}
+  void NotifyVisitDeleted(const VisitRow& visit) override {}
+
+  base::test::TaskEnvironment task_environment_;
+  scoped_refptr<TimingTaskRunner> task_runner_;
+  base::ScopedTempDir temp_dir_;
+  TestHistoryDatabase db_;
+  ExpireHistoryBackend expirer_;
+  const base::Time now_ = base::Time::Now();
+};
+
+}  // namespace
+
+TEST_F(ExpireHistoryPerfTest, OneYearSynchronous) {
+  RunSynchronous("one_year_synchronous");
+}
+
+TEST_F(ExpireHistoryPerfTest, OneYearIncremental) {
+  RunIncremental("one_year_incremental");
+}
+
+}  // namespace history
@@ -21,6 +21,7 @@
 #include "base/scoped_observation.h"
 #include "base/strings/utf_string_conversions.h"
 #include "base/task/current_thread.h"
+#include "base/test/bind.h"
 #include "base/test/task_environment.h"
 #include "components/favicon/core/favicon_database.h"
 #include "components/history/core/browser/history_backend_client.h"
@@ -974,6 +975,153 @@ TEST_F(ExpireHistoryTest, ExpireHistoryBetweenPropagatesUserInitiated) {
   EXPECT_TRUE(GetLastDeletionInfo()->is_from_expiration());
 }
 
+TEST_F(ExpireHistoryTest, ExpireHistoryBetweenIncrementally) {
+  URLID url_ids[3];
+  base::Time visit_times[4];
+  AddExampleData(url_ids, visit_times);
+
+  // Give the middle URL enough visits in the range to need several slices.
+  for (int i = 1; i <= 40; ++i) {
+    VisitRow visit_row;
+    visit_row.url_id = url_ids[1];
+    visit_row.visit_time = visit_times[2] + base::TimeDelta::FromMinutes(i);
+    main_db_->AddVisit(&visit_row, SOURCE_BROWSED);
+  }
+
+  URLRow url_row2;
+  ASSERT_TRUE(main_db_->GetURLRow(url_ids[2], &url_row2));
+
+  // Without a budget, each slice reads half as many visits as the one before,
+  // starting with 32.
+  expirer_.set_slice_budget_for_testing(base::TimeDelta());
+  std::vector<size_t> progress;
+  base::RunLoop run_loop;
+  expirer_.ExpireHistoryBetweenIncrementally(
+      std::set<GURL>(), visit_times[2], base::Time(), /*user_initiated*/ true,
+      base::BindLambdaForTesting([&](size_t expired_visits) {
+        progress.push_back(expired_visits);
+      }),
+      run_loop.QuitClosure());
+
+  // The first slice is expired right away, the others in later tasks. The
+  // last one reads the range again, for visits added behind the others.
+  EXPECT_EQ(1U, progress.size());
+  run_loop.Run();
+  EXPECT_EQ(std::vector<size_t>({32, 42, 42}), progress);
+
+  // Only the first visit of the middle URL is left, and the last URL is gone.
+  VisitVector visits;
+  main_db_->GetVisitsForURL(url_ids[1], &visits);
+  EXPECT_EQ(1U, visits.size());
+  EnsureURLInfoGone(url_row2, false);
+  EXPECT_EQ(GetLastDeletionInfo()->time_range().begin(), visit_times[2]);
+  EXPECT_EQ(GetLastDeletionInfo()->time_range().end(), base::Time());
+}
+
+TEST_F(ExpireHistoryTest, ExpireHistoryBetweenIncrementallySkipsDeletedVisits) {
+  URLID url_ids[3];
+  base::Time visit_times[4];
+  AddExampleData(url_ids, visit_times);
+
+  expirer_.set_slice_budget_for_testing(base::TimeDelta());
+  for (int i = 1; i <= 40; ++i) {
+    VisitRow visit_row;
+    visit_row.url_id = url_ids[1];
+    visit_row.visit_time = visit_times[2] + base::TimeDelta::FromMinutes(i);
+    main_db_->AddVisit(&visit_row, SOURCE_BROWSED);
+  }
+
+  base::RunLoop run_loop;
+  expirer_.ExpireHistoryBetweenIncrementally(
+      std::set<GURL>(), visit_times[1], base::Time(), /*user_initiated*/ true,
+      ExpireHistoryBackend::ExpireProgressCallback(), run_loop.QuitClosure());
+
+  // Deleting the middle URL between slices must not fail the expiration.
+  expirer_.DeleteURL(GURL("http://www.google.com/2"), base::Time::Max());
+  run_loop.Run();
+
+  URLRow temp_row;
+  EXPECT_FALSE(main_db_->GetURLRow(url_ids[1], &temp_row));
+  EXPECT_FALSE(main_db_->GetURLRow(url_ids[2], &temp_row));
+  EXPECT_TRUE(main_db_->GetURLRow(url_ids[0], &temp_row));
+}
+
+// Tests that visits which took the IDs of expired ones between slices are
+// kept, while the visits added to the range are expired.
+TEST_F(ExpireHistoryTest, ExpireHistoryBetweenIncrementallyChecksVisits) {
+  URLID url_ids[3];
+  base::Time visit_times[4];
+  AddExampleData(url_ids, visit_times);
+
+  expirer_.set_slice_budget_for_testing(base::TimeDelta());
+  VisitRow last_visit;
+  for (int i = 1; i <= 40; ++i) {
+    last_visit = VisitRow();
+    last_visit.url_id = url_ids[1];
+    last_visit.visit_time = visit_times[2] + base::TimeDelta::FromMinutes(i);
+    main_db_->AddVisit(&last_visit, SOURCE_BROWSED);
+  }
+
+  base::RunLoop run_loop;
+  expirer_.ExpireHistoryBetweenIncrementally(
+      std::set<GURL>(), visit_times[2], base::Time(), /*user_initiated*/ true,
+      ExpireHistoryBackend::ExpireProgressCallback(), run_loop.QuitClosure());
+
+  // The visit with the largest ID is deleted, so that the next visit reuses
+  // its ID, but out of the range.
+  main_db_->DeleteVisit(last_visit);
+  VisitRow reused_visit;
+  reused_visit.url_id = url_ids[0];
+  reused_visit.visit_time = visit_times[0] + base::TimeDelta::FromMinutes(1);
+  ASSERT_EQ(last_visit.visit_id,
+            main_db_->AddVisit(&reused_visit, SOURCE_BROWSED));
+  // A visit added to the range after the expiration started.
+  VisitRow new_visit;
+  new_visit.url_id = url_ids[0];
+  new_visit.visit_time = visit_times[2] + base::TimeDelta::FromSeconds(30);
+  ASSERT_TRUE(main_db_->AddVisit(&new_visit, SOURCE_BROWSED));
+  run_loop.Run();
+
+  VisitRow temp_visit;
+  EXPECT_TRUE(main_db_->GetRowForVisit(reused_visit.visit_id, &temp_visit));
+  EXPECT_FALSE(main_db_->GetRowForVisit(new_visit.visit_id, &temp_visit));
+  VisitVector visits;
+  main_db_->GetVisitsForURL(url_ids[0], &visits);
+  EXPECT_EQ(2U, visits.size());
+  main_db_->GetVisitsForURL(url_ids[1], &visits);
+  EXPECT_EQ(1U, visits.size());
+}
+
+// Tests that a cancelled incremental expiration stops, but still runs its
+// done callback.
+TEST_F(ExpireHistoryTest, CancelIncrementalExpirations) {
+  URLID url_ids[3];
+  base::Time visit_times[4];
+  AddExampleData(url_ids, visit_times);
+
+  expirer_.set_slice_budget_for_testing(base::TimeDelta());
+  for (int i = 1; i <= 40; ++i) {
+    VisitRow visit_row;
+    visit_row.url_id = url_ids[1];
+    visit_row.visit_time = visit_times[2] + base::TimeDelta::FromMinutes(i);
+    main_db_->AddVisit(&visit_row, SOURCE_BROWSED);
+  }
+
+  base::RunLoop run_loop;
+  expirer_.ExpireHistoryBetweenIncrementally(
+      std::set<GURL>(), visit_times[2], base::Time(), /*user_initiated*/ true,
+      ExpireHistoryBackend::ExpireProgressCallback(), run_loop.QuitClosure());
+  expirer_.CancelIncrementalExpirations();
+  run_loop.Run();
+
+  // Only the first slice, the first 32 visits of the range, was expired.
+  VisitVector visits;
+  main_db_->GetVisitsForURL(url_ids[1], &visits);
+  EXPECT_EQ(10U, visits.size());
+  main_db_->GetVisitsForURL(url_ids[2], &visits);
+  EXPECT_EQ(1U, visits.size());
+}
+
 TEST_F(ExpireHistoryTest, ExpireHistoryBeforeUnstarred) {
   URLID url_ids[3];
   base::Time visit_times[4];
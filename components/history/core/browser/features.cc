@@ -4,6 +4,7 @@
 
 #include "components/history/core/browser/features.h"
 
+#include "base/time/time.h"
 #include "components/history/core/browser/top_sites_impl.h"
 
 namespace history {
@@ -36,4 +37,32 @@ const base::FeatureParam<bool> kPrivilegeRepeatableQueries(
     "PrivilegeRepeatableQueries",
     false);
 
+const base::Feature kHistoryWriteBatching{"HistoryWriteBatching",
+                                          base::FEATURE_DISABLED_BY_DEFAULT};
+
+// How long a write may wait to be committed. The default is the commit
+// interval used when the feature is disabled.
+const base::FeatureParam<base::TimeDelta> kHistoryWriteBatchingLatencyBudget(
+    &kHistoryWriteBatching,
+    "LatencyBudget",
+    base::TimeDelta::FromSeconds(10));
+
+// How many writes may be batched in one commit.
+const base::FeatureParam<int> kHistoryWriteBatchingMaxBatchSize(
+    &kHistoryWriteBatching,
+    "MaxBatchSize",
+    500);
+
+const base::Feature kHistoryIncrementalExpiration{
+    "HistoryIncrementalExpiration", base::FEATURE_DISABLED_BY_DEFAULT};
+
+const base::Feature kDownloadUpdateCoalescing{
+    "DownloadUpdateCoalescing", base::FEATURE_DISABLED_BY_DEFAULT};
+
+// How long the progress updates of a download may wait to be written.
+const base::FeatureParam<base::TimeDelta> kDownloadUpdateCoalescingWindow(
+    &kDownloadUpdateCoalescing,
+    "Window",
+    base::TimeDelta::FromSeconds(1));
+
 }  // namespace history
@@ -16,6 +16,25 @@ extern const base::FeatureParam<int> kMaxNumRepeatableQueries;
 extern const base::FeatureParam<bool> kScaleRepeatableQueriesScores;
 extern const base::FeatureParam<bool> kPrivilegeRepeatableQueries;
 
+// Bounds the writes HistoryBackend batches in the transaction it keeps open:
+// they are committed once the oldest is `kHistoryWriteBatchingLatencyBudget`
+// old, or once there are `kHistoryWriteBatchingMaxBatchSize` of them.
+extern const base::Feature kHistoryWriteBatching;
+extern const base::FeatureParam<base::TimeDelta>
+    kHistoryWriteBatchingLatencyBudget;
+extern const base::FeatureParam<int> kHistoryWriteBatchingMaxBatchSize;
+
+// Expires the time ranges HistoryService::ExpireHistoryBetween() deletes in
+// slices, rather than in a single task on the history sequence.
+extern const base::Feature kHistoryIncrementalExpiration;
+
+// Coalesces the progress updates of the downloads in progress, writing the
+// latest one of each download at most once per
+// `kDownloadUpdateCoalescingWindow`. Other updates are written right away.
+extern const base::Feature kDownloadUpdateCoalescing;
+extern const base::FeatureParam<base::TimeDelta>
+    kDownloadUpdateCoalescingWindow;
+
 }  // namespace history
 
 #endif  // COMPONENTS_HISTORY_CORE_BROWSER_FEATURES_H_
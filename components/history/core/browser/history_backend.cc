@@ -39,6 +39,7 @@
 #include "components/favicon/core/favicon_backend.h"
 #include "components/history/core/browser/download_constants.h"
 #include "components/history/core/browser/download_row.h"
+#include "components/history/core/browser/features.h"
 #include "components/history/core/browser/history_backend_client.h"
 #include "components/history/core/browser/history_backend_observer.h"
 #include "components/history/core/browser/history_constants.h"
@@ -150,6 +151,18 @@ const int kCommitIntervalSeconds = 10;
 // deleting some.
 const int kMaxRedirectCount = 32;
 
+// After migration to version 46, the words of this many URLs are indexed at a
+// time, with this delay in between so that other history tasks can run.
+const int kURLWordsRebuildBatchSize = 1000;
+constexpr base::TimeDelta kURLWordsRebuildBatchDelay =
+    base::TimeDelta::FromMilliseconds(200);
+
+// While the domain_visits table is filled, this many visits are counted at a
+// time, with this delay in between so that other history tasks can run.
+const int kDomainVisitsRebuildBatchSize = 5000;
+constexpr base::TimeDelta kDomainVisitsRebuildBatchDelay =
+    base::TimeDelta::FromMilliseconds(200);
+
 // The number of days old a history entry can be before it is considered "old"
 // and is deleted.
 const int kExpireDaysThreshold = 60;
@@ -350,6 +363,7 @@ void HistoryBackend::Closing() {
   // Any scheduled commit will have a reference to us, we must make it
   // release that reference before we can be destroyed.
   CancelScheduledCommit();
+  scheduled_download_updates_flush_.Cancel();
 }
 
 #if BUILDFLAG(IS_IOS)
@@ -931,6 +945,11 @@ void HistoryBackend::InitImpl(
   // Start expiring old stuff.
   expirer_.StartExpiringOldStuff(TimeDelta::FromDays(kExpireDaysThreshold));
 
+  if (db_->NeedsURLWordsRebuild())
+    ScheduleURLWordsRebuildBatch();
+  if (db_->NeedsDomainVisitsRebuild())
+    ScheduleDomainVisitsRebuildBatch();
+
   LOCAL_HISTOGRAM_TIMES("History.InitTime", TimeTicks::Now() - beginning_time);
 }
 
@@ -950,6 +969,7 @@ void HistoryBackend::OnMemoryPressure(
 
 void HistoryBackend::CloseAllDatabases() {
   if (db_) {
+    WritePendingDownloadUpdates();
     // Commit the long-running transaction.
     db_->CommitTransaction();
     db_.reset();
@@ -1698,6 +1718,7 @@ uint32_t HistoryBackend::GetNextDownloadId() {
 
 // Get all the download entries from the database.
 std::vector<DownloadRow> HistoryBackend::QueryDownloads() {
+  FlushDownloadUpdates();
   std::vector<DownloadRow> rows;
   if (db_)
     db_->QueryDownloads(&rows);
@@ -1710,6 +1731,26 @@ void HistoryBackend::UpdateDownload(const DownloadRow& data,
   TRACE_EVENT0("browser", "HistoryBackend::UpdateDownload");
   if (!db_)
     return;
+
+  // Many downloads in progress may each report their progress several times a
+  // second. Only the latest of their progress updates is written once the
+  // coalescing window is over, while any other update, such as a change of
+  // state, supersedes the one held back and is written right away.
+  if (!should_commit_immediately &&
+      base::FeatureList::IsEnabled(kDownloadUpdateCoalescing) &&
+      db_->IsDownloadProgressUpdate(data)) {
+    pending_download_updates_[data.id] = data;
+    if (scheduled_download_updates_flush_.IsCancelled()) {
+      scheduled_download_updates_flush_.Reset(base::BindOnce(
+          &HistoryBackend::FlushDownloadUpdates, base::Unretained(this)));
+      task_runner_->PostDelayedTask(
+          FROM_HERE, scheduled_download_updates_flush_.callback(),
+          kDownloadUpdateCoalescingWindow.Get());
+    }
+    return;
+  }
+  pending_download_updates_.erase(data.id);
+
   db_->UpdateDownload(data);
   if (should_commit_immediately)
     Commit();
@@ -1741,8 +1782,10 @@ void HistoryBackend::RemoveDownloads(const std::set<uint32_t>& ids) {
   size_t downloads_count_before = db_->CountDownloads();
   // HistoryBackend uses a long-running Transaction that is committed
   // periodically, so this loop doesn't actually hit the disk too hard.
-  for (uint32_t id : ids)
+  for (uint32_t id : ids) {
+    pending_download_updates_.erase(id);
     db_->RemoveDownload(id);
+  }
   ScheduleCommit();
   size_t downloads_count_after = db_->CountDownloads();
 
@@ -1894,7 +1937,8 @@ VisibleVisitCountToHostResult HistoryBackend::GetVisibleVisitCountToHost(
   return result;
 }
 
-MostVisitedURLList HistoryBackend::QueryMostVisitedURLs(int result_count) {
+MostVisitedURLList HistoryBackend::QueryMostVisitedURLs(int result_count,
+                                                        int days_back) {
   if (!db_)
     return {};
 
@@ -2230,6 +2274,44 @@ void HistoryBackend::SendFaviconChangedNotificationForIconURL(
   NotifyFaviconsChanged(std::set<GURL>(), icon_url);
 }
 
+void HistoryBackend::ScheduleURLWordsRebuildBatch() {
+  task_runner_->PostDelayedTask(
+      FROM_HERE,
+      base::BindOnce(&HistoryBackend::RebuildURLWordsBatch, this),
+      kURLWordsRebuildBatchDelay);
+}
+
+void HistoryBackend::RebuildURLWordsBatch() {
+  if (!db_)
+    return;
+  // On failure, the rebuild resumes at the next startup.
+  if (!db_->RebuildURLWordsBatch(kURLWordsRebuildBatchSize))
+    return;
+  ScheduleCommit();
+  if (db_->NeedsURLWordsRebuild())
+    ScheduleURLWordsRebuildBatch();
+}
+
+void HistoryBackend::ScheduleDomainVisitsRebuildBatch() {
+  domain_visits_rebuild_scheduled_ = true;
+  task_runner_->PostDelayedTask(
+      FROM_HERE,
+      base::BindOnce(&HistoryBackend::RebuildDomainVisitsBatch, this),
+      kDomainVisitsRebuildBatchDelay);
+}
+
+void HistoryBackend::RebuildDomainVisitsBatch() {
+  domain_visits_rebuild_scheduled_ = false;
+  if (!db_)
+    return;
+  // On failure, the rebuild is retried after the next commit.
+  if (!db_->RebuildDomainVisitsBatch(kDomainVisitsRebuildBatchSize))
+    return;
+  ScheduleCommit();
+  if (db_->NeedsDomainVisitsRebuild())
+    ScheduleDomainVisitsRebuildBatch();
+}
+
 void HistoryBackend::Commit() {
   if (!db_)
     return;
@@ -2249,16 +2331,52 @@ void HistoryBackend::Commit() {
   // some cases) but it hasn't been important yet.
   CancelScheduledCommit();
 
+  // The progress of the downloads is committed along with everything else.
+  WritePendingDownloadUpdates();
+
+  const base::TimeTicks commit_start_time = base::TimeTicks::Now();
   db_->CommitTransaction();
   DCHECK_EQ(db_->transaction_nesting(), 0)
       << "Somebody left a transaction open";
   db_->BeginTransaction();
 
+  if (uncommitted_write_count_ > 0) {
+    UMA_HISTOGRAM_TIMES("History.CommitTime",
+                        base::TimeTicks::Now() - commit_start_time);
+    UMA_HISTOGRAM_COUNTS_10000("History.CommitBatchSize",
+                               uncommitted_write_count_);
+    UMA_HISTOGRAM_MEDIUM_TIMES(
+        "History.CommitLatency",
+        commit_start_time - first_uncommitted_write_time_);
+    uncommitted_write_count_ = 0;
+  }
+
   if (favicon_backend_)
     favicon_backend_->Commit();
+
+  // Keeping the domain visits up to date may have failed since the last
+  // commit, in which case they are counted again.
+  if (db_->NeedsDomainVisitsRebuild() && !domain_visits_rebuild_scheduled_)
+    ScheduleDomainVisitsRebuildBatch();
 }
 
 void HistoryBackend::ScheduleCommit() {
+  if (uncommitted_write_count_++ == 0)
+    first_uncommitted_write_time_ = base::TimeTicks::Now();
+
+  const bool write_batching =
+      base::FeatureList::IsEnabled(kHistoryWriteBatching);
+  if (write_batching &&
+      uncommitted_write_count_ == kHistoryWriteBatchingMaxBatchSize.Get()) {
+    // The batch is full. Commit it once the current task is done rather than
+    // right away, as the caller may have a nested transaction open. This
+    // replaces the commit scheduled for the end of the latency budget.
+    scheduled_commit_.Reset(
+        base::BindOnce(&HistoryBackend::Commit, base::Unretained(this)));
+    task_runner_->PostTask(FROM_HERE, scheduled_commit_.callback());
+    return;
+  }
+
   // Non-cancelled means there's an already scheduled commit. Note that
   // CancelableOnceClosure starts cancelled with the default constructor.
   if (!scheduled_commit_.IsCancelled())
@@ -2269,13 +2387,31 @@ void HistoryBackend::ScheduleCommit() {
 
   task_runner_->PostDelayedTask(
       FROM_HERE, scheduled_commit_.callback(),
-      base::TimeDelta::FromSeconds(kCommitIntervalSeconds));
+      write_batching ? kHistoryWriteBatchingLatencyBudget.Get()
+                     : base::TimeDelta::FromSeconds(kCommitIntervalSeconds));
 }
 
 void HistoryBackend::CancelScheduledCommit() {
   scheduled_commit_.Cancel();
 }
 
+bool HistoryBackend::WritePendingDownloadUpdates() {
+  scheduled_download_updates_flush_.Cancel();
+  if (!db_ || pending_download_updates_.empty()) {
+    pending_download_updates_.clear();
+    return false;
+  }
+  for (const auto& pending_update : pending_download_updates_)
+    db_->UpdateDownload(pending_update.second);
+  pending_download_updates_.clear();
+  return true;
+}
+
+void HistoryBackend::FlushDownloadUpdates() {
+  if (WritePendingDownloadUpdates())
+    ScheduleCommit();
+}
+
 void HistoryBackend::ProcessDBTaskImpl() {
   if (!db_) {
     // db went away, release all the refs.
@@ -2386,6 +2522,50 @@ void HistoryBackend::ExpireHistoryBetween(const std::set<GURL>& restrict_urls,
     db_->GetStartDate(&first_recorded_time_);
 }
 
+void HistoryBackend::ExpireHistoryBetweenIncrementally(
+    const std::set<GURL>& restrict_urls,
+    Time begin_time,
+    Time end_time,
+    bool user_initiated,
+    scoped_refptr<base::SingleThreadTaskRunner> origin_loop,
+    const base::CancelableTaskTracker::IsCanceledCallback& is_canceled,
+    base::OnceClosure callback) {
+  TRACE_EVENT0("browser", "HistoryBackend::ExpireHistoryBetweenIncrementally");
+  base::OnceClosure reply =
+      base::BindOnce(&RunUnlessCanceled, std::move(callback), is_canceled);
+
+  if (!db_ || (begin_time.is_null() &&
+               (end_time.is_null() || end_time.is_max()) &&
+               restrict_urls.empty())) {
+    // Deleting all history is fast already.
+    ExpireHistoryBetween(restrict_urls, begin_time, end_time, user_initiated);
+    origin_loop->PostTask(FROM_HERE, std::move(reply));
+    return;
+  }
+
+  expirer_.ExpireHistoryBetweenIncrementally(
+      restrict_urls, begin_time, end_time, user_initiated,
+      base::BindRepeating(&HistoryBackend::OnExpirationSliceDone,
+                          base::Unretained(this)),
+      base::BindOnce(&HistoryBackend::OnIncrementalExpirationDone,
+                     base::Unretained(this), begin_time, origin_loop,
+                     std::move(reply)));
+}
+
+void HistoryBackend::OnExpirationSliceDone(size_t expired_visits) {
+  // As for ExpireHistoryBetween(), get what the user deleted on disk ASAP.
+  Commit();
+}
+
+void HistoryBackend::OnIncrementalExpirationDone(
+    Time begin_time,
+    scoped_refptr<base::SingleThreadTaskRunner> origin_loop,
+    base::OnceClosure reply) {
+  if (db_ && begin_time <= first_recorded_time_)
+    db_->GetStartDate(&first_recorded_time_);
+  origin_loop->PostTask(FROM_HERE, std::move(reply));
+}
+
 void HistoryBackend::ExpireHistoryForTimes(const std::set<base::Time>& times,
                                            base::Time begin_time,
                                            base::Time end_time) {
@@ -2517,12 +2697,15 @@ void HistoryBackend::KillHistoryDatabase() {
   // Rollback transaction because Raze() cannot be called from within a
   // transaction.
   db_->RollbackTransaction();
+  uncommitted_write_count_ = 0;
   bool success = db_->Raze();
   UMA_HISTOGRAM_BOOLEAN("History.KillHistoryDatabaseResult", success);
 
   // The expirer keeps tabs on the active databases. Tell it about the
-  // databases which will be closed.
+  // databases which will be closed. The visit IDs its incremental expirations
+  // read may be reused once the database is razed.
   expirer_.SetDatabases(nullptr, nullptr);
+  expirer_.CancelIncrementalExpirations();
 
   // Reopen a new transaction for `db_` for the sake of CloseAllDatabases().
   db_->BeginTransaction();
@@ -2608,6 +2791,10 @@ void HistoryBackend::DeleteAllHistory() {
   // compared to all history, this is also much faster than just deleting from
   // the original tables directly.
 
+  // The visits that incremental expirations read are all gone, and their IDs
+  // may be reused by new visits.
+  expirer_.CancelIncrementalExpirations();
+
   // Get the pinned URLs.
   std::vector<URLAndTitle> pinned_url;
   if (backend_client_)
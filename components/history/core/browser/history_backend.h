@@ -9,6 +9,7 @@
 #include <stdint.h>
 
 #include <list>
+#include <map>
 #include <memory>
 #include <set>
 #include <string>
@@ -27,10 +28,13 @@
 #include "base/single_thread_task_runner.h"
 #include "base/supports_user_data.h"
 #include "base/task/cancelable_task_tracker.h"
+#include "base/time/time.h"
 #include "build/build_config.h"
 #include "components/favicon/core/favicon_backend_delegate.h"
 #include "components/favicon/core/favicon_database.h"
 #include "components/favicon_base/favicon_usage_data.h"
+#include "components/history/core/browser/download_row.h"
+#include "components/history/core/browser/download_types.h"
 #include "components/history/core/browser/expire_history_backend.h"
 #include "components/history/core/browser/history_backend_notifier.h"
 #include "components/history/core/browser/history_types.h"
@@ -54,7 +58,6 @@ class ModelTypeControllerDelegate;
 }
 
 namespace history {
-struct DownloadRow;
 class HistoryBackendClient;
 class HistoryBackendDBBaseTest;
 class HistoryBackendObserver;
@@ -500,6 +503,18 @@ class HistoryBackend : public base::RefCountedThreadSafe<HistoryBackend>,
                             base::Time end_time,
                             bool user_initiated);
 
+  // Same as ExpireHistoryBetween(), but lets the expirer delete the visits in
+  // slices, committing each one. `callback` is posted to `origin_loop` once
+  // they are all deleted, unless `is_canceled`.
+  void ExpireHistoryBetweenIncrementally(
+      const std::set<GURL>& restrict_urls,
+      base::Time begin_time,
+      base::Time end_time,
+      bool user_initiated,
+      scoped_refptr<base::SingleThreadTaskRunner> origin_loop,
+      const base::CancelableTaskTracker::IsCanceledCallback& is_canceled,
+      base::OnceClosure callback);
+
   // Finds the URLs visited at `times` and expires all their visits within
   // [`begin_time`, `end_time`). All times in `times` should be in
   // [`begin_time`, `end_time`). This is used when expiration request is from
@@ -664,15 +679,48 @@ class HistoryBackend : public base::RefCountedThreadSafe<HistoryBackend>,
   // to write something to disk.
   void Commit();
 
+  // Fills the url_words table of a database migrated to version 46 a batch of
+  // URLs at a time, in delayed tasks.
+  void ScheduleURLWordsRebuildBatch();
+  void RebuildURLWordsBatch();
+
+  // Fills the domain_visits table a batch of visits at a time, in delayed
+  // tasks, after migration to version 47 or after keeping it up to date
+  // failed.
+  void ScheduleDomainVisitsRebuildBatch();
+  void RebuildDomainVisitsBatch();
+
   // Schedules a commit to happen in the future. We do this so that many
   // operations over a period of time will be batched together. If there is
   // already a commit scheduled for the future, this will do nothing.
+  //
+  // Each call counts as one write of the batch. With kHistoryWriteBatching,
+  // the commit happens within the latency budget of the first write, and as
+  // soon as the current task is done once the batch is full.
   void ScheduleCommit();
 
   // Cancels the scheduled commit, if any. If there is no scheduled commit,
   // does nothing.
   void CancelScheduledCommit();
 
+  // Writes the download updates UpdateDownload() held back, if any, and
+  // cancels their scheduled flush. Returns true if any was written.
+  bool WritePendingDownloadUpdates();
+
+  // Writes the download updates held back at the end of the coalescing window,
+  // and schedules their commit.
+  void FlushDownloadUpdates();
+
+  // Called by the expirer after each slice of an incremental expiration.
+  void OnExpirationSliceDone(size_t expired_visits);
+
+  // Called by the expirer once an incremental expiration is done. Posts
+  // `reply` to `origin_loop`.
+  void OnIncrementalExpirationDone(
+      base::Time begin_time,
+      scoped_refptr<base::SingleThreadTaskRunner> origin_loop,
+      base::OnceClosure reply);
+
   // Segments ------------------------------------------------------------------
 
   // Walks back a segment chain to find the last visit with a non null segment
@@ -780,6 +828,20 @@ class HistoryBackend : public base::RefCountedThreadSafe<HistoryBackend>,
   // one scheduled commit at a time (see ScheduleCommit).
   base::CancelableOnceClosure scheduled_commit_;
 
+  // The number of writes (see ScheduleCommit) since the last commit, and when
+  // the first of them was made.
+  int uncommitted_write_count_ = 0;
+  base::TimeTicks first_uncommitted_write_time_;
+
+  // Whether a RebuildDomainVisitsBatch() task is pending.
+  bool domain_visits_rebuild_scheduled_ = false;
+
+  // With kDownloadUpdateCoalescing, the latest progress update held back for
+  // each download in progress, and the task writing them at the end of the
+  // coalescing window.
+  std::map<DownloadId, DownloadRow> pending_download_updates_;
+  base::CancelableOnceClosure scheduled_download_updates_flush_;
+
   // Maps recent redirect destination pages to the chain of redirects that
   // brought us to there. Pages that did not have redirects or were not the
   // final redirect in a chain will not be in this list, as well as pages that
@@ -23,6 +23,7 @@
 
 #include <string>
 #include <unordered_set>
+#include <utility>
 
 #include "base/bind.h"
 #include "base/callback_helpers.h"
@@ -33,9 +34,11 @@
 #include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
 #include "base/strings/utf_string_conversions.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/time/time.h"
 #include "components/history/core/browser/download_constants.h"
 #include "components/history/core/browser/download_row.h"
+#include "components/history/core/browser/features.h"
 #include "components/history/core/browser/history_constants.h"
 #include "components/history/core/browser/history_database.h"
 #include "components/history/core/browser/keyword_search_term.h"
@@ -1330,6 +1333,144 @@ TEST_F(HistoryBackendDBTest, DownloadSliceDeletedIfEmpty) {
   EXPECT_EQ(0u, results[0].download_slice_info.size());
 }
 
+// Tests that updates of a download in progress, which only write the columns
+// and slices that changed, leave the same row as writing it whole.
+TEST_F(HistoryBackendDBTest, DownloadProgressUpdates) {
+  CreateBackendAndDatabase();
+
+  DownloadRow download;
+  download.current_path = base::FilePath(FILE_PATH_LITERAL("/path/1"));
+  download.target_path = base::FilePath(FILE_PATH_LITERAL("/path/2"));
+  download.url_chain.push_back(GURL("http://example.com/a"));
+  download.mime_type = "mime/type";
+  download.original_mime_type = "original/mime-type";
+  download.start_time = base::Time::Now();
+  download.received_bytes = 10;
+  download.total_bytes = 1500;
+  download.state = DownloadState::IN_PROGRESS;
+  download.danger_type = DownloadDangerType::NOT_DANGEROUS;
+  download.interrupt_reason = kTestDownloadInterruptReasonNone;
+  download.id = 1;
+  download.guid = "FE672168-26EF-4275-A149-FEC25F6A75F9";
+  download.download_slice_info.push_back(
+      DownloadSliceInfo(download.id, 0, download.received_bytes, false));
+  ASSERT_TRUE(db_->CreateDownload(download));
+  EXPECT_TRUE(db_->IsDownloadProgressUpdate(download));
+
+  std::vector<DownloadRow> results;
+  // Progress, with a new slice.
+  download.received_bytes = 30;
+  download.download_slice_info[0].received_bytes = 20;
+  download.download_slice_info.push_back(
+      DownloadSliceInfo(download.id, 750, 10, false));
+  EXPECT_TRUE(db_->IsDownloadProgressUpdate(download));
+  ASSERT_TRUE(db_->UpdateDownload(download));
+  db_->QueryDownloads(&results);
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(download, results[0]);
+
+  // A new total, and no change at all.
+  download.total_bytes = 2000;
+  ASSERT_TRUE(db_->UpdateDownload(download));
+  ASSERT_TRUE(db_->UpdateDownload(download));
+  db_->QueryDownloads(&results);
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(download, results[0]);
+
+  // A change of path while in progress.
+  download.target_path = base::FilePath(FILE_PATH_LITERAL("/path/3"));
+  EXPECT_FALSE(db_->IsDownloadProgressUpdate(download));
+  ASSERT_TRUE(db_->UpdateDownload(download));
+  db_->QueryDownloads(&results);
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(download, results[0]);
+
+  // Completion, and an update of the completed download.
+  download.received_bytes = 2000;
+  download.download_slice_info[0].received_bytes = 750;
+  download.download_slice_info[1].received_bytes = 1250;
+  download.download_slice_info[1].finished = true;
+  download.state = DownloadState::COMPLETE;
+  download.end_time = base::Time::Now();
+  EXPECT_FALSE(db_->IsDownloadProgressUpdate(download));
+  ASSERT_TRUE(db_->UpdateDownload(download));
+  download.opened = true;
+  EXPECT_FALSE(db_->IsDownloadProgressUpdate(download));
+  ASSERT_TRUE(db_->UpdateDownload(download));
+  db_->QueryDownloads(&results);
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(download, results[0]);
+}
+
+// Tests that with kDownloadUpdateCoalescing, the progress updates of a
+// download are held back until the end of the window, while its other updates
+// are written right away.
+TEST_F(HistoryBackendDBTest, DownloadUpdateCoalescing) {
+  base::test::ScopedFeatureList feature_list;
+  feature_list.InitAndEnableFeatureWithParameters(kDownloadUpdateCoalescing,
+                                                  {{"Window", "1h"}});
+  CreateBackendAndDatabase();
+
+  DownloadRow download;
+  download.current_path = base::FilePath(FILE_PATH_LITERAL("/path/1"));
+  download.target_path = base::FilePath(FILE_PATH_LITERAL("/path/2"));
+  download.url_chain.push_back(GURL("http://example.com/a"));
+  download.start_time = base::Time::Now();
+  download.received_bytes = 10;
+  download.total_bytes = 1500;
+  download.state = DownloadState::IN_PROGRESS;
+  download.danger_type = DownloadDangerType::NOT_DANGEROUS;
+  download.interrupt_reason = kTestDownloadInterruptReasonNone;
+  download.id = 1;
+  download.guid = "FE672168-26EF-4275-A149-FEC25F6A75F9";
+  ASSERT_TRUE(backend_->CreateDownload(download));
+
+  std::vector<DownloadRow> results;
+  download.received_bytes = 20;
+  backend_->UpdateDownload(download, false);
+  download.received_bytes = 30;
+  backend_->UpdateDownload(download, false);
+  db_->QueryDownloads(&results);
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(10, results[0].received_bytes);
+
+  // Reading the downloads through the backend writes the latest progress.
+  results = backend_->QueryDownloads();
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(download, results[0]);
+
+  // A change of state supersedes the progress held back.
+  download.received_bytes = 40;
+  backend_->UpdateDownload(download, false);
+  download.received_bytes = 50;
+  download.state = DownloadState::INTERRUPTED;
+  download.interrupt_reason = kTestDownloadInterruptReasonCrash;
+  backend_->UpdateDownload(download, false);
+  db_->QueryDownloads(&results);
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(download, results[0]);
+
+  // Resuming is written right away too, and so is the progress to commit
+  // immediately.
+  download.state = DownloadState::IN_PROGRESS;
+  download.interrupt_reason = kTestDownloadInterruptReasonNone;
+  backend_->UpdateDownload(download, false);
+  download.received_bytes = 60;
+  backend_->UpdateDownload(download, true);
+  db_->QueryDownloads(&results);
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(download, results[0]);
+
+  // Progress held back is written when the backend shuts down.
+  download.received_bytes = 70;
+  backend_->UpdateDownload(download, false);
+  DeleteBackend();
+  CreateBackendAndDatabase();
+  db_->QueryDownloads(&results);
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(70, results[0].received_bytes);
+}
+
 TEST_F(HistoryBackendDBTest, MigratePresentations) {
   // Create the db we want. Use 22 since segments didn't change in that time
   // frame.
@@ -1953,6 +2094,121 @@ TEST_F(HistoryBackendDBTest, MigrateReplaceClusterVisitsTable) {
   }
 }
 
+// Tests that the url_words table is filled in batches after migration to
+// version 46, and that text matches are found meanwhile.
+TEST_F(HistoryBackendDBTest, MigrateURLWords) {
+  ASSERT_NO_FATAL_FAILURE(CreateDBVersion(45));
+
+  const URLID url_id = 12;
+  {
+    sql::Database db;
+    ASSERT_TRUE(db.Open(history_dir_.Append(kHistoryFilename)));
+    sql::Statement s(db.GetUniqueStatement(
+        "INSERT INTO urls (id, url, title, last_visit_time) "
+        "VALUES (?, ?, ?, ?)"));
+    s.BindInt64(0, url_id);
+    s.BindString(1, "https://www.example.com/recipes");
+    s.BindString16(2, u"Weekly News");
+    s.BindInt64(3, 1);
+    ASSERT_TRUE(s.Run());
+  }
+
+  // Re-open the db, triggering migration.
+  CreateBackendAndDatabase();
+
+  // The version should have been updated.
+  ASSERT_GE(HistoryDatabase::GetCurrentVersion(), 46);
+
+  ASSERT_TRUE(db_->NeedsURLWordsRebuild());
+  URLRows results;
+  ASSERT_TRUE(db_->GetTextMatches(u"week recip", &results));
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(url_id, results[0].id());
+
+  // Once the rebuild is done, the matches are found through the url_words
+  // table.
+  ASSERT_TRUE(db_->RebuildURLWordsBatch(100));
+  EXPECT_FALSE(db_->NeedsURLWordsRebuild());
+  ASSERT_TRUE(db_->GetTextMatches(u"week recip", &results));
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(url_id, results[0].id());
+}
+
+// Tests that the domain_visits table is filled in batches after migration to
+// version 47.
+TEST_F(HistoryBackendDBTest, MigrateDomainVisits) {
+  ASSERT_NO_FATAL_FAILURE(CreateDBVersion(46));
+
+  const base::Time today = base::Time::Now().LocalMidnight();
+  {
+    sql::Database db;
+    ASSERT_TRUE(db.Open(history_dir_.Append(kHistoryFilename)));
+    ASSERT_TRUE(db.Execute(
+        "INSERT INTO urls (id, url, last_visit_time) VALUES "
+        "(1, 'https://www.example.com/', 1),"
+        "(2, 'https://mail.example.com/', 1),"
+        "(3, 'https://www.other.com/frame', 1)"));
+    sql::Statement s(db.GetUniqueStatement(
+        "INSERT INTO visits (url, visit_time, transition) VALUES (?, ?, ?)"));
+    const std::pair<URLID, ui::PageTransition> visits[] = {
+        {1, ui::PAGE_TRANSITION_LINK},
+        {2, ui::PAGE_TRANSITION_TYPED},
+        {3, ui::PAGE_TRANSITION_AUTO_SUBFRAME}};
+    for (const auto& visit : visits) {
+      s.BindInt64(0, visit.first);
+      s.BindInt64(
+          1, (today + base::TimeDelta::FromHours(1)).ToInternalValue());
+      s.BindInt64(2, visit.second | ui::PAGE_TRANSITION_CHAIN_END);
+      ASSERT_TRUE(s.Run());
+      s.Reset(true);
+    }
+  }
+
+  // Re-open the db, triggering migration.
+  CreateBackendAndDatabase();
+
+  // The version should have been updated.
+  ASSERT_GE(HistoryDatabase::GetCurrentVersion(), 47);
+
+  // Until the table is filled, the visits are counted one by one.
+  const base::Time tomorrow =
+      (today + base::TimeDelta::FromHours(36)).LocalMidnight();
+  ASSERT_TRUE(db_->NeedsDomainVisitsRebuild());
+  int count = 0;
+  EXPECT_FALSE(db_->CountDomainsVisitedOnDays(today, tomorrow, &count));
+  EXPECT_EQ(1, db_->CountUniqueDomainsVisited(today, tomorrow));
+
+  ASSERT_TRUE(db_->RebuildDomainVisitsBatch(100));
+  EXPECT_FALSE(db_->NeedsDomainVisitsRebuild());
+  ASSERT_TRUE(db_->CountDomainsVisitedOnDays(today, tomorrow, &count));
+  EXPECT_EQ(1, count);
+}
+
+// Tests that visits_time_index is replaced by visits_time_url_transition_index
+// during migration to version 49.
+TEST_F(HistoryBackendDBTest, MigrateVisitsTimeIndex) {
+  ASSERT_NO_FATAL_FAILURE(CreateDBVersion(44));
+
+  sql::Database db;
+  ASSERT_TRUE(db.Open(history_dir_.Append(kHistoryFilename)));
+  ASSERT_TRUE(db.DoesIndexExist("visits_time_index"));
+  ASSERT_FALSE(db.DoesIndexExist("visits_time_url_transition_index"));
+
+  // Re-open the db, triggering migration.
+  CreateBackendAndDatabase();
+
+  // The version should have been updated.
+  ASSERT_GE(HistoryDatabase::GetCurrentVersion(), 49);
+
+  EXPECT_FALSE(db.DoesIndexExist("visits_time_index"));
+  EXPECT_TRUE(db.DoesIndexExist("visits_time_url_transition_index"));
+
+  // Opening the migrated db again doesn't bring the old index back.
+  DeleteBackend();
+  CreateBackendAndDatabase();
+  EXPECT_FALSE(db.DoesIndexExist("visits_time_index"));
+}
+
 // Tests that the migration code correctly replaces the lower_term column in the
 // keyword search terms table which normalized_term which contains the
 // normalized search term during migration to version 42.
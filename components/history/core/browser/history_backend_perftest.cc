@@ -0,0 +1,274 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "components/history/core/browser/history_backend.h"
+
+#include <stdint.h>
+
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/memory/scoped_refptr.h"
+#include "base/run_loop.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/stringprintf.h"
+#include "base/strings/utf_string_conversions.h"
+#include "base/test/metrics/histogram_tester.h"
+#include "base/test/scoped_feature_list.h"
+#include "base/test/task_environment.h"
+#include "base/threading/thread_task_runner_handle.h"
+#include "base/time/time.h"
+#include "base/time/time_override.h"
+#include "base/timer/elapsed_timer.h"
+#include "components/history/core/browser/download_row.h"
+#include "components/history/core/browser/download_slice_info.h"
+#include "components/history/core/browser/download_types.h"
+#include "components/history/core/browser/features.h"
+#include "components/history/core/browser/history_types.h"
+#include "components/history/core/browser/in_memory_history_backend.h"
+#include "components/history/core/test/test_history_database.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "ui/base/page_transition_types.h"
+#include "url/gurl.h"
+
+namespace history {
+
+namespace {
+
+constexpr char kMetricPrefixHistoryBackend[] = "HistoryBackend.";
+constexpr char kMetricPagesPerSecond[] = "pages_per_second";
+constexpr char kMetricCommitCount[] = "commit_count";
+constexpr char kMetricDownloadUpdatesPerSecond[] =
+    "download_updates_per_second";
+
+constexpr int kPageCount = 10000;
+
+// Parallel downloads of two slices each, reporting their progress ten times a
+// second for half a minute.
+constexpr int kDownloadCount = 200;
+constexpr int kDownloadUpdateIntervalMs = 100;
+constexpr int kDownloadUpdateRounds = 300;
+constexpr int64_t kSliceBytesPerUpdate = 64 * 1024;
+constexpr int64_t kSecondSliceOffset = int64_t{1} << 30;
+
+perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixHistoryBackend,
+                                         story_name);
+  reporter.RegisterImportantMetric(kMetricPagesPerSecond, "count");
+  reporter.RegisterImportantMetric(kMetricCommitCount, "count");
+  reporter.RegisterImportantMetric(kMetricDownloadUpdatesPerSecond, "count");
+  return reporter;
+}
+
+// Drops all notifications.
+class NullDelegate : public HistoryBackend::Delegate {
+ public:
+  NullDelegate() = default;
+  NullDelegate(const NullDelegate&) = delete;
+  NullDelegate& operator=(const NullDelegate&) = delete;
+
+  void NotifyProfileError(sql::InitStatus init_status,
+                          const std::string& diagnostics) override {}
+  void SetInMemoryBackend(
+      std::unique_ptr<InMemoryHistoryBackend> backend) override {}
+  void NotifyFaviconsChanged(const std::set<GURL>& page_urls,
+                             const GURL& icon_url) override {}
+  void NotifyURLVisited(ui::PageTransition transition,
+                        const URLRow& row,
+                        const RedirectList& redirects,
+                        base::Time visit_time) override {}
+  void NotifyURLsModified(const URLRows& changed_urls) override {}
+  void NotifyURLsDeleted(DeletionInfo deletion_info) override {}
+  void NotifyKeywordSearchTermUpdated(const URLRow& row,
+                                      KeywordID keyword_id,
+                                      const std::u16string& term) override {}
+  void NotifyKeywordSearchTermDeleted(URLID url_id) override {}
+  void DBLoaded() override {}
+};
+
+// Measures how many page loads the backend records per second, as automation
+// loading pages in bulk would make it: each load adds a page, sets its title
+// and then its end time, in separate tasks.
+class HistoryBackendPerfTest : public testing::Test {
+ public:
+  HistoryBackendPerfTest() = default;
+
+ protected:
+  void SetUp() override { ASSERT_TRUE(temp_dir_.CreateUniqueTempDir()); }
+
+  void RunTest(const std::string& story_name) {
+    auto backend = base::MakeRefCounted<HistoryBackend>(
+        std::make_unique<NullDelegate>(), /*backend_client=*/nullptr,
+        base::ThreadTaskRunnerHandle::Get());
+    backend->Init(false, TestHistoryDatabaseParamsForPath(temp_dir_.GetPath()));
+    base::RunLoop().RunUntilIdle();
+
+    base::HistogramTester histogram_tester;
+    const ContextID context_id = reinterpret_cast<ContextID>(1);
+    const base::Time now = base::Time::Now();
+    base::ElapsedTimer timer;
+    for (int i = 0; i < kPageCount; ++i) {
+      const GURL url(base::StringPrintf("https://www.site%d.com/page/%d",
+                                        i % 500, i));
+      const base::Time visit_time = now + base::TimeDelta::FromSeconds(i);
+      backend->AddPage(HistoryAddPageArgs(
+          url, visit_time, context_id, i, GURL(), {url},
+          ui::PAGE_TRANSITION_LINK, false, SOURCE_BROWSED, false, true, false));
+      base::RunLoop().RunUntilIdle();
+      backend->SetPageTitle(
+          url, base::ASCIIToUTF16(base::StringPrintf("Page %d", i)));
+      base::RunLoop().RunUntilIdle();
+      backend->UpdateWithPageEndTime(
+          context_id, i, url, visit_time + base::TimeDelta::FromSeconds(1));
+      base::RunLoop().RunUntilIdle();
+    }
+    // Deleting the backend commits the last batch.
+    backend->Closing();
+    backend = nullptr;
+    base::RunLoop().RunUntilIdle();
+    const base::TimeDelta elapsed = timer.Elapsed();
+
+    auto reporter = SetUpReporter(story_name);
+    reporter.AddResult(kMetricPagesPerSecond,
+                       kPageCount / elapsed.InSecondsF());
+    reporter.AddResult(kMetricCommitCount,
+                       static_cast<size_t>(
+                           histogram_tester
+                               .GetHistogramSamplesSinceCreation(
+                                   "History.CommitBatchSize")
+                               ->TotalCount()));
+  }
+
+  void EnableWriteBatching(int max_batch_size) {
+    feature_list_.InitAndEnableFeatureWithParameters(
+        kHistoryWriteBatching,
+        {{"LatencyBudget", "10s"},
+         {"MaxBatchSize", base::NumberToString(max_batch_size)}});
+  }
+
+ private:
+  base::test::TaskEnvironment task_environment_;
+  base::test::ScopedFeatureList feature_list_;
+  base::ScopedTempDir temp_dir_;
+};
+
+// Measures how many download updates the backend handles per second, as
+// DownloadHistory sends them for many parallel downloads. Time is mocked so
+// that the coalescing window and the commit timer go by at the pace of the
+// updates, while the elapsed time is measured on the real clock.
+class HistoryBackendDownloadsPerfTest : public testing::Test {
+ public:
+  HistoryBackendDownloadsPerfTest() = default;
+
+ protected:
+  void SetUp() override { ASSERT_TRUE(temp_dir_.CreateUniqueTempDir()); }
+
+  void RunTest(const std::string& story_name) {
+    auto backend = base::MakeRefCounted<HistoryBackend>(
+        std::make_unique<NullDelegate>(), /*backend_client=*/nullptr,
+        base::ThreadTaskRunnerHandle::Get());
+    backend->Init(false, TestHistoryDatabaseParamsForPath(temp_dir_.GetPath()));
+    base::RunLoop().RunUntilIdle();
+
+    std::vector<DownloadRow> downloads(kDownloadCount);
+    for (int i = 0; i < kDownloadCount; ++i) {
+      DownloadRow& download = downloads[i];
+      download.id = i + 1;
+      download.guid =
+          base::StringPrintf("%08X-26EF-4275-A149-FEC25F6A75F9", i + 1);
+      download.url_chain.push_back(
+          GURL(base::StringPrintf("https://www.site%d.com/file.zip", i)));
+      download.current_path = base::FilePath(
+          FILE_PATH_LITERAL("/downloads/file.zip.crdownload"));
+      download.target_path =
+          base::FilePath(FILE_PATH_LITERAL("/downloads/file.zip"));
+      download.start_time = base::Time::Now();
+      download.total_bytes = 2 * kSecondSliceOffset;
+      download.state = DownloadState::IN_PROGRESS;
+      download.danger_type = DownloadDangerType::NOT_DANGEROUS;
+      download.download_slice_info.push_back(
+          DownloadSliceInfo(download.id, 0, 0, false));
+      download.download_slice_info.push_back(
+          DownloadSliceInfo(download.id, kSecondSliceOffset, 0, false));
+      ASSERT_TRUE(backend->CreateDownload(download));
+    }
+
+    const base::TimeTicks start_time =
+        base::subtle::TimeTicksNowIgnoringOverride();
+    for (int round = 0; round < kDownloadUpdateRounds; ++round) {
+      for (DownloadRow& download : downloads) {
+        download.received_bytes += 2 * kSliceBytesPerUpdate;
+        download.download_slice_info[0].received_bytes += kSliceBytesPerUpdate;
+        download.download_slice_info[1].received_bytes += kSliceBytesPerUpdate;
+        backend->UpdateDownload(download, false);
+      }
+      task_environment_.FastForwardBy(
+          base::TimeDelta::FromMilliseconds(kDownloadUpdateIntervalMs));
+    }
+    for (DownloadRow& download : downloads) {
+      download.state = DownloadState::COMPLETE;
+      download.end_time = base::Time::Now();
+      backend->UpdateDownload(download, false);
+    }
+    // Deleting the backend commits the last batch.
+    backend->Closing();
+    backend = nullptr;
+    base::RunLoop().RunUntilIdle();
+    const base::TimeDelta elapsed =
+        base::subtle::TimeTicksNowIgnoringOverride() - start_time;
+
+    SetUpReporter(story_name)
+        .AddResult(kMetricDownloadUpdatesPerSecond,
+                   kDownloadCount * (kDownloadUpdateRounds + 1) /
+                       elapsed.InSecondsF());
+  }
+
+  void EnableDownloadUpdateCoalescing() {
+    feature_list_.InitAndEnableFeatureWithParameters(kDownloadUpdateCoalescing,
+                                                     {{"Window", "1s"}});
+  }
+
+ private:
+  base::test::TaskEnvironment task_environment_{
+      base::test::TaskEnvironment::TimeSource::MOCK_TIME};
+  base::test::ScopedFeatureList feature_list_;
+  base::ScopedTempDir temp_dir_;
+};
+
+}  // namespace
+
+TEST_F(HistoryBackendPerfTest, CommitTimer) {
+  RunTest("10k_pages_commit_timer");
+}
+
+TEST_F(HistoryBackendPerfTest, CommitEachWrite) {
+  EnableWriteBatching(1);
+  RunTest("10k_pages_commit_each_write");
+}
+
+TEST_F(HistoryBackendPerfTest, BatchOf100Writes) {
+  EnableWriteBatching(100);
+  RunTest("10k_pages_batch_100");
+}
+
+TEST_F(HistoryBackendPerfTest, BatchOf1000Writes) {
+  EnableWriteBatching(1000);
+  RunTest("10k_pages_batch_1000");
+}
+
+TEST_F(HistoryBackendDownloadsPerfTest, EachUpdate) {
+  RunTest("200_downloads_each_update");
+}
+
+TEST_F(HistoryBackendDownloadsPerfTest, Coalesced) {
+  EnableDownloadUpdateCoalescing();
+  RunTest("200_downloads_coalesced");
+}
+
+}  // namespace history
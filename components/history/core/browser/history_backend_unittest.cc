@@ -31,11 +31,13 @@
 #include "base/strings/utf_string_conversions.h"
 #include "base/test/gtest_util.h"
 #include "base/test/metrics/histogram_tester.h"
+#include "base/test/scoped_feature_list.h"
 #include "base/test/task_environment.h"
 #include "base/threading/thread_task_runner_handle.h"
 #include "build/build_config.h"
 #include "components/favicon/core/favicon_backend.h"
 #include "components/favicon_base/favicon_usage_data.h"
+#include "components/history/core/browser/features.h"
 #include "components/history/core/browser/history_backend_client.h"
 #include "components/history/core/browser/history_constants.h"
 #include "components/history/core/browser/history_database_params.h"
@@ -161,6 +163,7 @@ class TestHistoryBackend : public HistoryBackend {
  public:
   using HistoryBackend::AddPageVisit;
   using HistoryBackend::AnnotatedVisitsFromRows;
+  using HistoryBackend::Commit;
   using HistoryBackend::DeleteAllHistory;
   using HistoryBackend::DeleteFTSIndexDatabases;
   using HistoryBackend::HistoryBackend;
@@ -3368,4 +3371,33 @@ TEST_F(HistoryBackendTest, ExpireVisitDeletes) {
                    context_id, navigation_entry_id, url));
 }
 
+// Tests that with kHistoryWriteBatching, a full batch of writes is committed
+// right away, while a partial one waits for the latency budget.
+TEST_F(HistoryBackendTest, WriteBatchingCommitsFullBatch) {
+  ASSERT_TRUE(backend_);
+  base::test::ScopedFeatureList feature_list;
+  feature_list.InitAndEnableFeatureWithParameters(
+      kHistoryWriteBatching, {{"LatencyBudget", "1h"}, {"MaxBatchSize", "3"}});
+  backend_->Commit();
+  base::HistogramTester histogram_tester;
+
+  const char* chain1[] = {"http://one.com/", nullptr};
+  const char* chain2[] = {"http://two.com/", nullptr};
+  const char* chain3[] = {"http://three.com/", nullptr};
+  AddRedirectChain(chain1, 0);
+  AddRedirectChain(chain2, 0);
+  base::RunLoop().RunUntilIdle();
+  histogram_tester.ExpectTotalCount("History.CommitBatchSize", 0);
+
+  AddRedirectChain(chain3, 0);
+  base::RunLoop().RunUntilIdle();
+  histogram_tester.ExpectUniqueSample("History.CommitBatchSize", 3, 1);
+  histogram_tester.ExpectTotalCount("History.CommitTime", 1);
+  histogram_tester.ExpectTotalCount("History.CommitLatency", 1);
+
+  backend_->SetPageTitle(GURL("http://one.com/"), u"One");
+  base::RunLoop().RunUntilIdle();
+  histogram_tester.ExpectTotalCount("History.CommitBatchSize", 1);
+}
+
 }  // namespace history
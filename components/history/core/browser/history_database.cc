@@ -37,9 +37,16 @@ namespace {
 // Current version number. We write databases at the "current" version number,
 // but any previous version that can read the "compatible" one can make do with
 // our database without *too* many bad effects.
-const int kCurrentVersionNumber = 45;
+const int kCurrentVersionNumber = 49;
 const int kCompatibleVersionNumber = 16;
 const char kEarlyExpirationThresholdKey[] = "early_expiration_threshold";
+// The ID of the last URL whose words were indexed, while the url_words table is
+// filled in batches after migration to version 46.
+const char kURLWordsRebuildPositionKey[] = "url_words_rebuild_position";
+// The ID of the last visit counted in the domain_visits table, while it is
+// filled in batches after migration to version 47 or after keeping it up to
+// date failed.
+const char kDomainVisitsRebuildPositionKey[] = "domain_visits_rebuild_position";
 
 // Logs a migration failure to UMA and logging. The return value will be
 // what to return from ::Init (to simplify the call sites). Migration failures
@@ -124,6 +131,8 @@ sql::InitStatus HistoryDatabase::Init(const base::FilePath& history_name) {
       !InitSegmentTables() || !InitSyncTable() || !InitVisitAnnotationsTables())
     return LogInitFailure(InitStep::CREATE_TABLES);
   CreateMainURLIndex();
+  if (!InitURLSearchIndices() || !InitDomainVisitsTable())
+    return LogInitFailure(InitStep::CREATE_TABLES);
 
   // TODO(benjhayden) Remove at some point.
   meta_table_.DeleteKey("next_download_id");
@@ -134,6 +143,11 @@ sql::InitStatus HistoryDatabase::Init(const base::FilePath& history_name) {
     LogInitFailure(InitStep::VERSION);
     return version_status;
   }
+  if (NeedsURLWordsRebuild())
+    set_url_words_incomplete();
+  int64_t last_visit_id;
+  if (meta_table_.GetValue(kDomainVisitsRebuildPositionKey, &last_visit_id))
+    set_domain_visits_incomplete(last_visit_id);
 
   if (!committer.Commit())
     return LogInitFailure(InitStep::COMMIT);
@@ -246,6 +260,12 @@ int HistoryDatabase::CountUniqueHostsVisitedLastMonth() {
 
 int HistoryDatabase::CountUniqueDomainsVisited(base::Time begin_time,
                                                base::Time end_time) {
+  // Whole days are counted from the per-day domain visits, without looking at
+  // every visit.
+  int count = 0;
+  if (CountDomainsVisitedOnDays(begin_time, end_time, &count))
+    return count;
+
   sql::Statement url_sql(db_.GetUniqueStatement(
       "SELECT urls.url FROM urls JOIN visits "
       "WHERE urls.id = visits.url "
@@ -308,7 +328,7 @@ void HistoryDatabase::RollbackTransaction() {
 bool HistoryDatabase::RecreateAllTablesButURL() {
   if (!DropVisitTable())
     return false;
-  if (!InitVisitTable())
+  if (!InitVisitTable() || !InitDomainVisitsTable())
     return false;
 
   if (!DropKeywordSearchTermsTable())
@@ -389,6 +409,41 @@ void HistoryDatabase::UpdateEarlyExpirationThreshold(base::Time threshold) {
   cached_early_expiration_threshold_ = threshold;
 }
 
+bool HistoryDatabase::NeedsURLWordsRebuild() {
+  int64_t last_url_id;
+  return meta_table_.GetValue(kURLWordsRebuildPositionKey, &last_url_id);
+}
+
+bool HistoryDatabase::RebuildURLWordsBatch(int max_rows) {
+  int64_t last_url_id;
+  if (!meta_table_.GetValue(kURLWordsRebuildPositionKey, &last_url_id))
+    return true;
+  bool done = false;
+  if (!IndexURLWordsBatch(max_rows, &last_url_id, &done))
+    return false;
+  return done ? meta_table_.DeleteKey(kURLWordsRebuildPositionKey)
+              : meta_table_.SetValue(kURLWordsRebuildPositionKey, last_url_id);
+}
+
+bool HistoryDatabase::NeedsDomainVisitsRebuild() {
+  return !domain_visits_complete();
+}
+
+bool HistoryDatabase::RebuildDomainVisitsBatch(int max_visits) {
+  if (!CountDomainVisitsBatch(max_visits))
+    return false;
+  return domain_visits_complete()
+             ? meta_table_.DeleteKey(kDomainVisitsRebuildPositionKey)
+             : meta_table_.SetValue(kDomainVisitsRebuildPositionKey,
+                                    domain_visits_last_visit_id());
+}
+
+void HistoryDatabase::OnDomainVisitsRebuildNeeded() {
+  // Recorded so that the rebuild also resumes after a restart.
+  ignore_result(
+      meta_table_.SetValue(kDomainVisitsRebuildPositionKey, int64_t{0}));
+}
+
 sql::Database& HistoryDatabase::GetDB() {
   return db_;
 }
@@ -643,6 +698,41 @@ sql::InitStatus HistoryDatabase::EnsureCurrentVersion() {
     meta_table_.SetVersionNumber(cur_version);
   }
 
+  if (cur_version == 45) {
+    // The url_words table was created empty by Init(). It is filled by
+    // RebuildURLWordsBatch() after init rather than here, as the URLs table
+    // may be large.
+    if (!meta_table_.SetValue(kURLWordsRebuildPositionKey, int64_t{0}))
+      return LogMigrationFailure(45);
+    cur_version++;
+    meta_table_.SetVersionNumber(cur_version);
+  }
+
+  if (cur_version == 46) {
+    // The domain_visits table was created empty by Init(). It is filled by
+    // RebuildDomainVisitsBatch() after init rather than here, as the visits
+    // table may be large.
+    if (!meta_table_.SetValue(kDomainVisitsRebuildPositionKey, int64_t{0}))
+      return LogMigrationFailure(46);
+    cur_version++;
+    meta_table_.SetVersionNumber(cur_version);
+  }
+
+  if (cur_version == 47) {
+    // The normalized_keyword_search_terms table was created empty by Init().
+    if (!RebuildNormalizedKeywordSearchTerms())
+      return LogMigrationFailure(47);
+    cur_version++;
+    meta_table_.SetVersionNumber(cur_version);
+  }
+
+  if (cur_version == 48) {
+    if (!MigrateVisitsTimeIndex())
+      return LogMigrationFailure(48);
+    cur_version++;
+    meta_table_.SetVersionNumber(cur_version);
+  }
+
   // =========================       ^^ new migration code goes here ^^
   // ADDING NEW MIGRATION CODE
   // =========================
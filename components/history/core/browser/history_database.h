@@ -91,7 +91,10 @@ class HistoryDatabase : public DownloadDatabase,
   int CountUniqueHostsVisitedLastMonth();
 
   // Counts the number of unique domains (eLTD+1) visited within
-  // [`begin_time`, `end_time`).
+  // [`begin_time`, `end_time`). When both are local midnights, the count comes
+  // from the per-day domain visits, which unlike a scan of the visits do not
+  // look at whether the URLs are hidden; the visits that count are main frame
+  // ones, whose URLs are never hidden.
   int CountUniqueDomainsVisited(base::Time begin_time, base::Time end_time);
 
   // Call to set the mode on the database to exclusive. The default locking mode
@@ -164,6 +167,22 @@ class HistoryDatabase : public DownloadDatabase,
   virtual base::Time GetEarlyExpirationThreshold();
   virtual void UpdateEarlyExpirationThreshold(base::Time threshold);
 
+  // Whether the url_words table is still being filled after migration to
+  // version 46.
+  bool NeedsURLWordsRebuild();
+
+  // Indexes the words of up to `max_rows` more URLs while
+  // NeedsURLWordsRebuild(). Returns false on failure.
+  bool RebuildURLWordsBatch(int max_rows);
+
+  // Whether the domain_visits table is still being filled, after migration to
+  // version 47 or after keeping it up to date failed.
+  bool NeedsDomainVisitsRebuild();
+
+  // Counts up to `max_visits` more visits into the domain_visits table while
+  // NeedsDomainVisitsRebuild(). Returns false on failure.
+  bool RebuildDomainVisitsBatch(int max_visits);
+
  private:
 #if defined(OS_ANDROID)
   // AndroidProviderBackend uses the `db_`.
@@ -179,6 +198,9 @@ class HistoryDatabase : public DownloadDatabase,
   // Overridden from TypedURLSyncMetadataDatabase.
   sql::MetaTable& GetMetaTable() override;
 
+  // Overridden from VisitDatabase.
+  void OnDomainVisitsRebuildNeeded() override;
+
   // Migration -----------------------------------------------------------------
 
   // Makes sure the version is up to date, updating if necessary. If the
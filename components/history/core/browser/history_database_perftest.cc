@@ -0,0 +1,125 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "components/history/core/browser/history_database.h"
+
+#include <stdint.h>
+
+#include <string>
+
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "components/history/core/browser/history_constants.h"
+#include "components/history/core/browser/history_types.h"
+#include "components/history/core/test/test_history_database.h"
+#include "sql/init_status.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "ui/base/page_transition_types.h"
+#include "url/gurl.h"
+
+namespace history {
+
+namespace {
+
+constexpr char kMetricPrefixHistoryDatabase[] = "HistoryDatabase.";
+constexpr char kMetricDomainDiversityTime[] = "domain_diversity_time";
+
+// Two months of history, as a heavy user would have it.
+constexpr int kDays = 60;
+constexpr int kVisitsPerDay = 2000;
+constexpr int kURLCount = 20000;
+constexpr int kDomainCount = 500;
+
+// What HistoryBackend::GetDomainDiversity() counts for a weekly report.
+constexpr int kReportedDays = 7;
+constexpr int kMetricDays[] = {1, 7, 28};
+
+perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixHistoryDatabase,
+                                         story_name);
+  reporter.RegisterImportantMetric(kMetricDomainDiversityTime, "ms");
+  return reporter;
+}
+
+// Measures counting the domains visited for the domain diversity metrics.
+class HistoryDatabasePerfTest : public testing::Test {
+ public:
+  HistoryDatabasePerfTest() = default;
+
+ protected:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    ASSERT_EQ(sql::INIT_OK,
+              db_.Init(temp_dir_.GetPath().Append(kHistoryFilename)));
+    PopulateDatabase();
+  }
+
+  void PopulateDatabase() {
+    db_.BeginTransaction();
+    const base::Time first_day =
+        (now_ - base::TimeDelta::FromDays(kDays)).LocalMidnight();
+    for (int i = 0; i < kURLCount; ++i) {
+      URLRow row(GURL(base::StringPrintf("https://www.site%d.com/page%d",
+                                         i % kDomainCount, i)));
+      row.set_last_visit(now_);
+      ASSERT_TRUE(db_.AddURL(row));
+    }
+    for (int i = 0; i < kDays * kVisitsPerDay; ++i) {
+      VisitRow visit(
+          1 + i % kURLCount,
+          first_day + base::TimeDelta::FromSeconds(int64_t{i} * 24 * 60 * 60 /
+                                                   kVisitsPerDay),
+          0,
+          ui::PageTransitionFromInt(ui::PAGE_TRANSITION_LINK |
+                                    ui::PAGE_TRANSITION_CHAIN_END),
+          0, false, false);
+      ASSERT_TRUE(db_.AddVisit(&visit, SOURCE_BROWSED));
+    }
+    db_.CommitTransaction();
+  }
+
+  // Counts the domains of a weekly report, over ranges which end `offset`
+  // after midnight.
+  void RunTest(base::TimeDelta offset, const std::string& story_name) {
+    base::ElapsedTimer timer;
+    base::Time end_time = now_.LocalMidnight();
+    for (int day = 0; day < kReportedDays; ++day) {
+      for (int metric_days : kMetricDays) {
+        const base::Time begin_time =
+            (end_time - base::TimeDelta::FromDays(metric_days) +
+             base::TimeDelta::FromHours(4))
+                .LocalMidnight();
+        EXPECT_LT(0, db_.CountUniqueDomainsVisited(begin_time + offset,
+                                                   end_time + offset));
+      }
+      end_time = (end_time - base::TimeDelta::FromHours(20)).LocalMidnight();
+    }
+    const base::TimeDelta elapsed = timer.Elapsed();
+
+    SetUpReporter(story_name)
+        .AddResult(kMetricDomainDiversityTime, elapsed.InMillisecondsF());
+  }
+
+ private:
+  base::ScopedTempDir temp_dir_;
+  TestHistoryDatabase db_;
+  const base::Time now_ = base::Time::Now();
+};
+
+}  // namespace
+
+// Ranges starting past midnight count every visit, as all ranges did before
+// the per-day domain visits.
+TEST_F(HistoryDatabasePerfTest, DomainDiversityScan) {
+  RunTest(base::TimeDelta::FromMicroseconds(1), "domain_diversity_scan");
+}
+
+TEST_F(HistoryDatabasePerfTest, DomainDiversityPerDay) {
+  RunTest(base::TimeDelta(), "domain_diversity_per_day");
+}
+
+}  // namespace history
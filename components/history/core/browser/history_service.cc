@@ -23,6 +23,7 @@
 #include "base/callback_helpers.h"
 #include "base/command_line.h"
 #include "base/compiler_specific.h"
+#include "base/feature_list.h"
 #include "base/location.h"
 #include "base/logging.h"
 #include "base/memory/ref_counted.h"
@@ -36,6 +37,7 @@
 #include "base/trace_event/trace_event.h"
 #include "build/build_config.h"
 #include "components/history/core/browser/download_row.h"
+#include "components/history/core/browser/features.h"
 #include "components/history/core/browser/history_backend.h"
 #include "components/history/core/browser/history_backend_client.h"
 #include "components/history/core/browser/history_client.h"
@@ -1165,6 +1167,17 @@ void HistoryService::ExpireHistoryBetween(
     base::CancelableTaskTracker* tracker) {
   DCHECK(backend_task_runner_) << "History service being called after cleanup";
   DCHECK_CALLED_ON_VALID_SEQUENCE(sequence_checker_);
+  if (base::FeatureList::IsEnabled(kHistoryIncrementalExpiration)) {
+    base::CancelableTaskTracker::IsCanceledCallback is_canceled;
+    tracker->NewTrackedTaskId(&is_canceled);
+    backend_task_runner_->PostTask(
+        FROM_HERE,
+        base::BindOnce(&HistoryBackend::ExpireHistoryBetweenIncrementally,
+                       history_backend_, restrict_urls, begin_time, end_time,
+                       user_initiated, base::ThreadTaskRunnerHandle::Get(),
+                       is_canceled, std::move(callback)));
+    return;
+  }
   tracker->PostTaskAndReply(
       backend_task_runner_.get(), FROM_HERE,
       base::BindOnce(&HistoryBackend::ExpireHistoryBetween, history_backend_,
@@ -116,6 +116,13 @@ bool InMemoryDatabase::InitFromDisk(const base::FilePath& history_name) {
   }
   UMA_HISTOGRAM_COUNTS_1M("History.InMemoryDBKeywordTermsCount",
                           db_.GetLastChangeCount());
+  if (!db_.Execute(
+          "INSERT INTO normalized_keyword_search_terms SELECT * FROM "
+          "history.normalized_keyword_search_terms")) {
+    // The history database may predate the table, in which case the copied
+    // search terms are ranked here instead.
+    RebuildNormalizedKeywordSearchTerms();
+  }
 
   // Detach from the history database on disk.
   if (!db_.Execute("DETACH history")) {
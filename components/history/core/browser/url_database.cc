@@ -4,8 +4,11 @@
 
 #include "components/history/core/browser/url_database.h"
 
+#include <algorithm>
+#include <iterator>
 #include <limits>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/i18n/case_conversion.h"
@@ -23,6 +26,32 @@ namespace history {
 
 const char URLDatabase::kURLRowFields[] = HISTORY_URL_ROW_FIELDS;
 const int URLDatabase::kNumURLRowFields = 9;
+const size_t URLDatabase::kMaxURLIDsPerQueryWord = 5000;
+
+namespace {
+
+// Returns the words GetTextMatchesWithAlgorithm() matches queries against: the
+// words of `url_string`, of its host decoded from punycode, and of `title`,
+// all in lower case.
+query_parser::QueryWordVector ExtractURLWords(const std::u16string& url_string,
+                                              const std::u16string& title) {
+  query_parser::QueryWordVector words;
+  std::u16string url = base::i18n::ToLower(url_string);
+  query_parser::QueryParser::ExtractQueryWords(url, &words);
+  GURL gurl(url);
+  if (gurl.is_valid()) {
+    // Decode punycode to match IDN.
+    std::u16string ascii = base::ASCIIToUTF16(gurl.host());
+    std::u16string utf = url_formatter::IDNToUnicode(gurl.host());
+    if (ascii != utf)
+      query_parser::QueryParser::ExtractQueryWords(utf, &words);
+  }
+  query_parser::QueryParser::ExtractQueryWords(base::i18n::ToLower(title),
+                                               &words);
+  return words;
+}
+
+}  // namespace
 
 URLDatabase::URLEnumeratorBase::URLEnumeratorBase()
     : initialized_(false) {
@@ -139,6 +168,18 @@ URLID URLDatabase::GetRowForURL(const GURL& url, URLRow* info) {
 }
 
 bool URLDatabase::UpdateURLRow(URLID url_id, const URLRow& info) {
+  // Only a new title changes the words of the row.
+  std::string url_string_to_reindex;
+  if (has_url_search_indices_) {
+    sql::Statement select_statement(GetDB().GetCachedStatement(
+        SQL_FROM_HERE, "SELECT url, title FROM urls WHERE id=?"));
+    select_statement.BindInt64(0, url_id);
+    if (select_statement.Step() &&
+        select_statement.ColumnString16(1) != info.title()) {
+      url_string_to_reindex = select_statement.ColumnString(0);
+    }
+  }
+
   sql::Statement statement(GetDB().GetCachedStatement(SQL_FROM_HERE,
       "UPDATE urls SET title=?,visit_count=?,typed_count=?,last_visit_time=?,"
         "hidden=?"
@@ -150,7 +191,17 @@ bool URLDatabase::UpdateURLRow(URLID url_id, const URLRow& info) {
   statement.BindInt(4, info.hidden() ? 1 : 0);
   statement.BindInt64(5, url_id);
 
-  return statement.Run() && GetDB().GetLastChangeCount() > 0;
+  if (!statement.Run() || GetDB().GetLastChangeCount() == 0)
+    return false;
+  if (!url_string_to_reindex.empty() &&
+      !SetURLWords(url_id, url_string_to_reindex, info.title(),
+                   /*replace=*/true)) {
+    return false;
+  }
+  // The visit count and time of the search terms of the URL may have changed.
+  return !has_keyword_search_terms_ ||
+         UpdateNormalizedKeywordSearchTerms(
+             GetNormalizedKeywordSearchTerms(url_id, std::u16string()));
 }
 
 URLID URLDatabase::AddURLInternal(const URLRow& info, bool is_temporary) {
@@ -175,7 +226,8 @@ URLID URLDatabase::AddURLInternal(const URLRow& info, bool is_temporary) {
 
   sql::Statement statement(GetDB().GetCachedStatement(
       sql::StatementID(__FILE__, statement_line), statement_sql));
-  statement.BindString(0, database_utils::GurlToDatabaseUrl(info.url()));
+  const std::string url_string = database_utils::GurlToDatabaseUrl(info.url());
+  statement.BindString(0, url_string);
   statement.BindString16(1, info.title());
   statement.BindInt(2, info.visit_count());
   statement.BindInt(3, info.typed_count());
@@ -187,7 +239,15 @@ URLID URLDatabase::AddURLInternal(const URLRow& info, bool is_temporary) {
             << " to table history.urls.";
     return 0;
   }
-  return GetDB().GetLastInsertRowId();
+  const URLID id = GetDB().GetLastInsertRowId();
+
+  // The words of the temporary table are indexed once it is committed.
+  if (has_url_search_indices_ && !is_temporary &&
+      !SetURLWords(id, url_string, info.title(), /*replace=*/false)) {
+    VLOG(0) << "Failed to index url " << info.url().possibly_invalid_spec()
+            << " in table history.url_words.";
+  }
+  return id;
 }
 
 bool URLDatabase::URLTableContainsAutoincrement() {
@@ -224,20 +284,39 @@ bool URLDatabase::InsertOrUpdateURLRowByID(const URLRow& info) {
   //  * When rows are deleted due to constraint violations, the delete triggers
   //    may not be invoked. As of now, we do not have any delete triggers.
   // For more details, see: http://www.sqlite.org/lang_conflict.html.
+  // Clear the words of the row REPLACE deletes, if any, as that delete doesn't
+  // go through DeleteURLRow().
+  if (has_url_search_indices_) {
+    sql::Statement words_statement(GetDB().GetCachedStatement(
+        SQL_FROM_HERE, "DELETE FROM url_words WHERE url_id = ?"));
+    words_statement.BindInt64(0, info.id());
+    if (!words_statement.Run())
+      return false;
+  }
+
   sql::Statement statement(GetDB().GetCachedStatement(SQL_FROM_HERE,
       "INSERT OR REPLACE INTO urls "
       "(id, url, title, visit_count, typed_count, last_visit_time, hidden) "
       "VALUES (?, ?, ?, ?, ?, ?, ?)"));
 
+  const std::string url_string = database_utils::GurlToDatabaseUrl(info.url());
   statement.BindInt64(0, info.id());
-  statement.BindString(1, database_utils::GurlToDatabaseUrl(info.url()));
+  statement.BindString(1, url_string);
   statement.BindString16(2, info.title());
   statement.BindInt(3, info.visit_count());
   statement.BindInt(4, info.typed_count());
   statement.BindInt64(5, info.last_visit().ToInternalValue());
   statement.BindInt(6, info.hidden() ? 1 : 0);
 
-  return statement.Run();
+  if (!statement.Run())
+    return false;
+  if (has_url_search_indices_ &&
+      !SetURLWords(info.id(), url_string, info.title(), /*replace=*/false)) {
+    return false;
+  }
+  return !has_keyword_search_terms_ ||
+         UpdateNormalizedKeywordSearchTerms(
+             GetNormalizedKeywordSearchTerms(info.id(), std::u16string()));
 }
 
 bool URLDatabase::DeleteURLRow(URLID id) {
@@ -248,6 +327,14 @@ bool URLDatabase::DeleteURLRow(URLID id) {
   if (!statement.Run())
     return false;
 
+  if (has_url_search_indices_) {
+    sql::Statement words_statement(GetDB().GetCachedStatement(
+        SQL_FROM_HERE, "DELETE FROM url_words WHERE url_id = ?"));
+    words_statement.BindInt64(0, id);
+    if (!words_statement.Run())
+      return false;
+  }
+
   // And delete any keyword visits.
   return !has_keyword_search_terms_ || DeleteKeywordSearchTermForURL(id);
 }
@@ -273,7 +360,10 @@ bool URLDatabase::CommitTemporaryURLTable() {
 
   // Re-create the index over the now permanent URLs table -- this was not there
   // for the temporary table.
-  return CreateMainURLIndex();
+  if (!CreateMainURLIndex())
+    return false;
+  return !has_url_search_indices_ ||
+         (InitURLSearchIndices() && RebuildURLWords());
 }
 
 bool URLDatabase::InitURLEnumeratorForEverything(URLEnumerator* enumerator) {
@@ -316,7 +406,14 @@ bool URLDatabase::AutocompleteForPrefix(const std::string& prefix,
 
   const char* sql;
   size_t line;
-  if (typed_only) {
+  if (typed_only && has_url_search_indices_) {
+    sql = "SELECT" HISTORY_URL_ROW_FIELDS "FROM urls "
+        "INDEXED BY urls_typed_url_index "
+        "WHERE url >= ? AND url < ? AND hidden = 0 AND typed_count > 0 "
+        "ORDER BY typed_count DESC, visit_count DESC, last_visit_time DESC "
+        "LIMIT ?";
+    line = __LINE__;
+  } else if (typed_only) {
     sql = "SELECT" HISTORY_URL_ROW_FIELDS "FROM urls "
         "WHERE url >= ? AND url < ? AND hidden = 0 AND typed_count > 0 "
         "ORDER BY typed_count DESC, visit_count DESC, last_visit_time DESC "
@@ -418,34 +515,119 @@ bool URLDatabase::GetTextMatchesWithAlgorithm(
   query_parser::QueryParser::ParseQueryNodes(query, algorithm, &query_nodes);
 
   results->clear();
-  sql::Statement statement(GetDB().GetCachedStatement(SQL_FROM_HERE,
-      "SELECT" HISTORY_URL_ROW_FIELDS "FROM urls WHERE hidden = 0"));
-
-  while (statement.Step()) {
-    query_parser::QueryWordVector query_words;
-    std::u16string url = base::i18n::ToLower(statement.ColumnString16(1));
-    query_parser::QueryParser::ExtractQueryWords(url, &query_words);
-    GURL gurl(url);
-    if (gurl.is_valid()) {
-      // Decode punycode to match IDN.
-      std::u16string ascii = base::ASCIIToUTF16(gurl.host());
-      std::u16string utf = url_formatter::IDNToUnicode(gurl.host());
-      if (ascii != utf)
-        query_parser::QueryParser::ExtractQueryWords(utf, &query_words);
-    }
-    std::u16string title = base::i18n::ToLower(statement.ColumnString16(2));
-    query_parser::QueryParser::ExtractQueryWords(title, &query_words);
-
+  auto append_if_match = [&](sql::Statement& statement) {
+    query_parser::QueryWordVector query_words = ExtractURLWords(
+        statement.ColumnString16(1), statement.ColumnString16(2));
     if (query_parser::QueryParser::DoesQueryMatch(query_words, query_nodes)) {
       URLResult info;
       FillURLRow(statement, &info);
       if (info.url().is_valid())
         results->push_back(info);
     }
+  };
+
+  // Every word of the query has to start a word of a matching row, so the
+  // index narrows the rows down to those which may match.
+  std::vector<std::u16string> query_words;
+  if (has_url_search_indices_ && url_words_complete_) {
+    query_parser::QueryParser::ParseQueryWords(query, algorithm,
+                                               &query_words);
+  }
+  std::vector<URLID> url_ids;
+  if (!query_words.empty() && GetURLIDsMatchingWords(query_words, &url_ids)) {
+    sql::Statement statement(GetDB().GetCachedStatement(
+        SQL_FROM_HERE,
+        "SELECT" HISTORY_URL_ROW_FIELDS
+        "FROM urls WHERE id = ? AND hidden = 0"));
+    for (URLID url_id : url_ids) {
+      statement.Reset(true);
+      statement.BindInt64(0, url_id);
+      if (statement.Step())
+        append_if_match(statement);
+    }
+    return !results->empty();
   }
+
+  sql::Statement statement(GetDB().GetCachedStatement(SQL_FROM_HERE,
+      "SELECT" HISTORY_URL_ROW_FIELDS "FROM urls WHERE hidden = 0"));
+  while (statement.Step())
+    append_if_match(statement);
   return !results->empty();
 }
 
+bool URLDatabase::GetURLIDsMatchingWords(
+    const std::vector<std::u16string>& query_words,
+    std::vector<URLID>* url_ids) {
+  // As in AutocompleteForPrefix(), the words starting with `word` sort between
+  // `word` and `word` followed by the maximum character. The limit counts
+  // words rather than rows, so a query word may be ignored with a little fewer
+  // rows holding it.
+  sql::Statement statement(GetDB().GetCachedStatement(
+      SQL_FROM_HERE,
+      "SELECT url_id FROM url_words WHERE word >= ? AND word < ? LIMIT ?"));
+  bool narrowed = false;
+  url_ids->clear();
+  for (const std::u16string& query_word : query_words) {
+    std::string word = base::UTF16ToUTF8(base::i18n::ToLower(query_word));
+    std::string end_word = word;
+    end_word.push_back(std::numeric_limits<unsigned char>::max());
+    statement.Reset(true);
+    statement.BindString(0, word);
+    statement.BindString(1, end_word);
+    statement.BindInt64(2, kMaxURLIDsPerQueryWord + 1);
+
+    std::vector<URLID> word_url_ids;
+    while (statement.Step())
+      word_url_ids.push_back(statement.ColumnInt64(0));
+    // The rows are matched against the word after they are read anyway.
+    if (word_url_ids.size() > kMaxURLIDsPerQueryWord)
+      continue;
+    std::sort(word_url_ids.begin(), word_url_ids.end());
+    word_url_ids.erase(std::unique(word_url_ids.begin(), word_url_ids.end()),
+                       word_url_ids.end());
+
+    if (!narrowed) {
+      *url_ids = std::move(word_url_ids);
+      narrowed = true;
+    } else {
+      std::vector<URLID> intersection;
+      std::set_intersection(url_ids->begin(), url_ids->end(),
+                            word_url_ids.begin(), word_url_ids.end(),
+                            std::back_inserter(intersection));
+      *url_ids = std::move(intersection);
+    }
+    if (url_ids->empty())
+      break;
+  }
+  return narrowed;
+}
+
+bool URLDatabase::SetURLWords(URLID url_id,
+                              const std::string& url_string,
+                              const std::u16string& title,
+                              bool replace) {
+  if (replace) {
+    sql::Statement statement(GetDB().GetCachedStatement(
+        SQL_FROM_HERE, "DELETE FROM url_words WHERE url_id = ?"));
+    statement.BindInt64(0, url_id);
+    if (!statement.Run())
+      return false;
+  }
+
+  sql::Statement statement(GetDB().GetCachedStatement(
+      SQL_FROM_HERE,
+      "INSERT OR IGNORE INTO url_words (word, url_id) VALUES (?, ?)"));
+  for (const query_parser::QueryWord& word :
+       ExtractURLWords(base::UTF8ToUTF16(url_string), title)) {
+    statement.Reset(true);
+    statement.BindString16(0, word.word);
+    statement.BindInt64(1, url_id);
+    if (!statement.Run())
+      return false;
+  }
+  return true;
+}
+
 bool URLDatabase::InitKeywordSearchTermsTable() {
   has_keyword_search_terms_ = true;
   if (!GetDB().DoesTableExist("keyword_search_terms")) {
@@ -460,7 +642,24 @@ bool URLDatabase::InitKeywordSearchTermsTable() {
       return false;
     }
   }
-  return true;
+
+  // The visit count and time of each normalized search term, kept up to date
+  // as its search terms and their URLs change, so that zero-prefix suggestions
+  // are read from the index rather than aggregated over the URLs every time.
+  return GetDB().Execute(
+             "CREATE TABLE IF NOT EXISTS normalized_keyword_search_terms ("
+             "keyword_id INTEGER NOT NULL,"       // ID of the TemplateURL.
+             "normalized_term LONGVARCHAR NOT NULL,"
+             "visit_count INTEGER NOT NULL,"
+             "last_visit_time INTEGER NOT NULL,"
+             // The last visit time of the least recently visited URL.
+             "oldest_visit_time INTEGER NOT NULL,"
+             "PRIMARY KEY(keyword_id, normalized_term))") &&
+         // For zero-prefix suggestions.
+         GetDB().Execute(
+             "CREATE INDEX IF NOT EXISTS normalized_keyword_search_terms_index "
+             "ON normalized_keyword_search_terms "
+             "(keyword_id, last_visit_time)");
 }
 
 bool URLDatabase::CreateKeywordSearchTermsIndices() {
@@ -488,8 +687,25 @@ bool URLDatabase::CreateKeywordSearchTermsIndices() {
 }
 
 bool URLDatabase::DropKeywordSearchTermsTable() {
-  // This will implicitly delete the indices over the table.
-  return GetDB().Execute("DROP TABLE keyword_search_terms");
+  // This will implicitly delete the indices over the tables.
+  return GetDB().Execute(
+             "DROP TABLE IF EXISTS normalized_keyword_search_terms") &&
+         GetDB().Execute("DROP TABLE keyword_search_terms");
+}
+
+bool URLDatabase::RebuildNormalizedKeywordSearchTerms() {
+  if (!GetDB().Execute("DELETE FROM normalized_keyword_search_terms"))
+    return false;
+
+  std::vector<std::pair<KeywordID, std::u16string>> normalized_terms;
+  sql::Statement statement(GetDB().GetUniqueStatement(
+      "SELECT DISTINCT keyword_id, normalized_term FROM keyword_search_terms"));
+  while (statement.Step()) {
+    normalized_terms.emplace_back(statement.ColumnInt64(0),
+                                  statement.ColumnString16(1));
+  }
+  return statement.Succeeded() &&
+         UpdateNormalizedKeywordSearchTerms(normalized_terms);
 }
 
 bool URLDatabase::SetKeywordSearchTermsForURL(URLID url_id,
@@ -516,9 +732,11 @@ bool URLDatabase::SetKeywordSearchTermsForURL(URLID url_id,
   statement.BindInt64(0, keyword_id);
   statement.BindInt64(1, url_id);
   statement.BindString16(2, term);
-  statement.BindString16(
-      3, base::i18n::ToLower(base::CollapseWhitespace(term, false)));
-  return statement.Run();
+  const std::u16string normalized_term =
+      base::i18n::ToLower(base::CollapseWhitespace(term, false));
+  statement.BindString16(3, normalized_term);
+  return statement.Run() &&
+         UpdateNormalizedKeywordSearchTerm(keyword_id, normalized_term);
 }
 
 bool URLDatabase::GetKeywordSearchTermRow(URLID url_id,
@@ -572,7 +790,15 @@ void URLDatabase::DeleteAllSearchTermsForKeyword(
       "DELETE FROM keyword_search_terms WHERE keyword_id=?"));
   statement.BindInt64(0, keyword_id);
 
-  statement.Run();
+  if (!statement.Run())
+    return;
+
+  sql::Statement normalized_statement(GetDB().GetCachedStatement(
+      SQL_FROM_HERE,
+      "DELETE FROM normalized_keyword_search_terms WHERE keyword_id=?"));
+  normalized_statement.BindInt64(0, keyword_id);
+
+  normalized_statement.Run();
 }
 
 void URLDatabase::GetMostRecentKeywordSearchTerms(
@@ -627,65 +853,70 @@ URLDatabase::GetMostRecentNormalizedKeywordSearchTerms(
   if (!keyword_id)
     return {};
 
-  // Extracts the most recent normalized search terms from the
-  // keyword_search_terms table joined with the urls table. For a given search
-  // term, those search query URLs that are visited too closely to the original
-  // search query URL are ignored in order to avoid erroneously boosting the
-  // term when frecency ranking is used. This is done by rounding down the URLs'
-  // last_visit_time to the largest ? ms interval and picking the oldest URL out
-  // of all the URLs with the same rounded last visit time. The average of visit
-  // counts for those URLs is then used as the visit count of this emerging
-  // deduplicated URL This way no bare column (chosen at random) is returned by
-  // the aggregate query.
-  sql::Statement statement(GetDB().GetCachedStatement(SQL_FROM_HERE,
-                                                      R"(
-      SELECT
-        normalized_term,
-        SUM(visit_count) AS visit_count,
-        MAX(last_visit_time) AS last_visit_time
-      FROM
-        (
-          SELECT
-            normalized_term,
-            AVG(visit_count) AS visit_count,
-            MIN(u.last_visit_time) AS last_visit_time,
-            u.last_visit_time - (u.last_visit_time % ?) as rnd_last_visit_time
-          FROM
-            keyword_search_terms kv JOIN urls u ON kv.url_id = u.id
-          WHERE
-            kv.keyword_id = ?
-            AND u.last_visit_time > ?
-            AND kv.normalized_term IS NOT NULL
-            AND kv.normalized_term != ""
-          GROUP BY normalized_term, rnd_last_visit_time
-        )
-      GROUP BY normalized_term
-      ORDER BY last_visit_time DESC
-      )"));
-
+  // The last visit time of a normalized search term is that of the oldest URL
+  // in its most recent deduplication interval, so a term with a URL visited
+  // after `age_threshold` may be up to one interval older than that.
+  sql::Statement statement(GetDB().GetCachedStatement(
+      SQL_FROM_HERE,
+      "SELECT normalized_term, visit_count, last_visit_time, "
+      "oldest_visit_time "
+      "FROM normalized_keyword_search_terms "
+      "WHERE keyword_id = ? AND last_visit_time > ? "
+      "ORDER BY last_visit_time DESC"));
+  statement.BindInt64(0, keyword_id);
   statement.BindInt64(
-      0, kAutocompleteDuplicateVisitIntervalThreshold.ToInternalValue());
-  statement.BindInt64(1, keyword_id);
-  statement.BindInt64(2, age_threshold.ToInternalValue());
+      1, (age_threshold - kAutocompleteDuplicateVisitIntervalThreshold)
+             .ToInternalValue());
 
   std::vector<NormalizedKeywordSearchTermVisit> visits;
+  bool recounted = false;
   while (statement.Step()) {
     NormalizedKeywordSearchTermVisit visit;
     visit.normalized_term = statement.ColumnString16(0);
-    visit.visits = statement.ColumnInt(1);
-    visit.most_recent_visit_time =
-        base::Time::FromInternalValue(statement.ColumnInt64(2));
+    if (base::Time::FromInternalValue(statement.ColumnInt64(3)) >
+        age_threshold) {
+      // None of the URLs of the term is older than `age_threshold`.
+      visit.visits = statement.ColumnInt(1);
+      visit.most_recent_visit_time =
+          base::Time::FromInternalValue(statement.ColumnInt64(2));
+    } else {
+      // Only count the URLs visited after `age_threshold`.
+      sql::Statement count_statement;
+      if (!CountNormalizedKeywordSearchTermVisits(
+              keyword_id, visit.normalized_term, age_threshold,
+              &count_statement)) {
+        return {};
+      }
+      if (count_statement.GetColumnType(0) == sql::ColumnType::kNull)
+        continue;
+      visit.visits = count_statement.ColumnInt(0);
+      visit.most_recent_visit_time =
+          base::Time::FromInternalValue(count_statement.ColumnInt64(1));
+      recounted = true;
+    }
     visits.push_back(visit);
   }
+  if (recounted) {
+    std::stable_sort(visits.begin(), visits.end(),
+                     [](const NormalizedKeywordSearchTermVisit& a,
+                        const NormalizedKeywordSearchTermVisit& b) {
+                       return a.most_recent_visit_time >
+                              b.most_recent_visit_time;
+                     });
+  }
   return visits;
 }
 
 bool URLDatabase::DeleteKeywordSearchTerm(const std::u16string& term) {
+  const std::vector<std::pair<KeywordID, std::u16string>> normalized_terms =
+      GetNormalizedKeywordSearchTerms(0, term);
+
   sql::Statement statement(GetDB().GetCachedStatement(SQL_FROM_HERE,
       "DELETE FROM keyword_search_terms WHERE term=?"));
   statement.BindString16(0, term);
 
-  return statement.Run();
+  return statement.Run() &&
+         UpdateNormalizedKeywordSearchTerms(normalized_terms);
 }
 
 bool URLDatabase::DeleteKeywordSearchTermForNormalizedTerm(
@@ -698,14 +929,135 @@ bool URLDatabase::DeleteKeywordSearchTermForNormalizedTerm(
   statement.BindInt64(0, keyword_id);
   statement.BindString16(1, normalized_term);
 
-  return statement.Run();
+  return statement.Run() &&
+         UpdateNormalizedKeywordSearchTerm(keyword_id, normalized_term);
 }
 
 bool URLDatabase::DeleteKeywordSearchTermForURL(URLID url_id) {
+  const std::vector<std::pair<KeywordID, std::u16string>> normalized_terms =
+      GetNormalizedKeywordSearchTerms(url_id, std::u16string());
+
   sql::Statement statement(GetDB().GetCachedStatement(
       SQL_FROM_HERE, "DELETE FROM keyword_search_terms WHERE url_id=?"));
   statement.BindInt64(0, url_id);
-  return statement.Run();
+  return statement.Run() &&
+         UpdateNormalizedKeywordSearchTerms(normalized_terms);
+}
+
+bool URLDatabase::CountNormalizedKeywordSearchTermVisits(
+    KeywordID keyword_id,
+    const std::u16string& normalized_term,
+    base::Time age_threshold,
+    sql::Statement* statement) {
+  // For a given search term, those search query URLs that are visited too
+  // closely to the original search query URL are ignored in order to avoid
+  // erroneously boosting the term when frecency ranking is used. This is done
+  // by rounding down the URLs' last_visit_time to the largest ? ms interval
+  // and picking the oldest URL out of all the URLs with the same rounded last
+  // visit time. The average of visit counts for those URLs is then used as the
+  // visit count of this emerging deduplicated URL. This way no bare column
+  // (chosen at random) is returned by the aggregate query.
+  statement->Assign(GetDB().GetCachedStatement(SQL_FROM_HERE,
+                                               R"(
+      SELECT
+        SUM(visit_count) AS visit_count,
+        MAX(last_visit_time) AS last_visit_time,
+        MIN(last_visit_time) AS oldest_visit_time
+      FROM
+        (
+          SELECT
+            AVG(visit_count) AS visit_count,
+            MIN(u.last_visit_time) AS last_visit_time,
+            u.last_visit_time - (u.last_visit_time % ?) as rnd_last_visit_time
+          FROM
+            keyword_search_terms kv JOIN urls u ON kv.url_id = u.id
+          WHERE
+            kv.keyword_id = ?
+            AND kv.normalized_term = ?
+            AND u.last_visit_time > ?
+          GROUP BY rnd_last_visit_time
+        )
+      )"));
+  statement->BindInt64(
+      0, kAutocompleteDuplicateVisitIntervalThreshold.ToInternalValue());
+  statement->BindInt64(1, keyword_id);
+  statement->BindString16(2, normalized_term);
+  statement->BindInt64(3, age_threshold.ToInternalValue());
+  return statement->Step();
+}
+
+bool URLDatabase::UpdateNormalizedKeywordSearchTerm(
+    KeywordID keyword_id,
+    const std::u16string& normalized_term) {
+  if (normalized_term.empty())
+    return true;
+
+  sql::Statement statement;
+  if (!CountNormalizedKeywordSearchTermVisits(keyword_id, normalized_term,
+                                              base::Time(), &statement)) {
+    return false;
+  }
+
+  // The aggregates are NULL once the last search term is deleted.
+  if (statement.GetColumnType(0) == sql::ColumnType::kNull) {
+    sql::Statement delete_statement(GetDB().GetCachedStatement(
+        SQL_FROM_HERE,
+        "DELETE FROM normalized_keyword_search_terms "
+        "WHERE keyword_id = ? AND normalized_term = ?"));
+    delete_statement.BindInt64(0, keyword_id);
+    delete_statement.BindString16(1, normalized_term);
+    return delete_statement.Run();
+  }
+
+  sql::Statement insert_statement(GetDB().GetCachedStatement(
+      SQL_FROM_HERE,
+      "INSERT OR REPLACE INTO normalized_keyword_search_terms "
+      "(keyword_id, normalized_term, visit_count, last_visit_time, "
+      "oldest_visit_time) VALUES (?,?,?,?,?)"));
+  insert_statement.BindInt64(0, keyword_id);
+  insert_statement.BindString16(1, normalized_term);
+  insert_statement.BindInt(2, statement.ColumnInt(0));
+  insert_statement.BindInt64(3, statement.ColumnInt64(1));
+  insert_statement.BindInt64(4, statement.ColumnInt64(2));
+  return insert_statement.Run();
+}
+
+std::vector<std::pair<KeywordID, std::u16string>>
+URLDatabase::GetNormalizedKeywordSearchTerms(URLID url_id,
+                                             const std::u16string& term) {
+  sql::Statement statement;
+  if (url_id) {
+    statement.Assign(GetDB().GetCachedStatement(
+        SQL_FROM_HERE,
+        "SELECT keyword_id, normalized_term FROM keyword_search_terms "
+        "WHERE url_id=?"));
+    statement.BindInt64(0, url_id);
+  } else {
+    statement.Assign(GetDB().GetCachedStatement(
+        SQL_FROM_HERE,
+        "SELECT keyword_id, normalized_term FROM keyword_search_terms "
+        "WHERE term=?"));
+    statement.BindString16(0, term);
+  }
+
+  std::vector<std::pair<KeywordID, std::u16string>> normalized_terms;
+  while (statement.Step()) {
+    normalized_terms.emplace_back(statement.ColumnInt64(0),
+                                  statement.ColumnString16(1));
+  }
+  return normalized_terms;
+}
+
+bool URLDatabase::UpdateNormalizedKeywordSearchTerms(
+    const std::vector<std::pair<KeywordID, std::u16string>>&
+        normalized_terms) {
+  for (const auto& normalized_term : normalized_terms) {
+    if (!UpdateNormalizedKeywordSearchTerm(normalized_term.first,
+                                           normalized_term.second)) {
+      return false;
+    }
+  }
+  return true;
 }
 
 bool URLDatabase::DropStarredIDFromURLs() {
@@ -762,6 +1114,83 @@ bool URLDatabase::CreateMainURLIndex() {
       "CREATE INDEX IF NOT EXISTS urls_url_index ON urls (url)");
 }
 
+bool URLDatabase::InitURLSearchIndices() {
+  has_url_search_indices_ = true;
+
+  // Typed URLs are a small part of history, which AutocompleteForPrefix() with
+  // `typed_only` would otherwise pick out of every URL with the prefix. Its
+  // WHERE clause must imply this one for SQLite to use the index.
+  if (!GetDB().Execute("CREATE INDEX IF NOT EXISTS urls_typed_url_index "
+                       "ON urls (url) WHERE hidden = 0 AND typed_count > 0")) {
+    return false;
+  }
+
+  if (!GetDB().DoesTableExist("url_words")) {
+    if (!GetDB().Execute("CREATE TABLE url_words ("
+                         "word LONGVARCHAR NOT NULL,"  // In lower case.
+                         "url_id INTEGER NOT NULL)") ||
+        !GetDB().Execute("CREATE UNIQUE INDEX url_words_index "
+                         "ON url_words (word, url_id)") ||
+        !GetDB().Execute("CREATE INDEX url_words_url_id_index "
+                         "ON url_words (url_id)")) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool URLDatabase::RebuildURLWords() {
+  DCHECK(has_url_search_indices_);
+  if (!GetDB().Execute("DELETE FROM url_words"))
+    return false;
+
+  sql::Statement statement(
+      GetDB().GetUniqueStatement("SELECT id, url, title FROM urls"));
+  while (statement.Step()) {
+    if (!SetURLWords(statement.ColumnInt64(0), statement.ColumnString(1),
+                     statement.ColumnString16(2), /*replace=*/false)) {
+      return false;
+    }
+  }
+  if (!statement.Succeeded())
+    return false;
+  url_words_complete_ = true;
+  return true;
+}
+
+bool URLDatabase::IndexURLWordsBatch(int max_rows,
+                                     URLID* last_url_id,
+                                     bool* done) {
+  DCHECK(has_url_search_indices_);
+  *done = url_words_complete_;
+  if (*done)
+    return true;
+
+  // Rows added or updated since the rebuild started were indexed then, which
+  // the words inserted here don't duplicate.
+  sql::Statement statement(GetDB().GetCachedStatement(
+      SQL_FROM_HERE,
+      "SELECT id, url, title FROM urls WHERE id > ? ORDER BY id LIMIT ?"));
+  statement.BindInt64(0, *last_url_id);
+  statement.BindInt(1, max_rows);
+  int row_count = 0;
+  while (statement.Step()) {
+    *last_url_id = statement.ColumnInt64(0);
+    if (!SetURLWords(*last_url_id, statement.ColumnString(1),
+                     statement.ColumnString16(2), /*replace=*/false)) {
+      return false;
+    }
+    ++row_count;
+  }
+  if (!statement.Succeeded())
+    return false;
+  if (row_count < max_rows) {
+    url_words_complete_ = true;
+    *done = true;
+  }
+  return true;
+}
+
 bool URLDatabase::RecreateURLTableWithAllContents() {
   // Create a temporary table to contain the new URLs table.
   if (!CreateTemporaryURLTable()) {
@@ -8,6 +8,7 @@
 #include <stddef.h>
 
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "base/macros.h"
@@ -181,9 +182,10 @@ class URLDatabase {
 
   // History search ------------------------------------------------------------
 
-  // Performs a brute force search over the database to find any URLs or titles
-  // which match the `query` string, using the default text matching algorithm.
-  // Returns any matches in `results`.
+  // Searches the database for any URLs or titles which match the `query`
+  // string, using the default text matching algorithm. Returns any matches in
+  // `results`, by increasing ID. Only looks at the rows holding every word of
+  // the query if InitURLSearchIndices() was invoked, or else at all of them.
   bool GetTextMatches(const std::u16string& query, URLRows* results);
 
   // Same as GetTextMatches, using `algorithm` as the text matching
@@ -222,7 +224,7 @@ class URLDatabase {
 
   // Returns the most recent (i.e., no older than `age_threshold`) normalized
   // search terms (i.e., search terms in lower case with whitespaces collapsed)
-  // for the specified keyword.
+  // for the specified keyword, from the most recent to the least recent.
   std::vector<NormalizedKeywordSearchTermVisit>
   GetMostRecentNormalizedKeywordSearchTerms(KeywordID keyword_id,
                                             base::Time age_threshold);
@@ -249,6 +251,11 @@ class URLDatabase {
   // fields following kURLRowFields.
   static const int kNumURLRowFields;
 
+  // The number of rows above which a word of a query, such as the first
+  // keystroke or "https", is not looked up in the url_words table: looking
+  // that many rows up one by one is no faster than scanning them.
+  static const size_t kMaxURLIDsPerQueryWord;
+
   // Drops the starred_id column from urls, returning true on success. This does
   // nothing (and returns true) if the urls doesn't contain the starred_id
   // column.
@@ -279,6 +286,32 @@ class URLDatabase {
   // Deletes the keyword search terms table.
   bool DropKeywordSearchTermsTable();
 
+  // Fills the normalized_keyword_search_terms table, which keeps the visit
+  // count and time of each normalized search term, from the keyword search
+  // terms and URLs tables, for migration to version 48.
+  bool RebuildNormalizedKeywordSearchTerms();
+
+  // Ensures the url_words table, which maps the words GetTextMatches() looks
+  // for to the rows holding them, and the index of typed URLs used by
+  // AutocompleteForPrefix() exist. From then on, adding, updating and deleting
+  // URL rows keeps them up to date.
+  bool InitURLSearchIndices();
+
+  // Fills the url_words table from the URLs table, after the URLs table is
+  // replaced.
+  bool RebuildURLWords();
+
+  // Marks the url_words table as lacking the words of some URL rows, until
+  // IndexURLWordsBatch() is done. Meanwhile, GetTextMatches() looks at every
+  // row.
+  void set_url_words_incomplete() { url_words_complete_ = false; }
+
+  // Indexes the words of up to `max_rows` URL rows whose ID is greater than
+  // `*last_url_id`, in ID order, and sets `*last_url_id` to the last of them.
+  // Once no row is left, sets `*done` and marks the url_words table complete.
+  // For filling the url_words table in batches after migration to version 46.
+  bool IndexURLWordsBatch(int max_rows, URLID* last_url_id, bool* done);
+
   // Inserts the given URL row into the URLs table, using the regular table
   // if is_temporary is false, or the temporary URL table if is temporary is
   // true. The current `id` of `info` will be ignored in both cases and a new ID
@@ -305,10 +338,58 @@ class URLDatabase {
   bool MigrateKeywordsSearchTermsLowerTermColumn();
 
  private:
+  // Replaces the words of the row `url_id` in the url_words table with those
+  // of `url_string`, as stored in the URLs table, and of `title`. The row's
+  // previous words are only deleted if `replace` is true.
+  bool SetURLWords(URLID url_id,
+                   const std::string& url_string,
+                   const std::u16string& title,
+                   bool replace);
+
+  // Sets `url_ids` to the IDs of the rows which hold a word starting with each
+  // of `query_words`, sorted, ignoring the words held by more than
+  // kMaxURLIDsPerQueryWord rows. Returns false if all of them are, in which
+  // case the rows are better scanned.
+  bool GetURLIDsMatchingWords(const std::vector<std::u16string>& query_words,
+                              std::vector<URLID>* url_ids);
+
+  // Aggregates the visit count and time of the URLs of `normalized_term` for
+  // `keyword_id` last visited after `age_threshold` into `statement`, whose
+  // columns are the visit count, last visit time and oldest visit time, all
+  // NULL if there are none. Returns false on failure.
+  bool CountNormalizedKeywordSearchTermVisits(
+      KeywordID keyword_id,
+      const std::u16string& normalized_term,
+      base::Time age_threshold,
+      sql::Statement* statement);
+
+  // Recomputes the visit count and time of `normalized_term` for `keyword_id`
+  // in the normalized_keyword_search_terms table, from its search terms.
+  bool UpdateNormalizedKeywordSearchTerm(KeywordID keyword_id,
+                                         const std::u16string& normalized_term);
+
+  // Returns the keyword IDs and normalized search terms of the search terms
+  // for the URL `url_id`, or of `term` if `url_id` is 0.
+  std::vector<std::pair<KeywordID, std::u16string>>
+  GetNormalizedKeywordSearchTerms(URLID url_id, const std::u16string& term);
+
+  // Calls UpdateNormalizedKeywordSearchTerm() for each of
+  // `normalized_terms`.
+  bool UpdateNormalizedKeywordSearchTerms(
+      const std::vector<std::pair<KeywordID, std::u16string>>&
+          normalized_terms);
+
   // True if InitKeywordSearchTermsTable() has been invoked. Not all subclasses
   // have keyword search terms.
   bool has_keyword_search_terms_;
 
+  // True if InitURLSearchIndices() has been invoked. The in-memory database
+  // doesn't have them.
+  bool has_url_search_indices_ = false;
+
+  // False while the url_words table lacks the words of some URL rows.
+  bool url_words_complete_ = true;
+
   DISALLOW_COPY_AND_ASSIGN(URLDatabase);
 };
 
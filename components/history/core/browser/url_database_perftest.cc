@@ -0,0 +1,217 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "components/history/core/browser/url_database.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/stringprintf.h"
+#include "base/strings/utf_string_conversions.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "components/history/core/browser/keyword_id.h"
+#include "components/history/core/browser/keyword_search_term.h"
+#include "sql/database.h"
+#include "sql/transaction.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "url/gurl.h"
+
+namespace history {
+
+namespace {
+
+constexpr char kMetricPrefixURLDatabase[] = "URLDatabase.";
+constexpr char kMetricTextMatchesTime[] = "text_matches_time";
+constexpr char kMetricTextMatchesMaxTime[] = "text_matches_max_time";
+constexpr char kMetricAutocompleteTime[] = "autocomplete_time";
+constexpr char kMetricAutocompleteMaxTime[] = "autocomplete_max_time";
+constexpr char kMetricSearchTermsTime[] = "search_terms_time";
+constexpr char kMetricZeroPrefixSearchTermsTime[] =
+    "zero_prefix_search_terms_time";
+constexpr char kMetricSearchTermUpdateTime[] = "search_term_update_time";
+
+constexpr int kURLCount = 1000000;
+constexpr size_t kMaxResults = 5;
+
+// What the user types, one keystroke at a time.
+constexpr char kTypedURL[] = "https://www.site1234.com/";
+constexpr char16_t kTypedQuery[] = u"recipes for site1234";
+
+// Search terms of a heavy user of the default search engine.
+constexpr int kSearchTermCount = 100000;
+constexpr KeywordID kKeywordID = 1;
+constexpr int kSearchTermUpdateCount = 1000;
+
+perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixURLDatabase, story_name);
+  reporter.RegisterImportantMetric(kMetricTextMatchesTime, "ms");
+  reporter.RegisterImportantMetric(kMetricTextMatchesMaxTime, "ms");
+  reporter.RegisterImportantMetric(kMetricAutocompleteTime, "us");
+  reporter.RegisterImportantMetric(kMetricAutocompleteMaxTime, "us");
+  reporter.RegisterImportantMetric(kMetricSearchTermsTime, "us");
+  reporter.RegisterImportantMetric(kMetricZeroPrefixSearchTermsTime, "ms");
+  reporter.RegisterImportantMetric(kMetricSearchTermUpdateTime, "us");
+  return reporter;
+}
+
+class URLDatabasePerfTest : public testing::Test, public URLDatabase {
+ public:
+  URLDatabasePerfTest() = default;
+
+ protected:
+  sql::Database& GetDB() override { return db_; }
+
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    ASSERT_TRUE(db_.Open(temp_dir_.GetPath().AppendASCII("URLTest.db")));
+    CreateURLTable(false);
+    CreateMainURLIndex();
+    ASSERT_TRUE(InitKeywordSearchTermsTable());
+  }
+
+  void PopulateDatabase() {
+    sql::Transaction transaction(&db_);
+    ASSERT_TRUE(transaction.Begin());
+    const base::Time now = base::Time::Now();
+    for (int i = 0; i < kURLCount; ++i) {
+      URLRow row(GURL(base::StringPrintf("https://www.site%d.com/page/%d",
+                                         i % 5000, i)));
+      row.set_title(base::ASCIIToUTF16(base::StringPrintf(
+          "%s for page %d", i % 3 ? "Recipes" : "News", i)));
+      row.set_visit_count(1 + i % 17);
+      row.set_typed_count(i % 4 == 0 ? 1 + i % 3 : 0);
+      row.set_last_visit(now - base::TimeDelta::FromMinutes(i));
+      ASSERT_TRUE(AddURL(row));
+    }
+    ASSERT_TRUE(transaction.Commit());
+  }
+
+  void RunTest(const std::string& story_name) {
+    // The slowest keystroke is reported along with the mean, as the first
+    // ones match the most rows.
+    const std::u16string query = kTypedQuery;
+    URLRows results;
+    base::TimeDelta text_matches_time;
+    base::TimeDelta text_matches_max_time;
+    for (size_t length = 1; length <= query.size(); ++length) {
+      base::ElapsedTimer timer;
+      GetTextMatches(query.substr(0, length), &results);
+      const base::TimeDelta elapsed = timer.Elapsed();
+      text_matches_time += elapsed;
+      text_matches_max_time = std::max(text_matches_max_time, elapsed);
+    }
+
+    const std::string url = kTypedURL;
+    base::TimeDelta autocomplete_time;
+    base::TimeDelta autocomplete_max_time;
+    for (size_t length = 1; length <= url.size(); ++length) {
+      base::ElapsedTimer timer;
+      AutocompleteForPrefix(url.substr(0, length), kMaxResults,
+                            /*typed_only=*/true, &results);
+      const base::TimeDelta elapsed = timer.Elapsed();
+      autocomplete_time += elapsed;
+      autocomplete_max_time = std::max(autocomplete_max_time, elapsed);
+    }
+
+    auto reporter = SetUpReporter(story_name);
+    reporter.AddResult(kMetricTextMatchesTime,
+                       text_matches_time.InMillisecondsF() / query.size());
+    reporter.AddResult(kMetricTextMatchesMaxTime,
+                       text_matches_max_time.InMillisecondsF());
+    reporter.AddResult(kMetricAutocompleteTime,
+                       autocomplete_time.InMicrosecondsF() / url.size());
+    reporter.AddResult(kMetricAutocompleteMaxTime,
+                       autocomplete_max_time.InMicrosecondsF());
+  }
+
+  // Adds `kSearchTermCount` searches, a tenth of them searched again with
+  // different capitalization or spacing.
+  void PopulateSearchTerms() {
+    sql::Transaction transaction(&db_);
+    ASSERT_TRUE(transaction.Begin());
+    const base::Time now = base::Time::Now();
+    for (int i = 0; i < kSearchTermCount; ++i) {
+      const int term_index = i % 10 ? i : i / 10;
+      const std::string term = base::StringPrintf(
+          i % 10 ? "recipes for dish %d" : "Recipes  for dish %d", term_index);
+      URLRow row(GURL("https://www.google.com/search?q=" + term));
+      row.set_visit_count(1 + i % 7);
+      row.set_last_visit(now - base::TimeDelta::FromMinutes(i));
+      search_url_ids_.push_back(AddURL(row));
+      ASSERT_TRUE(SetKeywordSearchTermsForURL(
+          search_url_ids_.back(), kKeywordID, base::ASCIIToUTF16(term)));
+    }
+    ASSERT_TRUE(transaction.Commit());
+  }
+
+  void RunSearchTermsTest(const std::string& story_name) {
+    const std::u16string query = kTypedQuery;
+    std::vector<KeywordSearchTermVisit> matches;
+    base::ElapsedTimer search_terms_timer;
+    for (size_t length = 1; length <= query.size(); ++length) {
+      matches.clear();
+      GetMostRecentKeywordSearchTerms(kKeywordID, query.substr(0, length),
+                                      kMaxResults, &matches);
+    }
+    const base::TimeDelta search_terms_time = search_terms_timer.Elapsed();
+
+    base::ElapsedTimer zero_prefix_timer;
+    EXPECT_FALSE(GetMostRecentNormalizedKeywordSearchTerms(
+                     kKeywordID, AutocompleteAgeThreshold())
+                     .empty());
+    const base::TimeDelta zero_prefix_time = zero_prefix_timer.Elapsed();
+
+    // What visiting a search result page again costs to keep the search terms
+    // ranked.
+    base::ElapsedTimer update_timer;
+    const base::Time now = base::Time::Now();
+    for (int i = 0; i < kSearchTermUpdateCount; ++i) {
+      const URLID url_id =
+          search_url_ids_[(i * 7919) % search_url_ids_.size()];
+      URLRow row;
+      ASSERT_TRUE(GetURLRow(url_id, &row));
+      row.set_visit_count(row.visit_count() + 1);
+      row.set_last_visit(now);
+      ASSERT_TRUE(UpdateURLRow(url_id, row));
+    }
+    const base::TimeDelta update_time = update_timer.Elapsed();
+
+    auto reporter = SetUpReporter(story_name);
+    reporter.AddResult(kMetricSearchTermsTime,
+                       search_terms_time.InMicrosecondsF() / query.size());
+    reporter.AddResult(kMetricZeroPrefixSearchTermsTime,
+                       zero_prefix_time.InMillisecondsF());
+    reporter.AddResult(kMetricSearchTermUpdateTime,
+                       update_time.InMicrosecondsF() / kSearchTermUpdateCount);
+  }
+
+ private:
+  std::vector<URLID> search_url_ids_;
+  base::ScopedTempDir temp_dir_;
+  sql::Database db_;
+};
+
+}  // namespace
+
+TEST_F(URLDatabasePerfTest, FullScan) {
+  PopulateDatabase();
+  RunTest("1m_urls_full_scan");
+}
+
+TEST_F(URLDatabasePerfTest, SearchIndices) {
+  ASSERT_TRUE(InitURLSearchIndices());
+  PopulateDatabase();
+  RunTest("1m_urls_search_indices");
+}
+
+TEST_F(URLDatabasePerfTest, KeywordSearchTerms) {
+  PopulateSearchTerms();
+  RunSearchTermsTest("100k_search_terms");
+}
+
+}  // namespace history
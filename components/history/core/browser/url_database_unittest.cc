@@ -4,11 +4,16 @@
 
 #include "components/history/core/browser/url_database.h"
 
+#include <algorithm>
+
 #include "base/files/file_path.h"
 #include "base/files/scoped_temp_dir.h"
+#include "base/strings/string_number_conversions.h"
+#include "base/strings/string_util.h"
 #include "base/strings/utf_string_conversions.h"
 #include "components/history/core/browser/keyword_search_term.h"
 #include "sql/database.h"
+#include "sql/statement.h"
 #include "testing/gtest/include/gtest/gtest.h"
 
 using base::Time;
@@ -379,6 +384,143 @@ TEST_F(URLDatabaseTest, GetAndDeleteKeywordSearchTermByTerm) {
   EXPECT_TRUE(rows.empty());
 }
 
+// Tests that the search terms are suggested once per search URL, and that the
+// normalized search terms only count the visits newer than the age threshold.
+TEST_F(URLDatabaseTest, KeywordSearchTermsAgeThreshold) {
+  const KeywordID keyword_id = 100;
+  const Time now = Time::Now();
+  URLRow old_url(GURL("https://www.google.com/search?q=Weather"));
+  old_url.set_visit_count(3);
+  old_url.set_last_visit(now - TimeDelta::FromDays(10));
+  URLID old_url_id = AddURL(old_url);
+  ASSERT_TRUE(SetKeywordSearchTermsForURL(old_url_id, keyword_id, u"Weather"));
+  URLRow new_url(GURL("https://www.google.com/search?q=weather+"));
+  new_url.set_visit_count(2);
+  new_url.set_last_visit(now - TimeDelta::FromDays(1));
+  URLID new_url_id = AddURL(new_url);
+  ASSERT_TRUE(
+      SetKeywordSearchTermsForURL(new_url_id, keyword_id, u"weather  "));
+  URLRow other_url(GURL("https://www.google.com/search?q=web"));
+  other_url.set_visit_count(1);
+  other_url.set_last_visit(now - TimeDelta::FromHours(1));
+  ASSERT_TRUE(
+      SetKeywordSearchTermsForURL(AddURL(other_url), keyword_id, u"web"));
+
+  std::vector<KeywordSearchTermVisit> matches;
+  GetMostRecentKeywordSearchTerms(keyword_id, u"WE", 10, &matches);
+  ASSERT_EQ(3U, matches.size());
+  EXPECT_EQ(u"web", matches[0].term);
+  EXPECT_EQ(u"weather  ", matches[1].term);
+  EXPECT_EQ(2, matches[1].visits);
+  EXPECT_EQ(u"Weather", matches[2].term);
+  EXPECT_EQ(3, matches[2].visits);
+
+  std::vector<NormalizedKeywordSearchTermVisit> zero_prefix_matches =
+      GetMostRecentNormalizedKeywordSearchTerms(keyword_id,
+                                                now - TimeDelta::FromDays(30));
+  ASSERT_EQ(2U, zero_prefix_matches.size());
+  EXPECT_EQ(u"web", zero_prefix_matches[0].normalized_term);
+  EXPECT_EQ(u"weather", zero_prefix_matches[1].normalized_term);
+  EXPECT_EQ(5, zero_prefix_matches[1].visits);
+
+  // The visits of the older search are not counted within a week.
+  zero_prefix_matches = GetMostRecentNormalizedKeywordSearchTerms(
+      keyword_id, now - TimeDelta::FromDays(7));
+  ASSERT_EQ(2U, zero_prefix_matches.size());
+  EXPECT_EQ(u"weather", zero_prefix_matches[1].normalized_term);
+  EXPECT_EQ(2, zero_prefix_matches[1].visits);
+  EXPECT_EQ(new_url.last_visit(),
+            zero_prefix_matches[1].most_recent_visit_time);
+
+  // Nor are any visits of the term within half a day.
+  zero_prefix_matches = GetMostRecentNormalizedKeywordSearchTerms(
+      keyword_id, now - TimeDelta::FromHours(12));
+  ASSERT_EQ(1U, zero_prefix_matches.size());
+  EXPECT_EQ(u"web", zero_prefix_matches[0].normalized_term);
+
+  // Visiting the older search again makes the term the most recent one.
+  old_url.set_visit_count(4);
+  old_url.set_last_visit(now);
+  ASSERT_TRUE(UpdateURLRow(old_url_id, old_url));
+  zero_prefix_matches = GetMostRecentNormalizedKeywordSearchTerms(
+      keyword_id, now - TimeDelta::FromDays(7));
+  ASSERT_EQ(2U, zero_prefix_matches.size());
+  EXPECT_EQ(u"weather", zero_prefix_matches[0].normalized_term);
+  EXPECT_EQ(6, zero_prefix_matches[0].visits);
+  EXPECT_EQ(u"web", zero_prefix_matches[1].normalized_term);
+
+  // Deleting its URLs one at a time deletes the normalized search term last.
+  ASSERT_TRUE(DeleteURLRow(old_url_id));
+  zero_prefix_matches = GetMostRecentNormalizedKeywordSearchTerms(
+      keyword_id, now - TimeDelta::FromDays(7));
+  ASSERT_EQ(2U, zero_prefix_matches.size());
+  EXPECT_EQ(u"web", zero_prefix_matches[0].normalized_term);
+  EXPECT_EQ(u"weather", zero_prefix_matches[1].normalized_term);
+  EXPECT_EQ(2, zero_prefix_matches[1].visits);
+  ASSERT_TRUE(DeleteKeywordSearchTermForURL(new_url_id));
+  zero_prefix_matches = GetMostRecentNormalizedKeywordSearchTerms(
+      keyword_id, now - TimeDelta::FromDays(7));
+  ASSERT_EQ(1U, zero_prefix_matches.size());
+  EXPECT_EQ(u"web", zero_prefix_matches[0].normalized_term);
+}
+
+// Tests that the normalized search terms kept up to date as search terms and
+// URLs change match the ones rebuilt from scratch.
+TEST_F(URLDatabaseTest, NormalizedKeywordSearchTermsMatchRebuild) {
+  const Time now = Time::Now();
+  std::vector<URLID> url_ids;
+  for (int i = 0; i < 40; ++i) {
+    URLRow row(GURL("https://www.google.com/search?q=" +
+                    base::NumberToString(i)));
+    row.set_visit_count(1 + i % 4);
+    row.set_last_visit(now - TimeDelta::FromHours(i * 7));
+    url_ids.push_back(AddURL(row));
+    ASSERT_TRUE(SetKeywordSearchTermsForURL(
+        url_ids.back(), 1 + i % 2,
+        i % 3 ? u"Term " + base::NumberToString16(i % 5)
+              : u"term  " + base::NumberToString16(i % 5)));
+  }
+  for (int i = 0; i < 40; i += 3) {
+    URLRow row;
+    ASSERT_TRUE(GetURLRow(url_ids[i], &row));
+    row.set_visit_count(row.visit_count() + 2);
+    row.set_last_visit(now - TimeDelta::FromMinutes(i));
+    ASSERT_TRUE(UpdateURLRow(url_ids[i], row));
+  }
+  ASSERT_TRUE(DeleteURLRow(url_ids[5]));
+  ASSERT_TRUE(DeleteKeywordSearchTermForURL(url_ids[8]));
+  ASSERT_TRUE(DeleteKeywordSearchTerm(u"Term 1"));
+  ASSERT_TRUE(DeleteKeywordSearchTermForNormalizedTerm(2, u"term 2"));
+
+  // Some of the terms have URLs on both sides of the threshold.
+  const Time age_threshold = now - TimeDelta::FromDays(5);
+  for (KeywordID keyword_id : {1, 2}) {
+    std::vector<NormalizedKeywordSearchTermVisit> visits =
+        GetMostRecentNormalizedKeywordSearchTerms(keyword_id, age_threshold);
+    std::vector<KeywordSearchTermVisit> matches;
+    GetMostRecentKeywordSearchTerms(keyword_id, u"term", 10, &matches);
+    ASSERT_TRUE(RebuildNormalizedKeywordSearchTerms());
+    std::vector<NormalizedKeywordSearchTermVisit> rebuilt_visits =
+        GetMostRecentNormalizedKeywordSearchTerms(keyword_id, age_threshold);
+    std::vector<KeywordSearchTermVisit> rebuilt_matches;
+    GetMostRecentKeywordSearchTerms(keyword_id, u"term", 10, &rebuilt_matches);
+
+    EXPECT_FALSE(visits.empty());
+    ASSERT_EQ(rebuilt_visits.size(), visits.size());
+    for (size_t i = 0; i < visits.size(); ++i) {
+      EXPECT_EQ(rebuilt_visits[i].normalized_term, visits[i].normalized_term);
+      EXPECT_EQ(rebuilt_visits[i].visits, visits[i].visits);
+      EXPECT_EQ(rebuilt_visits[i].most_recent_visit_time,
+                visits[i].most_recent_visit_time);
+    }
+    ASSERT_EQ(rebuilt_matches.size(), matches.size());
+    for (size_t i = 0; i < matches.size(); ++i) {
+      EXPECT_EQ(rebuilt_matches[i].term, matches[i].term);
+      EXPECT_EQ(rebuilt_matches[i].visits, matches[i].visits);
+    }
+  }
+}
+
 // Test for migration of update URL table, verify AUTOINCREMENT is working
 // properly.
 TEST_F(URLDatabaseTest, MigrationURLTableForAddingAUTOINCREMENT) {
@@ -483,4 +625,198 @@ TEST_F(URLDatabaseTest, URLTableContainsAUTOINCREMENTTest) {
   EXPECT_TRUE(URLTableContainsAutoincrement());
 }
 
+// Tests that GetTextMatches() finds the same rows through the url_words table
+// as it does by looking at every row, as rows are added, updated and deleted.
+TEST_F(URLDatabaseTest, TextMatchesWithURLWords) {
+  ASSERT_TRUE(InitURLSearchIndices());
+
+  URLRow url_info1(GURL("http://www.google.com/"));
+  url_info1.set_title(u"Search Engine");
+  URLID id1 = AddURL(url_info1);
+  ASSERT_TRUE(id1);
+
+  URLRow url_info2(GURL("http://news.example.com/weekly"));
+  url_info2.set_title(u"Weekly News");
+  URLID id2 = AddURL(url_info2);
+  ASSERT_TRUE(id2);
+
+  URLRow url_info3(GURL("http://www.example.com/hidden"));
+  url_info3.set_title(u"Hidden News");
+  url_info3.set_hidden(true);
+  ASSERT_TRUE(AddURL(url_info3));
+
+  auto get_matches = [this](const std::u16string& query) {
+    std::vector<URLID> ids;
+    URLRows results;
+    GetTextMatches(query, &results);
+    for (const URLRow& row : results)
+      ids.push_back(row.id());
+    return ids;
+  };
+  EXPECT_EQ(std::vector<URLID>({id1}), get_matches(u"goo"));
+  EXPECT_EQ(std::vector<URLID>({id1}), get_matches(u"google sear"));
+  EXPECT_EQ(std::vector<URLID>({id2}), get_matches(u"news"));
+  EXPECT_EQ(std::vector<URLID>({id1, id2}), get_matches(u"com"));
+  EXPECT_EQ(std::vector<URLID>(), get_matches(u"google news"));
+
+  // A new title replaces the words of the old one.
+  url_info1.set_title(u"Daily News");
+  ASSERT_TRUE(UpdateURLRow(id1, url_info1));
+  EXPECT_EQ(std::vector<URLID>({id1}), get_matches(u"daily"));
+  EXPECT_EQ(std::vector<URLID>({id1}), get_matches(u"google"));
+  EXPECT_EQ(std::vector<URLID>(), get_matches(u"engine"));
+  EXPECT_EQ(std::vector<URLID>({id1, id2}), get_matches(u"news"));
+
+  ASSERT_TRUE(DeleteURLRow(id2));
+  EXPECT_EQ(std::vector<URLID>({id1}), get_matches(u"news"));
+
+  url_info2.set_id(id2);
+  ASSERT_TRUE(InsertOrUpdateURLRowByID(url_info2));
+  EXPECT_EQ(std::vector<URLID>({id2}), get_matches(u"weekly"));
+}
+
+// Tests that the query words held by too many rows to narrow them down are
+// matched against the rows rather than looked up in the url_words table.
+TEST_F(URLDatabaseTest, TextMatchesWithCommonWords) {
+  ASSERT_TRUE(InitURLSearchIndices());
+  std::vector<URLID> site42_ids;
+  for (size_t i = 0; i <= kMaxURLIDsPerQueryWord; ++i) {
+    const std::string site = "site" + base::NumberToString(i);
+    URLRow row(GURL("https://www." + site + ".com/"));
+    row.set_title(u"Page");
+    const URLID id = AddURL(row);
+    ASSERT_TRUE(id);
+    if (base::StartsWith(site, "site42"))
+      site42_ids.push_back(id);
+  }
+
+  auto get_matches = [this](const std::u16string& query) {
+    std::vector<URLID> ids;
+    URLRows results;
+    GetTextMatches(query, &results);
+    for (const URLRow& row : results)
+      ids.push_back(row.id());
+    std::sort(ids.begin(), ids.end());
+    return ids;
+  };
+  EXPECT_EQ(kMaxURLIDsPerQueryWord + 1, get_matches(u"https page").size());
+  EXPECT_EQ(site42_ids, get_matches(u"https www site42 page"));
+  EXPECT_EQ(std::vector<URLID>(), get_matches(u"https missing"));
+}
+
+// Tests that InsertOrUpdateURLRowByID() replaces the words of the row it
+// replaces.
+TEST_F(URLDatabaseTest, InsertOrUpdateURLRowByIDReplacesURLWords) {
+  ASSERT_TRUE(InitURLSearchIndices());
+
+  URLRow old_row(GURL("http://www.old.com/"));
+  old_row.set_title(u"Old Title");
+  old_row.set_id(AddURL(old_row));
+  ASSERT_TRUE(old_row.id());
+
+  URLRow new_row(GURL("http://www.new.com/"), old_row.id());
+  new_row.set_title(u"New Title");
+  ASSERT_TRUE(InsertOrUpdateURLRowByID(new_row));
+
+  URLRows results;
+  EXPECT_FALSE(GetTextMatches(u"old", &results));
+  ASSERT_TRUE(GetTextMatches(u"new title", &results));
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(old_row.id(), results[0].id());
+
+  sql::Statement words(GetDB().GetUniqueStatement(
+      "SELECT COUNT(*) FROM url_words WHERE word = 'old'"));
+  ASSERT_TRUE(words.Step());
+  EXPECT_EQ(0, words.ColumnInt(0));
+}
+
+// Tests that IndexURLWordsBatch() fills the url_words table in batches, while
+// GetTextMatches() keeps finding every row.
+TEST_F(URLDatabaseTest, IndexURLWordsBatch) {
+  ASSERT_TRUE(InitURLSearchIndices());
+  std::vector<URLID> ids;
+  for (const char* url : {"http://www.alpha.com/", "http://www.beta.com/",
+                          "http://www.gamma.com/"}) {
+    ids.push_back(AddURL(URLRow(GURL(url))));
+    ASSERT_TRUE(ids.back());
+  }
+  ASSERT_TRUE(GetDB().Execute("DELETE FROM url_words"));
+  set_url_words_incomplete();
+
+  URLRows results;
+  ASSERT_TRUE(GetTextMatches(u"gamma", &results));
+  EXPECT_EQ(ids[2], results[0].id());
+
+  URLID last_url_id = 0;
+  bool done = false;
+  ASSERT_TRUE(IndexURLWordsBatch(2, &last_url_id, &done));
+  EXPECT_EQ(ids[1], last_url_id);
+  EXPECT_FALSE(done);
+  ASSERT_TRUE(GetTextMatches(u"gamma", &results));
+  EXPECT_EQ(ids[2], results[0].id());
+
+  ASSERT_TRUE(IndexURLWordsBatch(2, &last_url_id, &done));
+  EXPECT_EQ(ids[2], last_url_id);
+  EXPECT_TRUE(done);
+  ASSERT_TRUE(GetTextMatches(u"gamma", &results));
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(ids[2], results[0].id());
+  ASSERT_TRUE(GetTextMatches(u"alpha", &results));
+  EXPECT_EQ(ids[0], results[0].id());
+}
+
+// Tests that the url_words table follows the IDs of the rows kept when the URL
+// table is replaced.
+TEST_F(URLDatabaseTest, TextMatchesAfterCommitTemporaryURLTable) {
+  ASSERT_TRUE(InitURLSearchIndices());
+
+  URLRow dropped(GURL("http://www.dropped.com/"));
+  ASSERT_TRUE(AddURL(dropped));
+  URLRow kept(GURL("http://www.kept.com/"));
+  kept.set_title(u"Kept");
+  ASSERT_TRUE(AddURL(kept));
+
+  ASSERT_TRUE(CreateTemporaryURLTable());
+  URLID kept_id = AddTemporaryURL(kept);
+  ASSERT_TRUE(kept_id);
+  ASSERT_TRUE(CommitTemporaryURLTable());
+
+  URLRows results;
+  EXPECT_FALSE(GetTextMatches(u"dropped", &results));
+  ASSERT_TRUE(GetTextMatches(u"kept", &results));
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(kept_id, results[0].id());
+}
+
+// Tests that AutocompleteForPrefix() returns the same typed URLs through the
+// index of typed URLs.
+TEST_F(URLDatabaseTest, AutocompleteForPrefixWithTypedURLIndex) {
+  ASSERT_TRUE(InitURLSearchIndices());
+
+  URLRow typed(GURL("http://www.google.com/typed"));
+  typed.set_typed_count(1);
+  ASSERT_TRUE(AddURL(typed));
+  URLRow typed_more(GURL("http://www.google.com/typed_more"));
+  typed_more.set_typed_count(2);
+  ASSERT_TRUE(AddURL(typed_more));
+  URLRow typed_hidden(GURL("http://www.google.com/hidden"));
+  typed_hidden.set_typed_count(3);
+  typed_hidden.set_hidden(true);
+  ASSERT_TRUE(AddURL(typed_hidden));
+  URLRow visited(GURL("http://www.google.com/visited"));
+  visited.set_visit_count(5);
+  ASSERT_TRUE(AddURL(visited));
+
+  URLRows results;
+  ASSERT_TRUE(AutocompleteForPrefix("http://www.google.com/", 10,
+                                    /*typed_only=*/true, &results));
+  ASSERT_EQ(2u, results.size());
+  EXPECT_EQ(typed_more.url(), results[0].url());
+  EXPECT_EQ(typed.url(), results[1].url());
+
+  ASSERT_TRUE(AutocompleteForPrefix("http://www.google.com/", 10,
+                                    /*typed_only=*/false, &results));
+  EXPECT_EQ(3u, results.size());
+}
+
 }  // namespace history
@@ -0,0 +1,679 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "components/history/core/browser/url_snapshot.h"
+
+#include <string.h>
+
+#include <algorithm>
+#include <limits>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "base/check.h"
+#include "base/files/file.h"
+#include "base/files/file_util.h"
+#include "base/files/important_file_writer.h"
+#include "base/files/memory_mapped_file.h"
+#include "base/hash/hash.h"
+#include "base/memory/ptr_util.h"
+#include "base/pickle.h"
+#include "base/strings/string_util.h"
+#include "base/strings/utf_string_conversions.h"
+#include "base/time/time.h"
+#include "components/history/core/browser/url_database.h"
+#include "url/gurl.h"
+
+namespace history {
+
+namespace {
+
+// "HUSN", for History URL SNapshot, in little endian.
+constexpr uint32_t kMagic = 0x4e535548;
+constexpr uint32_t kVersion = 2;
+
+// The base file is a FileHeader, followed by `entry_count` Entries sorted by
+// URL, followed by the UTF-8 strings they point to.
+struct FileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t entry_count;
+  uint32_t strings_size;
+  // The generation of the history database the rows were committed at.
+  int64_t generation;
+};
+
+struct Entry {
+  // Relative to the start of the strings.
+  uint32_t url_offset;
+  uint32_t url_size;
+  uint32_t title_offset;
+  uint32_t title_size;
+  int64_t id;
+  // Microseconds since the Windows epoch, as in the history database.
+  int64_t last_visit;
+  int32_t visit_count;
+  int32_t typed_count;
+  uint32_t hidden;
+  uint32_t unused;
+};
+
+static_assert(sizeof(FileHeader) == 24, "FileHeader has padding");
+static_assert(sizeof(Entry) == 48, "Entry has padding");
+
+// Each journal record is a RecordHeader followed by a pickled RecordType and
+// its data. The checksum tells apart a record that was only partly written.
+struct RecordHeader {
+  uint32_t size;
+  uint32_t checksum;
+};
+
+enum class RecordType {
+  // Followed by a row.
+  kInsertOrUpdate = 1,
+  // Followed by a URL.
+  kDelete = 2,
+  // Deletes all the rows.
+  kClear = 3,
+  // Followed by the generation of the history database the records before it
+  // were committed at. Ends the records of each commit.
+  kCommit = 4,
+};
+
+// The journal is folded into the base file once larger than a quarter of it,
+// and than this.
+constexpr size_t kMinJournalSizeToCompact = 64 * 1024;
+
+int64_t TimeToMicroseconds(base::Time time) {
+  return time.ToDeltaSinceWindowsEpoch().InMicroseconds();
+}
+
+base::Time MicrosecondsToTime(int64_t microseconds) {
+  return base::Time::FromDeltaSinceWindowsEpoch(
+      base::TimeDelta::FromMicroseconds(microseconds));
+}
+
+void WriteRow(const URLRow& row, base::Pickle* pickle) {
+  pickle->WriteString(row.url().spec());
+  pickle->WriteString16(row.title());
+  pickle->WriteInt64(row.id());
+  pickle->WriteInt64(TimeToMicroseconds(row.last_visit()));
+  pickle->WriteInt(row.visit_count());
+  pickle->WriteInt(row.typed_count());
+  pickle->WriteBool(row.hidden());
+}
+
+bool ReadRow(base::PickleIterator* iter, URLRow* row) {
+  std::string url;
+  std::u16string title;
+  int64_t id;
+  int64_t last_visit;
+  int visit_count;
+  int typed_count;
+  bool hidden;
+  if (!iter->ReadString(&url) || !iter->ReadString16(&title) ||
+      !iter->ReadInt64(&id) || !iter->ReadInt64(&last_visit) ||
+      !iter->ReadInt(&visit_count) || !iter->ReadInt(&typed_count) ||
+      !iter->ReadBool(&hidden)) {
+    return false;
+  }
+  *row = URLRow(GURL(url), id);
+  row->set_title(title);
+  row->set_last_visit(MicrosecondsToTime(last_visit));
+  row->set_visit_count(visit_count);
+  row->set_typed_count(typed_count);
+  row->set_hidden(hidden);
+  return true;
+}
+
+// Appends the journal record holding `pickle` to `records`.
+void AppendRecord(const base::Pickle& pickle, std::string* records) {
+  base::StringPiece payload(static_cast<const char*>(pickle.data()),
+                            pickle.size());
+  RecordHeader header = {static_cast<uint32_t>(payload.size()),
+                         base::PersistentHash(payload)};
+  records->append(reinterpret_cast<const char*>(&header), sizeof(header));
+  records->append(payload.data(), payload.size());
+}
+
+}  // namespace
+
+// The mapped base file. Offsets are checked as entries are read rather than
+// up front, so that opening the file doesn't read all of it.
+class URLSnapshot::BaseFile {
+ public:
+  BaseFile() = default;
+  BaseFile(const BaseFile&) = delete;
+  BaseFile& operator=(const BaseFile&) = delete;
+
+  bool Initialize(const base::FilePath& path) {
+    if (!file_.Initialize(path))
+      return false;
+    if (file_.length() < sizeof(FileHeader))
+      return false;
+    FileHeader header;
+    memcpy(&header, file_.data(), sizeof(header));
+    if (header.magic != kMagic || header.version != kVersion)
+      return false;
+    const uint64_t expected_length =
+        sizeof(FileHeader) +
+        static_cast<uint64_t>(header.entry_count) * sizeof(Entry) +
+        header.strings_size;
+    if (file_.length() != expected_length)
+      return false;
+    entry_count_ = header.entry_count;
+    generation_ = header.generation;
+    strings_ = reinterpret_cast<const char*>(file_.data()) +
+               sizeof(FileHeader) + entry_count_ * sizeof(Entry);
+    strings_size_ = header.strings_size;
+    return true;
+  }
+
+  size_t entry_count() const { return entry_count_; }
+  size_t length() const { return file_.length(); }
+  int64_t generation() const { return generation_; }
+
+  Entry GetEntry(size_t index) const {
+    DCHECK_LT(index, entry_count_);
+    Entry entry;
+    memcpy(&entry, file_.data() + sizeof(FileHeader) + index * sizeof(Entry),
+           sizeof(entry));
+    return entry;
+  }
+
+  base::StringPiece GetURL(size_t index) const {
+    Entry entry = GetEntry(index);
+    return GetString(entry.url_offset, entry.url_size);
+  }
+
+  URLRow GetRow(size_t index) const {
+    Entry entry = GetEntry(index);
+    URLRow row(GURL(GetString(entry.url_offset, entry.url_size)), entry.id);
+    row.set_title(
+        base::UTF8ToUTF16(GetString(entry.title_offset, entry.title_size)));
+    row.set_last_visit(MicrosecondsToTime(entry.last_visit));
+    row.set_visit_count(entry.visit_count);
+    row.set_typed_count(entry.typed_count);
+    row.set_hidden(entry.hidden != 0);
+    return row;
+  }
+
+  // Returns the index of the first entry whose URL is not less than `url`.
+  size_t LowerBound(base::StringPiece url) const {
+    size_t begin = 0;
+    size_t end = entry_count_;
+    while (begin < end) {
+      size_t middle = begin + (end - begin) / 2;
+      if (GetURL(middle) < url)
+        begin = middle + 1;
+      else
+        end = middle;
+    }
+    return begin;
+  }
+
+ private:
+  // Returns an empty string if the entry points outside of the strings.
+  base::StringPiece GetString(uint32_t offset, uint32_t size) const {
+    if (offset > strings_size_ || size > strings_size_ - offset)
+      return base::StringPiece();
+    return base::StringPiece(strings_ + offset, size);
+  }
+
+  base::MemoryMappedFile file_;
+  size_t entry_count_ = 0;
+  int64_t generation_ = 0;
+  const char* strings_ = nullptr;
+  size_t strings_size_ = 0;
+};
+
+// A row matching an autocomplete prefix, with what it is ranked by.
+struct URLSnapshot::Candidate {
+  int typed_count;
+  int visit_count;
+  int64_t last_visit;
+  // The row, from the overlay if set, or else from the base file.
+  const URLRow* overlay_row;
+  size_t base_index;
+};
+
+URLSnapshot::URLSnapshot() = default;
+
+URLSnapshot::~URLSnapshot() = default;
+
+// static
+base::FilePath URLSnapshot::GetJournalPath(const base::FilePath& path) {
+  return base::FilePath(path.value() + FILE_PATH_LITERAL("-journal"));
+}
+
+// static
+std::unique_ptr<URLSnapshot> URLSnapshot::Open(const base::FilePath& path) {
+  std::unique_ptr<URLSnapshot> snapshot(new URLSnapshot());
+  snapshot->base_file_ = std::make_unique<BaseFile>();
+  if (!snapshot->base_file_->Initialize(path))
+    return nullptr;
+  snapshot->generation_ = snapshot->base_file_->generation();
+
+  std::string journal;
+  if (base::ReadFileToString(GetJournalPath(path), &journal))
+    snapshot->ReplayJournal(journal);
+  return snapshot;
+}
+
+// static
+std::unique_ptr<URLSnapshot> URLSnapshot::CreateEmpty() {
+  return base::WrapUnique(new URLSnapshot());
+}
+
+URLID URLSnapshot::GetRowForURL(const GURL& url, URLRow* row) const {
+  const std::string& url_spec = url.spec();
+  if (const absl::optional<URLRow>* overlay_row = FindInOverlay(url_spec)) {
+    if (!overlay_row->has_value())
+      return 0;
+    if (row)
+      *row = **overlay_row;
+    return (*overlay_row)->id();
+  }
+
+  if (!base_file_ || base_file_cleared_)
+    return 0;
+  size_t index = base_file_->LowerBound(url_spec);
+  if (index == base_file_->entry_count() ||
+      base_file_->GetURL(index) != base::StringPiece(url_spec)) {
+    return 0;
+  }
+  if (row)
+    *row = base_file_->GetRow(index);
+  return base_file_->GetEntry(index).id;
+}
+
+bool URLSnapshot::AutocompleteForPrefix(const std::string& prefix,
+                                        size_t max_results,
+                                        URLRows* results) const {
+  results->clear();
+
+  // Only the entries of the top rows are turned into URLRows, which is the
+  // costly part.
+  std::vector<Candidate> candidates;
+  if (base_file_ && !base_file_cleared_) {
+    for (size_t i = base_file_->LowerBound(prefix);
+         i < base_file_->entry_count(); ++i) {
+      base::StringPiece url = base_file_->GetURL(i);
+      if (!base::StartsWith(url, prefix))
+        break;
+      Entry entry = base_file_->GetEntry(i);
+      if (entry.hidden || entry.typed_count <= 0)
+        continue;
+      if (!overlay_.empty() && FindInOverlay(std::string(url)))
+        continue;
+      candidates.push_back({entry.typed_count, entry.visit_count,
+                            entry.last_visit, nullptr, i});
+    }
+  }
+  for (auto it = overlay_.lower_bound(prefix);
+       it != overlay_.end() && base::StartsWith(it->first, prefix); ++it) {
+    const absl::optional<URLRow>& row = it->second;
+    if (!row || row->hidden() || row->typed_count() <= 0)
+      continue;
+    candidates.push_back({row->typed_count(), row->visit_count(),
+                          TimeToMicroseconds(row->last_visit()), &*row, 0});
+  }
+
+  // Sorted by typed count, then by visit count, then by visit date, all
+  // descending, as in URLDatabase.
+  const size_t result_count = std::min(max_results, candidates.size());
+  std::partial_sort(
+      candidates.begin(), candidates.begin() + result_count, candidates.end(),
+      [](const Candidate& a, const Candidate& b) {
+        return std::tie(a.typed_count, a.visit_count, a.last_visit) >
+               std::tie(b.typed_count, b.visit_count, b.last_visit);
+      });
+  for (size_t i = 0; i < result_count; ++i) {
+    const Candidate& candidate = candidates[i];
+    URLRow row = candidate.overlay_row
+                     ? *candidate.overlay_row
+                     : base_file_->GetRow(candidate.base_index);
+    if (row.url().is_valid())
+      results->push_back(std::move(row));
+  }
+  return !results->empty();
+}
+
+URLRows URLSnapshot::GetAllRows() const {
+  URLRows rows;
+  const size_t base_count =
+      base_file_ && !base_file_cleared_ ? base_file_->entry_count() : 0;
+  size_t index = 0;
+  auto it = overlay_.begin();
+  while (index < base_count || it != overlay_.end()) {
+    if (it == overlay_.end()) {
+      rows.push_back(base_file_->GetRow(index++));
+      continue;
+    }
+    const base::StringPiece overlay_url = it->first;
+    if (index < base_count && base_file_->GetURL(index) < overlay_url) {
+      rows.push_back(base_file_->GetRow(index++));
+      continue;
+    }
+    // The overlay hides the row of the base file for the same URL.
+    if (index < base_count && base_file_->GetURL(index) == overlay_url)
+      ++index;
+    if (it->second)
+      rows.push_back(*it->second);
+    ++it;
+  }
+  return rows;
+}
+
+void URLSnapshot::InsertOrUpdateURLRow(const URLRow& row) {
+  if (row.typed_count() > 0)
+    overlay_[row.url().spec()] = row;
+  else
+    DeleteURL(row.url());
+}
+
+void URLSnapshot::DeleteURL(const GURL& url) {
+  // Most deleted or modified URLs were never typed, and need not be tracked.
+  if (GetRowForURL(url, nullptr))
+    overlay_[url.spec()] = absl::nullopt;
+}
+
+bool URLSnapshot::ShouldCompact() const {
+  if (journal_has_deletions_ || journal_truncated_)
+    return true;
+  const size_t base_length = base_file_ ? base_file_->length() : 0;
+  return journal_size_ > std::max(kMinJournalSizeToCompact, base_length / 4);
+}
+
+void URLSnapshot::ReplayJournal(base::StringPiece journal) {
+  journal_size_ = journal.size();
+  // The records of a commit are only applied once its kCommit record is read,
+  // so that none of those of a commit that was only partly written are.
+  std::vector<base::StringPiece> commit_records;
+  while (!journal.empty()) {
+    RecordHeader header;
+    if (journal.size() < sizeof(header)) {
+      journal_truncated_ = true;
+      return;
+    }
+    memcpy(&header, journal.data(), sizeof(header));
+    journal.remove_prefix(sizeof(header));
+    if (header.size > journal.size()) {
+      journal_truncated_ = true;
+      return;
+    }
+    base::StringPiece payload = journal.substr(0, header.size);
+    journal.remove_prefix(header.size);
+    if (base::PersistentHash(payload) != header.checksum) {
+      journal_truncated_ = true;
+      return;
+    }
+
+    base::Pickle pickle(payload.data(), payload.size());
+    base::PickleIterator iter(pickle);
+    int type;
+    if (!iter.ReadInt(&type)) {
+      journal_truncated_ = true;
+      return;
+    }
+    if (static_cast<RecordType>(type) != RecordType::kCommit) {
+      commit_records.push_back(payload);
+      continue;
+    }
+    int64_t generation;
+    if (!iter.ReadInt64(&generation)) {
+      journal_truncated_ = true;
+      return;
+    }
+    for (base::StringPiece record : commit_records) {
+      if (!ApplyRecord(record)) {
+        journal_truncated_ = true;
+        return;
+      }
+    }
+    commit_records.clear();
+    generation_ = generation;
+  }
+  if (!commit_records.empty())
+    journal_truncated_ = true;
+}
+
+bool URLSnapshot::ApplyRecord(base::StringPiece payload) {
+  base::Pickle pickle(payload.data(), payload.size());
+  base::PickleIterator iter(pickle);
+  int type;
+  if (!iter.ReadInt(&type))
+    return false;
+  switch (static_cast<RecordType>(type)) {
+    case RecordType::kInsertOrUpdate: {
+      URLRow row;
+      if (!ReadRow(&iter, &row))
+        return false;
+      InsertOrUpdateURLRow(row);
+      return true;
+    }
+    case RecordType::kDelete: {
+      std::string url_spec;
+      if (!iter.ReadString(&url_spec))
+        return false;
+      overlay_[url_spec] = absl::nullopt;
+      journal_has_deletions_ = true;
+      return true;
+    }
+    case RecordType::kClear:
+      overlay_.clear();
+      base_file_cleared_ = true;
+      journal_has_deletions_ = true;
+      return true;
+    default:
+      return false;
+  }
+}
+
+const absl::optional<URLRow>* URLSnapshot::FindInOverlay(
+    const std::string& url_spec) const {
+  auto it = overlay_.find(url_spec);
+  return it != overlay_.end() ? &it->second : nullptr;
+}
+
+URLSnapshotWriter::URLSnapshotWriter(const base::FilePath& path)
+    : path_(path) {}
+
+URLSnapshotWriter::~URLSnapshotWriter() = default;
+
+// static
+void URLSnapshotWriter::DeleteFiles(const base::FilePath& path) {
+  base::DeleteFile(path);
+  base::DeleteFile(URLSnapshot::GetJournalPath(path));
+}
+
+// static
+bool URLSnapshotWriter::WriteBaseFile(const base::FilePath& path,
+                                      const URLRows& rows,
+                                      int64_t generation) {
+  std::vector<Entry> entries;
+  entries.reserve(rows.size());
+  std::string strings;
+  for (const URLRow& row : rows) {
+    const std::string& url = row.url().spec();
+    const std::string title = base::UTF16ToUTF8(row.title());
+    DCHECK(entries.empty() ||
+           base::StringPiece(strings).substr(entries.back().url_offset,
+                                             entries.back().url_size) <
+               base::StringPiece(url));
+    if (strings.size() + url.size() + title.size() >
+        std::numeric_limits<uint32_t>::max()) {
+      return false;
+    }
+
+    Entry entry = {};
+    entry.url_offset = static_cast<uint32_t>(strings.size());
+    entry.url_size = static_cast<uint32_t>(url.size());
+    strings.append(url);
+    entry.title_offset = static_cast<uint32_t>(strings.size());
+    entry.title_size = static_cast<uint32_t>(title.size());
+    strings.append(title);
+    entry.id = row.id();
+    entry.last_visit = TimeToMicroseconds(row.last_visit());
+    entry.visit_count = row.visit_count();
+    entry.typed_count = row.typed_count();
+    entry.hidden = row.hidden();
+    entries.push_back(entry);
+  }
+
+  FileHeader header = {kMagic, kVersion, static_cast<uint32_t>(entries.size()),
+                       static_cast<uint32_t>(strings.size()), generation};
+  std::string data;
+  data.reserve(sizeof(header) + entries.size() * sizeof(Entry) +
+               strings.size());
+  data.append(reinterpret_cast<const char*>(&header), sizeof(header));
+  data.append(reinterpret_cast<const char*>(entries.data()),
+              entries.size() * sizeof(Entry));
+  data.append(strings);
+  if (!base::ImportantFileWriter::WriteFileAtomically(path, data))
+    return false;
+
+  // Replaying the journal over the new base file is harmless, if this fails.
+  base::DeleteFile(URLSnapshot::GetJournalPath(path));
+  return true;
+}
+
+bool URLSnapshotWriter::Init(URLDatabase* db, int64_t generation) {
+  std::unique_ptr<URLSnapshot> snapshot = URLSnapshot::Open(path_);
+  // A snapshot of another generation missed commits of the database, or holds
+  // changes whose transaction failed to commit.
+  if (snapshot && snapshot->generation() != generation)
+    snapshot.reset();
+  if (snapshot && !snapshot->ShouldCompact()) {
+    snapshot_ = std::move(snapshot);
+    return true;
+  }
+
+  URLRows rows;
+  if (snapshot) {
+    rows = snapshot->GetAllRows();
+    // Unmap the base file before replacing it.
+    snapshot.reset();
+  } else {
+    // There is no snapshot yet, or it is unusable: copy the typed URLs, as
+    // InMemoryDatabase::InitFromDisk() does.
+    URLDatabase::URLEnumerator enumerator;
+    if (!db->InitURLEnumeratorForEverything(&enumerator)) {
+      DeleteFiles(path_);
+      return false;
+    }
+    URLRow row;
+    while (enumerator.GetNextURL(&row)) {
+      if (row.typed_count() > 0)
+        rows.push_back(row);
+    }
+    std::sort(rows.begin(), rows.end(), [](const URLRow& a, const URLRow& b) {
+      return a.url().spec() < b.url().spec();
+    });
+  }
+
+  if (!WriteBaseFile(path_, rows, generation)) {
+    DeleteFiles(path_);
+    return false;
+  }
+  snapshot_ = URLSnapshot::Open(path_);
+  return !!snapshot_;
+}
+
+void URLSnapshotWriter::OnURLsModified(const URLRows& changed_urls) {
+  DCHECK(snapshot_);
+  for (const URLRow& row : changed_urls) {
+    const std::string& url_spec = row.url().spec();
+    // Rows that lost their last typed visit are deleted by Commit().
+    if (row.typed_count() > 0 || pending_rows_.count(url_spec) ||
+        snapshot_->GetRowForURL(row.url(), nullptr)) {
+      pending_rows_[url_spec] = row;
+    }
+  }
+}
+
+void URLSnapshotWriter::OnURLsDeleted(const URLRows& deleted_urls) {
+  DCHECK(snapshot_);
+  for (const URLRow& row : deleted_urls) {
+    const std::string& url_spec = row.url().spec();
+    if (pending_rows_.count(url_spec) ||
+        snapshot_->GetRowForURL(row.url(), nullptr)) {
+      pending_rows_[url_spec] = absl::nullopt;
+    }
+  }
+}
+
+void URLSnapshotWriter::OnAllHistoryDeleted() {
+  pending_rows_.clear();
+  pending_clear_ = true;
+  snapshot_ = URLSnapshot::CreateEmpty();
+}
+
+bool URLSnapshotWriter::HasPendingChanges() const {
+  return pending_clear_ || !pending_rows_.empty();
+}
+
+void URLSnapshotWriter::Commit(int64_t generation) {
+  if (!HasPendingChanges())
+    return;
+  DCHECK(snapshot_);
+
+  std::string records;
+  if (pending_clear_) {
+    base::Pickle pickle;
+    pickle.WriteInt(static_cast<int>(RecordType::kClear));
+    AppendRecord(pickle, &records);
+  }
+  for (const auto& url_and_row : pending_rows_) {
+    const absl::optional<URLRow>& row = url_and_row.second;
+    base::Pickle pickle;
+    if (row && row->typed_count() > 0) {
+      pickle.WriteInt(static_cast<int>(RecordType::kInsertOrUpdate));
+      WriteRow(*row, &pickle);
+      snapshot_->InsertOrUpdateURLRow(*row);
+    } else {
+      pickle.WriteInt(static_cast<int>(RecordType::kDelete));
+      pickle.WriteString(url_and_row.first);
+      snapshot_->DeleteURL(GURL(url_and_row.first));
+    }
+    AppendRecord(pickle, &records);
+  }
+  base::Pickle pickle;
+  pickle.WriteInt(static_cast<int>(RecordType::kCommit));
+  pickle.WriteInt64(generation);
+  AppendRecord(pickle, &records);
+  pending_rows_.clear();
+
+  if (!pending_clear_) {
+    AppendToJournal(records);
+    return;
+  }
+  pending_clear_ = false;
+  if (!base::WriteFile(URLSnapshot::GetJournalPath(path_), records)) {
+    DeleteFiles(path_);
+    return;
+  }
+  // Where the base file can't be deleted while mapped, the kClear record hides
+  // it until the next Init() replaces it.
+  base::DeleteFile(path_);
+}
+
+void URLSnapshotWriter::AppendToJournal(const std::string& records) {
+  if (records.empty())
+    return;
+  base::File journal(URLSnapshot::GetJournalPath(path_),
+                     base::File::FLAG_OPEN_ALWAYS | base::File::FLAG_APPEND);
+  if (journal.IsValid() &&
+      journal.WriteAtCurrentPos(records.data(),
+                                static_cast<int>(records.size())) ==
+          static_cast<int>(records.size())) {
+    return;
+  }
+  // The snapshot would be out of date. Without files, the next Init() copies
+  // the typed URLs again.
+  DeleteFiles(path_);
+}
+
+}  // namespace history
@@ -0,0 +1,177 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef COMPONENTS_HISTORY_CORE_BROWSER_URL_SNAPSHOT_H_
+#define COMPONENTS_HISTORY_CORE_BROWSER_URL_SNAPSHOT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/files/file_path.h"
+#include "base/strings/string_piece.h"
+#include "components/history/core/browser/url_row.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
+
+class GURL;
+
+namespace history {
+
+class URLDatabase;
+
+// A compact, read-only copy of the typed URLs of the history database, which
+// inline autocomplete can query synchronously. It replaces copying those rows
+// into the SQLite database of InMemoryDatabase at startup.
+//
+// The snapshot is stored in two files, maintained by URLSnapshotWriter on the
+// history thread:
+//  - The base file holds the rows sorted by URL, as fixed-size entries followed
+//    by their strings. It is memory-mapped, so that only the pages lookups
+//    touch are ever read, and the OS can drop them again.
+//  - The journal file holds the changes made since the base file was written,
+//    as checksummed records appended at each commit. They are replayed into a
+//    small in-memory overlay when the snapshot is opened.
+//
+// Both files record the generation of the history database they were last
+// committed at, which the database keeps in its meta table. A snapshot of
+// another generation is rebuilt from the database.
+//
+// Like InMemoryDatabase, an open snapshot is kept up to date by the
+// InMemoryHistoryBackend from history notifications, in its overlay.
+class URLSnapshot {
+ public:
+  URLSnapshot(const URLSnapshot&) = delete;
+  URLSnapshot& operator=(const URLSnapshot&) = delete;
+  ~URLSnapshot();
+
+  // Returns the path of the journal of the snapshot at `path`.
+  static base::FilePath GetJournalPath(const base::FilePath& path);
+
+  // Maps the snapshot at `path`, and replays its journal. Returns nullptr if
+  // the base file is missing or invalid.
+  static std::unique_ptr<URLSnapshot> Open(const base::FilePath& path);
+
+  // Creates an empty snapshot, backed by no file.
+  static std::unique_ptr<URLSnapshot> CreateEmpty();
+
+  // Returns the ID of the row for `url`, and fills in `row` if it is not null.
+  // Returns 0 if the snapshot has no such row.
+  URLID GetRowForURL(const GURL& url, URLRow* row) const;
+
+  // Same as URLDatabase::AutocompleteForPrefix() with `typed_only`, as the
+  // snapshot only holds typed URLs.
+  bool AutocompleteForPrefix(const std::string& prefix,
+                             size_t max_results,
+                             URLRows* results) const;
+
+  // Returns every row, sorted by URL.
+  URLRows GetAllRows() const;
+
+  // Returns the generation of the history database the snapshot was last
+  // committed at.
+  int64_t generation() const { return generation_; }
+
+  // Updates the overlay. Rows with no typed visit are removed.
+  void InsertOrUpdateURLRow(const URLRow& row);
+  void DeleteURL(const GURL& url);
+
+  // Whether the journal should be folded into the base file: because it grew
+  // large, holds deleted URLs that should not linger on disk, or ends with a
+  // record that was only partly written.
+  bool ShouldCompact() const;
+
+ private:
+  class BaseFile;
+  struct Candidate;
+
+  URLSnapshot();
+
+  // Replays the journal in `journal`. Stops at the first invalid record, and
+  // ignores the records of the commit it belongs to.
+  void ReplayJournal(base::StringPiece journal);
+
+  // Applies the journal record in `payload` to the overlay. Returns false if
+  // it is invalid.
+  bool ApplyRecord(base::StringPiece payload);
+
+  // Returns the overlay entry for `url_spec`, or nullptr if the overlay has
+  // none. A null row means the URL was deleted.
+  const absl::optional<URLRow>* FindInOverlay(const std::string& url_spec)
+      const;
+
+  std::unique_ptr<BaseFile> base_file_;
+
+  // Rows changed since the base file was written, by URL. Deleted rows are
+  // kept as nullopt, to hide those of the base file.
+  std::map<std::string, absl::optional<URLRow>> overlay_;
+  // Whether all history was deleted after the base file was written.
+  bool base_file_cleared_ = false;
+
+  int64_t generation_ = 0;
+
+  size_t journal_size_ = 0;
+  bool journal_has_deletions_ = false;
+  bool journal_truncated_ = false;
+};
+
+// Maintains the files of a URLSnapshot. Used on the history thread.
+class URLSnapshotWriter {
+ public:
+  explicit URLSnapshotWriter(const base::FilePath& path);
+  URLSnapshotWriter(const URLSnapshotWriter&) = delete;
+  URLSnapshotWriter& operator=(const URLSnapshotWriter&) = delete;
+  ~URLSnapshotWriter();
+
+  // Deletes the files of the snapshot at `path`.
+  static void DeleteFiles(const base::FilePath& path);
+
+  // Writes a base file holding `rows`, which must be sorted by URL, at
+  // `generation`, and removes the journal.
+  static bool WriteBaseFile(const base::FilePath& path,
+                            const URLRows& rows,
+                            int64_t generation);
+
+  // Makes sure the files hold a valid snapshot of `db`, whose generation is
+  // `generation`: copies its typed URLs if there is no snapshot of that
+  // generation, or folds the journal into the base file when
+  // URLSnapshot::ShouldCompact(). Must be called before the snapshot is
+  // opened. Returns false, after deleting the files, on failure.
+  bool Init(URLDatabase* db, int64_t generation);
+
+  // Records changes to URLs, to be written by Commit(). Changes to URLs that
+  // were never typed are ignored.
+  void OnURLsModified(const URLRows& changed_urls);
+  void OnURLsDeleted(const URLRows& deleted_urls);
+  void OnAllHistoryDeleted();
+
+  // Whether there are changes for Commit() to write.
+  bool HasPendingChanges() const;
+
+  // Appends the changes to the journal, at `generation`. Must be called once
+  // the history database committed them along with `generation`, so that the
+  // snapshot never has rows the database lacks.
+  void Commit(int64_t generation);
+
+ private:
+  // Appends `records` to the journal.
+  void AppendToJournal(const std::string& records);
+
+  const base::FilePath path_;
+
+  // The snapshot as written so far, to tell which URLs it holds.
+  std::unique_ptr<URLSnapshot> snapshot_;
+
+  // Rows changed since the last Commit(), by URL. Deleted rows are nullopt.
+  std::map<std::string, absl::optional<URLRow>> pending_rows_;
+  // Whether all history was deleted since the last Commit(), before the
+  // changes of `pending_rows_`.
+  bool pending_clear_ = false;
+};
+
+}  // namespace history
+
+#endif  // COMPONENTS_HISTORY_CORE_BROWSER_URL_SNAPSHOT_H_
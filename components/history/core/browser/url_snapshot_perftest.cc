@@ -0,0 +1,153 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "components/history/core/browser/url_snapshot.h"
+
+#include <memory>
+#include <string>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/stringprintf.h"
+#include "base/strings/utf_string_conversions.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "components/history/core/browser/in_memory_database.h"
+#include "components/history/core/browser/url_database.h"
+#include "sql/database.h"
+#include "sql/transaction.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "url/gurl.h"
+
+namespace history {
+
+namespace {
+
+constexpr char kMetricPrefixURLSnapshot[] = "URLSnapshot.";
+constexpr char kMetricOpenTime[] = "open_time";
+constexpr char kMetricAutocompleteTime[] = "autocomplete_time";
+constexpr char kMetricFileSize[] = "file_size";
+
+// One URL in this many is typed, as in a typical profile.
+constexpr int kTypedURLRatio = 4;
+constexpr size_t kMaxResults = 5;
+
+perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixURLSnapshot, story_name);
+  reporter.RegisterImportantMetric(kMetricOpenTime, "ms");
+  reporter.RegisterImportantMetric(kMetricAutocompleteTime, "us");
+  reporter.RegisterImportantMetric(kMetricFileSize, "bytes");
+  return reporter;
+}
+
+// A history database holding synthetic URLs, and their snapshot.
+class URLSnapshotPerfTest : public testing::Test, public URLDatabase {
+ public:
+  URLSnapshotPerfTest() = default;
+
+ protected:
+  sql::Database& GetDB() override { return db_; }
+
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    history_path_ = temp_dir_.GetPath().AppendASCII("History");
+    snapshot_path_ = temp_dir_.GetPath().AppendASCII("Snapshot");
+    ASSERT_TRUE(db_.Open(history_path_));
+    CreateURLTable(false);
+    CreateMainURLIndex();
+    InitKeywordSearchTermsTable();
+  }
+
+  void PopulateDatabase(int url_count) {
+    sql::Transaction transaction(&db_);
+    ASSERT_TRUE(transaction.Begin());
+    const base::Time now = base::Time::Now();
+    for (int i = 0; i < url_count; ++i) {
+      URLRow row(GURL(base::StringPrintf("https://www.site%d.com/page/%d",
+                                         i % 5000, i)));
+      row.set_title(base::ASCIIToUTF16(base::StringPrintf("Page %d", i)));
+      row.set_visit_count(1 + i % 17);
+      row.set_typed_count(i % kTypedURLRatio == 0 ? 1 + i % 3 : 0);
+      row.set_last_visit(now - base::TimeDelta::FromMinutes(i));
+      ASSERT_TRUE(AddURL(row));
+    }
+    ASSERT_TRUE(transaction.Commit());
+  }
+
+  void RunTest(int url_count, const std::string& story_name) {
+    PopulateDatabase(url_count);
+    URLSnapshotWriter writer(snapshot_path_);
+    ASSERT_TRUE(writer.Init(this, /*generation=*/0));
+    db_.Close();
+
+    int64_t file_size = 0;
+    ASSERT_TRUE(base::GetFileSize(snapshot_path_, &file_size));
+
+    // What InMemoryHistoryBackend::Init() copies into the in-memory database.
+    base::ElapsedTimer database_timer;
+    InMemoryDatabase in_memory_db;
+    ASSERT_TRUE(in_memory_db.InitFromDisk(history_path_));
+    const base::TimeDelta database_open_time = database_timer.Elapsed();
+
+    base::ElapsedTimer snapshot_timer;
+    std::unique_ptr<URLSnapshot> snapshot = URLSnapshot::Open(snapshot_path_);
+    ASSERT_TRUE(snapshot);
+    const base::TimeDelta snapshot_open_time = snapshot_timer.Elapsed();
+
+    // Prefixes as typed one character at a time.
+    const std::string url = "https://www.site1234.com/page/";
+    URLRows database_results;
+    URLRows snapshot_results;
+    base::TimeDelta database_autocomplete_time;
+    base::TimeDelta snapshot_autocomplete_time;
+    for (size_t length = 1; length <= url.size(); ++length) {
+      const std::string prefix = url.substr(0, length);
+      base::ElapsedTimer database_query_timer;
+      in_memory_db.AutocompleteForPrefix(prefix, kMaxResults,
+                                         /*typed_only=*/true,
+                                         &database_results);
+      database_autocomplete_time += database_query_timer.Elapsed();
+      base::ElapsedTimer snapshot_query_timer;
+      snapshot->AutocompleteForPrefix(prefix, kMaxResults, &snapshot_results);
+      snapshot_autocomplete_time += snapshot_query_timer.Elapsed();
+      ASSERT_EQ(database_results.size(), snapshot_results.size());
+    }
+
+    auto database_reporter = SetUpReporter(story_name + "_in_memory_database");
+    database_reporter.AddResult(kMetricOpenTime,
+                                database_open_time.InMillisecondsF());
+    database_reporter.AddResult(
+        kMetricAutocompleteTime,
+        database_autocomplete_time.InMicrosecondsF() / url.size());
+
+    auto snapshot_reporter = SetUpReporter(story_name + "_snapshot");
+    snapshot_reporter.AddResult(kMetricOpenTime,
+                                snapshot_open_time.InMillisecondsF());
+    snapshot_reporter.AddResult(
+        kMetricAutocompleteTime,
+        snapshot_autocomplete_time.InMicrosecondsF() / url.size());
+    snapshot_reporter.AddResult(kMetricFileSize,
+                                static_cast<size_t>(file_size));
+  }
+
+ private:
+  base::ScopedTempDir temp_dir_;
+  base::FilePath history_path_;
+  base::FilePath snapshot_path_;
+  sql::Database db_;
+};
+
+}  // namespace
+
+TEST_F(URLSnapshotPerfTest, 100kURLs) {
+  RunTest(100000, "100k_urls");
+}
+
+TEST_F(URLSnapshotPerfTest, 1MURLs) {
+  RunTest(1000000, "1m_urls");
+}
+
+}  // namespace history
@@ -0,0 +1,352 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "components/history/core/browser/url_snapshot.h"
+
+#include <memory>
+#include <string>
+
+#include "base/files/file_path.h"
+#include "base/files/file_util.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/stringprintf.h"
+#include "base/strings/utf_string_conversions.h"
+#include "base/time/time.h"
+#include "components/history/core/browser/url_database.h"
+#include "sql/database.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+
+namespace history {
+
+namespace {
+
+URLRow MakeRow(const std::string& url, int visit_count, int typed_count) {
+  URLRow row((GURL(url)));
+  row.set_title(base::UTF8ToUTF16(url));
+  row.set_visit_count(visit_count);
+  row.set_typed_count(typed_count);
+  row.set_last_visit(base::Time::Now() -
+                     base::TimeDelta::FromMinutes(visit_count));
+  return row;
+}
+
+void ExpectRowsEqual(const URLRow& expected, const URLRow& actual) {
+  EXPECT_EQ(expected.url(), actual.url());
+  EXPECT_EQ(expected.id(), actual.id());
+  EXPECT_EQ(expected.title(), actual.title());
+  EXPECT_EQ(expected.visit_count(), actual.visit_count());
+  EXPECT_EQ(expected.typed_count(), actual.typed_count());
+  EXPECT_EQ(expected.last_visit(), actual.last_visit());
+  EXPECT_EQ(expected.hidden(), actual.hidden());
+}
+
+}  // namespace
+
+class URLSnapshotTest : public testing::Test, public URLDatabase {
+ public:
+  URLSnapshotTest() = default;
+
+ protected:
+  // Provided for URLDatabase.
+  sql::Database& GetDB() override { return db_; }
+
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    ASSERT_TRUE(db_.Open(temp_dir_.GetPath().AppendASCII("URLTest.db")));
+    CreateURLTable(false);
+    CreateMainURLIndex();
+    snapshot_path_ = temp_dir_.GetPath().AppendASCII("Snapshot");
+  }
+  void TearDown() override { db_.Close(); }
+
+  // Adds `row` to the database, and returns it with its ID.
+  URLRow AddRow(URLRow row) {
+    row.set_id(AddURL(row));
+    EXPECT_TRUE(row.id());
+    return row;
+  }
+
+  base::FilePath snapshot_path_;
+
+ private:
+  base::ScopedTempDir temp_dir_;
+  sql::Database db_;
+};
+
+// Init() copies the typed URLs, and only those.
+TEST_F(URLSnapshotTest, InitCopiesTypedURLs) {
+  URLRow typed = AddRow(MakeRow("http://b.com/", 3, 2));
+  URLRow typed_hidden = MakeRow("http://a.com/", 1, 1);
+  typed_hidden.set_hidden(true);
+  typed_hidden = AddRow(typed_hidden);
+  URLRow untyped = AddRow(MakeRow("http://c.com/", 5, 0));
+
+  EXPECT_FALSE(URLSnapshot::Open(snapshot_path_));
+  URLSnapshotWriter writer(snapshot_path_);
+  ASSERT_TRUE(writer.Init(this, 0));
+
+  std::unique_ptr<URLSnapshot> snapshot = URLSnapshot::Open(snapshot_path_);
+  ASSERT_TRUE(snapshot);
+  EXPECT_FALSE(snapshot->ShouldCompact());
+  URLRow row;
+  EXPECT_EQ(typed.id(), snapshot->GetRowForURL(typed.url(), &row));
+  ExpectRowsEqual(typed, row);
+  EXPECT_EQ(typed_hidden.id(),
+            snapshot->GetRowForURL(typed_hidden.url(), &row));
+  ExpectRowsEqual(typed_hidden, row);
+  EXPECT_EQ(0, snapshot->GetRowForURL(untyped.url(), &row));
+
+  URLRows rows = snapshot->GetAllRows();
+  ASSERT_EQ(2u, rows.size());
+  EXPECT_EQ(typed_hidden.url(), rows[0].url());
+  EXPECT_EQ(typed.url(), rows[1].url());
+}
+
+// Changed rows are written to the journal on Commit().
+TEST_F(URLSnapshotTest, Journal) {
+  URLRow kept = AddRow(MakeRow("http://kept.com/", 1, 1));
+  URLRow deleted = AddRow(MakeRow("http://deleted.com/", 1, 1));
+  URLSnapshotWriter writer(snapshot_path_);
+  ASSERT_TRUE(writer.Init(this, 0));
+
+  URLRow added = AddRow(MakeRow("http://added.com/", 1, 1));
+  URLRow untyped = AddRow(MakeRow("http://untyped.com/", 1, 0));
+  kept.set_title(u"Kept");
+  writer.OnURLsModified({added, untyped, kept});
+  writer.OnURLsDeleted({deleted});
+
+  EXPECT_TRUE(writer.HasPendingChanges());
+
+  std::unique_ptr<URLSnapshot> snapshot = URLSnapshot::Open(snapshot_path_);
+  ASSERT_TRUE(snapshot);
+  EXPECT_FALSE(snapshot->GetRowForURL(added.url(), nullptr));
+  EXPECT_TRUE(snapshot->GetRowForURL(deleted.url(), nullptr));
+  URLRow row;
+  ASSERT_TRUE(snapshot->GetRowForURL(kept.url(), &row));
+  EXPECT_EQ(u"http://kept.com/", row.title());
+  EXPECT_EQ(0, snapshot->generation());
+
+  writer.Commit(1);
+  EXPECT_FALSE(writer.HasPendingChanges());
+  snapshot = URLSnapshot::Open(snapshot_path_);
+  ASSERT_TRUE(snapshot);
+  EXPECT_EQ(1, snapshot->generation());
+  ASSERT_TRUE(snapshot->GetRowForURL(added.url(), &row));
+  ExpectRowsEqual(added, row);
+  ASSERT_TRUE(snapshot->GetRowForURL(kept.url(), &row));
+  ExpectRowsEqual(kept, row);
+  EXPECT_FALSE(snapshot->GetRowForURL(untyped.url(), nullptr));
+  EXPECT_FALSE(snapshot->GetRowForURL(deleted.url(), nullptr));
+  EXPECT_EQ(2u, snapshot->GetAllRows().size());
+
+  // The deleted URL should not linger in the base file.
+  EXPECT_TRUE(snapshot->ShouldCompact());
+  snapshot.reset();
+  URLSnapshotWriter compacting_writer(snapshot_path_);
+  ASSERT_TRUE(compacting_writer.Init(this, 1));
+  EXPECT_FALSE(base::PathExists(URLSnapshot::GetJournalPath(snapshot_path_)));
+  snapshot = URLSnapshot::Open(snapshot_path_);
+  ASSERT_TRUE(snapshot);
+  EXPECT_FALSE(snapshot->ShouldCompact());
+  EXPECT_EQ(1, snapshot->generation());
+  URLRows rows = snapshot->GetAllRows();
+  ASSERT_EQ(2u, rows.size());
+  ExpectRowsEqual(added, rows[0]);
+  ExpectRowsEqual(kept, rows[1]);
+}
+
+// A snapshot of another generation than the database is rebuilt from it.
+TEST_F(URLSnapshotTest, GenerationMismatch) {
+  URLRow committed = AddRow(MakeRow("http://committed.com/", 1, 1));
+  URLSnapshotWriter writer(snapshot_path_);
+  ASSERT_TRUE(writer.Init(this, 3));
+
+  // The database committed a change the snapshot missed.
+  URLRow added = AddRow(MakeRow("http://added.com/", 1, 1));
+  URLSnapshotWriter missed_writer(snapshot_path_);
+  ASSERT_TRUE(missed_writer.Init(this, 4));
+  std::unique_ptr<URLSnapshot> snapshot = URLSnapshot::Open(snapshot_path_);
+  ASSERT_TRUE(snapshot);
+  EXPECT_EQ(4, snapshot->generation());
+  EXPECT_TRUE(snapshot->GetRowForURL(added.url(), nullptr));
+  EXPECT_TRUE(snapshot->GetRowForURL(committed.url(), nullptr));
+  snapshot.reset();
+
+  // The snapshot committed a change the database rolled back.
+  URLRow rolled_back = MakeRow("http://rolled-back.com/", 1, 1);
+  rolled_back.set_id(42);
+  missed_writer.OnURLsModified({rolled_back});
+  missed_writer.Commit(5);
+  URLSnapshotWriter rolled_back_writer(snapshot_path_);
+  ASSERT_TRUE(rolled_back_writer.Init(this, 4));
+  snapshot = URLSnapshot::Open(snapshot_path_);
+  ASSERT_TRUE(snapshot);
+  EXPECT_EQ(4, snapshot->generation());
+  EXPECT_FALSE(snapshot->GetRowForURL(rolled_back.url(), nullptr));
+  EXPECT_EQ(2u, snapshot->GetAllRows().size());
+}
+
+// A URL whose last typed visit expired is removed.
+TEST_F(URLSnapshotTest, URLNoLongerTyped) {
+  URLRow row = AddRow(MakeRow("http://a.com/", 2, 1));
+  URLSnapshotWriter writer(snapshot_path_);
+  ASSERT_TRUE(writer.Init(this, 0));
+
+  row.set_typed_count(0);
+  writer.OnURLsModified({row});
+  writer.Commit(1);
+  std::unique_ptr<URLSnapshot> snapshot = URLSnapshot::Open(snapshot_path_);
+  ASSERT_TRUE(snapshot);
+  EXPECT_FALSE(snapshot->GetRowForURL(row.url(), nullptr));
+  EXPECT_TRUE(snapshot->GetAllRows().empty());
+}
+
+// A record that was only partly written is ignored, along with the other
+// records of its commit and what follows.
+TEST_F(URLSnapshotTest, TruncatedJournal) {
+  URLSnapshotWriter writer(snapshot_path_);
+  ASSERT_TRUE(writer.Init(this, 0));
+  URLRow row = AddRow(MakeRow("http://a.com/", 1, 1));
+  writer.OnURLsModified({row});
+  writer.Commit(1);
+
+  const base::FilePath journal_path =
+      URLSnapshot::GetJournalPath(snapshot_path_);
+  std::string journal;
+  ASSERT_TRUE(base::ReadFileToString(journal_path, &journal));
+  ASSERT_TRUE(base::WriteFile(journal_path, journal + journal.substr(0, 10)));
+
+  std::unique_ptr<URLSnapshot> snapshot = URLSnapshot::Open(snapshot_path_);
+  ASSERT_TRUE(snapshot);
+  EXPECT_TRUE(snapshot->GetRowForURL(row.url(), nullptr));
+  EXPECT_EQ(1, snapshot->generation());
+  EXPECT_TRUE(snapshot->ShouldCompact());
+
+  // A corrupt kCommit record drops the row of its commit.
+  journal[journal.size() - 1] ^= 1;
+  ASSERT_TRUE(base::WriteFile(journal_path, journal));
+  snapshot = URLSnapshot::Open(snapshot_path_);
+  ASSERT_TRUE(snapshot);
+  EXPECT_FALSE(snapshot->GetRowForURL(row.url(), nullptr));
+  EXPECT_EQ(0, snapshot->generation());
+  EXPECT_TRUE(snapshot->ShouldCompact());
+}
+
+// An invalid base file is rebuilt from the database.
+TEST_F(URLSnapshotTest, InvalidBaseFile) {
+  URLRow row = AddRow(MakeRow("http://a.com/", 1, 1));
+  ASSERT_TRUE(base::WriteFile(snapshot_path_, "Not a snapshot"));
+  EXPECT_FALSE(URLSnapshot::Open(snapshot_path_));
+
+  URLSnapshotWriter writer(snapshot_path_);
+  ASSERT_TRUE(writer.Init(this, 0));
+  std::unique_ptr<URLSnapshot> snapshot = URLSnapshot::Open(snapshot_path_);
+  ASSERT_TRUE(snapshot);
+  EXPECT_TRUE(snapshot->GetRowForURL(row.url(), nullptr));
+}
+
+TEST_F(URLSnapshotTest, AllHistoryDeleted) {
+  URLRow row = AddRow(MakeRow("http://a.com/", 1, 1));
+  URLSnapshotWriter writer(snapshot_path_);
+  ASSERT_TRUE(writer.Init(this, 0));
+  std::unique_ptr<URLSnapshot> mapped_snapshot =
+      URLSnapshot::Open(snapshot_path_);
+
+  writer.OnAllHistoryDeleted();
+  EXPECT_TRUE(writer.HasPendingChanges());
+
+  // URLs typed afterwards are kept.
+  URLRow new_row = AddRow(MakeRow("http://b.com/", 1, 1));
+  writer.OnURLsModified({new_row});
+  writer.Commit(1);
+  std::unique_ptr<URLSnapshot> snapshot = URLSnapshot::Open(snapshot_path_);
+  if (snapshot) {
+    URLRows rows = snapshot->GetAllRows();
+    ASSERT_EQ(1u, rows.size());
+    EXPECT_EQ(new_row.url(), rows[0].url());
+  }
+  mapped_snapshot.reset();
+  DeleteURLRow(row.id());
+  URLSnapshotWriter new_writer(snapshot_path_);
+  ASSERT_TRUE(new_writer.Init(this, 1));
+  snapshot = URLSnapshot::Open(snapshot_path_);
+  ASSERT_TRUE(snapshot);
+  URLRows rows = snapshot->GetAllRows();
+  ASSERT_EQ(1u, rows.size());
+  EXPECT_EQ(new_row.url(), rows[0].url());
+}
+
+// The overlay of an open snapshot is kept up to date like InMemoryDatabase.
+TEST_F(URLSnapshotTest, Overlay) {
+  URLRow row = AddRow(MakeRow("http://a.com/", 1, 1));
+  URLSnapshotWriter writer(snapshot_path_);
+  ASSERT_TRUE(writer.Init(this, 0));
+  std::unique_ptr<URLSnapshot> snapshot = URLSnapshot::Open(snapshot_path_);
+  ASSERT_TRUE(snapshot);
+
+  URLRow new_row = MakeRow("http://b.com/", 1, 1);
+  new_row.set_id(42);
+  snapshot->InsertOrUpdateURLRow(new_row);
+  EXPECT_EQ(42, snapshot->GetRowForURL(new_row.url(), nullptr));
+  snapshot->DeleteURL(row.url());
+  EXPECT_FALSE(snapshot->GetRowForURL(row.url(), nullptr));
+  URLRows rows = snapshot->GetAllRows();
+  ASSERT_EQ(1u, rows.size());
+  ExpectRowsEqual(new_row, rows[0]);
+}
+
+// AutocompleteForPrefix() returns what URLDatabase returns for typed URLs,
+// across the base file and the overlay.
+TEST_F(URLSnapshotTest, AutocompleteForPrefix) {
+  // Rows differ at least by their last visit, so that both orders are the same.
+  const base::Time now = base::Time::Now();
+  for (int i = 0; i < 40; ++i) {
+    URLRow row = MakeRow(
+        base::StringPrintf("http://%s.com/%d", i % 2 ? "odd" : "even", i),
+        i % 7, i % 5);
+    row.set_last_visit(now - base::TimeDelta::FromSeconds(i));
+    row.set_hidden(i % 11 == 0);
+    AddRow(row);
+  }
+  URLSnapshotWriter writer(snapshot_path_);
+  ASSERT_TRUE(writer.Init(this, 0));
+
+  // Changes after the base file was written.
+  std::unique_ptr<URLSnapshot> snapshot = URLSnapshot::Open(snapshot_path_);
+  ASSERT_TRUE(snapshot);
+  for (int i = 40; i < 50; ++i) {
+    URLRow row = MakeRow(base::StringPrintf("http://odd.com/%d", i), i % 4,
+                         1 + i % 3);
+    row.set_last_visit(now - base::TimeDelta::FromSeconds(i));
+    row = AddRow(row);
+    snapshot->InsertOrUpdateURLRow(row);
+  }
+  URLRow row;
+  ASSERT_TRUE(GetRowForURL(GURL("http://even.com/4"), &row));
+  row.set_typed_count(9);
+  UpdateURLRow(row.id(), row);
+  snapshot->InsertOrUpdateURLRow(row);
+  ASSERT_TRUE(GetRowForURL(GURL("http://odd.com/3"), &row));
+  DeleteURLRow(row.id());
+  snapshot->DeleteURL(row.url());
+
+  for (const char* prefix :
+       {"http://", "http://odd.com/", "http://even.com/1", "http://x", ""}) {
+    for (size_t max_results : {1u, 5u, 100u}) {
+      SCOPED_TRACE(testing::Message() << prefix << " " << max_results);
+      URLRows expected;
+      AutocompleteForPrefix(prefix, max_results, /*typed_only=*/true,
+                            &expected);
+      URLRows actual;
+      EXPECT_EQ(!expected.empty(),
+                snapshot->AutocompleteForPrefix(prefix, max_results, &actual));
+      ASSERT_EQ(expected.size(), actual.size());
+      for (size_t i = 0; i < expected.size(); ++i)
+        EXPECT_EQ(expected[i].url(), actual[i].url());
+    }
+  }
+}
+
+}  // namespace history
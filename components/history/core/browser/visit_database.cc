@@ -16,10 +16,12 @@
 
 #include "base/logging.h"
 #include "base/strings/string_number_conversions.h"
+#include "base/strings/string_util.h"
 #include "base/time/time.h"
 #include "components/google/core/common/google_util.h"
 #include "components/history/core/browser/history_backend.h"
 #include "components/history/core/browser/url_database.h"
+#include "net/base/registry_controlled_domains/registry_controlled_domain.h"
 #include "sql/statement.h"
 #include "sql/transaction.h"
 #include "ui/base/page_transition_types.h"
@@ -59,8 +61,73 @@ bool TransitionIsVisible(int32_t transition) {
                                        ui::PAGE_TRANSITION_KEYWORD_GENERATED);
 }
 
+// Whether a visit counts towards the domains visited on its day: it must end
+// a redirect chain and be neither a subframe nor a keyword-generated visit.
+// Must be in sync with HistoryDatabase::CountUniqueDomainsVisited().
+bool CountsTowardsDomainVisits(ui::PageTransition transition) {
+  return (transition & ui::PAGE_TRANSITION_CHAIN_END) != 0 &&
+         !ui::PageTransitionCoreTypeIs(transition,
+                                       ui::PAGE_TRANSITION_AUTO_SUBFRAME) &&
+         !ui::PageTransitionCoreTypeIs(transition,
+                                       ui::PAGE_TRANSITION_MANUAL_SUBFRAME) &&
+         !ui::PageTransitionCoreTypeIs(transition,
+                                       ui::PAGE_TRANSITION_KEYWORD_GENERATED);
+}
+
+// Returns the domain (eTLD+1) `url` counts as in the domain_visits table. IP
+// addresses, empty URLs, and URLs with empty or unregistered TLDs have none.
+std::string GetDomainForDomainVisits(const GURL& url) {
+  return net::registry_controlled_domains::GetDomainAndRegistry(
+      url, net::registry_controlled_domains::EXCLUDE_PRIVATE_REGISTRIES);
+}
+
 }  // namespace
 
+VisitColumnBatch::VisitColumnBatch() = default;
+
+VisitColumnBatch::~VisitColumnBatch() = default;
+
+void VisitColumnBatch::clear() {
+  size = 0;
+  visit_ids.clear();
+  url_ids.clear();
+  visit_times.clear();
+  transitions.clear();
+  visit_durations.clear();
+}
+
+VisitDatabase::VisitColumnEnumerator::VisitColumnEnumerator() = default;
+
+VisitDatabase::VisitColumnEnumerator::~VisitColumnEnumerator() = default;
+
+bool VisitDatabase::VisitColumnEnumerator::GetNextBatch(
+    VisitColumnBatch* batch) {
+  DCHECK(initialized_);
+  batch->clear();
+  while (batch->size < batch_size_ && statement_.Step()) {
+    // Must be in sync with the columns InitVisitColumnEnumerator() selects.
+    int column = 0;
+    if (columns_ & kVisitIdColumn)
+      batch->visit_ids.push_back(statement_.ColumnInt64(column++));
+    if (columns_ & kURLIdColumn)
+      batch->url_ids.push_back(statement_.ColumnInt64(column++));
+    if (columns_ & kVisitTimeColumn) {
+      batch->visit_times.push_back(
+          base::Time::FromInternalValue(statement_.ColumnInt64(column++)));
+    }
+    if (columns_ & kTransitionColumn) {
+      batch->transitions.push_back(
+          ui::PageTransitionFromInt(statement_.ColumnInt(column++)));
+    }
+    if (columns_ & kVisitDurationColumn) {
+      batch->visit_durations.push_back(
+          base::TimeDelta::FromInternalValue(statement_.ColumnInt64(column++)));
+    }
+    ++batch->size;
+  }
+  return batch->size > 0;
+}
+
 VisitDatabase::VisitDatabase() = default;
 
 VisitDatabase::~VisitDatabase() = default;
@@ -110,17 +177,49 @@ bool VisitDatabase::InitVisitTable() {
     return false;
 
   // Create an index over time so that we can efficiently find the visits in a
-  // given time range (most history views are time-based).
-  if (!GetDB().Execute("CREATE INDEX IF NOT EXISTS visits_time_index ON "
-                       "visits (visit_time)"))
+  // given time range (most history views are time-based). It covers the
+  // columns most scans over a time range need, so that VisitColumnEnumerator
+  // can read them without reading the table. Databases older than version 49
+  // have visits_time_index instead, until migrated.
+  if (!GetDB().DoesIndexExist("visits_time_index") &&
+      !CreateVisitsTimeIndex()) {
     return false;
+  }
+
+  return true;
+}
+
+bool VisitDatabase::CreateVisitsTimeIndex() {
+  return GetDB().Execute(
+      "CREATE INDEX IF NOT EXISTS visits_time_url_transition_index ON "
+      "visits (visit_time, url, transition)");
+}
+
+bool VisitDatabase::MigrateVisitsTimeIndex() {
+  // The new index starts with visit_time, so it serves every query the old one
+  // did.
+  return CreateVisitsTimeIndex() &&
+         GetDB().Execute("DROP INDEX IF EXISTS visits_time_index");
+}
 
+bool VisitDatabase::InitDomainVisitsTable() {
+  // Days are local midnights as of when the visits were recorded, so that the
+  // visits of the last N days are found with a range scan of the primary key.
+  if (!GetDB().Execute("CREATE TABLE IF NOT EXISTS domain_visits("
+                       "day INTEGER NOT NULL,"
+                       "domain LONGVARCHAR NOT NULL,"
+                       "visit_count INTEGER NOT NULL,"
+                       "PRIMARY KEY(day, domain))")) {
+    return false;
+  }
+  has_domain_visits_ = true;
   return true;
 }
 
 bool VisitDatabase::DropVisitTable() {
   // This will also drop the indices over the table.
   return GetDB().Execute("DROP TABLE IF EXISTS visit_source") &&
+         GetDB().Execute("DROP TABLE IF EXISTS domain_visits") &&
          GetDB().Execute("DROP TABLE visits");
 }
 
@@ -213,6 +312,11 @@ VisitID VisitDatabase::AddVisit(VisitRow* visit, VisitSource source) {
 
   visit->visit_id = GetDB().GetLastInsertRowId();
 
+  // The domain visits are derived from the visits, so failing to count this
+  // one only makes them recounted.
+  if (!UpdateDomainVisits(*visit, 1))
+    MarkDomainVisitsForRebuild();
+
   if (source != SOURCE_BROWSED) {
     // Record the source of this visit when it is not browsed.
     sql::Statement statement1(GetDB().GetCachedStatement(
@@ -231,6 +335,12 @@ VisitID VisitDatabase::AddVisit(VisitRow* visit, VisitSource source) {
 }
 
 void VisitDatabase::DeleteVisit(const VisitRow& visit) {
+  // The domain visits are updated from the visit as stored, which is the one
+  // they were counted from.
+  VisitRow stored_visit;
+  const bool update_domain_visits =
+      has_domain_visits_ && GetRowForVisit(visit.visit_id, &stored_visit);
+
   // Patch around this visit. Any visits that this went to will now have their
   // "source" be the deleted visit's source.
   sql::Statement update_chain(GetDB().GetCachedStatement(
@@ -247,6 +357,11 @@ void VisitDatabase::DeleteVisit(const VisitRow& visit) {
   if (!del.Run())
     return;
 
+  // Failing to update the domain visits must not keep the visit from being
+  // deleted, so they are recounted instead.
+  if (update_domain_visits && !UpdateDomainVisits(stored_visit, -1))
+    MarkDomainVisitsForRebuild();
+
   // Try to delete the entry in visit_source table as well.
   // If the visit was browsed, there is no corresponding entry in visit_source
   // table, and nothing will be deleted.
@@ -296,7 +411,25 @@ bool VisitDatabase::UpdateVisitRow(const VisitRow& visit) {
   statement.BindBool(6, visit.incremented_omnibox_typed_score);
   statement.BindInt64(7, visit.visit_id);
 
-  return statement.Run();
+  // Most updates, such as setting the duration of a visit, leave its domain
+  // visit as it is.
+  VisitRow stored_visit;
+  if (!has_domain_visits_ || !GetRowForVisit(visit.visit_id, &stored_visit))
+    return statement.Run();
+  bool domain_visit_changed =
+      stored_visit.url_id != visit.url_id ||
+      stored_visit.visit_time.LocalMidnight() !=
+          visit.visit_time.LocalMidnight() ||
+      CountsTowardsDomainVisits(stored_visit.transition) !=
+          CountsTowardsDomainVisits(visit.transition);
+
+  if (!statement.Run())
+    return false;
+  if (domain_visit_changed && (!UpdateDomainVisits(stored_visit, -1) ||
+                               !UpdateDomainVisits(visit, 1))) {
+    MarkDomainVisitsForRebuild();
+  }
+  return true;
 }
 
 bool VisitDatabase::GetVisitsForURL(URLID url_id, VisitVector* visits) {
@@ -366,6 +499,31 @@ bool VisitDatabase::GetAllVisitsInRange(base::Time begin_time,
   return FillVisitVector(statement, visits);
 }
 
+bool VisitDatabase::GetNextVisitsInRange(base::Time begin_time,
+                                         VisitID after_visit_id,
+                                         base::Time end_time,
+                                         int max_results,
+                                         VisitVector* visits) {
+  DCHECK_GT(max_results, 0);
+  visits->clear();
+
+  sql::Statement statement(GetDB().GetCachedStatement(
+      SQL_FROM_HERE, "SELECT" HISTORY_VISIT_ROW_FIELDS "FROM visits "
+                     "WHERE visit_time >= ? AND visit_time < ? "
+                     "AND (visit_time > ? OR id > ?) "
+                     "ORDER BY visit_time, id LIMIT ?"));
+
+  // See GetVisibleVisitsInRange for more info on how these times are bound.
+  int64_t end = end_time.ToInternalValue();
+  statement.BindInt64(0, begin_time.ToInternalValue());
+  statement.BindInt64(1, end ? end : std::numeric_limits<int64_t>::max());
+  statement.BindInt64(2, begin_time.ToInternalValue());
+  statement.BindInt64(3, after_visit_id);
+  statement.BindInt64(4, max_results);
+
+  return FillVisitVector(statement, visits);
+}
+
 bool VisitDatabase::GetVisitsInRangeForTransition(base::Time begin_time,
                                                   base::Time end_time,
                                                   int max_results,
@@ -789,6 +947,201 @@ VisitDatabase::GetGoogleDomainVisitsFromSearchesInRange(base::Time begin_time,
   return domain_visits;
 }
 
+bool VisitDatabase::CountDomainsVisitedOnDays(base::Time begin_time,
+                                              base::Time end_time,
+                                              int* count) {
+  if (!has_domain_visits_ || !domain_visits_complete_ ||
+      begin_time != begin_time.LocalMidnight() ||
+      end_time != end_time.LocalMidnight()) {
+    return false;
+  }
+
+  sql::Statement statement(GetDB().GetCachedStatement(
+      SQL_FROM_HERE,
+      "SELECT COUNT(DISTINCT domain) FROM domain_visits "
+      "WHERE day >= ? AND day < ?"));
+  statement.BindInt64(0, begin_time.ToInternalValue());
+  statement.BindInt64(1, end_time.ToInternalValue());
+  if (!statement.Step())
+    return false;
+
+  *count = statement.ColumnInt(0);
+  return true;
+}
+
+bool VisitDatabase::InitVisitColumnEnumerator(
+    base::Time begin_time,
+    base::Time end_time,
+    uint32_t columns,
+    size_t batch_size,
+    VisitColumnEnumerator* enumerator) {
+  DCHECK(!enumerator->initialized_);
+  DCHECK(columns);
+  DCHECK_GT(batch_size, 0u);
+
+  std::vector<std::string> column_names;
+  if (columns & kVisitIdColumn)
+    column_names.push_back("id");
+  if (columns & kURLIdColumn)
+    column_names.push_back("url");
+  if (columns & kVisitTimeColumn)
+    column_names.push_back("visit_time");
+  if (columns & kTransitionColumn)
+    column_names.push_back("transition");
+  if (columns & kVisitDurationColumn)
+    column_names.push_back("visit_duration");
+  if (column_names.empty())
+    return false;
+
+  // Every column but visit_duration is in visits_time_url_transition_index,
+  // id being its rowid, so SQLite picks it as a covering index unless the
+  // durations are read.
+  std::string sql("SELECT ");
+  sql.append(base::JoinString(column_names, ","));
+  sql.append(
+      " FROM visits WHERE visit_time >= ? AND visit_time < ? "
+      "ORDER BY visit_time");
+  enumerator->statement_.Assign(GetDB().GetUniqueStatement(sql.c_str()));
+
+  // See GetVisibleVisitsInRange for more info on how these times are bound.
+  int64_t end = end_time.ToInternalValue();
+  enumerator->statement_.BindInt64(0, begin_time.ToInternalValue());
+  enumerator->statement_.BindInt64(
+      1, end ? end : std::numeric_limits<int64_t>::max());
+
+  enumerator->columns_ = columns;
+  enumerator->batch_size_ = batch_size;
+  enumerator->initialized_ = enumerator->statement_.is_valid();
+  return enumerator->statement_.is_valid();
+}
+
+void VisitDatabase::set_domain_visits_incomplete(VisitID last_visit_id) {
+  domain_visits_complete_ = false;
+  domain_visits_last_visit_id_ = last_visit_id;
+}
+
+bool VisitDatabase::CountDomainVisitsBatch(int max_visits) {
+  DCHECK(has_domain_visits_);
+  DCHECK_GT(max_visits, 0);
+  if (domain_visits_complete_)
+    return true;
+  if (!domain_visits_last_visit_id_ &&
+      !GetDB().Execute("DELETE FROM domain_visits")) {
+    return false;
+  }
+
+  // Count the visits in memory: a day has few domains, but many visits to
+  // each.
+  std::map<std::pair<int64_t, std::string>, int> domain_visit_counts;
+  std::map<URLID, std::string> url_domains;
+  VisitID last_visit_id = domain_visits_last_visit_id_;
+  int visit_count = 0;
+  sql::Statement statement(GetDB().GetCachedStatement(
+      SQL_FROM_HERE,
+      "SELECT visits.id, visits.visit_time, visits.transition, urls.id, "
+      "urls.url "
+      "FROM visits JOIN urls ON urls.id = visits.url "
+      "WHERE visits.id > ? ORDER BY visits.id LIMIT ?"));
+  statement.BindInt64(0, last_visit_id);
+  statement.BindInt(1, max_visits);
+  while (statement.Step()) {
+    last_visit_id = statement.ColumnInt64(0);
+    ++visit_count;
+    if (!CountsTowardsDomainVisits(
+            ui::PageTransitionFromInt(statement.ColumnInt(2)))) {
+      continue;
+    }
+    URLID url_id = statement.ColumnInt64(3);
+    auto url_domain = url_domains.find(url_id);
+    if (url_domain == url_domains.end()) {
+      url_domain =
+          url_domains
+              .emplace(url_id, GetDomainForDomainVisits(
+                                   GURL(statement.ColumnString(4))))
+              .first;
+    }
+    if (url_domain->second.empty())
+      continue;
+    base::Time day =
+        base::Time::FromInternalValue(statement.ColumnInt64(1)).LocalMidnight();
+    ++domain_visit_counts[{day.ToInternalValue(), url_domain->second}];
+  }
+  if (!statement.Succeeded())
+    return false;
+
+  for (const auto& domain_visit_count : domain_visit_counts) {
+    if (!AddDomainVisits(domain_visit_count.first.first,
+                         domain_visit_count.first.second,
+                         domain_visit_count.second)) {
+      // Part of the batch may have been counted already.
+      MarkDomainVisitsForRebuild();
+      return false;
+    }
+  }
+  domain_visits_last_visit_id_ = last_visit_id;
+  if (visit_count < max_visits)
+    domain_visits_complete_ = true;
+  return true;
+}
+
+bool VisitDatabase::UpdateDomainVisits(const VisitRow& visit, int delta) {
+  if (!has_domain_visits_ || !CountsTowardsDomainVisits(visit.transition))
+    return true;
+  // CountDomainVisitsBatch() counts the visit once it gets to it.
+  if (!domain_visits_complete_ &&
+      visit.visit_id > domain_visits_last_visit_id_) {
+    return true;
+  }
+
+  sql::Statement url_statement(GetDB().GetCachedStatement(
+      SQL_FROM_HERE, "SELECT url FROM urls WHERE id=?"));
+  url_statement.BindInt64(0, visit.url_id);
+  if (!url_statement.Step())
+    return url_statement.Succeeded();
+  const std::string domain =
+      GetDomainForDomainVisits(GURL(url_statement.ColumnString(0)));
+  if (domain.empty())
+    return true;
+  return AddDomainVisits(visit.visit_time.LocalMidnight().ToInternalValue(),
+                         domain, delta);
+}
+
+bool VisitDatabase::AddDomainVisits(int64_t day,
+                                    const std::string& domain,
+                                    int delta) {
+  sql::Statement insert(GetDB().GetCachedStatement(
+      SQL_FROM_HERE,
+      "INSERT OR IGNORE INTO domain_visits (day, domain, visit_count) "
+      "VALUES (?,?,0)"));
+  insert.BindInt64(0, day);
+  insert.BindString(1, domain);
+  sql::Statement update(GetDB().GetCachedStatement(
+      SQL_FROM_HERE,
+      "UPDATE domain_visits SET visit_count = visit_count + ? "
+      "WHERE day=? AND domain=?"));
+  update.BindInt(0, delta);
+  update.BindInt64(1, day);
+  update.BindString(2, domain);
+  if (!insert.Run() || !update.Run())
+    return false;
+  if (delta > 0)
+    return true;
+
+  // A domain no longer visited that day does not count anymore.
+  sql::Statement del(GetDB().GetCachedStatement(
+      SQL_FROM_HERE,
+      "DELETE FROM domain_visits "
+      "WHERE day=? AND domain=? AND visit_count <= 0"));
+  del.BindInt64(0, day);
+  del.BindString(1, domain);
+  return del.Run();
+}
+
+void VisitDatabase::MarkDomainVisitsForRebuild() {
+  set_domain_visits_incomplete(0);
+  OnDomainVisitsRebuildNeeded();
+}
+
 bool VisitDatabase::MigrateVisitsWithoutDuration() {
   if (!GetDB().DoesTableExist("visits")) {
     NOTREACHED() << " Visits table should exist before migration";
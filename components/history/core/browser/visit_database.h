@@ -5,18 +5,48 @@
 #ifndef COMPONENTS_HISTORY_CORE_BROWSER_VISIT_DATABASE_H_
 #define COMPONENTS_HISTORY_CORE_BROWSER_VISIT_DATABASE_H_
 
+#include <stddef.h>
+#include <stdint.h>
+
+#include <string>
 #include <vector>
 
 #include "base/macros.h"
+#include "base/time/time.h"
 #include "components/history/core/browser/history_types.h"
+#include "sql/statement.h"
+#include "ui/base/page_transition_types.h"
 
 namespace sql {
 class Database;
-class Statement;
 }  // namespace sql
 
 namespace history {
 
+// A batch of visits read by a VisitDatabase::VisitColumnEnumerator, one vector
+// per column. Only the vectors of the columns the enumerator reads are filled,
+// the others are left empty. Entry i of each filled vector is about the same
+// visit.
+struct VisitColumnBatch {
+  VisitColumnBatch();
+  VisitColumnBatch(const VisitColumnBatch&) = delete;
+  VisitColumnBatch& operator=(const VisitColumnBatch&) = delete;
+  ~VisitColumnBatch();
+
+  // Empties all the columns, keeping their capacity so that the batch can be
+  // refilled without allocating.
+  void clear();
+
+  // Number of visits in the batch.
+  size_t size = 0;
+
+  std::vector<VisitID> visit_ids;
+  std::vector<URLID> url_ids;
+  std::vector<base::Time> visit_times;
+  std::vector<ui::PageTransition> transitions;
+  std::vector<base::TimeDelta> visit_durations;
+};
+
 // A visit database is one which stores visits for URLs, that is, times and
 // linking information. A visit database must also be a URLDatabase, as this
 // modifies tables used by URLs directly and could be thought of as inheriting
@@ -89,6 +119,17 @@ class VisitDatabase {
                            int max_results,
                            VisitVector* visits);
 
+  // Pages through the visits in the time range [begin, end) as
+  // GetAllVisitsInRange() does, up to `max_results` at a time, in increasing
+  // order of date and then ID. The visits at `begin_time` whose ID is not
+  // greater than `after_visit_id` are skipped, so that the next page starts at
+  // the time and ID of the last visit of the previous one.
+  bool GetNextVisitsInRange(base::Time begin_time,
+                            VisitID after_visit_id,
+                            base::Time end_time,
+                            int max_results,
+                            VisitVector* visits);
+
   // Fills all visits with specified transition in the time range [begin, end)
   // to the given vector. Either time can be is_null(), in which case the times
   // in that direction are unbounded.
@@ -219,6 +260,64 @@ class VisitDatabase {
       base::Time begin_time,
       base::Time end_time);
 
+  // Sets `count` to the number of unique domains (eTLD+1) visited on the local
+  // days in [`begin_time`, `end_time`), as recorded in the domain_visits table.
+  // Returns false if the table is not set up or not completely filled, or
+  // either time is not a local midnight, in which case the caller has to count
+  // the visits themselves.
+  bool CountDomainsVisitedOnDays(base::Time begin_time,
+                                 base::Time end_time,
+                                 int* count);
+
+  // Columnar scans -----------------------------------------------------------
+
+  // Columns of the visits table a VisitColumnEnumerator can read, to be or'ed
+  // together.
+  enum VisitColumn : uint32_t {
+    kVisitIdColumn = 1 << 0,
+    kURLIdColumn = 1 << 1,
+    kVisitTimeColumn = 1 << 2,
+    kTransitionColumn = 1 << 3,
+    kVisitDurationColumn = 1 << 4,
+  };
+
+  // Reads a few columns of the visits in a time range, a batch at a time,
+  // without materializing a VisitRow per visit.
+  class VisitColumnEnumerator {
+   public:
+    VisitColumnEnumerator();
+    VisitColumnEnumerator(const VisitColumnEnumerator&) = delete;
+    VisitColumnEnumerator& operator=(const VisitColumnEnumerator&) = delete;
+    ~VisitColumnEnumerator();
+
+    // Replaces the contents of `batch` with the next visits, at most the batch
+    // size the enumerator was initialized with. Returns false if no more
+    // visits are available.
+    bool GetNextBatch(VisitColumnBatch* batch);
+
+   private:
+    friend class VisitDatabase;
+
+    bool initialized_ = false;
+    uint32_t columns_ = 0;
+    size_t batch_size_ = 0;
+    sql::Statement statement_;
+  };
+
+  // Initializes the given enumerator to read the `columns` of the visits in
+  // the time range [begin, end), in increasing order of date, up to
+  // `batch_size` visits at a time. Either time can be is_null(), in which case
+  // the times in that direction are unbounded.
+  //
+  // Scans that read nothing but the visit ID, URL ID, visit time and
+  // transition are answered from an index covering these columns, without
+  // reading the visits table itself.
+  bool InitVisitColumnEnumerator(base::Time begin_time,
+                                 base::Time end_time,
+                                 uint32_t columns,
+                                 size_t batch_size,
+                                 VisitColumnEnumerator* enumerator);
+
  protected:
   // Returns the database for the functions in this interface.
   virtual sql::Database& GetDB() = 0;
@@ -227,6 +326,37 @@ class VisitDatabase {
   // and indices are properly set up. Must be called before anything else.
   bool InitVisitTable();
 
+  // Ensures the domain_visits table, which counts the user-visible visits to
+  // each domain per local day, exists. From then on, adding, updating and
+  // deleting visits keeps it up to date. Must be called again after
+  // DropVisitTable().
+  bool InitDomainVisitsTable();
+
+  // Marks the domain_visits table as counting only the visits whose ID is at
+  // most `last_visit_id`, until CountDomainVisitsBatch() is done. Meanwhile,
+  // CountDomainsVisitedOnDays() fails, and adding, updating and deleting the
+  // visits with greater IDs leaves the table as it is.
+  void set_domain_visits_incomplete(VisitID last_visit_id);
+
+  // Counts up to `max_visits` more visits into the incomplete domain_visits
+  // table, in ID order, emptying it first if it counts none yet. Marks it
+  // complete once no visit is left. For filling the table in batches after
+  // migration to version 47, or after keeping it up to date failed. On
+  // failure, the table is to be filled again from scratch.
+  bool CountDomainVisitsBatch(int max_visits);
+
+  bool domain_visits_complete() const { return domain_visits_complete_; }
+
+  // The ID of the last visit the domain_visits table counts while it is
+  // incomplete.
+  VisitID domain_visits_last_visit_id() const {
+    return domain_visits_last_visit_id_;
+  }
+
+  // Called when keeping the domain_visits table up to date failed, once it is
+  // marked incomplete to be filled again from scratch.
+  virtual void OnDomainVisitsRebuildNeeded() {}
+
   // Convenience to fill a VisitRow. Assumes the visit values are bound starting
   // at index 0.
   static void FillVisitRow(sql::Statement& statement, VisitRow* visit);
@@ -264,7 +394,35 @@ class VisitDatabase {
   bool GetAllVisitedURLRowidsForMigrationToVersion40(
       std::vector<URLID>* visited_url_rowids_sorted);
 
+  // Called by the derived classes to replace visits_time_index with
+  // visits_time_url_transition_index, for migration to version 49.
+  bool MigrateVisitsTimeIndex();
+
  private:
+  // Creates visits_time_url_transition_index, the index over visit times.
+  bool CreateVisitsTimeIndex();
+
+  // Adds `delta` to the visits to the domain of `visit` on its local day in
+  // the domain_visits table, if the visit is one that counts.
+  bool UpdateDomainVisits(const VisitRow& visit, int delta);
+
+  // Adds `delta` to the visits to `domain` on `day` in the domain_visits
+  // table, and removes the row once it drops to none.
+  bool AddDomainVisits(int64_t day, const std::string& domain, int delta);
+
+  // Marks the domain_visits table to be filled again from scratch, when
+  // keeping it up to date failed.
+  void MarkDomainVisitsForRebuild();
+
+  // True if InitDomainVisitsTable() has been invoked. Not all subclasses keep
+  // domain visits.
+  bool has_domain_visits_ = false;
+
+  // False while the domain_visits table only counts the visits up to
+  // `domain_visits_last_visit_id_`.
+  bool domain_visits_complete_ = true;
+  VisitID domain_visits_last_visit_id_ = 0;
+
   DISALLOW_COPY_AND_ASSIGN(VisitDatabase);
 };
 
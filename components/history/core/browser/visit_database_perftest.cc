@@ -0,0 +1,148 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "components/history/core/browser/visit_database.h"
+
+#include <stdint.h>
+
+#include <string>
+
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "components/history/core/browser/url_database.h"
+#include "sql/database.h"
+#include "sql/transaction.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "ui/base/page_transition_types.h"
+#include "url/gurl.h"
+
+namespace history {
+
+namespace {
+
+constexpr char kMetricPrefixVisitDatabase[] = "VisitDatabase.";
+constexpr char kMetricScanTime[] = "scan_time";
+
+// A year of history, as a heavy user would have it.
+constexpr int kDays = 365;
+constexpr int kVisitsPerDay = 1000;
+constexpr int kURLCount = 20000;
+
+constexpr size_t kBatchSize = 1024;
+
+perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixVisitDatabase,
+                                         story_name);
+  reporter.RegisterImportantMetric(kMetricScanTime, "ms");
+  return reporter;
+}
+
+// Measures reading the URL and transition of every visit in a year of
+// history, as the analytics-style consumers do.
+class VisitDatabasePerfTest : public testing::Test,
+                              public URLDatabase,
+                              public VisitDatabase {
+ public:
+  VisitDatabasePerfTest() = default;
+
+ protected:
+  sql::Database& GetDB() override { return db_; }
+
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    ASSERT_TRUE(db_.Open(temp_dir_.GetPath().AppendASCII("VisitTest.db")));
+    CreateURLTable(false);
+    CreateMainURLIndex();
+    ASSERT_TRUE(InitVisitTable());
+    PopulateDatabase();
+  }
+
+  void PopulateDatabase() {
+    sql::Transaction transaction(&db_);
+    ASSERT_TRUE(transaction.Begin());
+    for (int i = 0; i < kURLCount; ++i) {
+      ASSERT_TRUE(AddURL(URLRow(
+          GURL(base::StringPrintf("https://www.site%d.com/page", i)))));
+    }
+    for (int i = 0; i < kDays * kVisitsPerDay; ++i) {
+      const base::Time visit_time =
+          YearAgo() + base::TimeDelta::FromSeconds(int64_t{i} * 24 * 60 * 60 /
+                                                   kVisitsPerDay);
+      VisitRow visit(
+          1 + i % kURLCount, visit_time, 0,
+          i % 5 ? ui::PAGE_TRANSITION_LINK : ui::PAGE_TRANSITION_TYPED, 0,
+          false, false);
+      visit.visit_duration = base::TimeDelta::FromSeconds(i % 600);
+      ASSERT_TRUE(AddVisit(&visit, SOURCE_BROWSED));
+    }
+    ASSERT_TRUE(transaction.Commit());
+  }
+
+  // Reads the visits a VisitRow at a time.
+  void RunRowBased(const std::string& story_name) {
+    base::ElapsedTimer timer;
+    VisitVector visits;
+    ASSERT_TRUE(GetAllVisitsInRange(YearAgo(), base::Time(), 0, &visits));
+    int64_t checksum = 0;
+    for (const VisitRow& visit : visits)
+      checksum += visit.url_id + visit.transition;
+    const base::TimeDelta elapsed = timer.Elapsed();
+    EXPECT_EQ(static_cast<size_t>(kDays * kVisitsPerDay), visits.size());
+    EXPECT_NE(0, checksum);
+
+    SetUpReporter(story_name)
+        .AddResult(kMetricScanTime, elapsed.InMillisecondsF());
+  }
+
+  // Reads the `columns` of the visits a batch at a time.
+  void RunColumnar(uint32_t columns, const std::string& story_name) {
+    base::ElapsedTimer timer;
+    VisitColumnEnumerator enumerator;
+    ASSERT_TRUE(InitVisitColumnEnumerator(YearAgo(), base::Time(), columns,
+                                          kBatchSize, &enumerator));
+    VisitColumnBatch batch;
+    size_t visit_count = 0;
+    int64_t checksum = 0;
+    while (enumerator.GetNextBatch(&batch)) {
+      visit_count += batch.size;
+      for (size_t i = 0; i < batch.size; ++i)
+        checksum += batch.url_ids[i] + batch.transitions[i];
+    }
+    const base::TimeDelta elapsed = timer.Elapsed();
+    EXPECT_EQ(static_cast<size_t>(kDays * kVisitsPerDay), visit_count);
+    EXPECT_NE(0, checksum);
+
+    SetUpReporter(story_name)
+        .AddResult(kMetricScanTime, elapsed.InMillisecondsF());
+  }
+
+ private:
+  base::Time YearAgo() const {
+    return now_ - base::TimeDelta::FromDays(kDays + 1);
+  }
+
+  base::ScopedTempDir temp_dir_;
+  sql::Database db_;
+  const base::Time now_ = base::Time::Now();
+};
+
+}  // namespace
+
+TEST_F(VisitDatabasePerfTest, RowBased) {
+  RunRowBased("one_year_row_based");
+}
+
+TEST_F(VisitDatabasePerfTest, ColumnarCoveringIndex) {
+  RunColumnar(kURLIdColumn | kTransitionColumn, "one_year_columnar_covering");
+}
+
+TEST_F(VisitDatabasePerfTest, ColumnarWithDurations) {
+  RunColumnar(kURLIdColumn | kTransitionColumn | kVisitDurationColumn,
+              "one_year_columnar_with_durations");
+}
+
+}  // namespace history
@@ -5,6 +5,7 @@
 #include <stddef.h>
 
 #include <set>
+#include <string>
 #include <vector>
 
 #include "base/strings/string_util.h"
@@ -12,9 +13,12 @@
 #include "components/history/core/browser/url_database.h"
 #include "components/history/core/browser/visit_database.h"
 #include "sql/database.h"
+#include "sql/statement.h"
+#include "sql/test/scoped_error_expecter.h"
 #include "testing/gmock/include/gmock/gmock.h"
 #include "testing/gtest/include/gtest/gtest.h"
 #include "testing/platform_test.h"
+#include "third_party/sqlite/sqlite3.h"
 
 using base::Time;
 using base::TimeDelta;
@@ -287,6 +291,40 @@ TEST_F(VisitDatabaseTest, GetAllVisitsInRange) {
   EXPECT_TRUE(IsVisitInfoEqual(results[0], test_visit_rows[0]));
 }
 
+// Tests that paging through a range finds each visit once, including the
+// visits at the same time on both sides of a page boundary.
+TEST_F(VisitDatabaseTest, GetNextVisitsInRange) {
+  const Time begin_time = Time::Now();
+  VisitVector added_visits;
+  for (int i = 0; i < 5; ++i) {
+    VisitRow visit(1, begin_time + TimeDelta::FromMinutes(i / 2), 0,
+                   ui::PAGE_TRANSITION_LINK, 0, false, false);
+    ASSERT_TRUE(AddVisit(&visit, SOURCE_BROWSED));
+    added_visits.push_back(visit);
+  }
+  const Time end_time = begin_time + TimeDelta::FromMinutes(2);
+
+  std::vector<VisitID> visit_ids;
+  Time next_time = begin_time;
+  VisitID last_visit_id = 0;
+  VisitVector page;
+  do {
+    ASSERT_TRUE(
+        GetNextVisitsInRange(next_time, last_visit_id, end_time, 3, &page));
+    for (const VisitRow& visit : page)
+      visit_ids.push_back(visit.visit_id);
+    if (!page.empty()) {
+      next_time = page.back().visit_time;
+      last_visit_id = page.back().visit_id;
+    }
+  } while (page.size() == 3);
+
+  // The last visit is at the end of the range, which is excluded.
+  ASSERT_EQ(4U, visit_ids.size());
+  for (size_t i = 0; i < visit_ids.size(); ++i)
+    EXPECT_EQ(added_visits[i].visit_id, visit_ids[i]);
+}
+
 TEST_F(VisitDatabaseTest, GetVisibleVisitsInRange) {
   std::vector<VisitRow> test_visit_rows = GetTestVisitRows();
 
@@ -947,4 +985,220 @@ TEST_F(VisitDatabaseTest,
               IsEmpty());
 }
 
+// Tests that the column enumerator reads the visits in the range in batches,
+// the same as GetAllVisitsInRange() does row by row.
+TEST_F(VisitDatabaseTest, VisitColumnEnumerator) {
+  const Time begin_time = Time::Now();
+  for (int i = 0; i < 10; ++i) {
+    VisitRow visit(i % 3 + 1, begin_time + TimeDelta::FromMinutes(i), 0,
+                   i % 2 ? ui::PAGE_TRANSITION_TYPED : ui::PAGE_TRANSITION_LINK,
+                   0, false, false);
+    visit.visit_duration = TimeDelta::FromSeconds(i);
+    ASSERT_TRUE(AddVisit(&visit, SOURCE_BROWSED));
+  }
+  const Time end_time = begin_time + TimeDelta::FromMinutes(9);
+  VisitVector visits;
+  ASSERT_TRUE(GetAllVisitsInRange(begin_time, end_time, 0, &visits));
+  ASSERT_EQ(9U, visits.size());
+
+  VisitColumnEnumerator enumerator;
+  ASSERT_TRUE(InitVisitColumnEnumerator(
+      begin_time, end_time,
+      kVisitIdColumn | kURLIdColumn | kVisitTimeColumn | kTransitionColumn |
+          kVisitDurationColumn,
+      4, &enumerator));
+  VisitColumnBatch batch;
+  size_t visit_count = 0;
+  for (size_t batch_size : {4U, 4U, 1U}) {
+    ASSERT_TRUE(enumerator.GetNextBatch(&batch));
+    ASSERT_EQ(batch_size, batch.size);
+    ASSERT_EQ(batch_size, batch.visit_ids.size());
+    ASSERT_EQ(batch_size, batch.url_ids.size());
+    ASSERT_EQ(batch_size, batch.visit_times.size());
+    ASSERT_EQ(batch_size, batch.transitions.size());
+    ASSERT_EQ(batch_size, batch.visit_durations.size());
+    for (size_t i = 0; i < batch.size; ++i, ++visit_count) {
+      const VisitRow& visit = visits[visit_count];
+      EXPECT_EQ(visit.visit_id, batch.visit_ids[i]);
+      EXPECT_EQ(visit.url_id, batch.url_ids[i]);
+      EXPECT_EQ(visit.visit_time, batch.visit_times[i]);
+      EXPECT_TRUE(ui::PageTransitionTypeIncludingQualifiersIs(
+          visit.transition, batch.transitions[i]));
+      EXPECT_EQ(visit.visit_duration, batch.visit_durations[i]);
+    }
+  }
+  EXPECT_FALSE(enumerator.GetNextBatch(&batch));
+  EXPECT_EQ(0U, batch.size);
+}
+
+// Tests that only the selected columns are read.
+TEST_F(VisitDatabaseTest, VisitColumnEnumeratorSelectedColumns) {
+  const Time now = Time::Now();
+  VisitRow visit(1, now, 0, ui::PAGE_TRANSITION_LINK, 0, false, false);
+  ASSERT_TRUE(AddVisit(&visit, SOURCE_BROWSED));
+
+  VisitColumnEnumerator enumerator;
+  ASSERT_TRUE(InitVisitColumnEnumerator(
+      Time(), Time(), kURLIdColumn | kVisitTimeColumn, 100, &enumerator));
+  VisitColumnBatch batch;
+  ASSERT_TRUE(enumerator.GetNextBatch(&batch));
+  EXPECT_EQ(1U, batch.size);
+  EXPECT_THAT(batch.url_ids, ElementsAre(1));
+  EXPECT_THAT(batch.visit_times, ElementsAre(now));
+  EXPECT_THAT(batch.visit_ids, IsEmpty());
+  EXPECT_THAT(batch.transitions, IsEmpty());
+  EXPECT_THAT(batch.visit_durations, IsEmpty());
+  EXPECT_FALSE(enumerator.GetNextBatch(&batch));
+}
+
+// Tests that scans of the indexed columns do not read the visits table.
+TEST_F(VisitDatabaseTest, VisitColumnEnumeratorUsesCoveringIndex) {
+  sql::Statement plan(GetDB().GetUniqueStatement(
+      "EXPLAIN QUERY PLAN SELECT id,url,visit_time,transition FROM visits "
+      "WHERE visit_time >= ? AND visit_time < ? ORDER BY visit_time"));
+  ASSERT_TRUE(plan.Step());
+  EXPECT_NE(std::string::npos,
+            plan.ColumnString(3).find(
+                "COVERING INDEX visits_time_url_transition_index"));
+}
+
+// Tests that adding, updating and deleting visits keeps the domains visited
+// per day up to date.
+TEST_F(VisitDatabaseTest, CountDomainsVisitedOnDays) {
+  ASSERT_TRUE(InitDomainVisitsTable());
+  const Time today = Time::Now().LocalMidnight();
+  const Time yesterday = (today - TimeDelta::FromHours(12)).LocalMidnight();
+  const Time tomorrow = (today + TimeDelta::FromHours(36)).LocalMidnight();
+  const URLID foo_id = AddURL(URLRow(GURL("https://www.foo.com/")));
+  const URLID foo_mail_id = AddURL(URLRow(GURL("https://mail.foo.com/")));
+  const URLID bar_id = AddURL(URLRow(GURL("https://bar.co.uk/page")));
+  const URLID ip_id = AddURL(URLRow(GURL("http://127.0.0.1/")));
+  const ui::PageTransition link = ui::PageTransitionFromInt(
+      ui::PAGE_TRANSITION_LINK | ui::PAGE_TRANSITION_CHAIN_END);
+
+  VisitRow foo_visit(foo_id, today + TimeDelta::FromHours(1), 0, link, 0,
+                     false, false);
+  ASSERT_TRUE(AddVisit(&foo_visit, SOURCE_BROWSED));
+  VisitRow foo_mail_visit(foo_mail_id, today + TimeDelta::FromHours(2), 0,
+                          link, 0, false, false);
+  ASSERT_TRUE(AddVisit(&foo_mail_visit, SOURCE_BROWSED));
+  VisitRow bar_visit(bar_id, yesterday + TimeDelta::FromHours(1), 0, link, 0,
+                     false, false);
+  ASSERT_TRUE(AddVisit(&bar_visit, SOURCE_BROWSED));
+  VisitRow ip_visit(ip_id, today + TimeDelta::FromHours(3), 0, link, 0, false,
+                    false);
+  ASSERT_TRUE(AddVisit(&ip_visit, SOURCE_BROWSED));
+  // Visits that do not count: a subframe, and the start of a redirect chain.
+  VisitRow subframe_visit(bar_id, today + TimeDelta::FromHours(4), 0,
+                          ui::PageTransitionFromInt(
+                              ui::PAGE_TRANSITION_AUTO_SUBFRAME |
+                              ui::PAGE_TRANSITION_CHAIN_END),
+                          0, false, false);
+  ASSERT_TRUE(AddVisit(&subframe_visit, SOURCE_BROWSED));
+  VisitRow redirect_visit(bar_id, today + TimeDelta::FromHours(5), 0,
+                          ui::PageTransitionFromInt(
+                              ui::PAGE_TRANSITION_LINK |
+                              ui::PAGE_TRANSITION_CHAIN_START),
+                          0, false, false);
+  ASSERT_TRUE(AddVisit(&redirect_visit, SOURCE_BROWSED));
+
+  int count = 0;
+  ASSERT_TRUE(CountDomainsVisitedOnDays(today, tomorrow, &count));
+  EXPECT_EQ(1, count);
+  ASSERT_TRUE(CountDomainsVisitedOnDays(yesterday, tomorrow, &count));
+  EXPECT_EQ(2, count);
+  // Only whole days are counted.
+  EXPECT_FALSE(CountDomainsVisitedOnDays(
+      today + TimeDelta::FromMinutes(1), tomorrow, &count));
+
+  // The redirect chain ending counts.
+  redirect_visit.transition = ui::PageTransitionFromInt(
+      redirect_visit.transition | ui::PAGE_TRANSITION_CHAIN_END);
+  ASSERT_TRUE(UpdateVisitRow(redirect_visit));
+  ASSERT_TRUE(CountDomainsVisitedOnDays(today, tomorrow, &count));
+  EXPECT_EQ(2, count);
+
+  // foo.com is still visited today until both of its visits are deleted.
+  DeleteVisit(foo_visit);
+  ASSERT_TRUE(CountDomainsVisitedOnDays(today, tomorrow, &count));
+  EXPECT_EQ(2, count);
+  DeleteVisit(foo_mail_visit);
+  DeleteVisit(redirect_visit);
+  ASSERT_TRUE(CountDomainsVisitedOnDays(today, tomorrow, &count));
+  EXPECT_EQ(0, count);
+  ASSERT_TRUE(CountDomainsVisitedOnDays(yesterday, tomorrow, &count));
+  EXPECT_EQ(1, count);
+
+  // Filling the table again from the visits gives the same counts.
+  set_domain_visits_incomplete(0);
+  EXPECT_FALSE(CountDomainsVisitedOnDays(yesterday, tomorrow, &count));
+  while (!domain_visits_complete())
+    ASSERT_TRUE(CountDomainVisitsBatch(1));
+  ASSERT_TRUE(CountDomainsVisitedOnDays(yesterday, tomorrow, &count));
+  EXPECT_EQ(1, count);
+}
+
+// Tests that the visits added, updated and deleted while the domain_visits
+// table is filled in batches are counted once.
+TEST_F(VisitDatabaseTest, CountDomainVisitsBatch) {
+  ASSERT_TRUE(InitDomainVisitsTable());
+  const Time today = Time::Now().LocalMidnight();
+  const Time tomorrow = (today + TimeDelta::FromHours(36)).LocalMidnight();
+  const ui::PageTransition link = ui::PageTransitionFromInt(
+      ui::PAGE_TRANSITION_LINK | ui::PAGE_TRANSITION_CHAIN_END);
+  const char* const kURLs[] = {"https://foo.com/", "https://bar.com/",
+                               "https://baz.com/"};
+  VisitVector visits;
+  for (const char* url : kURLs) {
+    VisitRow visit(AddURL(URLRow(GURL(url))), today + TimeDelta::FromHours(1),
+                   0, link, 0, false, false);
+    ASSERT_TRUE(AddVisit(&visit, SOURCE_BROWSED));
+    visits.push_back(visit);
+  }
+
+  set_domain_visits_incomplete(0);
+  ASSERT_TRUE(CountDomainVisitsBatch(1));
+  ASSERT_FALSE(domain_visits_complete());
+  EXPECT_EQ(visits[0].visit_id, domain_visits_last_visit_id());
+
+  // foo.com is uncounted right away, bar.com once the batches get to it.
+  DeleteVisit(visits[0]);
+  DeleteVisit(visits[1]);
+  VisitRow qux_visit(AddURL(URLRow(GURL("https://qux.com/"))),
+                     today + TimeDelta::FromHours(2), 0, link, 0, false,
+                     false);
+  ASSERT_TRUE(AddVisit(&qux_visit, SOURCE_BROWSED));
+
+  int count = 0;
+  EXPECT_FALSE(CountDomainsVisitedOnDays(today, tomorrow, &count));
+  while (!domain_visits_complete())
+    ASSERT_TRUE(CountDomainVisitsBatch(1));
+  ASSERT_TRUE(CountDomainsVisitedOnDays(today, tomorrow, &count));
+  EXPECT_EQ(2, count);
+}
+
+// Tests that a visit is deleted even if its domain visit cannot be updated.
+TEST_F(VisitDatabaseTest, DeleteVisitWithoutDomainVisits) {
+  ASSERT_TRUE(InitDomainVisitsTable());
+  const URLID url_id = AddURL(URLRow(GURL("https://www.foo.com/")));
+  VisitRow visit(url_id, Time::Now(), 0,
+                 ui::PageTransitionFromInt(ui::PAGE_TRANSITION_LINK |
+                                           ui::PAGE_TRANSITION_CHAIN_END),
+                 0, false, false);
+  ASSERT_TRUE(AddVisit(&visit, SOURCE_BROWSED));
+
+  ASSERT_TRUE(GetDB().Execute("DROP TABLE domain_visits"));
+  {
+    sql::test::ScopedErrorExpecter expecter;
+    expecter.ExpectError(SQLITE_ERROR);
+    DeleteVisit(visit);
+    EXPECT_TRUE(expecter.SawExpectedErrors());
+  }
+  VisitRow deleted_visit;
+  EXPECT_FALSE(GetRowForVisit(visit.visit_id, &deleted_visit));
+  // The domain visits are to be counted again.
+  EXPECT_FALSE(domain_visits_complete());
+  EXPECT_EQ(0, domain_visits_last_visit_id());
+}
+
 }  // namespace history
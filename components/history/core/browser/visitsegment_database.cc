@@ -8,7 +8,6 @@
 #include <stddef.h>
 #include <stdint.h>
 
-#include <algorithm>
 #include <memory>
 #include <string>
 #include <vector>
@@ -35,6 +34,11 @@
 //   time_slot          time stamp identifying for what day this entry is about
 //   visit_count        Number of visit in the segment
 //
+// segment_scores (temporary, never written to disk)
+//   segment_id         Corresponding segment id
+//   score              Score of the segment in the ranking QuerySegmentUsage()
+//                      returns, as of segment_scores_day_
+//
 
 namespace history {
 
@@ -87,13 +91,25 @@ bool VisitSegmentDatabase::InitSegmentTables() {
                        "ON segment_usage(segment_id)"))
     return false;
 
+  // The ranking is recomputed at least once a day, so it is not worth keeping
+  // across sessions.
+  if (!GetDB().Execute("CREATE TEMP TABLE IF NOT EXISTS segment_scores ("
+                       "segment_id INTEGER PRIMARY KEY,"
+                       "score DOUBLE NOT NULL)") ||
+      !GetDB().Execute("CREATE INDEX IF NOT EXISTS segment_scores_score "
+                       "ON segment_scores(score)")) {
+    return false;
+  }
+
   return true;
 }
 
 bool VisitSegmentDatabase::DropSegmentTables() {
+  InvalidateSegmentScores();
   // Dropping the tables will implicitly delete the indices.
   return GetDB().Execute("DROP TABLE segments") &&
-         GetDB().Execute("DROP TABLE segment_usage");
+         GetDB().Execute("DROP TABLE segment_usage") &&
+         GetDB().Execute("DROP TABLE segment_scores");
 }
 
 // Note: the segment name is derived from the URL but is not a URL. It is
@@ -179,13 +195,16 @@ bool VisitSegmentDatabase::IncreaseSegmentVisitCount(SegmentID segment_id,
   if (!select.is_valid())
     return false;
 
+  int64_t visit_count = 0;
   if (select.Step()) {
+    visit_count = select.ColumnInt64(1);
     sql::Statement update(GetDB().GetCachedStatement(SQL_FROM_HERE,
         "UPDATE segment_usage SET visit_count = ? WHERE id = ?"));
-    update.BindInt64(0, select.ColumnInt64(1) + static_cast<int64_t>(amount));
+    update.BindInt64(0, visit_count + static_cast<int64_t>(amount));
     update.BindInt64(1, select.ColumnInt64(0));
 
-    return update.Run();
+    if (!update.Run())
+      return false;
   } else {
     sql::Statement insert(GetDB().GetCachedStatement(SQL_FROM_HERE,
         "INSERT INTO segment_usage "
@@ -194,8 +213,12 @@ bool VisitSegmentDatabase::IncreaseSegmentVisitCount(SegmentID segment_id,
     insert.BindInt64(1, t.ToInternalValue());
     insert.BindInt64(2, static_cast<int64_t>(amount));
 
-    return insert.Run();
+    if (!insert.Run())
+      return false;
   }
+
+  return UpdateSegmentScore(segment_id, t, visit_count,
+                            visit_count + static_cast<int64_t>(amount));
 }
 
 std::vector<std::unique_ptr<PageUsageData>>
@@ -203,86 +226,50 @@ VisitSegmentDatabase::QuerySegmentUsage(
     base::Time from_time,
     int max_result_count,
     const base::RepeatingCallback<bool(const GURL&)>& url_filter) {
-  // This function gathers the highest-ranked segments in two queries.
-  // The first gathers scores for all segments.
-  // The second gathers segment data (url, title, etc.) for the highest-ranked
-  // segments.
-
-  // Gather all the segment scores.
-  sql::Statement statement(GetDB().GetCachedStatement(SQL_FROM_HERE,
-      "SELECT segment_id, time_slot, visit_count "
-      "FROM segment_usage WHERE time_slot >= ? "
-      "ORDER BY segment_id"));
-  if (!statement.is_valid())
-    return std::vector<std::unique_ptr<PageUsageData>>();
-
-  base::Time ts = from_time.LocalMidnight();
-  statement.BindInt64(0, ts.ToInternalValue());
-
-  std::vector<std::unique_ptr<PageUsageData>> segments;
   base::Time now = base::Time::Now();
-  SegmentID previous_segment_id = 0;
-  while (statement.Step()) {
-    SegmentID segment_id = statement.ColumnInt64(0);
-    if (segment_id != previous_segment_id) {
-      segments.push_back(std::make_unique<PageUsageData>(segment_id));
-      previous_segment_id = segment_id;
-    }
-
-    base::Time timeslot =
-        base::Time::FromInternalValue(statement.ColumnInt64(1));
-    int visit_count = statement.ColumnInt(2);
-    int days_ago = (now - timeslot).InDays();
-
-    // Score for this day in isolation.
-    float day_visits_score = 1.0f + log(static_cast<float>(visit_count));
-    // Recent visits count more than historical ones, so we multiply in a boost
-    // related to how long ago this day was.
-    // This boost is a curve that smoothly goes through these values:
-    // Today gets 3x, a week ago 2x, three weeks ago 1.5x, falling off to 1x
-    // at the limit of how far we reach into the past.
-    float recency_boost = 1.0f + (2.0f * (1.0f / (1.0f + days_ago/7.0f)));
-    float score = recency_boost * day_visits_score;
-    segments.back()->SetScore(segments.back()->GetScore() + score);
+  base::Time from_slot = from_time.LocalMidnight();
+  if (segment_scores_day_ != now.LocalMidnight() ||
+      segment_scores_from_slot_ != from_slot) {
+    if (!RebuildSegmentScores(from_slot, now))
+      return std::vector<std::unique_ptr<PageUsageData>>();
   }
 
-  // Order by descending scores.
-  std::sort(segments.begin(), segments.end(),
-            [](const std::unique_ptr<PageUsageData>& lhs,
-               const std::unique_ptr<PageUsageData>& rhs) {
-              return lhs->GetScore() > rhs->GetScore();
-            });
-
-  // Now fetch the details about the entries we care about.
-  sql::Statement statement2(GetDB().GetCachedStatement(SQL_FROM_HERE,
-      "SELECT urls.url, urls.title FROM urls "
-      "JOIN segments ON segments.url_id = urls.id "
-      "WHERE segments.id = ?"));
-
-  if (!statement2.is_valid())
+  // Read the highest-ranked segments, until enough of them pass the filter.
+  sql::Statement statement(GetDB().GetCachedStatement(SQL_FROM_HERE,
+      "SELECT segment_scores.segment_id, segment_scores.score, urls.url, "
+      "urls.title FROM segment_scores "
+      "JOIN segments ON segments.id = segment_scores.segment_id "
+      "JOIN urls ON urls.id = segments.url_id "
+      "ORDER BY segment_scores.score DESC"));
+  if (!statement.is_valid())
     return std::vector<std::unique_ptr<PageUsageData>>();
 
   std::vector<std::unique_ptr<PageUsageData>> results;
   DCHECK_GE(max_result_count, 0);
-  for (std::unique_ptr<PageUsageData>& pud : segments) {
-    statement2.BindInt64(0, pud->GetID());
-    if (statement2.Step()) {
-      GURL url(statement2.ColumnString(0));
-      if (url_filter.is_null() || url_filter.Run(url)) {
-        pud->SetURL(url);
-        pud->SetTitle(statement2.ColumnString16(1));
-        results.push_back(std::move(pud));
-        if (results.size() >= static_cast<size_t>(max_result_count))
-          break;
-      }
-    }
-    statement2.Reset(true);
+  while (results.size() < static_cast<size_t>(max_result_count) &&
+         statement.Step()) {
+    GURL url(statement.ColumnString(2));
+    if (!url_filter.is_null() && !url_filter.Run(url))
+      continue;
+    auto pud = std::make_unique<PageUsageData>(statement.ColumnInt64(0));
+    pud->SetScore(statement.ColumnDouble(1));
+    pud->SetURL(url);
+    pud->SetTitle(statement.ColumnString16(3));
+    results.push_back(std::move(pud));
   }
 
   return results;
 }
 
 bool VisitSegmentDatabase::DeleteSegmentForURL(URLID url_id) {
+  sql::Statement delete_score(GetDB().GetCachedStatement(SQL_FROM_HERE,
+      "DELETE FROM segment_scores WHERE segment_id IN "
+      "(SELECT id FROM segments WHERE url_id = ?)"));
+  delete_score.BindInt64(0, url_id);
+
+  if (!delete_score.Run())
+    return false;
+
   sql::Statement delete_usage(GetDB().GetCachedStatement(SQL_FROM_HERE,
       "DELETE FROM segment_usage WHERE segment_id IN "
       "(SELECT id FROM segments WHERE url_id = ?)"));
@@ -298,7 +285,107 @@ bool VisitSegmentDatabase::DeleteSegmentForURL(URLID url_id) {
   return delete_seg.Run();
 }
 
+void VisitSegmentDatabase::InvalidateSegmentScores() {
+  segment_scores_day_ = base::Time();
+  segment_scores_from_slot_ = base::Time();
+}
+
+// static
+float VisitSegmentDatabase::ComputeDayScore(base::Time now,
+                                            base::Time time_slot,
+                                            int64_t visit_count) {
+  int days_ago = (now - time_slot).InDays();
+
+  // Score for this day in isolation.
+  float day_visits_score = 1.0f + log(static_cast<float>(visit_count));
+  // Recent visits count more than historical ones, so we multiply in a boost
+  // related to how long ago this day was.
+  // This boost is a curve that smoothly goes through these values:
+  // Today gets 3x, a week ago 2x, three weeks ago 1.5x, falling off to 1x
+  // at the limit of how far we reach into the past.
+  float recency_boost = 1.0f + (2.0f * (1.0f / (1.0f + days_ago/7.0f)));
+  return recency_boost * day_visits_score;
+}
+
+bool VisitSegmentDatabase::RebuildSegmentScores(base::Time from_slot,
+                                                base::Time now) {
+  InvalidateSegmentScores();
+  if (!GetDB().Execute("DELETE FROM segment_scores"))
+    return false;
+
+  // Gather all the segment scores.
+  sql::Statement statement(GetDB().GetCachedStatement(SQL_FROM_HERE,
+      "SELECT segment_id, time_slot, visit_count "
+      "FROM segment_usage WHERE time_slot >= ? "
+      "ORDER BY segment_id"));
+  sql::Statement insert(GetDB().GetCachedStatement(SQL_FROM_HERE,
+      "INSERT INTO segment_scores (segment_id, score) VALUES (?, ?)"));
+  if (!statement.is_valid() || !insert.is_valid())
+    return false;
+  statement.BindInt64(0, from_slot.ToInternalValue());
+
+  auto insert_score = [&insert](SegmentID segment_id, double score) {
+    insert.BindInt64(0, segment_id);
+    insert.BindDouble(1, score);
+    bool success = insert.Run();
+    insert.Reset(true);
+    return success;
+  };
+
+  SegmentID segment_id = 0;
+  double score = 0;
+  while (statement.Step()) {
+    if (statement.ColumnInt64(0) != segment_id) {
+      if (segment_id && !insert_score(segment_id, score))
+        return false;
+      segment_id = statement.ColumnInt64(0);
+      score = 0;
+    }
+    score += ComputeDayScore(
+        now, base::Time::FromInternalValue(statement.ColumnInt64(1)),
+        statement.ColumnInt(2));
+  }
+  if (segment_id && !insert_score(segment_id, score))
+    return false;
+
+  segment_scores_day_ = now.LocalMidnight();
+  segment_scores_from_slot_ = from_slot;
+  return true;
+}
+
+bool VisitSegmentDatabase::UpdateSegmentScore(SegmentID segment_id,
+                                              base::Time time_slot,
+                                              int64_t old_visit_count,
+                                              int64_t new_visit_count) {
+  // There is nothing to update if the ranking is to be recomputed anyway, or
+  // does not go back that far.
+  base::Time now = base::Time::Now();
+  if (segment_scores_day_ != now.LocalMidnight() ||
+      time_slot < segment_scores_from_slot_) {
+    return true;
+  }
+
+  double delta = ComputeDayScore(now, time_slot, new_visit_count);
+  if (old_visit_count > 0)
+    delta -= ComputeDayScore(now, time_slot, old_visit_count);
+
+  sql::Statement insert(GetDB().GetCachedStatement(SQL_FROM_HERE,
+      "INSERT OR IGNORE INTO segment_scores (segment_id, score) "
+      "VALUES (?, 0)"));
+  insert.BindInt64(0, segment_id);
+  sql::Statement update(GetDB().GetCachedStatement(SQL_FROM_HERE,
+      "UPDATE segment_scores SET score = score + ? WHERE segment_id = ?"));
+  update.BindDouble(0, delta);
+  update.BindInt64(1, segment_id);
+  if (insert.Run() && update.Run())
+    return true;
+
+  InvalidateSegmentScores();
+  return false;
+}
+
 bool VisitSegmentDatabase::MigratePresentationIndex() {
+  InvalidateSegmentScores();
   sql::Transaction transaction(&GetDB());
   return transaction.Begin() &&
       GetDB().Execute("DROP TABLE presentation") &&
@@ -350,6 +437,7 @@ bool VisitSegmentDatabase::RenameSegment(SegmentID segment_id,
 
 bool VisitSegmentDatabase::MergeSegments(SegmentID from_segment_id,
                                          SegmentID to_segment_id) {
+  InvalidateSegmentScores();
   sql::Transaction transaction(&GetDB());
   if (!transaction.Begin())
     return false;
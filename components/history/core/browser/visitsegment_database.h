@@ -5,11 +5,14 @@
 #ifndef COMPONENTS_HISTORY_CORE_BROWSER_VISITSEGMENT_DATABASE_H_
 #define COMPONENTS_HISTORY_CORE_BROWSER_VISITSEGMENT_DATABASE_H_
 
+#include <stdint.h>
+
 #include <memory>
 #include <string>
 
 #include "base/callback_forward.h"
 #include "base/macros.h"
+#include "base/time/time.h"
 #include "components/history/core/browser/history_types.h"
 
 namespace sql {
@@ -53,6 +56,10 @@ class VisitSegmentDatabase {
   // Computes the segment usage since `from_time`. If `url_filter` is non-null,
   // then only URLs for which it returns true will be included.
   // Returns the highest-scored segments up to `max_result_count`.
+  //
+  // The scores are read from a ranking that visits keep up to date, and that
+  // is only recomputed from the segment usage once a day, or when `from_time`
+  // falls on another day than in the previous call.
   std::vector<std::unique_ptr<PageUsageData>> QuerySegmentUsage(
       base::Time from_time,
       int max_result_count,
@@ -77,6 +84,10 @@ class VisitSegmentDatabase {
   // presentation table is removed entirely.
   bool MigratePresentationIndex();
 
+  // Discards the ranking QuerySegmentUsage() reads, so that the next call
+  // recomputes it.
+  void InvalidateSegmentScores();
+
   // Runs ComputeSegmentName() to recompute 'name'. If multiple segments have
   // the same name, they are merged by:
   // 1. Choosing one arbitrary `segment_id` and updating all references.
@@ -85,6 +96,22 @@ class VisitSegmentDatabase {
   bool MigrateVisitSegmentNames();
 
  private:
+  // Returns the score of `visit_count` visits on the day of `time_slot`, as of
+  // `now`.
+  static float ComputeDayScore(base::Time now,
+                               base::Time time_slot,
+                               int64_t visit_count);
+
+  // Recomputes the ranking from the segment usage since `from_slot`.
+  bool RebuildSegmentScores(base::Time from_slot, base::Time now);
+
+  // Updates the ranking after the visit count of `segment_id` on the day of
+  // `time_slot` went from `old_visit_count` to `new_visit_count`.
+  bool UpdateSegmentScore(SegmentID segment_id,
+                          base::Time time_slot,
+                          int64_t old_visit_count,
+                          int64_t new_visit_count);
+
   // Updates the `name` column for a single segment. Returns true on success.
   bool RenameSegment(SegmentID segment_id, const std::string& new_name);
   // Merges two segments such that data is aggregated, all former references to
@@ -92,6 +119,11 @@ class VisitSegmentDatabase {
   // deleted. Returns true on success.
   bool MergeSegments(SegmentID from_segment_id, SegmentID to_segment_id);
 
+  // The day and the first time slot the ranking in the segment_scores table
+  // was computed for. Null when it has to be recomputed.
+  base::Time segment_scores_day_;
+  base::Time segment_scores_from_slot_;
+
   DISALLOW_COPY_AND_ASSIGN(VisitSegmentDatabase);
 };
 
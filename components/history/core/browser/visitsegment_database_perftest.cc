@@ -0,0 +1,135 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "components/history/core/browser/visitsegment_database.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/callback_helpers.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/stringprintf.h"
+#include "base/time/time.h"
+#include "base/timer/elapsed_timer.h"
+#include "components/history/core/browser/page_usage_data.h"
+#include "components/history/core/browser/url_database.h"
+#include "sql/database.h"
+#include "sql/transaction.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+#include "url/gurl.h"
+
+namespace history {
+
+namespace {
+
+constexpr char kMetricPrefixVisitSegment[] = "VisitSegmentDatabase.";
+constexpr char kMetricRecomputeTime[] = "recompute_time";
+constexpr char kMetricQueryTime[] = "query_time";
+constexpr char kMetricVisitTime[] = "visit_time";
+
+// The TopSites parameters.
+constexpr int kDaysBack = 90;
+constexpr int kResultCount = 10;
+
+constexpr int kQueryCount = 100;
+constexpr int kVisitCount = 1000;
+
+perf_test::PerfResultReporter SetUpReporter(const std::string& story_name) {
+  perf_test::PerfResultReporter reporter(kMetricPrefixVisitSegment,
+                                         story_name);
+  reporter.RegisterImportantMetric(kMetricRecomputeTime, "ms");
+  reporter.RegisterImportantMetric(kMetricQueryTime, "us");
+  reporter.RegisterImportantMetric(kMetricVisitTime, "us");
+  return reporter;
+}
+
+class VisitSegmentDatabasePerfTest : public testing::Test,
+                                     public URLDatabase,
+                                     public VisitSegmentDatabase {
+ public:
+  VisitSegmentDatabasePerfTest() = default;
+
+ protected:
+  sql::Database& GetDB() override { return db_; }
+
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    ASSERT_TRUE(db_.Open(temp_dir_.GetPath().AppendASCII("SegmentTest.db")));
+    CreateURLTable(false);
+    CreateMainURLIndex();
+    ASSERT_TRUE(InitSegmentTables());
+  }
+
+  // Adds `segment_count` segments, each visited on one day in three of the
+  // last `kDaysBack` days.
+  void PopulateDatabase(int segment_count) {
+    sql::Transaction transaction(&db_);
+    ASSERT_TRUE(transaction.Begin());
+    const base::Time now = base::Time::Now();
+    for (int i = 0; i < segment_count; ++i) {
+      GURL url(base::StringPrintf("https://www.site%d.com/", i));
+      URLID url_id = AddURL(URLRow(url));
+      SegmentID segment_id = CreateSegment(url_id, ComputeSegmentName(url));
+      segment_ids_.push_back(segment_id);
+      for (int day = i % 3; day < kDaysBack; day += 3) {
+        ASSERT_TRUE(IncreaseSegmentVisitCount(
+            segment_id, now - base::TimeDelta::FromDays(day), 1 + i % 11));
+      }
+    }
+    ASSERT_TRUE(transaction.Commit());
+  }
+
+  void RunTest(int segment_count, const std::string& story_name) {
+    PopulateDatabase(segment_count);
+    const base::Time from_time =
+        base::Time::Now() - base::TimeDelta::FromDays(kDaysBack);
+
+    // What every query cost before the ranking was kept up to date.
+    base::ElapsedTimer recompute_timer;
+    InvalidateSegmentScores();
+    ASSERT_EQ(static_cast<size_t>(kResultCount),
+              QuerySegmentUsage(from_time, kResultCount, base::NullCallback())
+                  .size());
+    const base::TimeDelta recompute_time = recompute_timer.Elapsed();
+
+    base::ElapsedTimer query_timer;
+    for (int i = 0; i < kQueryCount; ++i)
+      QuerySegmentUsage(from_time, kResultCount, base::NullCallback());
+    const base::TimeDelta query_time = query_timer.Elapsed();
+
+    base::ElapsedTimer visit_timer;
+    const base::Time now = base::Time::Now();
+    for (int i = 0; i < kVisitCount; ++i) {
+      IncreaseSegmentVisitCount(segment_ids_[(i * 7919) % segment_count], now,
+                                1);
+    }
+    const base::TimeDelta visit_time = visit_timer.Elapsed();
+
+    auto reporter = SetUpReporter(story_name);
+    reporter.AddResult(kMetricRecomputeTime, recompute_time.InMillisecondsF());
+    reporter.AddResult(kMetricQueryTime,
+                       query_time.InMicrosecondsF() / kQueryCount);
+    reporter.AddResult(kMetricVisitTime,
+                       visit_time.InMicrosecondsF() / kVisitCount);
+  }
+
+ private:
+  base::ScopedTempDir temp_dir_;
+  sql::Database db_;
+  std::vector<SegmentID> segment_ids_;
+};
+
+}  // namespace
+
+TEST_F(VisitSegmentDatabasePerfTest, 10kSegments) {
+  RunTest(10000, "10k_segments");
+}
+
+TEST_F(VisitSegmentDatabasePerfTest, 100kSegments) {
+  RunTest(100000, "100k_segments");
+}
+
+}  // namespace history
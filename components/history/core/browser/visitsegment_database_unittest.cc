@@ -0,0 +1,153 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "components/history/core/browser/visitsegment_database.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include "base/callback_helpers.h"
+#include "base/files/file_path.h"
+#include "base/files/scoped_temp_dir.h"
+#include "base/strings/stringprintf.h"
+#include "components/history/core/browser/page_usage_data.h"
+#include "components/history/core/browser/url_database.h"
+#include "sql/database.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "url/gurl.h"
+
+using base::Time;
+using base::TimeDelta;
+
+namespace history {
+
+class VisitSegmentDatabaseTest : public testing::Test,
+                                 public URLDatabase,
+                                 public VisitSegmentDatabase {
+ public:
+  VisitSegmentDatabaseTest() = default;
+
+ protected:
+  // Provided for URL/VisitSegmentDatabase.
+  sql::Database& GetDB() override { return db_; }
+
+  SegmentID AddSegment(const GURL& url) {
+    URLID url_id = AddURL(URLRow(url));
+    EXPECT_TRUE(url_id);
+    return CreateSegment(url_id, ComputeSegmentName(url));
+  }
+
+  // Returns the scores of the segments with usage in the last `days_back`
+  // days, by segment.
+  std::map<SegmentID, double> GetScores(int days_back) {
+    std::vector<std::unique_ptr<PageUsageData>> data = QuerySegmentUsage(
+        Time::Now() - TimeDelta::FromDays(days_back), 1000,
+        base::NullCallback());
+    std::map<SegmentID, double> scores;
+    for (size_t i = 0; i < data.size(); ++i) {
+      if (i > 0)
+        EXPECT_GE(data[i - 1]->GetScore(), data[i]->GetScore());
+      scores[data[i]->GetID()] = data[i]->GetScore();
+    }
+    return scores;
+  }
+
+  // EXPECTs that the ranking kept up to date matches the one recomputed from
+  // the segment usage.
+  void ExpectRankingIsConsistent(int days_back) {
+    std::map<SegmentID, double> scores = GetScores(days_back);
+    InvalidateSegmentScores();
+    std::map<SegmentID, double> recomputed_scores = GetScores(days_back);
+    ASSERT_EQ(recomputed_scores.size(), scores.size());
+    for (const auto& segment_score : recomputed_scores) {
+      ASSERT_TRUE(scores.count(segment_score.first));
+      EXPECT_NEAR(segment_score.second, scores[segment_score.first], 1e-3);
+    }
+  }
+
+ private:
+  void SetUp() override {
+    ASSERT_TRUE(temp_dir_.CreateUniqueTempDir());
+    ASSERT_TRUE(db_.Open(temp_dir_.GetPath().AppendASCII("SegmentTest.db")));
+    CreateURLTable(false);
+    CreateMainURLIndex();
+    ASSERT_TRUE(InitSegmentTables());
+  }
+  void TearDown() override { db_.Close(); }
+
+  base::ScopedTempDir temp_dir_;
+  sql::Database db_;
+};
+
+// Tests that visits and deletions keep the ranking the same as recomputing it.
+TEST_F(VisitSegmentDatabaseTest, RankingMatchesRecomputedRanking) {
+  const Time now = Time::Now();
+  std::vector<SegmentID> segment_ids;
+  for (int i = 0; i < 50; ++i) {
+    segment_ids.push_back(AddSegment(
+        GURL(base::StringPrintf("http://www.site%d.com/", i))));
+    for (int j = 0; j < i % 7 + 1; ++j) {
+      ASSERT_TRUE(IncreaseSegmentVisitCount(
+          segment_ids.back(), now - TimeDelta::FromDays((i * 7 + j) % 60),
+          1 + j));
+    }
+  }
+  EXPECT_EQ(50U, GetScores(90).size());
+
+  // Visits today, in the past, and older than the ranking goes back.
+  for (int i = 0; i < 50; i += 3) {
+    ASSERT_TRUE(IncreaseSegmentVisitCount(segment_ids[i], now, 1));
+    ASSERT_TRUE(IncreaseSegmentVisitCount(
+        segment_ids[i], now - TimeDelta::FromDays(i), 2));
+    ASSERT_TRUE(IncreaseSegmentVisitCount(
+        segment_ids[i], now - TimeDelta::FromDays(120), 5));
+  }
+  // A segment that had no visits yet.
+  SegmentID new_segment_id = AddSegment(GURL("http://www.newsite.com/"));
+  ASSERT_TRUE(IncreaseSegmentVisitCount(new_segment_id, now, 1));
+  // Deleted URLs.
+  ASSERT_TRUE(DeleteSegmentForURL(GetRowForURL(GURL("http://www.site4.com/"),
+                                               nullptr)));
+  ASSERT_TRUE(DeleteSegmentForURL(GetRowForURL(GURL("http://www.site9.com/"),
+                                               nullptr)));
+
+  std::map<SegmentID, double> scores = GetScores(90);
+  EXPECT_EQ(49U, scores.size());
+  EXPECT_TRUE(scores.count(new_segment_id));
+  EXPECT_FALSE(scores.count(segment_ids[4]));
+  EXPECT_FALSE(scores.count(segment_ids[9]));
+  ExpectRankingIsConsistent(90);
+}
+
+// Tests that only the usage since the given time is ranked, whether the
+// ranking is recomputed or kept up to date.
+TEST_F(VisitSegmentDatabaseTest, RankingStartsAtFromTime) {
+  const Time now = Time::Now();
+  SegmentID old_segment_id = AddSegment(GURL("http://www.old.com/"));
+  SegmentID recent_segment_id = AddSegment(GURL("http://www.recent.com/"));
+  ASSERT_TRUE(IncreaseSegmentVisitCount(old_segment_id,
+                                        now - TimeDelta::FromDays(30), 10));
+  ASSERT_TRUE(IncreaseSegmentVisitCount(recent_segment_id, now, 1));
+
+  std::map<SegmentID, double> scores = GetScores(7);
+  EXPECT_EQ(1U, scores.size());
+  EXPECT_TRUE(scores.count(recent_segment_id));
+
+  ASSERT_TRUE(IncreaseSegmentVisitCount(old_segment_id,
+                                        now - TimeDelta::FromDays(30), 10));
+  scores = GetScores(7);
+  EXPECT_EQ(1U, scores.size());
+  EXPECT_TRUE(scores.count(recent_segment_id));
+
+  // Going further back ranks the old segment first.
+  std::vector<std::unique_ptr<PageUsageData>> data = QuerySegmentUsage(
+      now - TimeDelta::FromDays(60), 1, base::NullCallback());
+  ASSERT_EQ(1U, data.size());
+  EXPECT_EQ(old_segment_id, data[0]->GetID());
+  EXPECT_EQ(GURL("http://www.old.com/"), data[0]->GetURL());
+  ExpectRankingIsConsistent(60);
+}
+
+}  // namespace history
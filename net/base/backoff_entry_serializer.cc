@@ -7,6 +7,7 @@
 #include <algorithm>
 #include <utility>
 
+#include "base/pickle.h"
 #include "base/strings/string_number_conversions.h"
 #include "base/time/tick_clock.h"
 #include "base/values.h"
@@ -17,6 +18,10 @@ namespace {
 // serialized values loaded from disk etc being misinterpreted.
 const int kSerializationFormatVersion = 1;
 
+// Same, for the binary format. Kept separate from the above so the two formats
+// can evolve independently.
+const int kBinarySerializationFormatVersion = 1;
+
 // This max defines how many times we are willing to call
 // |BackoffEntry::InformOfRequest| in |DeserializeFromValue|.
 //
@@ -32,37 +37,97 @@ bool BackoffDurationSafeToSerialize(const base::TimeDelta& duration) {
   return !duration.is_inf() &&
          !base::TimeDelta::FromSecondsD(duration.InSecondsF()).is_inf();
 }
-}  // namespace
-
-namespace net {
-
-base::Value BackoffEntrySerializer::SerializeToValue(const BackoffEntry& entry,
-                                                     base::Time time_now) {
-  std::vector<base::Value> serialized;
-  serialized.emplace_back(kSerializationFormatVersion);
-
-  serialized.emplace_back(entry.failure_count());
 
+// Computes the remaining backoff duration of |entry| and the corresponding
+// absolute release time, as stored by both serialization formats.
+void ComputeReleaseTimes(const net::BackoffEntry& entry,
+                         base::Time time_now,
+                         base::TimeDelta* backoff_duration,
+                         base::Time* absolute_release_time) {
   // Convert both |base::TimeTicks| values into |base::TimeDelta| values by
   // subtracting |kZeroTicks. This way, the top-level subtraction uses
   // |base::TimeDelta::operator-|, which has clamping semantics.
   const base::TimeTicks kZeroTicks;
   const base::TimeDelta kReleaseTime = entry.GetReleaseTime() - kZeroTicks;
   const base::TimeDelta kTimeTicksNow = entry.GetTimeTicksNow() - kZeroTicks;
-  base::TimeDelta backoff_duration;
+  *backoff_duration = base::TimeDelta();
   if (!kReleaseTime.is_inf() && !kTimeTicksNow.is_inf()) {
-    backoff_duration = kReleaseTime - kTimeTicksNow;
+    *backoff_duration = kReleaseTime - kTimeTicksNow;
   }
-  if (!BackoffDurationSafeToSerialize(backoff_duration)) {
-    backoff_duration = base::TimeDelta();
+  if (!BackoffDurationSafeToSerialize(*backoff_duration)) {
+    *backoff_duration = base::TimeDelta();
   }
 
-  base::Time absolute_release_time = backoff_duration + time_now;
+  *absolute_release_time = *backoff_duration + time_now;
   // If the computed release time is infinite, default to zero. The deserializer
   // should pick up on this.
-  if (absolute_release_time.is_inf()) {
-    absolute_release_time = base::Time();
+  if (absolute_release_time->is_inf()) {
+    *absolute_release_time = base::Time();
+  }
+}
+
+// Creates the BackoffEntry described by already-parsed serialized fields, or
+// returns NULL if they are inconsistent. Shared by both formats.
+std::unique_ptr<net::BackoffEntry> CreateEntry(
+    int failure_count,
+    base::TimeDelta original_backoff_duration,
+    base::Time absolute_release_time,
+    const net::BackoffEntry::Policy* policy,
+    const base::TickClock* tick_clock,
+    base::Time time_now) {
+  if (failure_count < 0)
+    return nullptr;
+  failure_count = std::min(failure_count, kMaxFailureCount);
+
+  std::unique_ptr<net::BackoffEntry> entry(
+      new net::BackoffEntry(policy, tick_clock));
+
+  for (int n = 0; n < failure_count; n++)
+    entry->InformOfRequest(false);
+
+  base::TimeDelta backoff_duration;
+  if (absolute_release_time == base::Time()) {
+    // When the serializer cannot compute a finite release time, it uses zero.
+    // When we see this, fall back to the redundant original_backoff_duration.
+    backoff_duration = original_backoff_duration;
+  } else {
+    // Before computing |backoff_duration|, throw out +/- infinity values for
+    // either operand. This way, we can use base::TimeDelta's saturated math.
+    if (absolute_release_time.is_inf() || time_now.is_inf())
+      return nullptr;
+
+    backoff_duration = absolute_release_time.ToDeltaSinceWindowsEpoch() -
+                       time_now.ToDeltaSinceWindowsEpoch();
+
+    // In cases where the system wall clock is rewound, use the redundant
+    // original_backoff_duration to ensure the backoff duration isn't longer
+    // than it was before serializing (note that it's not possible to protect
+    // against the clock being wound forward).
+    if (backoff_duration > original_backoff_duration)
+      backoff_duration = original_backoff_duration;
   }
+  if (!BackoffDurationSafeToSerialize(backoff_duration))
+    return nullptr;
+  entry->SetCustomReleaseTime(
+      entry->BackoffDurationToReleaseTime(backoff_duration));
+
+  return entry;
+}
+}  // namespace
+
+namespace net {
+
+base::Value BackoffEntrySerializer::SerializeToValue(const BackoffEntry& entry,
+                                                     base::Time time_now) {
+  std::vector<base::Value> serialized;
+  serialized.emplace_back(kSerializationFormatVersion);
+
+  serialized.emplace_back(entry.failure_count());
+
+  base::TimeDelta backoff_duration;
+  base::Time absolute_release_time;
+  ComputeReleaseTimes(entry, time_now, &backoff_duration,
+                      &absolute_release_time);
 
   // Redundantly stores both the remaining time delta and the absolute time.
   // The delta is used to work around some cases where wall clock time changes.
@@ -94,10 +159,6 @@ std::unique_ptr<BackoffEntry> BackoffEntrySerializer::DeserializeFromValue(
   if (!list_view[1].is_int())
     return nullptr;
   int failure_count = list_view[1].GetInt();
-  if (failure_count < 0) {
-    return nullptr;
-  }
-  failure_count = std::min(failure_count, kMaxFailureCount);
 
   if (!list_view[2].is_double())
     return nullptr;
@@ -113,43 +174,58 @@ std::unique_ptr<BackoffEntry> BackoffEntrySerializer::DeserializeFromValue(
     return nullptr;
   }
 
-  std::unique_ptr<BackoffEntry> entry(new BackoffEntry(policy, tick_clock));
-
-  for (int n = 0; n < failure_count; n++)
-    entry->InformOfRequest(false);
-
-  base::TimeDelta original_backoff_duration =
-      base::TimeDelta::FromSecondsD(original_backoff_duration_double);
-  base::Time absolute_release_time =
-      base::Time::FromInternalValue(absolute_release_time_us);
+  return CreateEntry(
+      failure_count,
+      base::TimeDelta::FromSecondsD(original_backoff_duration_double),
+      base::Time::FromInternalValue(absolute_release_time_us), policy,
+      tick_clock, time_now);
+}
 
+std::string BackoffEntrySerializer::SerializeToBinary(const BackoffEntry& entry,
+                                                      base::Time time_now) {
   base::TimeDelta backoff_duration;
-  if (absolute_release_time == base::Time()) {
-    // When the serializer cannot compute a finite release time, it uses zero.
-    // When we see this, fall back to the redundant original_backoff_duration.
-    backoff_duration = original_backoff_duration;
-  } else {
-    // Before computing |backoff_duration|, throw out +/- infinity values for
-    // either operand. This way, we can use base::TimeDelta's saturated math.
-    if (absolute_release_time.is_inf() || time_now.is_inf())
-      return nullptr;
+  base::Time absolute_release_time;
+  ComputeReleaseTimes(entry, time_now, &backoff_duration,
+                      &absolute_release_time);
+
+  // Same fields as SerializeToValue(), but the duration is stored in whole
+  // microseconds rather than as a double number of seconds.
+  base::Pickle pickle;
+  pickle.WriteInt(kBinarySerializationFormatVersion);
+  pickle.WriteInt(entry.failure_count());
+  pickle.WriteInt64(backoff_duration.InMicroseconds());
+  pickle.WriteInt64(absolute_release_time.ToInternalValue());
+  return std::string(static_cast<const char*>(pickle.data()), pickle.size());
+}
 
-    backoff_duration = absolute_release_time.ToDeltaSinceWindowsEpoch() -
-                       time_now.ToDeltaSinceWindowsEpoch();
+std::unique_ptr<BackoffEntry> BackoffEntrySerializer::DeserializeFromBinary(
+    base::StringPiece serialized,
+    const BackoffEntry::Policy* policy,
+    const base::TickClock* tick_clock,
+    base::Time time_now) {
+  base::Pickle pickle(serialized.data(), serialized.size());
+  base::PickleIterator iter(pickle);
 
-    // In cases where the system wall clock is rewound, use the redundant
-    // original_backoff_duration to ensure the backoff duration isn't longer
-    // than it was before serializing (note that it's not possible to protect
-    // against the clock being wound forward).
-    if (backoff_duration > original_backoff_duration)
-      backoff_duration = original_backoff_duration;
+  int version_number;
+  if (!iter.ReadInt(&version_number) ||
+      version_number != kBinarySerializationFormatVersion) {
+    return nullptr;
   }
-  if (!BackoffDurationSafeToSerialize(backoff_duration))
+
+  int failure_count;
+  int64_t original_backoff_duration_us;
+  int64_t absolute_release_time_us;
+  if (!iter.ReadInt(&failure_count) ||
+      !iter.ReadInt64(&original_backoff_duration_us) ||
+      !iter.ReadInt64(&absolute_release_time_us)) {
     return nullptr;
-  entry->SetCustomReleaseTime(
-      entry->BackoffDurationToReleaseTime(backoff_duration));
+  }
 
-  return entry;
+  return CreateEntry(
+      failure_count,
+      base::TimeDelta::FromMicroseconds(original_backoff_duration_us),
+      base::Time::FromInternalValue(absolute_release_time_us), policy,
+      tick_clock, time_now);
 }
 
 }  // namespace net
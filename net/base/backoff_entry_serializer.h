@@ -6,8 +6,10 @@
 #define NET_BASE_BACKOFF_ENTRY_SERIALIZER_H_
 
 #include <memory>
+#include <string>
 
 #include "base/macros.h"
+#include "base/strings/string_piece.h"
 #include "base/time/time.h"
 #include "net/base/backoff_entry.h"
 #include "net/base/net_export.h"
@@ -47,6 +49,20 @@ class NET_EXPORT BackoffEntrySerializer {
       const base::TickClock* clock,
       base::Time time_now);
 
+  // Same as SerializeToValue(), but produces a compact binary record (about 30
+  // bytes) instead of a ListValue, for callers that store many entries outside
+  // of JSON prefs. See BackoffEntryStore.
+  static std::string SerializeToBinary(const BackoffEntry& entry,
+                                       base::Time time_now);
+
+  // Same as DeserializeFromValue(), for a record produced by
+  // SerializeToBinary(). Returns NULL if |serialized| is malformed.
+  static std::unique_ptr<BackoffEntry> DeserializeFromBinary(
+      base::StringPiece serialized,
+      const BackoffEntry::Policy* policy,
+      const base::TickClock* clock,
+      base::Time time_now);
+
  private:
   DISALLOW_IMPLICIT_CONSTRUCTORS(BackoffEntrySerializer);
 };
@@ -50,6 +50,9 @@ class ProtoTranslator {
     return base::TimeTicks() +
            base::TimeDelta::FromMicroseconds(input_.now_ticks());
   }
+  const std::string& serialized_binary_entry() const {
+    return input_.serialized_binary_entry();
+  }
   absl::optional<base::Value> serialized_entry() const {
     json_proto::JsonProtoConverter converter;
     std::string json_array = converter.Convert(input_.serialized_entry());
@@ -123,6 +126,39 @@ void TestDeserialize(const ProtoTranslator& translator) {
   CHECK_LE(entry_reparsed->GetReleaseTime(), entry->GetReleaseTime());
 }
 
+// Same as TestDeserialize(), for the binary format. Also checks that
+// reserializing to the Value format agrees with the binary one.
+void TestDeserializeBinary(const ProtoTranslator& translator) {
+  BackoffEntry::Policy policy = translator.policy();
+
+  MockClock clock;
+  clock.SetNow(translator.parse_time_ticks());
+
+  std::unique_ptr<BackoffEntry> entry =
+      BackoffEntrySerializer::DeserializeFromBinary(
+          translator.serialized_binary_entry(), &policy, &clock,
+          translator.parse_time());
+  if (!entry)
+    return;
+
+  std::string reserialized = BackoffEntrySerializer::SerializeToBinary(
+      *entry, translator.parse_time());
+  std::unique_ptr<BackoffEntry> entry_reparsed =
+      BackoffEntrySerializer::DeserializeFromBinary(
+          reserialized, &policy, &clock, translator.parse_time());
+  CHECK(entry_reparsed);
+  CHECK_EQ(entry_reparsed->failure_count(), entry->failure_count());
+  CHECK_LE(entry_reparsed->GetReleaseTime(), entry->GetReleaseTime());
+
+  std::unique_ptr<BackoffEntry> entry_from_value =
+      BackoffEntrySerializer::DeserializeFromValue(
+          BackoffEntrySerializer::SerializeToValue(*entry,
+                                                   translator.parse_time()),
+          &policy, &clock, translator.parse_time());
+  CHECK(entry_from_value);
+  CHECK_EQ(entry_from_value->failure_count(), entry->failure_count());
+}
+
 // Tests the "serialize-deserialize" property. Serializes an arbitrary
 // BackoffEntry to JSON, deserializes to another BackoffEntry, and checks
 // equality of the two entries. Our notion of equality is *very weak* and needs
@@ -156,6 +192,16 @@ void TestSerialize(const ProtoTranslator& translator) {
   // suitable for CHECK_EQ here. See |BackoffEntry::CalculateReleaseTime|.
 
   CHECK_EQ(native_entry.failure_count(), deserialized_entry->failure_count());
+
+  // The binary format must round-trip the same way.
+  std::unique_ptr<BackoffEntry> deserialized_binary_entry =
+      BackoffEntrySerializer::DeserializeFromBinary(
+          BackoffEntrySerializer::SerializeToBinary(
+              native_entry, translator.serialize_time()),
+          &policy, &clock, translator.parse_time());
+  CHECK(deserialized_binary_entry);
+  CHECK_EQ(native_entry.failure_count(),
+           deserialized_binary_entry->failure_count());
 }
 }  // namespace
 
@@ -174,6 +220,7 @@ DEFINE_PROTO_FUZZER(const fuzz_proto::FuzzerInput& input) {
     return;
   }
   TestDeserialize(translator);
+  TestDeserializeBinary(translator);
   TestSerialize(translator);
 }
 
@@ -306,6 +306,54 @@ TEST(BackoffEntrySerializerTest, SerializeTimeOffsets) {
   }
 }
 
+TEST(BackoffEntrySerializerTest, BinaryRoundTrip) {
+  Time original_time = Time::FromJsTime(1430907555111);  // May 2015 for realism
+  TestTickClock original_ticks;
+  BackoffEntry original(&base_policy, &original_ticks);
+  original.InformOfRequest(false);
+  original.InformOfRequest(false);
+  std::string serialized =
+      BackoffEntrySerializer::SerializeToBinary(original, original_time);
+
+  std::unique_ptr<BackoffEntry> deserialized =
+      BackoffEntrySerializer::DeserializeFromBinary(
+          serialized, &base_policy, &original_ticks, original_time);
+  ASSERT_TRUE(deserialized.get());
+  EXPECT_EQ(original.failure_count(), deserialized->failure_count());
+  EXPECT_EQ(original.GetReleaseTime(), deserialized->GetReleaseTime());
+
+  // Wall clock changes are handled the same way as in the Value format.
+  Time earlier_time = original_time - TimeDelta::FromSeconds(1);
+  deserialized = BackoffEntrySerializer::DeserializeFromBinary(
+      serialized, &base_policy, &original_ticks, earlier_time);
+  ASSERT_TRUE(deserialized.get());
+  EXPECT_EQ(original.GetReleaseTime(), deserialized->GetReleaseTime());
+
+  // The binary format is considerably smaller than the JSON one.
+  EXPECT_LT(serialized.size(), 32u);
+}
+
+TEST(BackoffEntrySerializerTest, BinaryRejectsMalformedInput) {
+  Time original_time = Time::FromJsTime(1430907555111);
+  TestTickClock original_ticks;
+  BackoffEntry original(&base_policy, &original_ticks);
+  original.InformOfRequest(false);
+  std::string serialized =
+      BackoffEntrySerializer::SerializeToBinary(original, original_time);
+
+  EXPECT_FALSE(BackoffEntrySerializer::DeserializeFromBinary(
+      "", &base_policy, &original_ticks, original_time));
+  // Truncated.
+  EXPECT_FALSE(BackoffEntrySerializer::DeserializeFromBinary(
+      base::StringPiece(serialized).substr(0, serialized.size() - 1),
+      &base_policy, &original_ticks, original_time));
+  // Wrong version. The first field follows the 4-byte pickle header.
+  std::string wrong_version = serialized;
+  wrong_version[4] ^= 0x7f;
+  EXPECT_FALSE(BackoffEntrySerializer::DeserializeFromBinary(
+      wrong_version, &base_policy, &original_ticks, original_time));
+}
+
 }  // namespace
 
 }  // namespace net
@@ -0,0 +1,141 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/backoff_entry_store.h"
+
+#include <utility>
+
+#include "base/bind.h"
+#include "base/check.h"
+#include "base/time/default_clock.h"
+#include "base/time/default_tick_clock.h"
+#include "net/base/backoff_entry_serializer.h"
+
+namespace net {
+
+BackoffEntryStore::BackoffEntryStore(const BackoffEntry::Policy* policy,
+                                     std::unique_ptr<Persister> persister,
+                                     const base::Clock* clock,
+                                     const base::TickClock* tick_clock)
+    : policy_(policy),
+      persister_(std::move(persister)),
+      clock_(clock ? clock : base::DefaultClock::GetInstance()),
+      tick_clock_(tick_clock ? tick_clock
+                             : base::DefaultTickClock::GetInstance()) {
+  DCHECK(policy_);
+}
+
+BackoffEntryStore::~BackoffEntryStore() {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  Commit();
+}
+
+void BackoffEntryStore::Load(base::OnceClosure callback) {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  DCHECK(!load_started_);
+  load_started_ = true;
+  if (!persister_) {
+    if (callback)
+      std::move(callback).Run();
+    return;
+  }
+  persister_->LoadRecords(base::BindOnce(&BackoffEntryStore::OnRecordsLoaded,
+                                         weak_factory_.GetWeakPtr(),
+                                         std::move(callback)));
+}
+
+BackoffEntry* BackoffEntryStore::GetEntry(const std::string& key) {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  auto it = entries_.find(key);
+  if (it != entries_.end())
+    return it->second.get();
+
+  // Deserialize the record on first use, if there is one.
+  std::unique_ptr<BackoffEntry> entry;
+  auto record = records_.find(key);
+  if (record != records_.end()) {
+    entry = BackoffEntrySerializer::DeserializeFromBinary(
+        record->second, policy_, tick_clock_, clock_->Now());
+    records_.erase(record);
+    // Drop corrupt records from storage.
+    if (!entry)
+      MarkDirty(key);
+  }
+  if (!entry)
+    entry = std::make_unique<BackoffEntry>(policy_, tick_clock_);
+
+  BackoffEntry* result = entry.get();
+  entries_.emplace(key, std::move(entry));
+  return result;
+}
+
+bool BackoffEntryStore::HasEntry(const std::string& key) const {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  return entries_.count(key) || records_.count(key);
+}
+
+void BackoffEntryStore::InformOfRequest(const std::string& key,
+                                        bool succeeded) {
+  GetEntry(key)->InformOfRequest(succeeded);
+  MarkDirty(key);
+}
+
+void BackoffEntryStore::MarkDirty(const std::string& key) {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  dirty_keys_.insert(key);
+  ScheduleCommit();
+}
+
+void BackoffEntryStore::RemoveEntry(const std::string& key) {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  entries_.erase(key);
+  records_.erase(key);
+  MarkDirty(key);
+}
+
+void BackoffEntryStore::Commit() {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  commit_timer_.Stop();
+  if (dirty_keys_.empty())
+    return;
+
+  RecordChanges changes;
+  base::Time now = clock_->Now();
+  for (const std::string& key : dirty_keys_) {
+    auto it = entries_.find(key);
+    if (it == entries_.end() || it->second->CanDiscard()) {
+      changes.emplace(key, absl::nullopt);
+      continue;
+    }
+    changes.emplace(key,
+                    BackoffEntrySerializer::SerializeToBinary(*it->second, now));
+  }
+  dirty_keys_.clear();
+
+  if (persister_)
+    persister_->CommitChanges(std::move(changes));
+}
+
+void BackoffEntryStore::OnRecordsLoaded(base::OnceClosure callback,
+                                        RecordMap records) {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  // Entries that were used, or removed, before the load completed are newer
+  // than what was stored.
+  for (auto& record : records) {
+    if (!entries_.count(record.first) && !dirty_keys_.count(record.first))
+      records_.insert(std::move(record));
+  }
+  if (callback)
+    std::move(callback).Run();
+}
+
+void BackoffEntryStore::ScheduleCommit() {
+  if (commit_timer_.IsRunning())
+    return;
+  commit_timer_.Start(FROM_HERE, kCommitDelay,
+                      base::BindOnce(&BackoffEntryStore::Commit,
+                                     base::Unretained(this)));
+}
+
+}  // namespace net
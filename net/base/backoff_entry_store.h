@@ -0,0 +1,128 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_BASE_BACKOFF_ENTRY_STORE_H_
+#define NET_BASE_BACKOFF_ENTRY_STORE_H_
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+
+#include "base/callback.h"
+#include "base/memory/weak_ptr.h"
+#include "base/threading/thread_checker.h"
+#include "base/time/time.h"
+#include "base/timer/timer.h"
+#include "net/base/backoff_entry.h"
+#include "net/base/net_export.h"
+#include "third_party/abseil-cpp/absl/types/optional.h"
+
+namespace base {
+class Clock;
+class TickClock;
+}  // namespace base
+
+namespace net {
+
+// Keeps a BackoffEntry per key (e.g. per endpoint) and persists them with
+// BackoffEntrySerializer's binary format. Unlike storing a ListValue per entry
+// in a JSON pref, only records that changed since the last commit are written,
+// and records are kept in serialized form until their key is first used.
+//
+// All entries share one Policy. The store must be used on a single sequence.
+class NET_EXPORT BackoffEntryStore {
+ public:
+  // Serialized records, keyed by the store's keys.
+  using RecordMap = std::map<std::string, std::string>;
+  // Records to write; absl::nullopt means the record should be deleted.
+  using RecordChanges = std::map<std::string, absl::optional<std::string>>;
+
+  // Where records live between sessions, e.g. a SQLite table or a file.
+  // Implementations may do their I/O on another sequence.
+  class Persister {
+   public:
+    virtual ~Persister() = default;
+
+    // Reads every stored record and passes them to |callback|, possibly
+    // asynchronously. Called at most once.
+    virtual void LoadRecords(base::OnceCallback<void(RecordMap)> callback) = 0;
+
+    // Applies |changes| to the stored records.
+    virtual void CommitChanges(RecordChanges changes) = 0;
+  };
+
+  // Time to wait after a change before committing it, so that bursts of
+  // changes result in a single write.
+  static constexpr base::TimeDelta kCommitDelay =
+      base::TimeDelta::FromSeconds(10);
+
+  // |policy| must outlive the store. |clock| and |tick_clock| may be null, in
+  // which case the default clocks are used; otherwise they must outlive the
+  // store. |persister| may be null, in which case nothing is persisted.
+  BackoffEntryStore(const BackoffEntry::Policy* policy,
+                    std::unique_ptr<Persister> persister,
+                    const base::Clock* clock = nullptr,
+                    const base::TickClock* tick_clock = nullptr);
+  BackoffEntryStore(const BackoffEntryStore&) = delete;
+  BackoffEntryStore& operator=(const BackoffEntryStore&) = delete;
+
+  // Commits any pending changes.
+  ~BackoffEntryStore();
+
+  // Starts loading the persisted records. Entries used before loading
+  // completes start out fresh, and their persisted records are then ignored.
+  // |callback|, if not null, is run once loading has completed.
+  void Load(base::OnceClosure callback);
+
+  // Returns the entry for |key|, creating it if needed. The pointer is valid
+  // until the entry is removed or the store is destroyed. After changing the
+  // entry directly, callers must call MarkDirty() for the change to persist.
+  BackoffEntry* GetEntry(const std::string& key);
+
+  // Returns true if there is an entry for |key|, without creating one.
+  bool HasEntry(const std::string& key) const;
+
+  // Shorthand for GetEntry(key)->InformOfRequest(succeeded) plus MarkDirty().
+  void InformOfRequest(const std::string& key, bool succeeded);
+
+  // Schedules the entry for |key| to be written at the next commit.
+  void MarkDirty(const std::string& key);
+
+  // Removes the entry for |key| from memory and from storage.
+  void RemoveEntry(const std::string& key);
+
+  // Commits pending changes now, rather than after kCommitDelay. Entries that
+  // BackoffEntry::CanDiscard() are deleted instead of written.
+  void Commit();
+
+  size_t dirty_count_for_testing() const { return dirty_keys_.size(); }
+
+ private:
+  void OnRecordsLoaded(base::OnceClosure callback, RecordMap records);
+  void ScheduleCommit();
+
+  const BackoffEntry::Policy* const policy_;
+  const std::unique_ptr<Persister> persister_;
+  const base::Clock* const clock_;
+  const base::TickClock* const tick_clock_;
+
+  // Entries that have been used, and are therefore deserialized.
+  std::map<std::string, std::unique_ptr<BackoffEntry>> entries_;
+  // Loaded records that have not been used yet.
+  RecordMap records_;
+  // Keys whose entry has changed, or been removed, since the last commit.
+  std::set<std::string> dirty_keys_;
+
+  bool load_started_ = false;
+  base::OneShotTimer commit_timer_;
+
+  THREAD_CHECKER(thread_checker_);
+
+  base::WeakPtrFactory<BackoffEntryStore> weak_factory_{this};
+};
+
+}  // namespace net
+
+#endif  // NET_BASE_BACKOFF_ENTRY_STORE_H_
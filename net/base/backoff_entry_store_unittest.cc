@@ -0,0 +1,178 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/backoff_entry_store.h"
+
+#include <utility>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/test/bind.h"
+#include "net/base/backoff_entry_serializer.h"
+#include "net/test/test_with_task_environment.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+namespace net {
+
+namespace {
+
+const BackoffEntry::Policy kPolicy = {
+    0 /* num_errors_to_ignore */,
+    1000 /* initial_delay_ms */,
+    2.0 /* multiply_factor */,
+    0.0 /* jitter_factor */,
+    20000 /* maximum_backoff_ms */,
+    0 /* entry_lifetime_ms */,
+    false /* always_use_initial_delay */
+};
+
+// Persister that keeps records in memory and records every commit. Loads
+// complete when CompleteLoad() is called.
+class TestPersister : public BackoffEntryStore::Persister {
+ public:
+  struct State {
+    BackoffEntryStore::RecordMap records;
+    std::vector<BackoffEntryStore::RecordChanges> commits;
+    base::OnceCallback<void(BackoffEntryStore::RecordMap)> load_callback;
+  };
+
+  explicit TestPersister(State* state) : state_(state) {}
+
+  void LoadRecords(base::OnceCallback<void(BackoffEntryStore::RecordMap)>
+                       callback) override {
+    state_->load_callback = std::move(callback);
+  }
+
+  void CommitChanges(BackoffEntryStore::RecordChanges changes) override {
+    for (const auto& change : changes) {
+      if (change.second)
+        state_->records[change.first] = *change.second;
+      else
+        state_->records.erase(change.first);
+    }
+    state_->commits.push_back(std::move(changes));
+  }
+
+ private:
+  State* const state_;
+};
+
+class BackoffEntryStoreTest : public TestWithTaskEnvironment {
+ protected:
+  BackoffEntryStoreTest()
+      : TestWithTaskEnvironment(
+            base::test::TaskEnvironment::TimeSource::MOCK_TIME) {}
+
+  std::unique_ptr<BackoffEntryStore> CreateStore() {
+    return std::make_unique<BackoffEntryStore>(
+        &kPolicy, std::make_unique<TestPersister>(&state_), GetMockClock(),
+        GetMockTickClock());
+  }
+
+  void CompleteLoad() {
+    std::move(state_.load_callback).Run(state_.records);
+  }
+
+  TestPersister::State state_;
+};
+
+TEST_F(BackoffEntryStoreTest, WritesOnlyChangedRecords) {
+  auto store = CreateStore();
+  store->Load(base::OnceClosure());
+  CompleteLoad();
+
+  store->InformOfRequest("a", false);
+  store->InformOfRequest("b", false);
+  store->InformOfRequest("a", false);
+  EXPECT_EQ(2u, store->dirty_count_for_testing());
+  EXPECT_TRUE(state_.commits.empty());
+
+  // Changes are committed together after the delay.
+  FastForwardBy(BackoffEntryStore::kCommitDelay);
+  ASSERT_EQ(1u, state_.commits.size());
+  EXPECT_EQ(2u, state_.commits[0].size());
+  EXPECT_EQ(0u, store->dirty_count_for_testing());
+
+  // Only "b" is written again.
+  store->InformOfRequest("b", false);
+  store->Commit();
+  ASSERT_EQ(2u, state_.commits.size());
+  ASSERT_EQ(1u, state_.commits[1].size());
+  EXPECT_EQ("b", state_.commits[1].begin()->first);
+
+  // Entries that can be discarded, and removed entries, are deleted.
+  store->InformOfRequest("c", true);
+  store->RemoveEntry("a");
+  store->Commit();
+  ASSERT_EQ(3u, state_.commits.size());
+  EXPECT_FALSE(state_.commits[2].at("a"));
+  EXPECT_FALSE(state_.commits[2].at("c"));
+  ASSERT_EQ(1u, state_.records.size());
+  EXPECT_EQ(1u, state_.records.count("b"));
+}
+
+TEST_F(BackoffEntryStoreTest, RoundTrip) {
+  {
+    auto store = CreateStore();
+    store->Load(base::OnceClosure());
+    CompleteLoad();
+    store->InformOfRequest("host", false);
+    store->InformOfRequest("host", false);
+    // Destruction commits pending changes.
+  }
+  ASSERT_EQ(1u, state_.records.size());
+
+  auto store = CreateStore();
+  bool loaded = false;
+  store->Load(base::BindLambdaForTesting([&]() { loaded = true; }));
+  CompleteLoad();
+  EXPECT_TRUE(loaded);
+  EXPECT_TRUE(store->HasEntry("host"));
+  EXPECT_FALSE(store->HasEntry("other"));
+  EXPECT_EQ(2, store->GetEntry("host")->failure_count());
+  EXPECT_TRUE(store->GetEntry("host")->ShouldRejectRequest());
+  // Reading an entry does not make it dirty.
+  EXPECT_EQ(0u, store->dirty_count_for_testing());
+}
+
+TEST_F(BackoffEntryStoreTest, EntriesUsedBeforeLoadWin) {
+  BackoffEntry stored(&kPolicy, GetMockTickClock());
+  stored.InformOfRequest(false);
+  stored.InformOfRequest(false);
+  stored.InformOfRequest(false);
+  state_.records["used"] =
+      BackoffEntrySerializer::SerializeToBinary(stored, GetMockClock()->Now());
+  state_.records["removed"] = state_.records["used"];
+  state_.records["untouched"] = state_.records["used"];
+
+  auto store = CreateStore();
+  store->Load(base::OnceClosure());
+  store->InformOfRequest("used", false);
+  store->RemoveEntry("removed");
+  CompleteLoad();
+
+  EXPECT_EQ(1, store->GetEntry("used")->failure_count());
+  EXPECT_FALSE(store->HasEntry("removed"));
+  EXPECT_EQ(3, store->GetEntry("untouched")->failure_count());
+
+  store->Commit();
+  EXPECT_EQ(2u, state_.records.size());
+  EXPECT_FALSE(state_.records.count("removed"));
+}
+
+TEST_F(BackoffEntryStoreTest, CorruptRecordIsDropped) {
+  state_.records["bad"] = "not a backoff entry";
+
+  auto store = CreateStore();
+  store->Load(base::OnceClosure());
+  CompleteLoad();
+  EXPECT_EQ(0, store->GetEntry("bad")->failure_count());
+
+  store->Commit();
+  EXPECT_TRUE(state_.records.empty());
+}
+
+}  // namespace
+
+}  // namespace net
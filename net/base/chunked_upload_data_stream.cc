@@ -78,6 +78,37 @@ int ChunkedUploadDataStream::ReadInternal(IOBuffer* buf, int buf_len) {
   return result;
 }
 
+bool ChunkedUploadDataStream::ReadInMemoryInternal(
+    size_t max_len,
+    base::span<const char>* data) {
+  DCHECK_LT(0u, max_len);
+  DCHECK(!read_buffer_.get());
+
+  if (read_index_ == upload_data_.size()) {
+    // Nothing buffered. Unless the stream is complete, the caller has to wait
+    // for more data with a regular Read().
+    if (!all_data_appended_)
+      return false;
+    SetIsFinalChunk();
+    *data = base::span<const char>();
+    return true;
+  }
+
+  // Hand out the rest of the current appended chunk, without copying.
+  const std::vector<char>* chunk = upload_data_[read_index_].get();
+  size_t bytes_to_read = std::min(max_len, chunk->size() - read_offset_);
+  *data = base::make_span(chunk->data() + read_offset_, bytes_to_read);
+  read_offset_ += bytes_to_read;
+  if (read_offset_ == chunk->size()) {
+    read_index_++;
+    read_offset_ = 0;
+  }
+
+  if (read_index_ == upload_data_.size() && all_data_appended_)
+    SetIsFinalChunk();
+  return true;
+}
+
 void ChunkedUploadDataStream::ResetInternal() {
   read_buffer_ = nullptr;
   read_buffer_len_ = 0;
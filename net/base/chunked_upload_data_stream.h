@@ -81,6 +81,8 @@ class NET_EXPORT ChunkedUploadDataStream : public UploadDataStream {
   // UploadDataStream implementation.
   int InitInternal(const NetLogWithSource& net_log) override;
   int ReadInternal(IOBuffer* buf, int buf_len) override;
+  bool ReadInMemoryInternal(size_t max_len,
+                            base::span<const char>* data) override;
   void ResetInternal() override;
 
   int ReadChunk(IOBuffer* buf, int buf_len);
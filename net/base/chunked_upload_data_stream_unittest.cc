@@ -339,6 +339,36 @@ TEST(ChunkedUploadDataStreamTest, RewindWhileReading) {
 }
 
 // Check the behavior of ChunkedUploadDataStream::Writer.
+// ReadInMemory() returns appended data without copying it, and declines when
+// it would have to wait for more data.
+TEST(ChunkedUploadDataStreamTest, ReadInMemory) {
+  ChunkedUploadDataStream stream(0);
+  ASSERT_THAT(
+      stream.Init(TestCompletionCallback().callback(), NetLogWithSource()),
+      IsOk());
+
+  base::span<const char> data;
+  EXPECT_FALSE(stream.ReadInMemory(kTestBufferSize, &data));
+
+  stream.AppendData(kTestData, kTestDataSize, false);
+  stream.AppendData(kTestData, kTestDataSize, false);
+  ASSERT_TRUE(stream.ReadInMemory(4, &data));
+  EXPECT_EQ("0123", std::string(data.begin(), data.end()));
+  // Only the rest of the current chunk is returned.
+  ASSERT_TRUE(stream.ReadInMemory(kTestBufferSize, &data));
+  EXPECT_EQ("456789", std::string(data.begin(), data.end()));
+  ASSERT_TRUE(stream.ReadInMemory(kTestBufferSize, &data));
+  EXPECT_EQ(kTestData, std::string(data.begin(), data.end()));
+  EXPECT_FALSE(stream.IsEOF());
+  EXPECT_FALSE(stream.ReadInMemory(kTestBufferSize, &data));
+
+  stream.AppendData(nullptr, 0, true);
+  ASSERT_TRUE(stream.ReadInMemory(kTestBufferSize, &data));
+  EXPECT_TRUE(data.empty());
+  EXPECT_TRUE(stream.IsEOF());
+  EXPECT_EQ(2 * kTestDataSize, stream.position());
+}
+
 TEST(ChunkedUploadDataStreamTest, ChunkedUploadDataStreamWriter) {
   std::unique_ptr<ChunkedUploadDataStream> stream(
       new ChunkedUploadDataStream(0));
@@ -0,0 +1,226 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/datagram_batch_io_posix.h"
+
+#include <errno.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/uio.h>
+
+#include <algorithm>
+#include <iterator>
+
+#include "base/bits.h"
+#include "base/check_op.h"
+#include "base/posix/eintr_wrapper.h"
+#include "build/build_config.h"
+#include "net/base/net_errors.h"
+
+#if defined(OS_LINUX) || defined(OS_CHROMEOS) || defined(OS_ANDROID)
+#define HAVE_MMSG 1
+#endif
+
+namespace net {
+
+namespace {
+
+void RecordBatchSize(
+    size_t batch_size,
+    std::array<uint64_t, DatagramBatchIO::kNumBatchSizeBuckets>* buckets) {
+  if (batch_size == 0)
+    return;
+  size_t bucket =
+      std::min<size_t>(base::bits::Log2Floor(static_cast<uint32_t>(batch_size)),
+                      buckets->size() - 1);
+  ++(*buckets)[bucket];
+}
+
+}  // namespace
+
+DatagramBatchIO::Stats::Stats() = default;
+
+DatagramBatchIO::Stats::Stats(const Stats& other) = default;
+
+DatagramBatchIO::Stats::~Stats() = default;
+
+DatagramBatchIO::DatagramBatchIO(int fd) : fd_(fd) {}
+
+DatagramBatchIO::~DatagramBatchIO() = default;
+
+int DatagramBatchIO::Send(DatagramBufferPool* pool, DatagramBuffers* buffers) {
+  int total = 0;
+  while (!buffers->empty()) {
+    size_t count = std::min(buffers->size(), kMaxBatchSize);
+    int rv = SendOneBatch(buffers->cbegin(), count);
+    if (rv < 0) {
+      // Errors after a partial send are reported by the next call.
+      if (total == 0)
+        return rv;
+      break;
+    }
+
+    DatagramBuffers sent;
+    sent.splice(sent.cend(), *buffers, buffers->cbegin(),
+                std::next(buffers->cbegin(), rv));
+    pool->Dequeue(&sent);
+    total += rv;
+
+    // A short batch means the socket buffer is full.
+    if (static_cast<size_t>(rv) < count)
+      break;
+  }
+  return total;
+}
+
+int DatagramBatchIO::Receive(DatagramBufferPool* pool,
+                             size_t max_datagrams,
+                             DatagramBuffers* buffers) {
+  DCHECK_GT(max_datagrams, 0u);
+  size_t initial_size = buffers->size();
+  size_t remaining = max_datagrams;
+  int error = ERR_IO_PENDING;
+  while (remaining > 0) {
+    size_t count = std::min(remaining, kMaxBatchSize);
+    int rv = ReceiveOneBatch(pool, count, buffers);
+    if (rv < 0) {
+      error = rv;
+      break;
+    }
+    remaining -= rv;
+
+    // A short batch means the socket has been drained.
+    if (static_cast<size_t>(rv) < count)
+      break;
+  }
+
+  size_t received = buffers->size() - initial_size;
+  if (received > 0)
+    return static_cast<int>(received);
+  // Datagrams were read, but all of them were too large for the pool.
+  if (remaining < max_datagrams)
+    return ERR_MSG_TOO_BIG;
+  return error;
+}
+
+int DatagramBatchIO::SendOneBatch(DatagramBuffers::const_iterator begin,
+                                  size_t count) {
+  DCHECK_GT(count, 0u);
+  DCHECK_LE(count, kMaxBatchSize);
+  ++stats_.send_calls;
+
+#if defined(HAVE_MMSG)
+  struct iovec iovs[kMaxBatchSize];
+  struct mmsghdr msgs[kMaxBatchSize] = {};
+  DatagramBuffers::const_iterator it = begin;
+  for (size_t i = 0; i < count; ++i, ++it) {
+    iovs[i].iov_base = (*it)->data();
+    iovs[i].iov_len = (*it)->length();
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+  }
+  int rv = HANDLE_EINTR(sendmmsg(fd_, msgs, count, 0));
+  if (rv < 0)
+    return MapSystemError(errno);
+  size_t sent = rv;
+#else
+  size_t sent = 0;
+  for (DatagramBuffers::const_iterator it = begin; sent < count; ++it) {
+    ssize_t rv = HANDLE_EINTR(send(fd_, (*it)->data(), (*it)->length(), 0));
+    if (rv < 0) {
+      if (sent == 0)
+        return MapSystemError(errno);
+      break;
+    }
+    ++sent;
+  }
+#endif  // defined(HAVE_MMSG)
+
+  stats_.datagrams_sent += sent;
+  RecordBatchSize(sent, &stats_.send_batch_sizes);
+  return static_cast<int>(sent);
+}
+
+int DatagramBatchIO::ReceiveOneBatch(DatagramBufferPool* pool,
+                                     size_t count,
+                                     DatagramBuffers* buffers) {
+  DCHECK_GT(count, 0u);
+  DCHECK_LE(count, kMaxBatchSize);
+  ++stats_.receive_calls;
+
+  DatagramBuffers batch;
+  pool->EnqueueForRead(count, &batch);
+  const size_t max_buffer_size = pool->max_buffer_size();
+
+  // Truncated datagrams, and buffers the kernel did not fill, go back to the
+  // pool; the rest move to |buffers|.
+  DatagramBuffers unused;
+  int received = 0;
+
+#if defined(HAVE_MMSG)
+  struct iovec iovs[kMaxBatchSize];
+  struct mmsghdr msgs[kMaxBatchSize] = {};
+  size_t i = 0;
+  for (const std::unique_ptr<DatagramBuffer>& buffer : batch) {
+    iovs[i].iov_base = buffer->data();
+    iovs[i].iov_len = max_buffer_size;
+    msgs[i].msg_hdr.msg_iov = &iovs[i];
+    msgs[i].msg_hdr.msg_iovlen = 1;
+    ++i;
+  }
+  int rv = HANDLE_EINTR(recvmmsg(fd_, msgs, count, 0, nullptr));
+  if (rv < 0) {
+    int os_error = errno;
+    pool->Dequeue(&batch);
+    return MapSystemError(os_error);
+  }
+  received = rv;
+  for (int j = 0; j < received; ++j) {
+    std::unique_ptr<DatagramBuffer>& buffer = batch.front();
+    DatagramBuffers* destination = buffers;
+    if (msgs[j].msg_hdr.msg_flags & MSG_TRUNC) {
+      ++stats_.datagrams_truncated;
+      destination = &unused;
+    } else {
+      buffer->set_length(msgs[j].msg_len);
+    }
+    destination->splice(destination->cend(), batch, batch.cbegin());
+  }
+#else
+  while (!batch.empty()) {
+    std::unique_ptr<DatagramBuffer>& buffer = batch.front();
+    struct iovec iov = {buffer->data(), max_buffer_size};
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    ssize_t rv = HANDLE_EINTR(recvmsg(fd_, &msg, 0));
+    if (rv < 0) {
+      if (received == 0) {
+        int os_error = errno;
+        pool->Dequeue(&batch);
+        return MapSystemError(os_error);
+      }
+      break;
+    }
+    ++received;
+    DatagramBuffers* destination = buffers;
+    if (msg.msg_flags & MSG_TRUNC) {
+      ++stats_.datagrams_truncated;
+      destination = &unused;
+    } else {
+      buffer->set_length(rv);
+    }
+    destination->splice(destination->cend(), batch, batch.cbegin());
+  }
+#endif  // defined(HAVE_MMSG)
+
+  unused.splice(unused.cend(), batch);
+  pool->Dequeue(&unused);
+
+  stats_.datagrams_received += received;
+  RecordBatchSize(received, &stats_.receive_batch_sizes);
+  return received;
+}
+
+}  // namespace net
@@ -0,0 +1,89 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#ifndef NET_BASE_DATAGRAM_BATCH_IO_POSIX_H_
+#define NET_BASE_DATAGRAM_BATCH_IO_POSIX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <array>
+
+#include "net/base/datagram_buffer.h"
+#include "net/base/net_export.h"
+
+namespace net {
+
+// Sends and receives batches of datagrams on a connected, non-blocking
+// datagram socket, using pooled |DatagramBuffer|s. On Linux and Android each
+// batch costs a single sendmmsg()/recvmmsg() system call; elsewhere it falls
+// back to one send()/recv() per datagram, so callers need not care which
+// platform they are on.
+//
+// The object does not own |fd| and is not thread-safe.
+class NET_EXPORT_PRIVATE DatagramBatchIO {
+ public:
+  // Largest number of datagrams passed to the kernel in one system call.
+  // Larger batches are split.
+  static constexpr size_t kMaxBatchSize = 64;
+
+  // Number of buckets in the batch size histograms. Bucket i counts batches
+  // of [2^i, 2^(i+1)) datagrams; the last bucket also counts larger ones.
+  static constexpr size_t kNumBatchSizeBuckets = 8;
+
+  struct Stats {
+    Stats();
+    Stats(const Stats& other);
+    ~Stats();
+
+    uint64_t send_calls = 0;
+    uint64_t datagrams_sent = 0;
+    uint64_t receive_calls = 0;
+    uint64_t datagrams_received = 0;
+    // Received datagrams dropped because they did not fit in a buffer.
+    uint64_t datagrams_truncated = 0;
+    std::array<uint64_t, kNumBatchSizeBuckets> send_batch_sizes = {};
+    std::array<uint64_t, kNumBatchSizeBuckets> receive_batch_sizes = {};
+  };
+
+  explicit DatagramBatchIO(int fd);
+  DatagramBatchIO(const DatagramBatchIO&) = delete;
+  DatagramBatchIO& operator=(const DatagramBatchIO&) = delete;
+  ~DatagramBatchIO();
+
+  // Sends datagrams from the front of |buffers| until all are sent or the
+  // socket would block. Sent buffers are returned to |pool|; unsent ones stay
+  // in |buffers|, in order. Returns the number of datagrams sent if any were,
+  // otherwise a net error code (ERR_IO_PENDING if the socket would block).
+  int Send(DatagramBufferPool* pool, DatagramBuffers* buffers);
+
+  // Receives up to |max_datagrams| datagrams, appending each to |buffers| in a
+  // buffer drawn from |pool|. Datagrams larger than |pool->max_buffer_size()|
+  // are dropped and counted in Stats::datagrams_truncated. Returns the number
+  // of datagrams appended if the socket had any, otherwise a net error code
+  // (ERR_IO_PENDING if there is nothing to read).
+  int Receive(DatagramBufferPool* pool,
+              size_t max_datagrams,
+              DatagramBuffers* buffers);
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  // Each makes a single system call (or, without sendmmsg()/recvmmsg(), a
+  // sequence of them) for at most kMaxBatchSize datagrams. Returns the number
+  // of datagrams transferred, or a net error code if there were none.
+  int SendOneBatch(DatagramBuffers::const_iterator begin, size_t count);
+  // Appends the received datagrams that fit to |buffers|; the return value
+  // also counts truncated ones.
+  int ReceiveOneBatch(DatagramBufferPool* pool,
+                      size_t count,
+                      DatagramBuffers* buffers);
+
+  const int fd_;
+  Stats stats_;
+};
+
+}  // namespace net
+
+#endif  // NET_BASE_DATAGRAM_BATCH_IO_POSIX_H_
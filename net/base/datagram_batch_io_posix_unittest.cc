@@ -0,0 +1,161 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/datagram_batch_io_posix.h"
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include <string>
+
+#include "base/files/scoped_file.h"
+#include "base/strings/string_number_conversions.h"
+#include "net/base/net_errors.h"
+#include "net/test/gtest_util.h"
+#include "testing/gtest/include/gtest/gtest.h"
+
+using net::test::IsError;
+
+namespace net {
+
+namespace test {
+
+const size_t kMaxBufferSize = 256;
+
+class DatagramBatchIOTest : public testing::Test {
+ public:
+  DatagramBatchIOTest() : pool_(kMaxBufferSize) {}
+
+  // Uses a pair of UDP sockets on the loopback interface connected to each
+  // other, rather than socketpair(), whose queue is only a few datagrams deep.
+  void SetUp() override {
+    sender_.reset(socket(AF_INET, SOCK_DGRAM, 0));
+    receiver_.reset(socket(AF_INET, SOCK_DGRAM, 0));
+    ASSERT_TRUE(sender_.is_valid());
+    ASSERT_TRUE(receiver_.is_valid());
+
+    sockaddr_in sender_address;
+    sockaddr_in receiver_address;
+    ASSERT_NO_FATAL_FAILURE(BindToLoopback(sender_.get(), &sender_address));
+    ASSERT_NO_FATAL_FAILURE(
+        BindToLoopback(receiver_.get(), &receiver_address));
+    ASSERT_EQ(0, connect(sender_.get(),
+                         reinterpret_cast<sockaddr*>(&receiver_address),
+                         sizeof(receiver_address)));
+    ASSERT_EQ(0, connect(receiver_.get(),
+                         reinterpret_cast<sockaddr*>(&sender_address),
+                         sizeof(sender_address)));
+  }
+
+  void BindToLoopback(int fd, sockaddr_in* address) {
+    memset(address, 0, sizeof(*address));
+    address->sin_family = AF_INET;
+    address->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ASSERT_EQ(0, bind(fd, reinterpret_cast<sockaddr*>(address),
+                      sizeof(*address)));
+    socklen_t length = sizeof(*address);
+    ASSERT_EQ(0, getsockname(fd, reinterpret_cast<sockaddr*>(address),
+                             &length));
+    ASSERT_EQ(0, fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK));
+  }
+
+  void EnqueueStrings(size_t count, DatagramBuffers* buffers) {
+    for (size_t i = 0; i < count; ++i) {
+      std::string data = "datagram " + base::NumberToString(i);
+      pool_.Enqueue(data.data(), data.size(), buffers);
+    }
+  }
+
+  DatagramBufferPool pool_;
+  base::ScopedFD sender_;
+  base::ScopedFD receiver_;
+};
+
+TEST_F(DatagramBatchIOTest, SendAndReceiveBatch) {
+  DatagramBatchIO sender(sender_.get());
+  DatagramBatchIO receiver(receiver_.get());
+
+  // More than one system call's worth, to exercise splitting.
+  const size_t kCount = DatagramBatchIO::kMaxBatchSize + 3;
+  DatagramBuffers to_send;
+  EnqueueStrings(kCount, &to_send);
+  EXPECT_EQ(static_cast<int>(kCount), sender.Send(&pool_, &to_send));
+  EXPECT_TRUE(to_send.empty());
+  EXPECT_EQ(kCount, sender.stats().datagrams_sent);
+  EXPECT_EQ(2u, sender.stats().send_calls);
+  // One batch of 64 (bucket 6) and one of 3 (bucket 1).
+  EXPECT_EQ(1u, sender.stats().send_batch_sizes[6]);
+  EXPECT_EQ(1u, sender.stats().send_batch_sizes[1]);
+
+  DatagramBuffers received;
+  EXPECT_EQ(static_cast<int>(kCount),
+            receiver.Receive(&pool_, 2 * kCount, &received));
+  ASSERT_EQ(kCount, received.size());
+  size_t i = 0;
+  for (const std::unique_ptr<DatagramBuffer>& buffer : received) {
+    EXPECT_EQ("datagram " + base::NumberToString(i++),
+              std::string(buffer->data(), buffer->length()));
+  }
+  EXPECT_EQ(kCount, receiver.stats().datagrams_received);
+  EXPECT_EQ(0u, receiver.stats().datagrams_truncated);
+
+  // Nothing left to read.
+  EXPECT_THAT(receiver.Receive(&pool_, 1, &received), IsError(ERR_IO_PENDING));
+  EXPECT_EQ(kCount, received.size());
+
+  // Every buffer came from, and except for |received| went back to, the pool.
+  pool_.Dequeue(&received);
+  DatagramBufferPool::Stats stats = pool_.GetStats();
+  EXPECT_EQ(stats.allocated, stats.free);
+}
+
+TEST_F(DatagramBatchIOTest, ReceiveRespectsMaxDatagrams) {
+  DatagramBatchIO sender(sender_.get());
+  DatagramBatchIO receiver(receiver_.get());
+
+  DatagramBuffers to_send;
+  EnqueueStrings(5, &to_send);
+  EXPECT_EQ(5, sender.Send(&pool_, &to_send));
+
+  DatagramBuffers received;
+  EXPECT_EQ(2, receiver.Receive(&pool_, 2, &received));
+  EXPECT_EQ(3, receiver.Receive(&pool_, 10, &received));
+  ASSERT_EQ(5u, received.size());
+  EXPECT_EQ("datagram 4",
+            std::string(received.back()->data(), received.back()->length()));
+  pool_.Dequeue(&received);
+}
+
+TEST_F(DatagramBatchIOTest, TruncatedDatagramsAreDropped) {
+  DatagramBatchIO receiver(receiver_.get());
+
+  const std::string too_big(kMaxBufferSize + 1, 'x');
+  ASSERT_EQ(static_cast<ssize_t>(too_big.size()),
+            send(sender_.get(), too_big.data(), too_big.size(), 0));
+
+  DatagramBuffers received;
+  EXPECT_THAT(receiver.Receive(&pool_, 4, &received),
+              IsError(ERR_MSG_TOO_BIG));
+  EXPECT_TRUE(received.empty());
+  EXPECT_EQ(1u, receiver.stats().datagrams_truncated);
+
+  // A truncated datagram in the middle of a batch does not stop the rest.
+  const char kSmall[] = "small";
+  ASSERT_EQ(static_cast<ssize_t>(too_big.size()),
+            send(sender_.get(), too_big.data(), too_big.size(), 0));
+  ASSERT_EQ(static_cast<ssize_t>(strlen(kSmall)),
+            send(sender_.get(), kSmall, strlen(kSmall), 0));
+  EXPECT_EQ(1, receiver.Receive(&pool_, 4, &received));
+  ASSERT_EQ(1u, received.size());
+  EXPECT_EQ(kSmall, std::string(received.front()->data(),
+                                received.front()->length()));
+  EXPECT_EQ(2u, receiver.stats().datagrams_truncated);
+  pool_.Dequeue(&received);
+}
+
+}  // namespace test
+
+}  // namespace net
@@ -6,6 +6,7 @@
 
 #include "base/memory/ptr_util.h"
 
+#include <algorithm>
 #include <cstring>
 
 namespace net {
@@ -19,17 +20,20 @@ void DatagramBufferPool::Enqueue(const char* buffer,
                                  size_t buf_len,
                                  DatagramBuffers* buffers) {
   DCHECK_LE(buf_len, max_buffer_size_);
-  std::unique_ptr<DatagramBuffer> datagram_buffer;
-  if (free_list_.empty()) {
-    datagram_buffer = base::WrapUnique(new DatagramBuffer(max_buffer_size_));
-  } else {
-    datagram_buffer = std::move(free_list_.front());
-    free_list_.pop_front();
-  }
+  std::unique_ptr<DatagramBuffer> datagram_buffer = Take();
   datagram_buffer->Set(buffer, buf_len);
   buffers->emplace_back(std::move(datagram_buffer));
 }
 
+void DatagramBufferPool::EnqueueForRead(size_t count,
+                                        DatagramBuffers* buffers) {
+  for (size_t i = 0; i < count; ++i) {
+    std::unique_ptr<DatagramBuffer> datagram_buffer = Take();
+    datagram_buffer->set_length(0);
+    buffers->emplace_back(std::move(datagram_buffer));
+  }
+}
+
 void DatagramBufferPool::Dequeue(DatagramBuffers* buffers) {
   if (buffers->size() == 0)
     return;
@@ -37,6 +41,27 @@ void DatagramBufferPool::Dequeue(DatagramBuffers* buffers) {
   free_list_.splice(free_list_.cend(), *buffers);
 }
 
+DatagramBufferPool::Stats DatagramBufferPool::GetStats() const {
+  Stats stats;
+  stats.allocated = allocated_;
+  stats.free = free_list_.size();
+  stats.peak_in_use = peak_in_use_;
+  return stats;
+}
+
+std::unique_ptr<DatagramBuffer> DatagramBufferPool::Take() {
+  std::unique_ptr<DatagramBuffer> datagram_buffer;
+  if (free_list_.empty()) {
+    datagram_buffer = base::WrapUnique(new DatagramBuffer(max_buffer_size_));
+    ++allocated_;
+  } else {
+    datagram_buffer = std::move(free_list_.front());
+    free_list_.pop_front();
+  }
+  peak_in_use_ = std::max(peak_in_use_, allocated_ - free_list_.size());
+  return datagram_buffer;
+}
+
 DatagramBuffer::DatagramBuffer(size_t max_buffer_size)
     : data_(new char[max_buffer_size]), length_(0) {}
 
@@ -51,15 +51,36 @@ class NET_EXPORT_PRIVATE DatagramBufferPool {
   // Insert a new element (drawn from the pool) containing a copy of
   // |buffer| to |buffers|. Caller retains owenership of |buffers| and |buffer|.
   void Enqueue(const char* buffer, size_t buf_len, DatagramBuffers* buffers);
+  // Append |count| elements (drawn from the pool) to |buffers|, each
+  // with zero length and |max_buffer_size()| bytes of capacity, to be
+  // filled by a read.  Caller retains ownership of |buffers|.
+  void EnqueueForRead(size_t count, DatagramBuffers* buffers);
   // Return all elements of |buffers| to the pool.  Caller retains
   // ownership of |buffers|.
   void Dequeue(DatagramBuffers* buffers);
 
   size_t max_buffer_size() { return max_buffer_size_; }
 
+  // Occupancy statistics, for tuning batch sizes and spotting leaks.
+  struct Stats {
+    // Buffers ever created by the pool; they are never freed while the
+    // pool is alive.
+    size_t allocated = 0;
+    // Buffers currently sitting in the pool's free list.
+    size_t free = 0;
+    // Largest number of buffers handed out at the same time.
+    size_t peak_in_use = 0;
+  };
+  Stats GetStats() const;
+
  private:
+  // Returns a buffer from the free list, or a new one if it is empty.
+  std::unique_ptr<DatagramBuffer> Take();
+
   const size_t max_buffer_size_;
   DatagramBuffers free_list_;
+  size_t allocated_ = 0;
+  size_t peak_in_use_ = 0;
 };
 
 // |DatagramBuffer|s can only be created via
@@ -85,6 +106,10 @@ class NET_EXPORT_PRIVATE DatagramBuffer {
   char* data() const;
   size_t length() const;
 
+  // Sets the length after |data()| has been filled in place, e.g. by a
+  // read.  |buf_len| must not exceed the pool's |max_buffer_size()|.
+  void set_length(size_t buf_len) { length_ = buf_len; }
+
  protected:
   DatagramBuffer(size_t max_packet_size);
 
@@ -49,6 +49,43 @@ TEST_F(DatagramBufferTest, DatgramBufferPoolRecycles) {
   EXPECT_EQ(buffer2_ptr, buffers.back().get());
 }
 
+TEST_F(DatagramBufferTest, EnqueueForRead) {
+  DatagramBuffers buffers;
+  pool_.EnqueueForRead(3, &buffers);
+  EXPECT_EQ(3u, buffers.size());
+  for (const std::unique_ptr<DatagramBuffer>& buffer : buffers) {
+    EXPECT_EQ(0u, buffer->length());
+    // The whole capacity is writable.
+    memset(buffer->data(), 'x', kMaxBufferSize);
+    buffer->set_length(kMaxBufferSize);
+    EXPECT_EQ(kMaxBufferSize, buffer->length());
+  }
+}
+
+TEST_F(DatagramBufferTest, Stats) {
+  DatagramBufferPool::Stats stats = pool_.GetStats();
+  EXPECT_EQ(0u, stats.allocated);
+  EXPECT_EQ(0u, stats.free);
+  EXPECT_EQ(0u, stats.peak_in_use);
+
+  DatagramBuffers buffers;
+  pool_.EnqueueForRead(4, &buffers);
+  pool_.Dequeue(&buffers);
+  stats = pool_.GetStats();
+  EXPECT_EQ(4u, stats.allocated);
+  EXPECT_EQ(4u, stats.free);
+  EXPECT_EQ(4u, stats.peak_in_use);
+
+  // Reuse does not allocate, and the peak is not lowered.
+  const char data[] = "foo";
+  pool_.Enqueue(data, sizeof(data), &buffers);
+  stats = pool_.GetStats();
+  EXPECT_EQ(4u, stats.allocated);
+  EXPECT_EQ(3u, stats.free);
+  EXPECT_EQ(4u, stats.peak_in_use);
+  pool_.Dequeue(&buffers);
+}
+
 }  // namespace test
 
 }  // namespace net
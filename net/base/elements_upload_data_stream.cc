@@ -45,6 +45,24 @@ int ElementsUploadDataStream::ReadInternal(
   return ReadElements(base::MakeRefCounted<DrainableIOBuffer>(buf, buf_len));
 }
 
+bool ElementsUploadDataStream::ReadInMemoryInternal(
+    size_t max_len,
+    base::span<const char>* data) {
+  if (read_error_ != OK)
+    return false;
+
+  while (element_index_ < element_readers_.size() &&
+         element_readers_[element_index_]->BytesRemaining() == 0) {
+    ++element_index_;
+  }
+  if (element_index_ == element_readers_.size())
+    return false;
+
+  // Only hands out bytes from a single element, so a caller wanting the whole
+  // body calls this once per element rather than having it copied together.
+  return element_readers_[element_index_]->ReadInMemory(max_len, data);
+}
+
 bool ElementsUploadDataStream::IsInMemory() const {
   for (const std::unique_ptr<UploadElementReader>& it : element_readers_) {
     if (!it->IsInMemory())
@@ -47,6 +47,8 @@ class NET_EXPORT ElementsUploadDataStream : public UploadDataStream {
       const override;
   int InitInternal(const NetLogWithSource& net_log) override;
   int ReadInternal(IOBuffer* buf, int buf_len) override;
+  bool ReadInMemoryInternal(size_t max_len,
+                            base::span<const char>* data) override;
   void ResetInternal() override;
 
   // Runs Init() for all element readers.
@@ -195,6 +195,57 @@ TEST_F(ElementsUploadDataStreamTest, ConsumeAllBytes) {
   ASSERT_TRUE(stream->IsEOF());
 }
 
+// ReadInMemory() hands out each bytes element's memory without copying.
+TEST_F(ElementsUploadDataStreamTest, ReadInMemory) {
+  const char kOtherData[] = "abc";
+  element_readers_.push_back(
+      std::make_unique<UploadBytesElementReader>(kTestData, kTestDataSize));
+  element_readers_.push_back(
+      std::make_unique<UploadBytesElementReader>(kOtherData, 3));
+  std::unique_ptr<UploadDataStream> stream(
+      new ElementsUploadDataStream(std::move(element_readers_), 0));
+  ASSERT_THAT(stream->Init(CompletionOnceCallback(), NetLogWithSource()),
+              IsOk());
+
+  base::span<const char> data;
+  ASSERT_TRUE(stream->ReadInMemory(kTestBufferSize, &data));
+  EXPECT_EQ(kTestData, data.data());
+  EXPECT_EQ(kTestDataSize, data.size());
+  EXPECT_EQ(kTestDataSize, stream->position());
+  EXPECT_FALSE(stream->IsEOF());
+
+  ASSERT_TRUE(stream->ReadInMemory(2, &data));
+  EXPECT_EQ(kOtherData, data.data());
+  EXPECT_EQ(2u, data.size());
+
+  ASSERT_TRUE(stream->ReadInMemory(kTestBufferSize, &data));
+  EXPECT_EQ(kOtherData + 2, data.data());
+  EXPECT_EQ(1u, data.size());
+  EXPECT_EQ(kTestDataSize + 3, stream->position());
+  EXPECT_TRUE(stream->IsEOF());
+
+  ASSERT_TRUE(stream->ReadInMemory(kTestBufferSize, &data));
+  EXPECT_TRUE(data.empty());
+}
+
+// ReadInMemory() declines elements that are not in memory, leaving them to be
+// read with Read().
+TEST_F(ElementsUploadDataStreamTest, ReadInMemoryNotInMemory) {
+  auto reader = std::make_unique<MockUploadElementReader>(kTestDataSize, false);
+  EXPECT_CALL(*reader, Init(_)).WillOnce(Return(OK));
+  element_readers_.push_back(std::move(reader));
+  std::unique_ptr<UploadDataStream> stream(
+      new ElementsUploadDataStream(std::move(element_readers_), 0));
+  TestCompletionCallback init_callback;
+  ASSERT_THAT(stream->Init(init_callback.callback(), NetLogWithSource()),
+              IsOk());
+
+  base::span<const char> data;
+  EXPECT_FALSE(stream->ReadInMemory(kTestBufferSize, &data));
+  EXPECT_EQ(0u, stream->position());
+  EXPECT_FALSE(stream->IsEOF());
+}
+
 TEST_F(ElementsUploadDataStreamTest, File) {
   base::FilePath temp_file_path;
   ASSERT_TRUE(
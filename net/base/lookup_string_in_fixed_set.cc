@@ -4,7 +4,9 @@
 
 #include "net/base/lookup_string_in_fixed_set.h"
 
-#include "base/check.h"
+#include <algorithm>
+
+#include "base/check_op.h"
 
 namespace net {
 
@@ -67,12 +69,48 @@ bool GetReturnValue(const unsigned char* offset, int* return_value) {
   return false;
 }
 
+// Finishes a lookup of the longest suffix of |host| in a reversed DAFSA.
+// |lookup| has already consumed the characters of |host| from |pos| to the end.
+// See LookupSuffixInReversedSet().
+inline int FinishSuffixLookup(FixedSetIncrementalLookup* lookup,
+                              bool include_private,
+                              base::StringPiece host,
+                              base::StringPiece::const_iterator pos,
+                              size_t* suffix_length) {
+  int result = kDafsaNotFound;
+  while (true) {
+    // Only host itself or a part that follows a dot can match.
+    if (pos == host.begin() || *(pos - 1) == '.') {
+      int value = lookup->GetResultForCurrentSequence();
+      if (value != kDafsaNotFound) {
+        // Break if private and private rules should be excluded.
+        if ((value & kDafsaPrivateRule) && !include_private)
+          break;
+        // Save length and return value. Since hosts are looked up from right to
+        // left, the last saved values will be from the longest match.
+        *suffix_length = host.end() - pos;
+        result = value;
+      }
+    }
+    // Look up host from right to left.
+    if (pos == host.begin() || !lookup->Advance(*--pos))
+      break;
+  }
+  return result;
+}
+
 }  // namespace
 
 FixedSetIncrementalLookup::FixedSetIncrementalLookup(const unsigned char* graph,
                                                      size_t length)
     : pos_(graph), end_(graph + length), pos_is_label_character_(false) {}
 
+FixedSetIncrementalLookup::FixedSetIncrementalLookup(
+    const unsigned char* pos,
+    const unsigned char* end,
+    bool pos_is_label_character)
+    : pos_(pos), end_(end), pos_is_label_character_(pos_is_label_character) {}
+
 FixedSetIncrementalLookup::FixedSetIncrementalLookup(
     const FixedSetIncrementalLookup& other) = default;
 
@@ -147,6 +185,33 @@ bool FixedSetIncrementalLookup::Advance(char input) {
   return false;
 }
 
+bool FixedSetIncrementalLookup::AdvanceString(base::StringPiece input) {
+  for (base::StringPiece::const_iterator it = input.begin();
+       it != input.end(); ++it) {
+    if (!pos_)
+      return false;
+
+    if (!pos_is_label_character_) {
+      // At a node boundary; only here is the child offset list decoded.
+      if (!Advance(*it))
+        return false;
+      continue;
+    }
+
+    // Inside a label the next byte either matches or the graph is exhausted,
+    // so whole label runs are consumed here without further decoding.
+    if (*it < 0x20 || !IsMatch(pos_, *it)) {
+      pos_ = nullptr;
+      pos_is_label_character_ = false;
+      return false;
+    }
+    pos_is_label_character_ = !IsEOL(pos_);
+    ++pos_;
+    DCHECK(pos_ < end_);
+  }
+  return true;
+}
+
 int FixedSetIncrementalLookup::GetResultForCurrentSequence() const {
   int value = kDafsaNotFound;
   // Look to see if there is a next character that's a return value.
@@ -184,12 +249,8 @@ int LookupStringInFixedSet(const unsigned char* graph,
   // Do an incremental lookup until either the end of the graph is reached, or
   // until every character in |key| is consumed.
   FixedSetIncrementalLookup lookup(graph, length);
-  const char* key_end = key + key_length;
-  while (key != key_end) {
-    if (!lookup.Advance(*key))
-      return kDafsaNotFound;
-    key++;
-  }
+  if (!lookup.AdvanceString(base::StringPiece(key, key_length)))
+    return kDafsaNotFound;
   // The entire input was consumed without reaching the end of the graph. Return
   // the result code (if present) for the current position, or kDafsaNotFound.
   return lookup.GetResultForCurrentSequence();
@@ -208,25 +269,85 @@ int LookupSuffixInReversedSet(const unsigned char* graph,
                               size_t* suffix_length) {
   FixedSetIncrementalLookup lookup(graph, length);
   *suffix_length = 0;
-  int result = kDafsaNotFound;
-  base::StringPiece::const_iterator pos = host.end();
-  // Look up host from right to left.
-  while (pos != host.begin() && lookup.Advance(*--pos)) {
-    // Only host itself or a part that follows a dot can match.
-    if (pos == host.begin() || *(pos - 1) == '.') {
-      int value = lookup.GetResultForCurrentSequence();
-      if (value != kDafsaNotFound) {
-        // Break if private and private rules should be excluded.
-        if ((value & kDafsaPrivateRule) && !include_private)
-          break;
-        // Save length and return value. Since hosts are looked up from right to
-        // left, the last saved values will be from the longest match.
-        *suffix_length = host.end() - pos;
-        result = value;
-      }
-    }
+  if (host.empty() || !lookup.Advance(host.back()))
+    return kDafsaNotFound;
+  return FinishSuffixLookup(&lookup, include_private, host, host.end() - 1,
+                            suffix_length);
+}
+
+FixedSetLookupTable::FixedSetLookupTable(const unsigned char* graph,
+                                         size_t length)
+    : graph_(graph), end_(graph + length) {
+  std::fill(std::begin(root_children_), std::end(root_children_), nullptr);
+
+  // The root node of the graph is just a list of child offsets. Record the
+  // child for every label character; result codes (below 0x20) are left to
+  // the slow path, which only matters for the empty key.
+  const unsigned char* pos = graph_;
+  const unsigned char* offset = graph_;
+  while (GetNextOffset(&pos, &offset)) {
+    DCHECK(offset < end_);
+    unsigned char c = *offset & 0x7F;
+    if (c < 0x20)
+      continue;
+    // The graph is deterministic, so each character has at most one child.
+    DCHECK(!root_children_[c]);
+    root_children_[c] = offset;
   }
-  return result;
+}
+
+FixedSetLookupTable::~FixedSetLookupTable() = default;
+
+bool FixedSetLookupTable::StartLookup(char c,
+                                      FixedSetIncrementalLookup* lookup) const {
+  unsigned char index = static_cast<unsigned char>(c);
+  if (index >= kNumChars || !root_children_[index])
+    return false;
+  const unsigned char* child = root_children_[index];
+  // Same transition FixedSetIncrementalLookup::Advance() makes on a match.
+  *lookup = FixedSetIncrementalLookup(child + 1, end_, !IsEOL(child));
+  return true;
+}
+
+int FixedSetLookupTable::Lookup(base::StringPiece key) const {
+  if (key.empty()) {
+    return FixedSetIncrementalLookup(graph_, end_ - graph_)
+        .GetResultForCurrentSequence();
+  }
+
+  FixedSetIncrementalLookup lookup(nullptr, end_, false);
+  if (!StartLookup(key[0], &lookup) || !lookup.AdvanceString(key.substr(1)))
+    return kDafsaNotFound;
+  return lookup.GetResultForCurrentSequence();
+}
+
+int FixedSetLookupTable::LookupSuffix(base::StringPiece host,
+                                      bool include_private,
+                                      size_t* suffix_length) const {
+  *suffix_length = 0;
+  FixedSetIncrementalLookup lookup(nullptr, end_, false);
+  if (host.empty() || !StartLookup(host.back(), &lookup))
+    return kDafsaNotFound;
+  return FinishSuffixLookup(&lookup, include_private, host, host.end() - 1,
+                            suffix_length);
+}
+
+void FixedSetLookupTable::LookupMany(base::span<const base::StringPiece> keys,
+                                     base::span<int> results) const {
+  CHECK_EQ(keys.size(), results.size());
+  for (size_t i = 0; i < keys.size(); ++i)
+    results[i] = Lookup(keys[i]);
+}
+
+void FixedSetLookupTable::LookupSuffixes(
+    base::span<const base::StringPiece> hosts,
+    bool include_private,
+    base::span<size_t> suffix_lengths,
+    base::span<int> results) const {
+  CHECK_EQ(hosts.size(), suffix_lengths.size());
+  CHECK_EQ(hosts.size(), results.size());
+  for (size_t i = 0; i < hosts.size(); ++i)
+    results[i] = LookupSuffix(hosts[i], include_private, &suffix_lengths[i]);
 }
 
 }  // namespace net
@@ -7,6 +7,7 @@
 
 #include <stddef.h>
 
+#include "base/containers/span.h"
 #include "base/strings/string_piece.h"
 #include "net/base/net_export.h"
 
@@ -126,6 +127,13 @@ class NET_EXPORT FixedSetIncrementalLookup {
   // effect.
   bool Advance(char input);
 
+  // Equivalent to calling Advance() with each character of |input| in order,
+  // stopping at the first call that would return false. Returns true if all of
+  // |input| was consumed. Characters inside a node label are matched directly
+  // against the label bytes without going back through the child offset list
+  // decoder, which makes this faster than a loop over Advance() for long keys.
+  bool AdvanceString(base::StringPiece input);
+
   // Returns the result code corresponding to the input sequence provided thus
   // far to Advance().
   //
@@ -141,6 +149,13 @@ class NET_EXPORT FixedSetIncrementalLookup {
   int GetResultForCurrentSequence() const;
 
  private:
+  friend class FixedSetLookupTable;
+
+  // Creates a lookup in an arbitrary decoder state; see the members below.
+  FixedSetIncrementalLookup(const unsigned char* pos,
+                            const unsigned char* end,
+                            bool pos_is_label_character);
+
   // Pointer to the current position in the graph indicating the current state
   // of the automaton, or nullptr if the graph is exhausted.
   const unsigned char* pos_;
@@ -155,6 +170,61 @@ class NET_EXPORT FixedSetIncrementalLookup {
   bool pos_is_label_character_;
 };
 
+// FixedSetLookupTable speeds up repeated lookups against a single DAFSA. On
+// construction it decodes the offset list of the root node, which is by far the
+// longest list in the graph, into a table indexed by character. Each lookup then
+// jumps straight to the child matching its first character instead of scanning
+// that list, and continues with FixedSetIncrementalLookup::AdvanceString().
+//
+// Results are identical to LookupStringInFixedSet() and
+// LookupSuffixInReversedSet() on the same graph. The batch methods are meant for
+// callers that resolve many keys at once (e.g. every host of a cookie jar), so
+// that the table is built once per graph rather than per key.
+//
+// |graph| must outlive the table. The table is immutable after construction and
+// may be shared between threads.
+class NET_EXPORT FixedSetLookupTable {
+ public:
+  FixedSetLookupTable(const unsigned char* graph, size_t length);
+  FixedSetLookupTable(const FixedSetLookupTable&) = delete;
+  FixedSetLookupTable& operator=(const FixedSetLookupTable&) = delete;
+  ~FixedSetLookupTable();
+
+  // Same as LookupStringInFixedSet() for the graph passed to the constructor.
+  int Lookup(base::StringPiece key) const;
+
+  // Same as LookupSuffixInReversedSet() for the graph passed to the
+  // constructor, which must be a reversed DAFSA.
+  int LookupSuffix(base::StringPiece host,
+                   bool include_private,
+                   size_t* suffix_length) const;
+
+  // Batch forms of Lookup() and LookupSuffix(). All spans must have the same
+  // size; entry i of the outputs corresponds to entry i of the input.
+  void LookupMany(base::span<const base::StringPiece> keys,
+                  base::span<int> results) const;
+  void LookupSuffixes(base::span<const base::StringPiece> hosts,
+                      bool include_private,
+                      base::span<size_t> suffix_lengths,
+                      base::span<int> results) const;
+
+ private:
+  // Number of distinct label characters; the DAFSA format is limited to 7-bit
+  // ASCII.
+  static constexpr size_t kNumChars = 0x80;
+
+  // Returns a lookup that has consumed the single character |c|, or false if
+  // no key in the set starts with |c|.
+  bool StartLookup(char c, FixedSetIncrementalLookup* lookup) const;
+
+  const unsigned char* const graph_;
+  const unsigned char* const end_;
+
+  // For each character, the node of the root child whose label starts with
+  // that character, or nullptr if there is none.
+  const unsigned char* root_children_[kNumChars];
+};
+
 }  // namespace net
 
 #endif  // NET_BASE_LOOKUP_STRING_IN_FIXED_SET_H_
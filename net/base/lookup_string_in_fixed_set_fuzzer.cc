@@ -5,6 +5,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "base/check_op.h"
+#include "base/strings/string_piece.h"
 #include "net/base/lookup_string_in_fixed_set.h"
 
 namespace {
@@ -13,7 +15,24 @@ namespace {
 
 // Entry point for LibFuzzer.
 extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
-  net::LookupStringInFixedSet(kDafsa, sizeof(kDafsa),
-                              reinterpret_cast<const char*>(data), size);
+  static const net::FixedSetLookupTable* table =
+      new net::FixedSetLookupTable(kDafsa, sizeof(kDafsa));
+
+  base::StringPiece key(reinterpret_cast<const char*>(data), size);
+  int result =
+      net::LookupStringInFixedSet(kDafsa, sizeof(kDafsa), key.data(), size);
+  CHECK_EQ(result, table->Lookup(key));
+
+  // The graph is not reversed, but suffix lookups are still well defined on
+  // it, so the two suffix implementations must agree as well.
+  for (bool include_private : {false, true}) {
+    size_t suffix_length = 0;
+    size_t table_suffix_length = 0;
+    result = net::LookupSuffixInReversedSet(
+        kDafsa, sizeof(kDafsa), include_private, key, &suffix_length);
+    CHECK_EQ(result,
+             table->LookupSuffix(key, include_private, &table_suffix_length));
+    CHECK_EQ(suffix_length, table_suffix_length);
+  }
   return 0;
 }
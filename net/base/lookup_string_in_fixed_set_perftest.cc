@@ -0,0 +1,124 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include "net/base/lookup_string_in_fixed_set.h"
+
+#include <string>
+#include <vector>
+
+#include "base/cxx17_backports.h"
+#include "base/rand_util.h"
+#include "base/strings/string_piece.h"
+#include "base/strings/string_util.h"
+#include "base/timer/elapsed_timer.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace net {
+namespace {
+
+#include "net/base/registry_controlled_domains/effective_tld_names-inc.cc"
+
+// Suffixes that hosts are generated under. A mix of plain TLDs, multi-label
+// public suffixes, and private registries, roughly in the proportions seen in
+// popular-site lists.
+const char* const kSuffixes[] = {
+    "com",    "com",           "com",         "net",    "org",
+    "de",     "co.uk",         "co.jp",       "com.br", "ru",
+    "com.au", "blogspot.com",  "github.io",   "cn",     "in",
+    "fr",     "appspot.com",   "example",     "xn--p1ai", "k12.ca.us",
+};
+
+const char* const kLabels[] = {
+    "www",  "mail", "cdn",     "static", "api",   "m",      "news",
+    "shop", "blog", "images",  "login",  "video", "search", "docs",
+    "app",  "beta", "storage", "assets", "media", "account",
+};
+
+constexpr size_t kNumHosts = 1 << 16;
+constexpr size_t kIterations = 16;
+
+// Generates |kNumHosts| pseudo-random hosts of two to five labels. The real
+// top-sites lists are not checked in, so hosts are synthesised from common
+// labels and suffixes instead.
+std::vector<std::string> MakeHosts() {
+  std::vector<std::string> hosts;
+  hosts.reserve(kNumHosts);
+  for (size_t i = 0; i < kNumHosts; ++i) {
+    std::vector<base::StringPiece> labels;
+    int num_labels = base::RandInt(1, 3);
+    for (int j = 0; j < num_labels; ++j)
+      labels.push_back(kLabels[base::RandGenerator(base::size(kLabels))]);
+    labels.push_back(kSuffixes[base::RandGenerator(base::size(kSuffixes))]);
+    hosts.push_back(base::JoinString(labels, "."));
+  }
+  return hosts;
+}
+
+// Returns every dot-separated suffix of every host, which is the sequence of
+// keys a registry lookup against the forward DAFSA performs.
+std::vector<base::StringPiece> MakeKeys(const std::vector<std::string>& hosts) {
+  std::vector<base::StringPiece> keys;
+  for (const std::string& host : hosts) {
+    base::StringPiece key(host);
+    while (true) {
+      keys.push_back(key);
+      size_t dot = key.find('.');
+      if (dot == base::StringPiece::npos)
+        break;
+      key.remove_prefix(dot + 1);
+    }
+  }
+  return keys;
+}
+
+void ReportResult(const std::string& story,
+                  size_t num_keys,
+                  base::TimeDelta elapsed) {
+  perf_test::PerfResultReporter reporter("LookupStringInFixedSet.", story);
+  reporter.RegisterImportantMetric("lookup_time", "ns");
+  reporter.AddResult("lookup_time", elapsed.InNanoseconds() /
+                                        static_cast<double>(num_keys));
+}
+
+TEST(LookupStringInFixedSetPerfTest, Lookup) {
+  std::vector<std::string> hosts = MakeHosts();
+  std::vector<base::StringPiece> keys = MakeKeys(hosts);
+  const size_t num_lookups = keys.size() * kIterations;
+
+  std::vector<int> expected(keys.size());
+  {
+    base::ElapsedTimer timer;
+    for (size_t i = 0; i < kIterations; ++i) {
+      for (size_t j = 0; j < keys.size(); ++j) {
+        expected[j] = LookupStringInFixedSet(kDafsa, sizeof(kDafsa),
+                                             keys[j].data(), keys[j].size());
+      }
+    }
+    ReportResult("scalar", num_lookups, timer.Elapsed());
+  }
+
+  FixedSetLookupTable table(kDafsa, sizeof(kDafsa));
+  std::vector<int> results(keys.size());
+  {
+    base::ElapsedTimer timer;
+    for (size_t i = 0; i < kIterations; ++i) {
+      for (size_t j = 0; j < keys.size(); ++j)
+        results[j] = table.Lookup(keys[j]);
+    }
+    ReportResult("table", num_lookups, timer.Elapsed());
+  }
+  EXPECT_EQ(expected, results);
+
+  {
+    base::ElapsedTimer timer;
+    for (size_t i = 0; i < kIterations; ++i)
+      table.LookupMany(keys, results);
+    ReportResult("table_batch", num_lookups, timer.Elapsed());
+  }
+  EXPECT_EQ(expected, results);
+}
+
+}  // namespace
+}  // namespace net
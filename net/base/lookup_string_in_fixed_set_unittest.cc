@@ -51,7 +51,11 @@ class LookupStringInFixedSetTest : public testing::TestWithParam<Expectation> {
  protected:
   template <size_t N>
   int LookupInGraph(const unsigned char(&graph)[N], const char* key) {
-    return LookupStringInFixedSet(graph, N, key, strlen(key));
+    int result = LookupStringInFixedSet(graph, N, key, strlen(key));
+    // The lookup table must always agree with the plain lookup.
+    FixedSetLookupTable table(graph, N);
+    EXPECT_EQ(result, table.Lookup(key));
+    return result;
   }
 };
 
@@ -247,5 +251,56 @@ TEST(LookupStringInFixedSetTest, Dafsa6EnumerateLanguage) {
   EXPECT_EQ(expected_language, language);
 }
 
+// Checks that the batch entry points of FixedSetLookupTable give the same
+// results as the per-key functions, including for keys that leave the graph
+// in the middle of a label and keys with characters outside the DAFSA range.
+TEST(LookupStringInFixedSetTest, LookupTableBatch) {
+  const std::vector<base::StringPiece> keys = {
+      "",        "j",       "jp",     "jpx",         "bar.jp",
+      "bar.j",   "baz.jp",  "b.c",    "priv.no",     "private",
+      "privatX", "no",      "no.",    "xn--fiqs8s",  "xn--fiqs8",
+      "\x01",   "\xff.jp", "c.b.c",  "pref.bar.jp", "a.pref.bar.jp",
+  };
+  FixedSetLookupTable table(test1::kDafsa, sizeof(test1::kDafsa));
+
+  std::vector<int> results(keys.size());
+  table.LookupMany(keys, results);
+  for (size_t i = 0; i < keys.size(); ++i) {
+    SCOPED_TRACE(keys[i]);
+    EXPECT_EQ(LookupStringInFixedSet(test1::kDafsa, sizeof(test1::kDafsa),
+                                     keys[i].data(), keys[i].size()),
+              results[i]);
+  }
+
+  for (bool include_private : {false, true}) {
+    std::vector<size_t> suffix_lengths(keys.size());
+    table.LookupSuffixes(keys, include_private, suffix_lengths, results);
+    for (size_t i = 0; i < keys.size(); ++i) {
+      SCOPED_TRACE(keys[i]);
+      size_t expected_suffix_length;
+      EXPECT_EQ(LookupSuffixInReversedSet(test1::kDafsa, sizeof(test1::kDafsa),
+                                          include_private, keys[i],
+                                          &expected_suffix_length),
+                results[i]);
+      EXPECT_EQ(expected_suffix_length, suffix_lengths[i]);
+    }
+  }
+}
+
+// Every string in the language must be found by the lookup table, including
+// in a graph whose root node uses three byte offsets.
+TEST(LookupStringInFixedSetTest, LookupTableEnumerateLanguage) {
+  FixedSetLookupTable table4(test4::kDafsa, sizeof(test4::kDafsa));
+  for (const std::string& line : EnumerateDafsaLanguage(test4::kDafsa)) {
+    size_t comma = line.rfind(", ");
+    ASSERT_NE(std::string::npos, comma);
+    base::StringPiece key(line.data(), comma);
+    EXPECT_EQ(LookupStringInFixedSet(test4::kDafsa, sizeof(test4::kDafsa),
+                                     key.data(), key.size()),
+              table4.Lookup(key));
+    EXPECT_NE(kDafsaNotFound, table4.Lookup(key));
+  }
+}
+
 }  // namespace
 }  // namespace net
@@ -56,6 +56,17 @@ int UploadBytesElementReader::Read(IOBuffer* buf,
   return num_bytes_to_read;
 }
 
+bool UploadBytesElementReader::ReadInMemory(size_t max_length,
+                                            base::span<const char>* data) {
+  DCHECK_LT(0u, max_length);
+
+  const size_t num_bytes_to_read = static_cast<size_t>(
+      std::min(BytesRemaining(), static_cast<uint64_t>(max_length)));
+  *data = base::make_span(bytes_ + offset_, num_bytes_to_read);
+  offset_ += num_bytes_to_read;
+  return true;
+}
+
 UploadOwnedBytesElementReader::UploadOwnedBytesElementReader(
     std::vector<char>* data)
     : UploadBytesElementReader(data->data(), data->size()) {
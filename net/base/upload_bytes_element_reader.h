@@ -37,6 +37,7 @@ class NET_EXPORT UploadBytesElementReader : public UploadElementReader {
   int Read(IOBuffer* buf,
            int buf_length,
            CompletionOnceCallback callback) override;
+  bool ReadInMemory(size_t max_length, base::span<const char>* data) override;
 
  private:
   const char* const bytes_;
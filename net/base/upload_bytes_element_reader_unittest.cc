@@ -99,4 +99,22 @@ TEST_F(UploadBytesElementReaderTest, MultipleInit) {
   EXPECT_EQ(bytes_, buf);
 }
 
+TEST_F(UploadBytesElementReaderTest, ReadInMemory) {
+  const size_t kHalfSize = bytes_.size() / 2;
+  base::span<const char> data;
+  ASSERT_TRUE(reader_->ReadInMemory(kHalfSize, &data));
+  EXPECT_EQ(&bytes_[0], data.data());
+  EXPECT_EQ(kHalfSize, data.size());
+  EXPECT_EQ(bytes_.size() - kHalfSize, reader_->BytesRemaining());
+
+  // Asking for more than is left returns just the remainder.
+  ASSERT_TRUE(reader_->ReadInMemory(bytes_.size(), &data));
+  EXPECT_EQ(&bytes_[kHalfSize], data.data());
+  EXPECT_EQ(bytes_.size() - kHalfSize, data.size());
+  EXPECT_EQ(0U, reader_->BytesRemaining());
+
+  ASSERT_TRUE(reader_->ReadInMemory(bytes_.size(), &data));
+  EXPECT_TRUE(data.empty());
+}
+
 }  // namespace net
@@ -89,6 +89,24 @@ int UploadDataStream::Read(IOBuffer* buf,
   return result;
 }
 
+bool UploadDataStream::ReadInMemory(size_t max_len,
+                                    base::span<const char>* data) {
+  DCHECK(initialized_successfully_);
+  DCHECK(callback_.is_null());
+  DCHECK_GT(max_len, 0u);
+
+  base::span<const char> result;
+  if (!is_eof_ && !ReadInMemoryInternal(max_len, &result))
+    return false;
+
+  net_log_.BeginEvent(NetLogEventType::UPLOAD_DATA_STREAM_READ,
+                      [&] { return CreateReadInfoParams(current_position_); });
+  OnReadCompleted(static_cast<int>(result.size()));
+
+  *data = result;
+  return true;
+}
+
 bool UploadDataStream::IsEOF() const {
   DCHECK(initialized_successfully_);
   DCHECK(is_chunked_ || is_eof_ == (current_position_ == total_size_));
@@ -136,6 +154,11 @@ bool UploadDataStream::IsInMemory() const {
   return false;
 }
 
+bool UploadDataStream::ReadInMemoryInternal(size_t max_len,
+                                            base::span<const char>* data) {
+  return false;
+}
+
 const std::vector<std::unique_ptr<UploadElementReader>>*
 UploadDataStream::GetElementReaders() const {
   return nullptr;
@@ -5,11 +5,13 @@
 #ifndef NET_BASE_UPLOAD_DATA_STREAM_H_
 #define NET_BASE_UPLOAD_DATA_STREAM_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
 #include <memory>
 #include <vector>
 
+#include "base/containers/span.h"
 #include "net/base/completion_once_callback.h"
 #include "net/base/net_export.h"
 #include "net/base/upload_progress.h"
@@ -62,6 +64,20 @@ class NET_EXPORT UploadDataStream {
   // TODO(mmenke):  Investigate letting reads fail.
   int Read(IOBuffer* buf, int buf_len, CompletionOnceCallback callback);
 
+  // Zero-copy alternative to Read(). If the next bytes of the stream are
+  // already in memory, sets |data| to (up to) |max_len| of them, advances the
+  // stream past them and returns true. |data| is empty only once the end of
+  // the stream has been reached, as with a 0-byte Read(). The memory is owned
+  // by the stream and remains valid until it is reset or destroyed, so it must
+  // not be handed to anything that may outlive the stream, such as a pending
+  // socket write.
+  //
+  // Returns false without side effects if the next bytes are not directly
+  // addressable (e.g. they come from a file, or a chunked upload is waiting
+  // for more data), in which case the caller should use Read(). Never blocks
+  // and never completes asynchronously.
+  bool ReadInMemory(size_t max_len, base::span<const char>* data);
+
   // Returns the total size of the data stream and the current position.
   // When the data is chunked, always returns zero. Must always return the same
   // value after each call to Initialize().
@@ -129,6 +145,12 @@ class NET_EXPORT UploadDataStream {
   // return any error, other than ERR_IO_PENDING.
   virtual int ReadInternal(IOBuffer* buf, int buf_len) = 0;
 
+  // See ReadInMemory(). Only called when not at EOF. On success, the same
+  // rules as for ReadInternal() apply to the number of bytes returned. The
+  // default implementation returns false.
+  virtual bool ReadInMemoryInternal(size_t max_len,
+                                    base::span<const char>* data);
+
   // Resets state and cancels any pending callbacks. Guaranteed to be called
   // at least once before every call to InitInternal.
   virtual void ResetInternal() = 0;
@@ -18,4 +18,9 @@ bool UploadElementReader::IsInMemory() const {
   return false;
 }
 
+bool UploadElementReader::ReadInMemory(size_t max_length,
+                                       base::span<const char>* data) {
+  return false;
+}
+
 }  // namespace net
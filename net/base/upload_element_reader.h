@@ -5,8 +5,10 @@
 #ifndef NET_BASE_UPLOAD_ELEMENT_READER_H_
 #define NET_BASE_UPLOAD_ELEMENT_READER_H_
 
+#include <stddef.h>
 #include <stdint.h>
 
+#include "base/containers/span.h"
 #include "net/base/completion_once_callback.h"
 #include "net/base/net_export.h"
 
@@ -61,6 +63,14 @@ class NET_EXPORT UploadElementReader {
   virtual int Read(IOBuffer* buf,
                    int buf_length,
                    CompletionOnceCallback callback) = 0;
+
+  // Zero-copy alternative to Read(). If the element's data is already in
+  // memory, sets |data| to the next (up to) |max_length| bytes, advances the
+  // read position past them and returns true. |data| points into memory owned
+  // by the reader and remains valid until the reader is destroyed. Returns
+  // false without side effects if the caller must use Read() instead. The
+  // default implementation returns false.
+  virtual bool ReadInMemory(size_t max_length, base::span<const char>* data);
 };
 
 }  // namespace net
@@ -251,6 +251,155 @@ class HttpCache::WorkItem {
 
 //-----------------------------------------------------------------------------
 
+// Services a single ProbeEntries() request. Every key is opened directly on the
+// backend, its response info is read and parsed, and the entry is closed again
+// before the next step; keys owned by a transaction are reported as in use
+// without touching the backend.
+class HttpCache::ProbeBatch {
+ public:
+  ProbeBatch(HttpCache* cache,
+             std::vector<std::string> keys,
+             RequestPriority priority,
+             ProbeCallback callback)
+      : cache_(cache),
+        keys_(std::move(keys)),
+        priority_(priority),
+        callback_(std::move(callback)),
+        results_(keys_.size()),
+        slots_(keys_.size()),
+        remaining_(keys_.size()) {}
+  ~ProbeBatch() = default;
+
+  void Start() {
+    if (cache_->mode() == DISABLE || keys_.empty()) {
+      Finish();
+      return;
+    }
+    if (cache_->disk_cache_) {
+      ProbeAllKeys();
+      return;
+    }
+    int rv = cache_->CreateBackend(
+        nullptr, base::BindOnce(&ProbeBatch::OnBackendReady,
+                                weak_factory_.GetWeakPtr()));
+    if (rv != ERR_IO_PENDING)
+      OnBackendReady(rv);
+  }
+
+  ProbeCallback TakeCallback() { return std::move(callback_); }
+  std::vector<ProbeResult> TakeResults() { return std::move(results_); }
+
+ private:
+  // Per-key state kept while the entry is open.
+  struct Slot {
+    disk_cache::ScopedEntryPtr entry;
+    scoped_refptr<IOBuffer> buffer;
+  };
+
+  void OnBackendReady(int rv) {
+    if (rv != OK || !cache_->disk_cache_) {
+      Finish();
+      return;
+    }
+    ProbeAllKeys();
+  }
+
+  void ProbeAllKeys() {
+    for (size_t i = 0; i < keys_.size(); ++i)
+      ProbeKey(i);
+  }
+
+  void ProbeKey(size_t index) {
+    const std::string& key = keys_[index];
+    if (cache_->FindActiveEntry(key) || cache_->pending_ops_.count(key)) {
+      results_[index].status = ProbeResult::Status::kInUse;
+      FinishKey(index);
+      return;
+    }
+
+    disk_cache::EntryResult entry_result = cache_->disk_cache_->OpenEntry(
+        key, priority_,
+        base::BindOnce(&ProbeBatch::OnEntryOpened, weak_factory_.GetWeakPtr(),
+                       index));
+    if (entry_result.net_error() != ERR_IO_PENDING)
+      OnEntryOpened(index, std::move(entry_result));
+  }
+
+  void OnEntryOpened(size_t index, disk_cache::EntryResult result) {
+    if (result.net_error() != OK) {
+      FinishKey(index);
+      return;
+    }
+
+    Slot& slot = slots_[index];
+    slot.entry.reset(result.ReleaseEntry());
+    int size = slot.entry->GetDataSize(kResponseInfoIndex);
+    if (size <= 0) {
+      FinishKey(index);
+      return;
+    }
+
+    slot.buffer = base::MakeRefCounted<IOBuffer>(size);
+    int rv = slot.entry->ReadData(
+        kResponseInfoIndex, 0, slot.buffer.get(), size,
+        base::BindOnce(&ProbeBatch::OnResponseInfoRead,
+                       weak_factory_.GetWeakPtr(), index, size));
+    if (rv != ERR_IO_PENDING)
+      OnResponseInfoRead(index, size, rv);
+  }
+
+  void OnResponseInfoRead(size_t index, int expected_size, int rv) {
+    Slot& slot = slots_[index];
+    HttpResponseInfo response_info;
+    bool truncated = false;
+    if (rv == expected_size &&
+        ParseResponseInfo(slot.buffer->data(), rv, &response_info,
+                          &truncated) &&
+        response_info.headers) {
+      ProbeResult& result = results_[index];
+      result.status = ProbeResult::Status::kFound;
+      result.validation = response_info.headers->RequiresValidation(
+          response_info.request_time, response_info.response_time,
+          cache_->clock()->Now());
+      result.truncated = truncated;
+      result.request_time = response_info.request_time;
+      result.response_time = response_info.response_time;
+      result.body_size = slot.entry->GetDataSize(kResponseContentIndex);
+    }
+    FinishKey(index);
+  }
+
+  void FinishKey(size_t index) {
+    // Close the entry as soon as possible so that it does not block
+    // transactions that want to open it.
+    slots_[index] = Slot();
+    DCHECK_GT(remaining_, 0u);
+    if (--remaining_ == 0)
+      Finish();
+  }
+
+  void Finish() {
+    // Always complete asynchronously so that the caller never observes a
+    // reentrant callback, and so that |this| is not destroyed while one of its
+    // methods is still on the stack.
+    base::ThreadTaskRunnerHandle::Get()->PostTask(
+        FROM_HERE, base::BindOnce(&HttpCache::OnProbeBatchComplete,
+                                  cache_->GetWeakPtr(), this));
+  }
+
+  HttpCache* const cache_;
+  const std::vector<std::string> keys_;
+  const RequestPriority priority_;
+  ProbeCallback callback_;
+  std::vector<ProbeResult> results_;
+  std::vector<Slot> slots_;
+  size_t remaining_;
+
+  base::WeakPtrFactory<ProbeBatch> weak_factory_{this};
+};
+
+//-----------------------------------------------------------------------------
+
 HttpCache::HttpCache(HttpNetworkSession* session,
                      std::unique_ptr<BackendFactory> backend_factory,
                      bool is_main_cache)
@@ -311,6 +460,10 @@ HttpCache::~HttpCache() {
 
   doomed_entries_.clear();
 
+  // Probe batches hold open entries, which must be closed before the backend
+  // goes away.
+  probe_batches_.clear();
+
   // Before deleting pending_ops_, we have to make sure that the disk cache is
   // done with said operations, or it will attempt to use deleted data.
   disk_cache_.reset();
@@ -411,6 +564,19 @@ int HttpCache::CreateTransaction(
   return OK;
 }
 
+void HttpCache::ProbeEntries(std::vector<std::string> keys,
+                             RequestPriority priority,
+                             ProbeCallback callback) {
+  DCHECK_CALLED_ON_VALID_THREAD(thread_checker_);
+  DCHECK(!callback.is_null());
+
+  auto batch = std::make_unique<ProbeBatch>(this, std::move(keys), priority,
+                                            std::move(callback));
+  ProbeBatch* batch_ptr = batch.get();
+  probe_batches_[batch_ptr] = std::move(batch);
+  batch_ptr->Start();
+}
+
 HttpCache* HttpCache::GetCache() {
   return this;
 }
@@ -1527,4 +1693,17 @@ void HttpCache::OnBackendCreated(int result, PendingOp* pending_op) {
     item->NotifyTransaction(result, nullptr);
 }
 
+void HttpCache::OnProbeBatchComplete(ProbeBatch* batch) {
+  auto it = probe_batches_.find(batch);
+  DCHECK(it != probe_batches_.end());
+  std::unique_ptr<ProbeBatch> owned_batch = std::move(it->second);
+  probe_batches_.erase(it);
+
+  // The cache may be gone when we return from the callback.
+  ProbeCallback callback = owned_batch->TakeCallback();
+  std::vector<ProbeResult> results = owned_batch->TakeResults();
+  owned_batch.reset();
+  std::move(callback).Run(std::move(results));
+}
+
 }  // namespace net
@@ -19,12 +19,15 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "base/callback.h"
 #include "base/files/file_path.h"
 #include "base/macros.h"
 #include "base/memory/weak_ptr.h"
 #include "base/threading/thread_checker.h"
 #include "base/time/clock.h"
+#include "base/time/time.h"
 #include "build/build_config.h"
 #include "net/base/cache_type.h"
 #include "net/base/completion_once_callback.h"
@@ -32,6 +35,7 @@
 #include "net/base/net_export.h"
 #include "net/base/request_priority.h"
 #include "net/http/http_network_session.h"
+#include "net/http/http_response_headers.h"
 #include "net/http/http_transaction_factory.h"
 
 class GURL;
@@ -159,6 +163,39 @@ class NET_EXPORT HttpCache : public HttpTransactionFactory {
     PARALLEL_WRITING_MAX
   };
 
+  // The outcome of probing a single cache key with ProbeEntries().
+  struct NET_EXPORT ProbeResult {
+    enum class Status {
+      // There is no usable entry for the key.
+      kNotFound,
+      // The entry is currently being opened, created or used by a transaction,
+      // so its response info was not read.
+      kInUse,
+      // A response is stored for the key; the fields below are valid.
+      kFound,
+    };
+
+    Status status = Status::kNotFound;
+
+    // Whether the stored response may be used without revalidation at the time
+    // of the probe. Vary is not taken into account since no request headers
+    // are available.
+    ValidationType validation = VALIDATION_NONE;
+
+    // True if the stored response body is incomplete.
+    bool truncated = false;
+
+    // Times recorded in the stored HttpResponseInfo.
+    base::Time request_time;
+    base::Time response_time;
+
+    // Size of the stored response body, in bytes.
+    int32_t body_size = 0;
+  };
+
+  using ProbeCallback =
+      base::OnceCallback<void(std::vector<ProbeResult> results)>;
+
   // The number of minutes after a resource is prefetched that it can be used
   // again without validation.
   static const int kPrefetchReuseMins = 5;
@@ -244,6 +281,21 @@ class NET_EXPORT HttpCache : public HttpTransactionFactory {
     fail_conditionalization_for_test_ = true;
   }
 
+  // Looks up every key in |keys| (as returned by GenerateCacheKey()) and reports
+  // whether a response is stored for it and whether that response is still
+  // fresh. |callback| receives one ProbeResult per key, in the same order, and
+  // is never invoked synchronously. Unlike issuing a LOAD_ONLY_FROM_CACHE
+  // transaction per key, all keys are opened in a single pass over the backend,
+  // each entry is held only for as long as it takes to read its response info,
+  // and no transaction or ActiveEntry is created. If the HttpCache is destroyed
+  // first, |callback| is never invoked.
+  void ProbeEntries(std::vector<std::string> keys,
+                    RequestPriority priority,
+                    ProbeCallback callback);
+
+  // Generates the cache key for this request.
+  static std::string GenerateCacheKey(const HttpRequestInfo*);
+
   // HttpTransactionFactory implementation:
   int CreateTransaction(RequestPriority priority,
                         std::unique_ptr<HttpTransaction>* transaction) override;
@@ -305,6 +357,7 @@ class NET_EXPORT HttpCache : public HttpTransactionFactory {
     kNumCacheEntryDataIndices
   };
 
+  class ProbeBatch;
   class QuicServerInfoFactoryAdaptor;
   class Transaction;
   class WorkItem;
@@ -402,6 +455,7 @@ class NET_EXPORT HttpCache : public HttpTransactionFactory {
       std::unordered_map<std::string, std::unique_ptr<ActiveEntry>>;
   using PendingOpsMap = std::unordered_map<std::string, PendingOp*>;
   using ActiveEntriesSet = std::map<ActiveEntry*, std::unique_ptr<ActiveEntry>>;
+  using ProbeBatchesSet = std::map<ProbeBatch*, std::unique_ptr<ProbeBatch>>;
 
   // Methods ------------------------------------------------------------------
 
@@ -424,9 +478,6 @@ class NET_EXPORT HttpCache : public HttpTransactionFactory {
   // time after receiving the notification.
   int GetBackendForTransaction(Transaction* transaction);
 
-  // Generates the cache key for this request.
-  static std::string GenerateCacheKey(const HttpRequestInfo*);
-
   // Dooms the entry selected by |key|, if it is currently in the list of active
   // entries.
   void DoomActiveEntry(const std::string& key);
@@ -640,6 +691,10 @@ class NET_EXPORT HttpCache : public HttpTransactionFactory {
   // Processes the backend creation notification.
   void OnBackendCreated(int result, PendingOp* pending_op);
 
+  // Invoked (via PostTask) once every key of |batch| has been probed. Destroys
+  // |batch| and runs its callback.
+  void OnProbeBatchComplete(ProbeBatch* batch);
+
   // Constants ----------------------------------------------------------------
 
   // Used when generating and accessing keys if cache is split.
@@ -673,6 +728,9 @@ class NET_EXPORT HttpCache : public HttpTransactionFactory {
   // The set of entries "under construction".
   PendingOpsMap pending_ops_;
 
+  // The set of ProbeEntries() requests in flight.
+  ProbeBatchesSet probe_batches_;
+
   // A clock that can be swapped out for testing.
   base::Clock* clock_;
 
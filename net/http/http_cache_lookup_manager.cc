@@ -5,11 +5,15 @@
 #include "net/http/http_cache_lookup_manager.h"
 
 #include <memory>
+#include <utility>
 
 #include "base/bind.h"
 #include "base/containers/contains.h"
+#include "base/location.h"
+#include "base/threading/thread_task_runner_handle.h"
 #include "base/values.h"
 #include "net/base/load_flags.h"
+#include "net/base/net_errors.h"
 
 namespace net {
 
@@ -36,9 +40,7 @@ HttpCacheLookupManager::LookupTransaction::LookupTransaction(
 
 HttpCacheLookupManager::LookupTransaction::~LookupTransaction() = default;
 
-int HttpCacheLookupManager::LookupTransaction::StartLookup(
-    HttpCache* cache,
-    CompletionOnceCallback callback,
+std::string HttpCacheLookupManager::LookupTransaction::StartLookup(
     const NetLogWithSource& session_net_log) {
   net_log_.BeginEvent(NetLogEventType::SERVER_PUSH_LOOKUP_TRANSACTION, [&] {
     return NetLogPushLookupTransactionParams(session_net_log.source(),
@@ -49,10 +51,30 @@ int HttpCacheLookupManager::LookupTransaction::StartLookup(
   request_->network_isolation_key = push_helper_->GetNetworkIsolationKey();
   request_->method = "GET";
   request_->load_flags = LOAD_ONLY_FROM_CACHE | LOAD_SKIP_CACHE_VALIDATION;
+  return HttpCache::GenerateCacheKey(request_.get());
+}
+
+int HttpCacheLookupManager::LookupTransaction::StartTransaction(
+    HttpCache* cache,
+    CompletionOnceCallback callback) {
   cache->CreateTransaction(DEFAULT_PRIORITY, &transaction_);
   return transaction_->Start(request_.get(), std::move(callback), net_log_);
 }
 
+void HttpCacheLookupManager::LookupTransaction::OnLookupComplete(
+    const HttpCache::ProbeResult& result) {
+  // Like the LOAD_SKIP_CACHE_VALIDATION lookup this replaces, any stored
+  // response counts as a hit regardless of its freshness.
+  bool found = result.status == HttpCache::ProbeResult::Status::kFound;
+  if (found) {
+    DCHECK(push_helper_.get());
+    push_helper_->Cancel();
+  }
+  net_log_.EndEventWithNetErrorCode(
+      NetLogEventType::SERVER_PUSH_LOOKUP_TRANSACTION,
+      found ? OK : ERR_CACHE_MISS);
+}
+
 void HttpCacheLookupManager::LookupTransaction::OnLookupComplete(int result) {
   if (result == OK) {
     DCHECK(push_helper_.get());
@@ -81,16 +103,56 @@ void HttpCacheLookupManager::OnPush(
   // TODO(zhongyi): add events in session net log to log the creation of
   // LookupTransaction.
 
-  int rv = lookup->StartLookup(
-      http_cache_,
-      base::BindOnce(&HttpCacheLookupManager::OnLookupComplete,
-                     weak_factory_.GetWeakPtr(), pushed_url),
-      session_net_log);
+  // Batch up all pushes received in this task into a single cache probe.
+  if (queued_urls_.empty()) {
+    base::ThreadTaskRunnerHandle::Get()->PostTask(
+        FROM_HERE, base::BindOnce(&HttpCacheLookupManager::ProbeQueuedLookups,
+                                  weak_factory_.GetWeakPtr()));
+  }
+  queued_urls_.push_back(pushed_url);
+  queued_keys_.push_back(lookup->StartLookup(session_net_log));
+  lookup_transactions_[pushed_url] = std::move(lookup);
+}
+
+void HttpCacheLookupManager::ProbeQueuedLookups() {
+  DCHECK(!queued_urls_.empty());
+  DCHECK_EQ(queued_urls_.size(), queued_keys_.size());
+
+  std::vector<GURL> urls;
+  urls.swap(queued_urls_);
+  std::vector<std::string> keys;
+  keys.swap(queued_keys_);
+
+  http_cache_->ProbeEntries(
+      std::move(keys), DEFAULT_PRIORITY,
+      base::BindOnce(&HttpCacheLookupManager::OnProbeComplete,
+                     weak_factory_.GetWeakPtr(), std::move(urls)));
+}
 
-  if (rv == ERR_IO_PENDING) {
-    lookup_transactions_[pushed_url] = std::move(lookup);
-  } else {
-    lookup->OnLookupComplete(rv);
+void HttpCacheLookupManager::OnProbeComplete(
+    std::vector<GURL> urls,
+    std::vector<HttpCache::ProbeResult> results) {
+  DCHECK_EQ(urls.size(), results.size());
+
+  for (size_t i = 0; i < urls.size(); ++i) {
+    auto it = lookup_transactions_.find(urls[i]);
+    DCHECK(it != lookup_transactions_.end());
+
+    // The entry is being written or validated by another transaction. Wait
+    // for it, as a cache transaction would, rather than treating it as a miss.
+    if (results[i].status == HttpCache::ProbeResult::Status::kInUse) {
+      int rv = it->second->StartTransaction(
+          http_cache_,
+          base::BindOnce(&HttpCacheLookupManager::OnLookupComplete,
+                         weak_factory_.GetWeakPtr(), urls[i]));
+      if (rv == ERR_IO_PENDING)
+        continue;
+      it->second->OnLookupComplete(rv);
+    } else {
+      it->second->OnLookupComplete(results[i]);
+    }
+
+    lookup_transactions_.erase(it);
   }
 }
 
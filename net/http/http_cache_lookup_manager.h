@@ -5,16 +5,28 @@
 #ifndef NET_HTTP_HTTP_CACHE_LOOKUP_MANAGER_H_
 #define NET_HTTP_HTTP_CACHE_LOOKUP_MANAGER_H_
 
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "net/base/completion_once_callback.h"
 #include "net/base/net_export.h"
 #include "net/http/http_cache.h"
-#include "net/http/http_cache_transaction.h"
+#include "net/http/http_request_info.h"
+#include "net/http/http_transaction.h"
+#include "net/log/net_log_with_source.h"
 #include "net/spdy/server_push_delegate.h"
+#include "url/gurl.h"
 
 namespace net {
 
-// An implementation of ServerPushDelegate that issues an HttpCache::Transaction
-// to lookup whether the response to the pushed URL is cached and cancel the
-// push in that case.
+// An implementation of ServerPushDelegate that probes the HttpCache to lookup
+// whether the response to the pushed URL is cached and cancel the push in that
+// case. Pushes received within the same task are probed together with a
+// single HttpCache::ProbeEntries() call. Pushes whose cache entry is in use
+// are looked up with an HttpCache::Transaction instead, which waits for the
+// entry to be released.
 class NET_EXPORT_PRIVATE HttpCacheLookupManager : public ServerPushDelegate {
  public:
   // |http_cache| MUST outlive the HttpCacheLookupManager.
@@ -25,26 +37,28 @@ class NET_EXPORT_PRIVATE HttpCacheLookupManager : public ServerPushDelegate {
   void OnPush(std::unique_ptr<ServerPushHelper> push_helper,
               const NetLogWithSource& session_net_log) override;
 
-  // Invoked when the HttpCache::Transaction for |url| finishes to cancel the
-  // server push if the response to the server push is found cached.
+  // Invoked when the HttpCache::Transaction looking up |url| finishes.
   void OnLookupComplete(const GURL& url, int rv);
 
  private:
-  // A class that takes the ownership of ServerPushHelper, issues and owns an
-  // HttpCache::Transaction which lookups the response in cache for the server
-  // push.
+  // A class that takes the ownership of ServerPushHelper while the response
+  // to the pushed URL is looked up in the cache, and owns the
+  // HttpCache::Transaction doing so, if any.
   class LookupTransaction {
    public:
     LookupTransaction(std::unique_ptr<ServerPushHelper> push_helper,
                       NetLog* net_log);
     ~LookupTransaction();
 
+    // Logs the start of the lookup and returns the cache key to probe.
+    std::string StartLookup(const NetLogWithSource& session_net_log);
+
     // Issues an HttpCache::Transaction to lookup whether the response is cached
-    // without header validation.
-    int StartLookup(HttpCache* cache,
-                    CompletionOnceCallback callback,
-                    const NetLogWithSource& session_net_log);
+    // without header validation, for when the entry was in use when probed.
+    int StartTransaction(HttpCache* cache, CompletionOnceCallback callback);
 
+    // Cancels the server push if the response was found cached.
+    void OnLookupComplete(const HttpCache::ProbeResult& result);
     void OnLookupComplete(int result);
 
    private:
@@ -54,9 +68,23 @@ class NET_EXPORT_PRIVATE HttpCacheLookupManager : public ServerPushDelegate {
     const NetLogWithSource net_log_;
   };
 
+  // Probes the cache for every URL in |queued_urls_|.
+  void ProbeQueuedLookups();
+
+  // Invoked when the HttpCache finishes probing |urls|; |results| holds one
+  // entry per URL.
+  void OnProbeComplete(std::vector<GURL> urls,
+                       std::vector<HttpCache::ProbeResult> results);
+
   // HttpCache must outlive the HttpCacheLookupManager.
   HttpCache* http_cache_;
   std::map<GURL, std::unique_ptr<LookupTransaction>> lookup_transactions_;
+
+  // Pushed URLs whose lookups have been started but not yet sent to the cache,
+  // together with their cache keys.
+  std::vector<GURL> queued_urls_;
+  std::vector<std::string> queued_keys_;
+
   base::WeakPtrFactory<HttpCacheLookupManager> weak_factory_{this};
 };
 
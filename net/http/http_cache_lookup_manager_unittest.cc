@@ -273,6 +273,48 @@ TEST(HttpCacheLookupManagerTest, ServerPushPendingLookup) {
   RemoveMockTransaction(mock_trans.get());
 }
 
+// Test that a server push whose cache entry is in use when probed waits for
+// the transaction using it, and is canceled once the response is cached.
+TEST(HttpCacheLookupManagerTest, ServerPushWaitsForEntryInUse) {
+  base::test::TaskEnvironment task_environment;
+  MockHttpCache mock_cache;
+  HttpCacheLookupManager push_delegate(mock_cache.http_cache());
+  GURL request_url("http://www.example.com/pushed.jpg");
+
+  std::unique_ptr<MockTransaction> mock_trans =
+      CreateMockTransaction(request_url);
+  AddMockTransaction(mock_trans.get());
+
+  // Start writing the cache entry, and keep it in use.
+  MockHttpRequest request(*(mock_trans.get()));
+  std::unique_ptr<HttpTransaction> trans;
+  ASSERT_THAT(mock_cache.CreateTransaction(&trans), IsOk());
+  TestCompletionCallback callback;
+  int rv = trans->Start(&request, callback.callback(), NetLogWithSource());
+  ASSERT_THAT(callback.GetResult(rv), IsOk());
+
+  std::unique_ptr<MockServerPushHelper> push_helper =
+      std::make_unique<MockServerPushHelper>(request_url);
+  MockServerPushHelper* push_helper_ptr = push_helper.get();
+
+  // Receive a server push and should cancel the push once the entry is
+  // written.
+  EXPECT_CALL(*push_helper_ptr, Cancel()).Times(1);
+  push_delegate.OnPush(std::move(push_helper), NetLogWithSource());
+  base::RunLoop().RunUntilIdle();
+
+  std::string content;
+  EXPECT_THAT(ReadTransaction(trans.get(), &content), IsOk());
+  trans.reset();
+  base::RunLoop().RunUntilIdle();
+
+  // Make sure no new net layer transaction is created.
+  EXPECT_EQ(1, mock_cache.network_layer()->transaction_count());
+  EXPECT_EQ(1, mock_cache.disk_cache()->create_count());
+
+  RemoveMockTransaction(mock_trans.get());
+}
+
 // Test the server push lookup is based on the full url.
 TEST(HttpCacheLookupManagerTest, ServerPushLookupOnUrl) {
   base::test::TaskEnvironment task_environment;
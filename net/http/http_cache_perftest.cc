@@ -0,0 +1,121 @@
+// Copyright 2021 The Chromium Authors. All rights reserved.
+// Use of this source code is governed by a BSD-style license that can be
+// found in the LICENSE file.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base/bind.h"
+#include "base/run_loop.h"
+#include "base/strings/stringprintf.h"
+#include "base/test/bind.h"
+#include "base/test/task_environment.h"
+#include "base/timer/elapsed_timer.h"
+#include "net/base/load_flags.h"
+#include "net/base/net_errors.h"
+#include "net/base/test_completion_callback.h"
+#include "net/http/http_cache.h"
+#include "net/http/http_transaction.h"
+#include "net/http/http_transaction_test_util.h"
+#include "net/http/mock_http_cache.h"
+#include "net/log/net_log_with_source.h"
+#include "testing/gtest/include/gtest/gtest.h"
+#include "testing/perf/perf_result_reporter.h"
+
+namespace net {
+namespace {
+
+const size_t kNumEntries = 1000;
+
+// Owns the URL strings referenced by the mock transactions.
+class PopulatedCache {
+ public:
+  PopulatedCache() {
+    urls_.reserve(kNumEntries);
+    transactions_.reserve(kNumEntries);
+    for (size_t i = 0; i < kNumEntries; ++i) {
+      urls_.push_back(
+          base::StringPrintf("http://www.example.com/resource/%zu.js", i));
+      auto transaction =
+          std::make_unique<ScopedMockTransaction>(kSimpleGET_Transaction);
+      transaction->url = urls_.back().c_str();
+      transactions_.push_back(std::move(transaction));
+    }
+    for (const auto& transaction : transactions_)
+      Fetch(*transaction, LOAD_NORMAL);
+  }
+
+  // Runs a transaction for |mock| to completion and returns its result.
+  int Fetch(const MockTransaction& mock, int load_flags) {
+    MockHttpRequest request(mock);
+    request.load_flags = load_flags;
+    std::unique_ptr<HttpTransaction> trans;
+    CHECK_EQ(OK, cache_.CreateTransaction(&trans));
+    TestCompletionCallback callback;
+    int rv = trans->Start(&request, callback.callback(), NetLogWithSource());
+    return callback.GetResult(rv);
+  }
+
+  std::vector<std::string> Keys() {
+    std::vector<std::string> keys;
+    for (const auto& transaction : transactions_)
+      keys.push_back(MockHttpRequest(*transaction).CacheKey());
+    return keys;
+  }
+
+  MockHttpCache& cache() { return cache_; }
+  const std::vector<std::unique_ptr<ScopedMockTransaction>>& transactions() {
+    return transactions_;
+  }
+
+ private:
+  MockHttpCache cache_;
+  std::vector<std::string> urls_;
+  std::vector<std::unique_ptr<ScopedMockTransaction>> transactions_;
+};
+
+void ReportResult(const std::string& story, base::TimeDelta elapsed) {
+  perf_test::PerfResultReporter reporter("HttpCacheProbe.", story);
+  reporter.RegisterImportantMetric("time_per_key", "us");
+  reporter.AddResult("time_per_key",
+                     elapsed.InMicrosecondsF() / kNumEntries);
+}
+
+TEST(HttpCachePerfTest, ProbeWithTransactions) {
+  base::test::TaskEnvironment task_environment;
+  PopulatedCache populated;
+
+  base::ElapsedTimer timer;
+  for (const auto& transaction : populated.transactions()) {
+    EXPECT_EQ(OK, populated.Fetch(*transaction, LOAD_ONLY_FROM_CACHE |
+                                                    LOAD_SKIP_CACHE_VALIDATION));
+  }
+  ReportResult("Transactions", timer.Elapsed());
+}
+
+TEST(HttpCachePerfTest, ProbeWithProbeEntries) {
+  base::test::TaskEnvironment task_environment;
+  PopulatedCache populated;
+  std::vector<std::string> keys = populated.Keys();
+
+  base::ElapsedTimer timer;
+  size_t found = 0;
+  base::RunLoop run_loop;
+  populated.cache().http_cache()->ProbeEntries(
+      std::move(keys), DEFAULT_PRIORITY,
+      base::BindLambdaForTesting(
+          [&](std::vector<HttpCache::ProbeResult> results) {
+            for (const auto& result : results) {
+              if (result.status == HttpCache::ProbeResult::Status::kFound)
+                ++found;
+            }
+            run_loop.Quit();
+          }));
+  run_loop.Run();
+  ReportResult("ProbeEntries", timer.Elapsed());
+  EXPECT_EQ(kNumEntries, found);
+}
+
+}  // namespace
+}  // namespace net
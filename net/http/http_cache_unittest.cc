@@ -23,6 +23,7 @@
 #include "base/strings/string_number_conversions.h"
 #include "base/strings/string_util.h"
 #include "base/strings/stringprintf.h"
+#include "base/test/bind.h"
 #include "base/test/metrics/histogram_tester.h"
 #include "base/test/scoped_feature_list.h"
 #include "base/test/simple_test_clock.h"
@@ -13091,4 +13092,100 @@ TEST_F(HttpCacheTest, DnsAliasesRevalidation) {
   EXPECT_THAT(response.dns_aliases, testing::ElementsAre("alias3", "alias4"));
 }
 
+namespace {
+
+std::vector<HttpCache::ProbeResult> ProbeEntriesAndWait(
+    HttpCache* cache,
+    std::vector<std::string> keys) {
+  std::vector<HttpCache::ProbeResult> results;
+  base::RunLoop run_loop;
+  cache->ProbeEntries(
+      std::move(keys), DEFAULT_PRIORITY,
+      base::BindLambdaForTesting(
+          [&](std::vector<HttpCache::ProbeResult> probe_results) {
+            results = std::move(probe_results);
+            run_loop.Quit();
+          }));
+  run_loop.Run();
+  return results;
+}
+
+}  // namespace
+
+TEST_F(HttpCacheTest, ProbeEntries) {
+  MockHttpCache cache;
+
+  // A fresh response and one that requires validation.
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  RunTransactionTest(cache.http_cache(), kTypicalGET_Transaction);
+  EXPECT_EQ(2, cache.network_layer()->transaction_count());
+  EXPECT_EQ(2, cache.disk_cache()->create_count());
+
+  MockHttpRequest fresh_request(kSimpleGET_Transaction);
+  MockHttpRequest stale_request(kTypicalGET_Transaction);
+  MockHttpRequest missing_request(kETagGET_Transaction);
+  std::vector<HttpCache::ProbeResult> results = ProbeEntriesAndWait(
+      cache.http_cache(), {fresh_request.CacheKey(), missing_request.CacheKey(),
+                           stale_request.CacheKey()});
+  ASSERT_EQ(3u, results.size());
+
+  EXPECT_EQ(HttpCache::ProbeResult::Status::kFound, results[0].status);
+  EXPECT_EQ(VALIDATION_NONE, results[0].validation);
+  EXPECT_FALSE(results[0].truncated);
+  EXPECT_EQ(static_cast<int32_t>(strlen(kSimpleGET_Transaction.data)),
+            results[0].body_size);
+
+  EXPECT_EQ(HttpCache::ProbeResult::Status::kNotFound, results[1].status);
+
+  EXPECT_EQ(HttpCache::ProbeResult::Status::kFound, results[2].status);
+  EXPECT_EQ(VALIDATION_SYNCHRONOUS, results[2].validation);
+
+  // Probing neither creates transactions nor entries.
+  EXPECT_EQ(2, cache.network_layer()->transaction_count());
+  EXPECT_EQ(2, cache.disk_cache()->open_count());
+  EXPECT_EQ(2, cache.disk_cache()->create_count());
+
+  // The probed entries are closed again and can be used normally.
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  EXPECT_EQ(2, cache.network_layer()->transaction_count());
+}
+
+TEST_F(HttpCacheTest, ProbeEntries_Empty) {
+  MockHttpCache cache;
+  EXPECT_TRUE(ProbeEntriesAndWait(cache.http_cache(), {}).empty());
+}
+
+TEST_F(HttpCacheTest, ProbeEntries_InUse) {
+  MockHttpCache cache;
+  // Create the backend.
+  RunTransactionTest(cache.http_cache(), kTypicalGET_Transaction);
+
+  MockHttpRequest request(kSimpleGET_Transaction);
+  std::unique_ptr<HttpTransaction> trans;
+  ASSERT_THAT(cache.CreateTransaction(&trans), IsOk());
+  TestCompletionCallback callback;
+  ASSERT_THAT(trans->Start(&request, callback.callback(), NetLogWithSource()),
+              IsError(ERR_IO_PENDING));
+
+  std::vector<HttpCache::ProbeResult> results =
+      ProbeEntriesAndWait(cache.http_cache(), {request.CacheKey()});
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(HttpCache::ProbeResult::Status::kInUse, results[0].status);
+
+  EXPECT_THAT(callback.WaitForResult(), IsOk());
+}
+
+TEST_F(HttpCacheTest, ProbeEntries_Disabled) {
+  MockHttpCache cache;
+  RunTransactionTest(cache.http_cache(), kSimpleGET_Transaction);
+  cache.http_cache()->set_mode(HttpCache::DISABLE);
+
+  MockHttpRequest request(kSimpleGET_Transaction);
+  std::vector<HttpCache::ProbeResult> results =
+      ProbeEntriesAndWait(cache.http_cache(), {request.CacheKey()});
+  ASSERT_EQ(1u, results.size());
+  EXPECT_EQ(HttpCache::ProbeResult::Status::kNotFound, results[0].status);
+  EXPECT_EQ(0, cache.disk_cache()->open_count());
+}
+
 }  // namespace net